@@ -0,0 +1,335 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <semaphore.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkActor.h"
+#include "vtkActorCollection.h"
+#include "vtkMutexLock.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataMapper.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoBench.h"
+#include "PlatoProfiler.h"
+#include "PlatoTrajectoryReader.h"
+#include "PlatoVTKPipeline.h"
+
+// the program-wide definitions main.cpp would otherwise give us. There's
+// no window or steering in a benchmark so they're never really used...
+volatile bool reRender = false;
+volatile bool regLoopDone = false;
+vtkMutexLock* renderLock = NULL;
+vtkMutexLock* loopLock = NULL;
+sem_t regDone;
+sem_t regWake;
+
+void renderCallback(vtkObject* obj, unsigned long eid, void* cd, void* calld) {
+}
+
+double getTimeMillis() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  return (now.tv_sec * 1000.0) + (now.tv_usec / 1000.0);
+}
+
+// the synthetic density is a gaussian on each of a few atoms, this wide
+// as a fraction of the cell...
+#define PVS_BENCH_ATOMS 4
+#define PVS_BENCH_SIGMA 0.08
+
+static const char* rhoDataSets[] = {"atom.rho", "dimer.rho", "8structured.rho"};
+
+PlatoBench::PlatoBench(const char* name, int argc, char** argv) {
+  char* sizeList = (char*) PVS_BENCH_SIZES;
+  int opt;
+
+  benchName = name;
+  dataDir = "data";
+  scratchDir = "/tmp";
+  generator = PVS_BENCH_GENERATOR;
+  results = stdout;
+  repeats = PVS_BENCH_REPEATS;
+  numSizes = 0;
+
+  while((opt = getopt(argc, argv, "d:g:ho:r:s:w:")) != -1) {
+    switch(opt) {
+    case 'd':
+      dataDir = optarg;
+      break;
+    case 'g':
+      generator = optarg;
+      break;
+    case 'h':
+      usage();
+      exit(0);
+    case 'o':
+      results = fopen(optarg, "a");
+      if(!results) {
+	std::cerr << "Could not open results file: " << optarg << std::endl;
+	exit(1);
+      }
+      break;
+    case 'r':
+      repeats = atoi(optarg);
+      if(repeats < 1) {
+	std::cerr << "Bad number of repeats: " << optarg << "\n\n";
+	usage();
+	exit(1);
+      }
+      break;
+    case 's':
+      sizeList = optarg;
+      break;
+    case 'w':
+      scratchDir = optarg;
+      break;
+    default:
+      usage();
+      exit(1);
+    }
+  }
+  parseSizes(sizeList);
+
+  times = new double[repeats];
+  numTimes = 0;
+  runStart = 0.0;
+  items = 0;
+  caseName[0] = '\0';
+  inputName[0] = '\0';
+}
+
+PlatoBench::~PlatoBench() {
+  if(results != stdout)
+    fclose(results);
+  delete[] times;
+}
+
+void PlatoBench::usage() {
+  using std::cout;
+
+  cout << "Usage: " << benchName << " [options]\nOptions:\n";
+  cout << "  -d DIR\tRead the shipped data sets from DIR (default data).\n";
+  cout << "  -g GEN\tMake the synthetic grids with GEN (default ";
+  cout << PVS_BENCH_GENERATOR << ").\n";
+  cout << "  -h\t\tPrint this message and exit.\n";
+  cout << "  -o FILE\tAppend the results to FILE instead of printing them.\n";
+  cout << "  -r N\t\tTime each case N times (default " << PVS_BENCH_REPEATS;
+  cout << ").\n";
+  cout << "  -s LIST\tThe edges of the synthetic grids, comma separated, or";
+  cout << "\n\t\t\"none\" (default " << PVS_BENCH_SIZES << ").\n";
+  cout << "  -w DIR\tWrite the synthetic rho files to DIR (default /tmp).\n";
+}
+
+void PlatoBench::parseSizes(char* list) {
+  char* p = list;
+
+  if(strcmp(list, "none") == 0)
+    return;
+
+  while(*p != '\0' && numSizes < PVS_BENCH_MAX_SIZES) {
+    int size = strtol(p, &p, 10);
+    if(size < 2) {
+      std::cerr << "Bad synthetic grid size in: " << list << "\n\n";
+      usage();
+      exit(1);
+    }
+    sizes[numSizes++] = size;
+    if(*p == ',')
+      p++;
+  }
+}
+
+int PlatoBench::getRepeats() {
+  return repeats;
+}
+
+int PlatoBench::getNumberOfSizes() {
+  return numSizes;
+}
+
+int PlatoBench::getSize(int i) {
+  return sizes[i];
+}
+
+void PlatoBench::getDataPath(const char* name, char* path) {
+  snprintf(path, PVS_BENCH_PATH, "%s/%s", dataDir, name);
+}
+
+void PlatoBench::getSyntheticName(int size, char* name) {
+  snprintf(name, PVS_BENCH_NAME, "synthetic-%d", size);
+}
+
+void PlatoBench::getSyntheticRho(int size, char* path) {
+  struct stat info;
+
+  // the files are kept between runs, the big ones take a while...
+  snprintf(path, PVS_BENCH_PATH, "%s/pvs-bench-%d.rho", scratchDir, size);
+  if(stat(path, &info) == 0)
+    return;
+
+  // a cubic cell about 0.2 bohr (0.1 angstroms) per grid point, like the
+  // shipped data. pvs-gen writes NAME.rho and NAME.xyz, the rho file is
+  // moved into place when it's finished...
+  double edge = size * 0.2 * 0.529177;
+  char* tmpName = new char[PVS_BENCH_PATH];
+  char* tmpPath = new char[PVS_BENCH_PATH + 4];
+  char* command = new char[(3 * PVS_BENCH_PATH) + 128];
+  snprintf(tmpName, PVS_BENCH_PATH, "%s/pvs-bench-%d.tmp", scratchDir, size);
+  snprintf(tmpPath, PVS_BENCH_PATH + 4, "%s.rho", tmpName);
+  snprintf(command, (3 * PVS_BENCH_PATH) + 128,
+	   "'%s' -a %d -c %.4f -g %d -w %.4f '%s' > /dev/null", generator,
+	   PVS_BENCH_ATOMS, edge, size, PVS_BENCH_SIGMA * edge, tmpName);
+
+  std::cout << "Writing " << path << "..." << std::endl;
+  if(system(command) != 0 || rename(tmpPath, path) != 0) {
+    std::cerr << "Could not make synthetic grid " << path << " with ";
+    std::cerr << generator << std::endl;
+    exit(1);
+  }
+  snprintf(tmpPath, PVS_BENCH_PATH + 4, "%s.xyz", tmpName);
+  unlink(tmpPath);
+
+  delete[] tmpName;
+  delete[] tmpPath;
+  delete[] command;
+}
+
+void PlatoBench::runRhoInputs(PlatoBenchInput input) {
+  // the shipped data sets, then a synthetic grid of each size...
+  char path[PVS_BENCH_PATH];
+  char name[PVS_BENCH_NAME];
+
+  for(int i = 0; i < 3; i++) {
+    getDataPath(rhoDataSets[i], path);
+    input(this, path, rhoDataSets[i]);
+  }
+  for(int i = 0; i < numSizes; i++) {
+    getSyntheticRho(sizes[i], path);
+    getSyntheticName(sizes[i], name);
+    input(this, path, name);
+  }
+}
+
+void PlatoBench::fillLattice(int side, PlatoXYZFrame* frame) {
+  // a simple cubic lattice of carbon, close enough to bond to its six
+  // neighbours...
+  int numAtoms = side * side * side;
+  frame->resize(numAtoms);
+  frame->numAtoms = numAtoms;
+  frame->frameNumber = 0;
+
+  int n = 0;
+  for(int k = 0; k < side; k++) {
+    for(int j = 0; j < side; j++) {
+      for(int i = 0; i < side; i++, n++) {
+	frame->coords[(3 * n)] = i * 1.4f;
+	frame->coords[(3 * n) + 1] = j * 1.4f;
+	frame->coords[(3 * n) + 2] = k * 1.4f;
+	frame->atomTypes[n] = 5;
+      }
+    }
+  }
+}
+
+void PlatoBench::begin(const char* name, const char* input) {
+  strncpy(caseName, name, PVS_BENCH_NAME - 1);
+  caseName[PVS_BENCH_NAME - 1] = '\0';
+  strncpy(inputName, input, PVS_BENCH_NAME - 1);
+  inputName[PVS_BENCH_NAME - 1] = '\0';
+  numTimes = 0;
+  items = 0;
+}
+
+void PlatoBench::startRun() {
+  runStart = getTimeMillis();
+}
+
+void PlatoBench::stopRun(long count) {
+  if(numTimes < repeats)
+    times[numTimes++] = getTimeMillis() - runStart;
+  items = count;
+}
+
+void PlatoBench::end() {
+  if(numTimes == 0)
+    return;
+
+  double* sorted = new double[numTimes];
+  std::copy(times, times + numTimes, sorted);
+  std::sort(sorted, sorted + numTimes);
+  double total = 0.0;
+  for(int i = 0; i < numTimes; i++)
+    total += sorted[i];
+  double median = sorted[numTimes / 2];
+
+  fprintf(results, "{\"key\":\"%s/%s/%s\",\"bench\":\"%s\",\"case\":\"%s\",",
+	  benchName, caseName, inputName, benchName, caseName);
+  fprintf(results, "\"input\":\"%s\",\"repeats\":%d,\"min_ms\":%.3f,",
+	  inputName, numTimes, sorted[0]);
+  fprintf(results, "\"median_ms\":%.3f,\"mean_ms\":%.3f,\"max_ms\":%.3f,",
+	  median, total / numTimes, sorted[numTimes - 1]);
+  fprintf(results, "\"items\":%ld,\"rss_kb\":%ld}\n", items,
+	  PlatoProfiler::getResident());
+  fflush(results);
+
+  if(results != stdout) {
+    std::cout << benchName << " " << caseName << " " << inputName;
+    std::cout << ": median " << median << " ms (min " << sorted[0];
+    std::cout << ", max " << sorted[numTimes - 1] << ") for " << items;
+    std::cout << " items\n";
+  }
+
+  delete[] sorted;
+}
+
+long PlatoBench::updatePipeline(PlatoVTKPipeline* pipeline) {
+  // update it the way a render would, through the mapper of its first
+  // actor...
+  vtkActor* actor = (vtkActor*) pipeline->getActors()->GetItemAsObject(0);
+  vtkPolyDataMapper* mapper =
+    vtkPolyDataMapper::SafeDownCast(actor->GetMapper());
+  mapper->Update();
+
+  return (long) mapper->GetInput()->GetNumberOfPolys();
+}
@@ -0,0 +1,105 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOBENCH_H__
+
+// macro definitions...
+#define PVS_BENCH_PATH 1024
+#define PVS_BENCH_NAME 128
+#define PVS_BENCH_MAX_SIZES 16
+#define PVS_BENCH_REPEATS 5
+#define PVS_BENCH_SIZES "32,64,128,256,512"
+#define PVS_BENCH_GENERATOR "./pvs-gen"
+
+// system includes...
+#include <cstdio>
+
+// vtk forward references...
+class vtkPolyData;
+
+// plato forward references...
+class PlatoBench;
+class PlatoVTKPipeline;
+class PlatoXYZFrame;
+
+// called with the path and name of each rho input in turn...
+typedef void (*PlatoBenchInput)(PlatoBench*, char*, const char*);
+
+// the shared parts of the benchmarks: the options, the inputs (the
+// shipped data and synthetic grids of each size asked for, made with
+// pvs-gen) and the timing. Each case is run a number of times and written
+// out as one JSON object per line, keyed by bench/case/input, for
+// pvs-bench-compare...
+class PlatoBench {
+
+ private:
+  const char* benchName;
+  const char* dataDir;
+  const char* scratchDir;
+  const char* generator;
+  FILE* results;
+  int repeats;
+  int sizes[PVS_BENCH_MAX_SIZES];
+  int numSizes;
+
+  // the case being run...
+  char caseName[PVS_BENCH_NAME];
+  char inputName[PVS_BENCH_NAME];
+  double* times;
+  int numTimes;
+  double runStart;
+  long items;
+
+ private:
+  void usage();
+  void parseSizes(char*);
+
+ public:
+  PlatoBench(const char*, int, char**);
+  ~PlatoBench();
+  int getRepeats();
+  int getNumberOfSizes();
+  int getSize(int);
+  void getDataPath(const char*, char*);
+  void getSyntheticRho(int, char*);
+  void getSyntheticName(int, char*);
+  void runRhoInputs(PlatoBenchInput);
+  void fillLattice(int, PlatoXYZFrame*);
+  void begin(const char*, const char*);
+  void startRun();
+  void stopRun(long);
+  void end();
+  static long updatePipeline(PlatoVTKPipeline*);
+};
+
+#define __PLATOBENCH_H__
+#endif // __PLATOBENCH_H__
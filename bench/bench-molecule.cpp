@@ -0,0 +1,102 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// times building the molecule geometry from scratch (finding the bonds and
+// placing a glyph for every atom and bond) and moving every atom of it a
+// little, as a trajectory does...
+
+// plato includes...
+#include "PlatoBench.h"
+#include "PlatoMoleculeGeometry.h"
+#include "PlatoTrajectoryReader.h"
+
+static const char* dataSets[] = {"atom.xyz", "dimer.xyz", "8.xyz"};
+
+static void benchFrame(PlatoBench* bench, PlatoXYZFrame* frame,
+		       const char* input) {
+  PlatoMoleculeGeometry* geometry;
+
+  // the same settings as the xyz pipeline...
+  bench->begin("build", input);
+  for(int r = 0; r < bench->getRepeats(); r++) {
+    bench->startRun();
+    geometry = new PlatoMoleculeGeometry(12, 0.5f, 0.2f);
+    geometry->update(frame);
+    bench->stopRun(frame->numAtoms);
+    delete geometry;
+  }
+  bench->end();
+
+  geometry = new PlatoMoleculeGeometry(12, 0.5f, 0.2f);
+  geometry->update(frame);
+  bench->begin("move", input);
+  for(int r = 0; r < bench->getRepeats(); r++) {
+    float step = (r % 2) ? -0.05f : 0.05f;
+    for(int i = 0; i < 3 * frame->numAtoms; i++)
+      frame->coords[i] += step;
+    frame->frameNumber++;
+    bench->startRun();
+    geometry->update(frame);
+    bench->stopRun(geometry->getNumberOfMovedAtoms());
+  }
+  bench->end();
+  delete geometry;
+}
+
+int main(int argc, char** argv) {
+  PlatoBench* bench = new PlatoBench("molecule", argc, argv);
+  PlatoXYZFrame* frame = new PlatoXYZFrame();
+  char path[PVS_BENCH_PATH];
+  char name[PVS_BENCH_NAME];
+
+  for(int i = 0; i < 3; i++) {
+    bench->getDataPath(dataSets[i], path);
+    PlatoTrajectoryReader* trajectory = new PlatoTrajectoryReader(path);
+    trajectory->readFrame(0, frame);
+    delete trajectory;
+    benchFrame(bench, frame, dataSets[i]);
+  }
+
+  // a lattice an eighth of the edge of each synthetic grid...
+  for(int i = 0; i < bench->getNumberOfSizes(); i++) {
+    int side = bench->getSize(i) / 8;
+    if(side < 2)
+      side = 2;
+    bench->fillLattice(side, frame);
+    bench->getSyntheticName(bench->getSize(i), name);
+    benchFrame(bench, frame, name);
+  }
+
+  delete frame;
+  delete bench;
+  return 0;
+}
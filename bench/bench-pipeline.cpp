@@ -0,0 +1,116 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// times the pipelines pvs builds on a grid as it starts up: an isosurface
+// through the middle of the data range, the same clipped by the cut plane
+// (pvs -c) and the orthoslice (pvs -o). Uniform grids are structured,
+// atom centred data unstructured...
+
+// vtk includes...
+#include "vtkPointSet.h"
+
+// plato includes...
+#include "PlatoBench.h"
+#include "PlatoDataReader.h"
+#include "PlatoIsoPipeline.h"
+#include "PlatoOrthoPipeline.h"
+
+static PlatoVTKPipeline* makeContour(PlatoDataReader* reader) {
+  PlatoIsoPipeline* pip = new PlatoIsoPipeline(reader);
+  pip->setIsoVisible(0, true);
+  pip->setPeriodic(true);
+
+  return pip;
+}
+
+static PlatoVTKPipeline* makeClip(PlatoDataReader* reader) {
+  // on top of the contour, so the difference between them is the cut...
+  PlatoIsoPipeline* pip = new PlatoIsoPipeline(reader);
+  pip->setIsoVisible(0, true);
+  pip->setPeriodic(true);
+  pip->setIsoCutter(true);
+
+  return pip;
+}
+
+static PlatoVTKPipeline* makeSlice(PlatoDataReader* reader) {
+  PlatoOrthoPipeline* pop = new PlatoOrthoPipeline(reader);
+  pop->setOrthoslice(true);
+  pop->setPeriodic(true);
+
+  return pop;
+}
+
+struct PlatoPipelineCase {
+  const char* name;
+  PlatoVTKPipeline* (*make)(PlatoDataReader*);
+};
+
+static const PlatoPipelineCase cases[] = {
+  {"contour", makeContour},
+  {"clip", makeClip},
+  {"slice", makeSlice}
+};
+
+static void benchFile(PlatoBench* bench, char* path, const char* input) {
+  PlatoVTKPipeline* pipeline;
+  char name[PVS_BENCH_NAME];
+
+  // the triangulation is made once and kept, as it is in pvs...
+  PlatoDataReader* reader = new PlatoDataReader(path);
+  reader->getData()->Update();
+
+  for(unsigned int c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    snprintf(name, PVS_BENCH_NAME, "%s.%s", cases[c].name,
+	     reader->isUniformMesh() ? "structured" : "unstructured");
+    bench->begin(name, input);
+    for(int r = 0; r < bench->getRepeats(); r++) {
+      pipeline = cases[c].make(reader);
+      bench->startRun();
+      long polygons = PlatoBench::updatePipeline(pipeline);
+      bench->stopRun(polygons);
+      delete pipeline;
+    }
+    bench->end();
+  }
+
+  delete reader;
+}
+
+int main(int argc, char** argv) {
+  PlatoBench* bench = new PlatoBench("pipeline", argc, argv);
+
+  bench->runRhoInputs(benchFile);
+
+  delete bench;
+  return 0;
+}
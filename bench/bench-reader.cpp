@@ -0,0 +1,82 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// times parsing rho files into a grid and, for atom centred data, the
+// delaunay triangulation that follows...
+
+// vtk includes...
+#include "vtkPointSet.h"
+
+// plato includes...
+#include "PlatoBench.h"
+#include "PlatoDataReader.h"
+
+static void benchFile(PlatoBench* bench, char* path, const char* input) {
+  PlatoDataReader* reader;
+  long points = 0;
+
+  bench->begin("parse", input);
+  for(int r = 0; r < bench->getRepeats(); r++) {
+    bench->startRun();
+    reader = new PlatoDataReader(path);
+    points = reader->getData()->GetNumberOfPoints();
+    bench->stopRun(points);
+    delete reader;
+  }
+  bench->end();
+
+  // only atom centred data is triangulated...
+  reader = new PlatoDataReader(path);
+  bool uniform = reader->isUniformMesh();
+  delete reader;
+  if(uniform)
+    return;
+
+  bench->begin("delaunay", input);
+  for(int r = 0; r < bench->getRepeats(); r++) {
+    reader = new PlatoDataReader(path);
+    bench->startRun();
+    reader->getData()->Update();
+    bench->stopRun(reader->getData()->GetNumberOfCells());
+    delete reader;
+  }
+  bench->end();
+}
+
+int main(int argc, char** argv) {
+  PlatoBench* bench = new PlatoBench("reader", argc, argv);
+
+  bench->runRhoInputs(benchFile);
+
+  delete bench;
+  return 0;
+}
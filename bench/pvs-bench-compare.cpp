@@ -0,0 +1,177 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// compares a run of the benchmarks with a baseline run and flags every
+// case whose median time has gone up by more than the threshold. Exits
+// with 1 if anything has, so it can stop a build...
+
+// system includes...
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+// macro definitions...
+#define PVS_COMPARE_MAX_RESULTS 4096
+#define PVS_COMPARE_KEY 256
+#define PVS_COMPARE_LINE 1024
+#define PVS_COMPARE_THRESHOLD 10.0
+#define PVS_COMPARE_NOISE 0.5
+
+// a single result line...
+struct BenchResult {
+  char key[PVS_COMPARE_KEY];
+  double median;
+};
+
+static void compareUsage() {
+  using std::cout;
+
+  cout << "Usage: pvs-bench-compare [options] BASELINE RESULTS\nOptions:\n";
+  cout << "  -h\t\tPrint this message and exit.\n";
+  cout << "  -m MS\t\tIgnore changes of less than MS ms (default ";
+  cout << PVS_COMPARE_NOISE << ").\n";
+  cout << "  -t PERCENT\tFlag cases more than PERCENT slower (default ";
+  cout << PVS_COMPARE_THRESHOLD << ").\n";
+}
+
+// pulls the key and the median out of each line, they're written by
+// PlatoBench so there's no need for a real JSON parser...
+static int readResults(const char* filename, BenchResult* results) {
+  char line[PVS_COMPARE_LINE];
+  int count = 0;
+
+  FILE* in = fopen(filename, "r");
+  if(!in) {
+    std::cerr << "Could not open results file: " << filename << std::endl;
+    exit(1);
+  }
+
+  while(fgets(line, PVS_COMPARE_LINE, in) && count < PVS_COMPARE_MAX_RESULTS) {
+    char* key = strstr(line, "\"key\":\"");
+    char* median = strstr(line, "\"median_ms\":");
+    if(!key || !median)
+      continue;
+
+    key += 7;
+    char* end = strchr(key, '"');
+    if(!end || (end - key) >= PVS_COMPARE_KEY)
+      continue;
+
+    // a later run of the same case replaces an earlier one...
+    int i;
+    *end = '\0';
+    for(i = 0; i < count; i++) {
+      if(strcmp(results[i].key, key) == 0)
+	break;
+    }
+    strcpy(results[i].key, key);
+    results[i].median = atof(median + 12);
+    if(i == count)
+      count++;
+  }
+  fclose(in);
+
+  return count;
+}
+
+int main(int argc, char** argv) {
+  double threshold = PVS_COMPARE_THRESHOLD;
+  double noise = PVS_COMPARE_NOISE;
+  int opt;
+
+  while((opt = getopt(argc, argv, "hm:t:")) != -1) {
+    switch(opt) {
+    case 'h':
+      compareUsage();
+      exit(0);
+    case 'm':
+      noise = atof(optarg);
+      break;
+    case 't':
+      threshold = atof(optarg);
+      break;
+    default:
+      compareUsage();
+      exit(1);
+    }
+  }
+  if(argc - optind != 2) {
+    compareUsage();
+    exit(1);
+  }
+
+  BenchResult* baseline = new BenchResult[PVS_COMPARE_MAX_RESULTS];
+  BenchResult* current = new BenchResult[PVS_COMPARE_MAX_RESULTS];
+  int numBaseline = readResults(argv[optind], baseline);
+  int numCurrent = readResults(argv[optind + 1], current);
+
+  int regressions = 0;
+  int improvements = 0;
+  printf("%-48s %12s %12s %8s\n", "case", "baseline ms", "now ms", "change");
+  for(int i = 0; i < numCurrent; i++) {
+    int j;
+    for(j = 0; j < numBaseline; j++) {
+      if(strcmp(baseline[j].key, current[i].key) == 0)
+	break;
+    }
+    if(j == numBaseline) {
+      printf("%-48s %12s %12.3f %8s\n", current[i].key, "-",
+	     current[i].median, "new");
+      continue;
+    }
+
+    double before = baseline[j].median;
+    double after = current[i].median;
+    double change = (before > 0.0) ? ((after - before) * 100.0) / before : 0.0;
+    const char* flag = "";
+    if((after - before) > noise && change > threshold) {
+      flag = "  SLOWER";
+      regressions++;
+    }
+    else if((before - after) > noise && -change > threshold) {
+      flag = "  faster";
+      improvements++;
+    }
+    printf("%-48s %12.3f %12.3f %+7.1f%%%s\n", current[i].key, before, after,
+	   change, flag);
+  }
+
+  printf("\n%d slower and %d faster by more than %g%%\n", regressions,
+	 improvements, threshold);
+
+  delete[] baseline;
+  delete[] current;
+
+  return (regressions > 0) ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+#!/bin/sh
+#
+#  Steering latency benchmark for the RealityGrid Plato Visualization
+#  System.
+#
+#  (C) Copyright 2005, University of Manchester, United Kingdom,
+#  all rights reserved.
+#
+#  This software was developed by the RealityGrid project
+#  (http://www.realitygrid.org), funded by the EPSRC under grants
+#  GR/R67699/01 and GR/R67699/02.
+#
+#  LICENCE TERMS
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions
+#  are met:
+#  1. Redistributions of source code must retain the above copyright
+#     notice, this list of conditions and the following disclaimer.
+#  2. Redistributions in binary form must reproduce the above copyright
+#     notice, this list of conditions and the following disclaimer in the
+#     documentation and/or other materials provided with the distribution.
+#
+#  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+#  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+#  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+#  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+#  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+#  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+#  CORRECTION.
+#
+#  Author........: Robert Haines
+#
+#------------------------------------------------------------------------
+
+# Measures how long steering changes take to reach the screen with the
+# real pvs. The same made up sessions are replayed at real speed through
+# pvs built with the adaptive steering poll and with the old fixed 200 ms
+# one, and the latency tracer's figures for each are printed. Each change
+# is timed from when it was due in the session, so the wait for the next
+# poll is counted.
+#
+# Usage: bench/steer-latency.sh [SECONDS] [GRID]
+#
+# SECONDS is how long each session runs (default 60) and GRID the size of
+# the synthetic grid contoured (default 64). It's run from the top of the
+# tree, needs vtk built with offscreen Mesa for the replay and rebuilds
+# pvs twice, leaving the adaptive one behind.
+#
+# The sessions are:
+#   drag    the first isosurface dragged with a change every 50 ms for
+#           2 s, then left for 1-3 s
+#   sparse  one change to it every 0.5-1.5 s
+#
+# Without a display there's no interactor, so the interactor timer the
+# old renderer also waited on isn't counted in the fixed poll figures.
+
+SECONDS_RUN=${1:-60}
+GRID=${2:-64}
+WORK=${TMPDIR:-/tmp}/pvs-steer-latency.$$
+
+mkdir -p ${WORK} || exit 1
+trap "rm -rf ${WORK}" 0
+
+make generator || exit 1
+./pvs-gen -g ${GRID} -s 1 ${WORK}/grid || exit 1
+
+awk -v end=${SECONDS_RUN}000 'BEGIN {
+  srand(1);
+  print "0.0\tparam\tIso 0 visible?\t1";
+  t = 1000.0;
+  while(t < end) {
+    for(i = 0; i < 40; i++) {
+      printf("%.1f\tparam\tIso 0 value\t%.6f\n", t,
+	     0.5 + 0.4 * sin(i * 3.14159265 / 20.0));
+      t += 50.0;
+    }
+    t += 1000.0 + 2000.0 * rand();
+  }
+}' > ${WORK}/drag.session
+
+awk -v end=${SECONDS_RUN}000 'BEGIN {
+  srand(2);
+  print "0.0\tparam\tIso 0 visible?\t1";
+  t = 1000.0;
+  while(t < end) {
+    printf("%.1f\tparam\tIso 0 value\t%.6f\n", t, 0.1 + 0.8 * rand());
+    t += 500.0 + 1000.0 * rand();
+  }
+}' > ${WORK}/sparse.session
+
+for poll in fixed adaptive; do
+  if [ ${poll} = fixed ]; then
+    flags="-DPVS_REG_MIN_INTERVAL=200 -DPVS_REG_MAX_INTERVAL=200"
+  else
+    flags=
+  fi
+  make clean > /dev/null
+  make STEER_FLAGS="${flags}" || exit 1
+  cp pvs ${WORK}/pvs-${poll}
+
+  for session in drag sparse; do
+    echo "== ${poll} poll, ${session} session"
+    ${WORK}/pvs-${poll} -i 1 -r ${WORK}/grid.rho \
+      --replay ${WORK}/${session}.session | grep -v "^Steering change "
+  done
+done
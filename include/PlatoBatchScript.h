@@ -0,0 +1,92 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOBATCHSCRIPT_H__
+
+// the longest line a script may have...
+#define PVS_SCRIPT_LINE 256
+
+// plato forward references...
+class PlatoImageEncoder;
+class PlatoRenderWindow;
+class PlatoTiledRenderer;
+struct threadData;
+
+// runs an offscreen render window from a script of camera moves and
+// parameter changes, writing each rendered frame to an image file. One
+// command per line, # starts a comment:
+//
+//   size W H		   the window size in pixels
+//   resolution W H	   the image size, tiled if bigger than the window
+//   output PATTERN	   printf style filename with one %d, e.g. frame%04d.png
+//   encoders N		   the number of image writing threads
+//   camera reset
+//   camera azimuth|elevation|roll|zoom|dolly X
+//   iso N VALUE|on|off
+//   ortho|cut|molecule|bonds on|off
+//   frame N		   the frame of the molecule to show
+//   render [N]		   render and write N images (default 1)
+//   orbit DEGREES N	   write N images, turning DEGREES in total
+//   frames FIRST LAST	   write an image of each molecule frame
+//   poster W H FILE	   write one big image in tiles, a row at a time
+class PlatoBatchScript {
+
+ private:
+  char* filename;
+  char* outputPattern;
+  int numEncoders;
+  int resolution[2];
+  int numImages;
+  double startTime;
+  double renderTime;
+
+  PlatoRenderWindow* window;
+  threadData* pipelines;
+  PlatoImageEncoder* encoder;
+  PlatoTiledRenderer* tiles;
+
+ private:
+  bool execute(char*, bool);
+  bool isPattern(const char*);
+  bool toggle(const char*, int*);
+  void command(int, int, double);
+  void renderImages(int, double);
+  void renderFrames(int, int);
+
+ public:
+  PlatoBatchScript(const char*, PlatoRenderWindow*, threadData*);
+  ~PlatoBatchScript();
+  void run();
+};
+
+#define __PLATOBATCHSCRIPT_H__
+#endif // __PLATOBATCHSCRIPT_H__
@@ -0,0 +1,78 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOCOMMANDQUEUE_H__
+
+// the size of the queue, this must be a power of two...
+#define PVS_CMD_QUEUE_SIZE 256
+
+// the things the steering thread can ask the render thread to do...
+enum PlatoCommandType {
+  PVS_CMD_STOP,
+  PVS_CMD_MOLECULE_VISIBLE,
+  PVS_CMD_BONDS_VISIBLE,
+  PVS_CMD_FRAME,
+  PVS_CMD_ISO_VISIBLE,
+  PVS_CMD_ISO_VALUE,
+  PVS_CMD_ORTHOSLICE,
+  PVS_CMD_CUTPLANE
+};
+
+// a command, index picks which iso etc. it applies to...
+struct PlatoCommand {
+  int type;
+  int index;
+  double value;
+};
+
+typedef void (*PlatoCommandCallback)(PlatoCommand*, void*);
+
+// a single producer, single consumer ring of commands. Only the steering
+// thread may push and only the render thread may drain...
+class PlatoCommandQueue {
+
+ private:
+  PlatoCommand* ring;
+  PlatoCommand* drained;
+  unsigned int head;
+  unsigned int tail;
+
+ public:
+  PlatoCommandQueue();
+  ~PlatoCommandQueue();
+  bool push(int, int, double);
+  int drain(PlatoCommandCallback, void*);
+  bool isEmpty();
+};
+
+#define __PLATOCOMMANDQUEUE_H__
+#endif // __PLATOCOMMANDQUEUE_H__
@@ -32,41 +32,84 @@
 
 #ifndef __PLATODATAREADER_H__
 
+// system includes...
+#include <iosfwd>
+
 // vtk forward references
 class vtkDelaunay3D;
 class vtkFloatArray;
 class vtkPoints;
 class vtkPointSet;
+class vtkStructuredGrid;
+class vtkUnstructuredGrid;
+
+// plato forward references
+class PlatoDataSource;
 
 class PlatoDataReader {
   
  private:
   char* rhoFilename;
+  PlatoDataSource* source;
   bool uniformMesh;
+  bool periodic;
   int* dataDims;
   double* dataRange;
   double* dataCentre;
   double* dataBounds;
+  double* cellVectors;
   int numAtoms;
 
+  // the frame a brick of a streamed grid last changed in...
+  int brickSize;
+  int brickDims[3];
+  int* brickStamps;
+  int dataStamp;
+
   vtkPointSet* dataSet;
   vtkPoints* dataPoints;
   vtkFloatArray* dataValues;
   vtkDelaunay3D* delaunay;
+  vtkUnstructuredGrid* boundary;
 
  private:
   void readRhoFile();
+  void readSource();
+  void buildUniformPoints();
+  static void fillPointsPlane(int, void*);
   void buildPipeline();
+  void findBounds();
+  void buildDelaunay();
+  void buildBoundary();
+  void fillBoundaryValues();
+  bool isBoundaryDirty(int);
+  bool isBoxCut(double[3][2], double*, double*);
 
  public:
   PlatoDataReader(char*);
+  PlatoDataReader(PlatoDataSource*);
   ~PlatoDataReader();
   vtkPointSet* getData();
   int* getDataDimensions();
   double* getDataRange();
   double* getDataCentre();
   double* getDataBounds();
+  double* getCellVectors();
+  vtkUnstructuredGrid* getPeriodicBoundary();
+  vtkStructuredGrid* extractRegion(int*, int*);
+  void fillRegion(vtkStructuredGrid*, int*, int*);
   bool isUniformMesh();
+  void setPeriodic(bool);
+  bool isPeriodic();
+  bool acquireFrame();
+  bool isFrameWaiting();
+  int getFrameNumber();
+  bool isStreamed();
+  int getDataStamp();
+  bool isRegionDirty(int*, int*, int);
+  bool isPlaneDirty(double*, double*, int);
+  static void readRhoHeader(std::istream&, const char*, double*, bool*, int*,
+			    long*);
 };
 
 #define __PLATODATAREADER_H__
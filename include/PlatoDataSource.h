@@ -0,0 +1,73 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATODATASOURCE_H__
+
+// system includes...
+#include <cstddef>
+
+// plato forward references...
+class PlatoRenderWindow;
+
+// somewhere that density frames for a uniform grid arrive from while pvs is
+// running. The front buffer is used in place as the data array so it must
+// stay put until the next acquireFrame()...
+class PlatoDataSource {
+
+ public:
+  virtual ~PlatoDataSource() {}
+
+  // block until there's a frame to build the pipelines from...
+  virtual void waitForFirstFrame() = 0;
+
+  // watch for new frames and ask the window to render when they arrive...
+  virtual void start(PlatoRenderWindow*) = 0;
+  virtual void stop() = 0;
+
+  virtual int* getDataDimensions() = 0;
+  virtual double* getCellVectors() = 0;
+  virtual float* getFrontBuffer() = 0;
+  virtual int getFrameNumber() = 0;
+  virtual bool isFrameWaiting() = 0;
+
+  // make the newest frame the front buffer, false if there isn't one...
+  virtual bool acquireFrame() = 0;
+
+  // sources that know which parts of the grid a new frame changed give
+  // the brick size and, after acquireFrame(), a flag per brick (x fastest).
+  // Zero means the whole grid has to be treated as changed...
+  virtual int getBrickSize() { return 0; }
+  virtual const unsigned char* getDirtyBricks() { return NULL; }
+};
+
+#define __PLATODATASOURCE_H__
+#endif // __PLATODATASOURCE_H__
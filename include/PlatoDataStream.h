@@ -0,0 +1,140 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATODATASTREAM_H__
+
+// the version of the stream protocol...
+#define PVS_STREAM_VERSION 2
+
+// how a frame's values are sent...
+#define PVS_STREAM_FULL 0
+#define PVS_STREAM_DELTA 1
+#define PVS_STREAM_DELTA_QUANTISED 2
+
+// the edge length, in grid points, of the bricks deltas are sent in...
+#define PVS_STREAM_BRICK_SIZE 8
+
+// the biggest grid (in points) that will be taken off the stream, four
+// buffers of this many floats are made for it...
+#define PVS_STREAM_MAX_POINTS (1L << 30)
+
+// plato includes...
+#include "PlatoDataSource.h"
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// every frame on the stream starts with this, in the sender's byte order,
+// which is worked out from the version and everything swapped if it isn't
+// ours. The cell vectors are in bohr. A full frame is followed by dims[0] *
+// dims[1] * dims[2] floats in the same order as a uniform rho file (x
+// fastest). A delta frame only carries the bricks that changed since the
+// frame before it: numBricks of an int brick number (x fastest over the
+// bricks), then a value to add for each point of the brick, x fastest,
+// with the bricks on the far faces cut short by the grid. The values are
+// floats, or shorts to multiply by quantum if quantised. The first frame
+// on a connection must be a full one...
+struct PlatoStreamHeader {
+  char magic[4];
+  int version;
+  int frame;
+  int dims[3];
+  double cellVectors[9];
+  int encoding;
+  int numBricks;
+  float quantum;
+};
+
+// receives density frames pushed by a simulation over a socket. Frames
+// are read straight into page aligned buffers: one being filled, the
+// latest complete one and the one the pipelines are using. A frame that
+// arrives before the last was taken replaces it...
+class PlatoDataStream : public PlatoDataSource {
+
+ private:
+  int port;
+  int listenSocket;
+  int dataSocket;
+  PlatoStreamHeader header;
+  long numValues;
+  bool swapped;
+
+  float* buffers[3];
+  float* latest;
+  bool haveLatest;
+  int brickDims[3];
+  int numBricks;
+  unsigned char* stale[3];
+  unsigned char* dirty;
+  float* brickValues;
+  int filling;
+  int ready;
+  int front;
+  bool frameWaiting;
+  int frontFrame;
+  int readyFrame;
+  bool done;
+
+  PlatoRenderWindow* window;
+  vtkMultiThreader* thread;
+  int threadID;
+  vtkMutexLock* bufferLock;
+
+ private:
+  bool acceptConnection();
+  bool readFully(void*, long);
+  bool readFrame(int, int*);
+  bool readDelta(PlatoStreamHeader*);
+  void getBrick(int, int*, int*);
+  void markAllStale(int);
+  static void swapBytes(void*, int, long);
+  static void* receiveLoop(void*);
+
+ public:
+  PlatoDataStream(const char*, int);
+  ~PlatoDataStream();
+  void waitForFirstFrame();
+  void start(PlatoRenderWindow*);
+  void stop();
+  int* getDataDimensions();
+  double* getCellVectors();
+  float* getFrontBuffer();
+  int getFrameNumber();
+  bool isFrameWaiting();
+  bool acquireFrame();
+  int getBrickSize();
+  const unsigned char* getDirtyBricks();
+};
+
+#define __PLATODATASTREAM_H__
+#endif // __PLATODATASTREAM_H__
@@ -0,0 +1,105 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOFRAMESCHEDULER_H__
+
+// the number of representations each mapper can be drawn with: as it is,
+// simplified, and as an outline...
+#define PVS_LOD_LEVELS 3
+
+// the grid the simplified geometry is clustered onto...
+#define PVS_LOD_DIVISIONS 32
+
+// the most mappers that are tracked...
+#define PVS_LOD_MAX_MAPPERS 64
+
+// vtk forward references...
+class vtkCallbackCommand;
+class vtkMapper;
+class vtkObject;
+class vtkOutlineFilter;
+class vtkPolyDataMapper;
+class vtkQuadricClustering;
+class vtkRenderer;
+
+// plato forward references...
+class PlatoRenderWindow;
+
+// the cheaper ways of drawing what one of the pipelines' mappers draws,
+// and what each has been measured to cost per frame (over all the actors
+// sharing the mapper, in milliseconds, negative if not yet known)...
+struct PlatoLOD {
+  vtkPolyDataMapper* mappers[PVS_LOD_LEVELS];
+  vtkQuadricClustering* simplified;
+  vtkOutlineFilter* outline;
+  double cost[PVS_LOD_LEVELS];
+  int level;
+  int users;
+};
+
+// keeps interactive frames within a time budget. Each mapper's draw time
+// is measured as it's rendered, and while the camera is being moved the
+// most expensive are swapped for cheaper versions until the frame fits.
+// Once the interaction stops they are brought back a level at a time...
+class PlatoFrameScheduler {
+
+ private:
+  double frameTime;
+  double overhead;
+  bool interacting;
+  bool refining;
+  PlatoLOD* lods;
+  int numLODs;
+
+  PlatoRenderWindow* window;
+  vtkRenderer* renderer;
+  vtkCallbackCommand* callback;
+
+ private:
+  PlatoLOD* findLOD(vtkMapper*);
+  double getCost(PlatoLOD*, int);
+  void chooseLevels();
+  void applyLevels();
+  void measureCosts();
+  static void eventCallback(vtkObject*, unsigned long, void*, void*);
+
+ public:
+  PlatoFrameScheduler(PlatoRenderWindow*, vtkRenderer*, double);
+  ~PlatoFrameScheduler();
+  void watchWindow(vtkObject*);
+  void watchInteraction(vtkObject*);
+  bool refine();
+  bool isRefining();
+};
+
+#define __PLATOFRAMESCHEDULER_H__
+#endif // __PLATOFRAMESCHEDULER_H__
@@ -0,0 +1,140 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOFRAMESERVER_H__
+
+// the version of the frame protocol...
+#define PVS_FRAME_VERSION 1
+
+// the edge length, in pixels, of the tiles that are compared with the
+// last frame sent and sent on if they've changed...
+#define PVS_FRAME_TILE_SIZE 64
+
+// zlib level, speed matters more than size here...
+#define PVS_FRAME_COMPRESSION 1
+
+// system includes...
+#include <semaphore.h>
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoRenderWindow;
+
+// every frame sent to a client starts with this, in the sender's byte
+// order. It is followed by numTiles tiles, each a PlatoFrameTile and then
+// bytes of zlib compressed RGB pixels, bottom row first. The tiles not sent
+// are the same as in the frame before. The first frame on a connection,
+// and any after the size changes, has every tile. Frame numbers count the
+// frames rendered, so a gap is frames dropped because the client was
+// behind. publishTime is getTimeMillis() when the frame was drawn...
+struct PlatoFrameHeader {
+  char magic[4];
+  int version;
+  int frame;
+  int width;
+  int height;
+  int numTiles;
+  double publishTime;
+};
+
+struct PlatoFrameTile {
+  int x;
+  int y;
+  int width;
+  int height;
+  int bytes;
+};
+
+// sends rendered frames to a thin client over a socket. The render thread
+// hands over each frame and carries on, a thread of our own compresses
+// and sends them. If a frame is still waiting when the next one comes it
+// is dropped, so a slow client only ever gets the latest...
+class PlatoFrameServer {
+
+ private:
+  int port;
+  int listenSocket;
+  int clientSocket;
+  PlatoRenderWindow* window;
+
+  // the frame waiting to be sent, and the last one taken...
+  unsigned char* pending;
+  int pendingSize[2];
+  int pendingFrame;
+  double pendingTime;
+  unsigned char* current;
+  int currentSize[2];
+  int currentFrame;
+  double currentTime;
+  bool currentSent;
+
+  // what the client has, and room to build the next message...
+  unsigned char* sent;
+  int sentSize[2];
+  unsigned char* tile;
+  unsigned char* message;
+  long messageSize;
+
+  int numPublished;
+  int numSent;
+  int numDropped;
+  double bytesSent;
+  double rawBytes;
+  bool done;
+
+  sem_t frameWaiting;
+  vtkMultiThreader* thread;
+  int threadID;
+  vtkMutexLock* frameLock;
+
+ private:
+  bool acceptConnection();
+  bool writeFully(const void*, long);
+  bool sendFrame();
+  void closeConnection();
+  void printStats();
+  static void* sendLoop(void*);
+
+ public:
+  PlatoFrameServer(const char*, int);
+  ~PlatoFrameServer();
+  void start(PlatoRenderWindow*);
+  void stop();
+  bool hasClient();
+  void publish(unsigned char*, int, int);
+};
+
+#define __PLATOFRAMESERVER_H__
+#endif // __PLATOFRAMESERVER_H__
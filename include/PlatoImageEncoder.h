@@ -0,0 +1,91 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOIMAGEENCODER_H__
+
+// system includes...
+#include <semaphore.h>
+
+// the most images that can be written at once...
+#define PVS_MAX_ENCODERS 16
+
+// vtk forward references...
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoImageEncoder;
+class PlatoTaskGroup;
+
+// an image waiting to be written...
+struct PlatoImageJob {
+  unsigned char* pixels;
+  int width;
+  int height;
+  char* filename;
+  PlatoImageEncoder* encoder;
+};
+
+// writes rendered images out to files on the task pool so that the render
+// thread can get on with the next frame. The file type comes from the
+// filename: .png, .jpg or .ppm...
+class PlatoImageEncoder {
+
+ private:
+  int numThreads;
+
+  // the render thread waits for a free slot if the encoders fall behind
+  // so the memory they use is bounded...
+  sem_t slotsFree;
+  PlatoTaskGroup* jobs;
+  vtkMutexLock* jobLock;
+
+  int numWritten;
+  double encodeTime;
+  double waitTime;
+
+ private:
+  static void encodeJob(int, void*);
+  void write(PlatoImageJob*);
+
+ public:
+  PlatoImageEncoder(int);
+  ~PlatoImageEncoder();
+  void encode(unsigned char*, int, int, const char*);
+  void finish();
+  int getNumThreads();
+  int getNumWritten();
+  double getEncodeTime();
+  double getWaitTime();
+};
+
+#define __PLATOIMAGEENCODER_H__
+#endif // __PLATOIMAGEENCODER_H__
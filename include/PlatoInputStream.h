@@ -0,0 +1,149 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOINPUTSTREAM_H__
+
+// the most decompressed text each stream keeps at once, which also sets
+// how far ahead of the parser the blocks are decompressed...
+#define PVS_INPUT_MEMORY (64 * 1048576)
+
+// how many blocks each pool thread is given to decompress ahead...
+#define PVS_INPUT_AHEAD 2
+
+// the size of the pieces a stream that can't be split is decompressed in,
+// one in use while the next is filled...
+#define PVS_INPUT_BLOCK 1048576
+
+// the size of the pieces a file is read in when the length of its text
+// isn't known...
+#define PVS_INPUT_PIECE (64 * 1048576)
+
+// the largest frame that is decompressed on its own, a file with bigger
+// ones than this is decompressed in order...
+#define PVS_INPUT_MAX_FRAME (16 * 1048576)
+
+// what a file is stored as...
+#define PVS_INPUT_PLAIN 0
+#define PVS_INPUT_GZIP 1
+#define PVS_INPUT_ZSTD 2
+
+// system includes...
+#include <streambuf>
+
+// zlib and zstd forward references...
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+
+// plato forward references...
+class PlatoInputStream;
+class PlatoTaskGroup;
+
+// a gzip member or zstd frame that can be decompressed on its own...
+struct PlatoInputBlock {
+  const unsigned char* start;
+  long length;
+  long outLength;
+};
+
+// the text decompressed from one block, or the next piece of the stream...
+struct PlatoInputSlot {
+  char* text;
+  long length;
+  int block;
+  bool failed;
+  PlatoTaskGroup* group;
+  PlatoInputStream* stream;
+};
+
+// reads a plain, gzip or zstd compressed file (found from the first few
+// bytes, not the name) for parsing with an istream, so a compressed file
+// never has to be unpacked to disk first. The file is mapped in, a plain
+// one is parsed straight from the mapping. When the file is made of blocks
+// that can be found without decompressing them (bgzip members or zstd
+// frames with their size in the header) they are decompressed on the task
+// pool in order, a few blocks ahead of the parser. Anything else is
+// decompressed in order a piece at a time, with the next piece being done
+// while the last one is parsed. Either way only a few blocks are ever held
+// in memory at once. The length of the text is known up front for a plain
+// file, bgzip members and zstd frames that say how big they are, but not
+// for any other gzip file (its trailer only gives the length modulo 4GB of
+// the last member)...
+class PlatoInputStream : public std::streambuf {
+
+ private:
+  char* filename;
+  int format;
+  int file;
+  unsigned char* mapped;
+  long mappedLength;
+  long textLength;
+
+  PlatoInputBlock* blocks;
+  int numBlocks;
+  PlatoInputSlot* slots;
+  int numSlots;
+  int current;
+
+  // the state of a stream decompressed in order...
+  bool streaming;
+  bool streamEnd;
+  long streamIn;
+  z_stream_s* inflater;
+  ZSTD_DCtx_s* zstd;
+
+ private:
+  static int checkMagic(const unsigned char*, long);
+  void findGzipMembers();
+  void findZstdFrames();
+  void startStream();
+  void fill(int, int);
+  static void fillSlot(int, void*);
+  void inflateBlock(PlatoInputSlot*);
+  void inflateStream(PlatoInputSlot*);
+  void unzstdBlock(PlatoInputSlot*);
+  void unzstdStream(PlatoInputSlot*);
+
+ protected:
+  int underflow();
+
+ public:
+  PlatoInputStream(const char*);
+  ~PlatoInputStream();
+  bool isOpen();
+  int getFormat();
+  static int getFormat(const char*);
+  long getLength();
+  static char* readText(const char*, long*);
+};
+
+#define __PLATOINPUTSTREAM_H__
+#endif // __PLATOINPUTSTREAM_H__
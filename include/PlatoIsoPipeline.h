@@ -32,46 +32,109 @@
 
 #ifndef __PLATOISOPIPELINE_H__
 
+// the edge length, in grid points, of the blocks streamed data is
+// contoured in...
+#define PVS_ISO_CHUNK_SIZE 32
+
 // plato includes...
 #include "PlatoVTKPipeline.h"
 
 // vtk forward references...
 class vtkActor;
+class vtkActorCollection;
+class vtkAppendPolyData;
 class vtkClipPolyData;
+class vtkContourFilter;
 class vtkLookupTable;
 class vtkMarchingContourFilter;
 class vtkPlane;
 class vtkPointSet;
+class vtkPolyData;
 class vtkPolyDataMapper;
 class vtkPolyDataNormals;
 class vtkProperty;
+class vtkStructuredGrid;
 
 // plato forward references...
 class PlatoDataReader;
+class PlatoSymmetry;
+
+// a block of the grid contoured on its own so it can be redone alone when
+// only its part of the data changes. Its part of the grid is only cut out
+// while it's contoured, just its surface (with normals) is kept...
+struct PlatoIsoChunk {
+  int low[3];
+  int high[3];
+  int stamp;
+  bool contoured;
+  vtkMarchingContourFilter* contour;
+  vtkPolyDataNormals* normals;
+  vtkPolyData* surface;
+};
 
 class PlatoIsoPipeline : public PlatoVTKPipeline {
 
  private:
   double* isoValues;
   bool* isoVisible;
+  double* contourValues;
+  int numContours;
   double* dataRange;
   double* cutPlaneCentre;
   double* cutPlaneNormals;
   bool cutPlaneOn;
+  bool periodic;
+  bool builtSymmetry;
+  bool builtCut;
+  int builtFrame;
+  int wedgeFrame;
+  int wedgeLow[3];
+  int wedgeHigh[3];
+  bool chunked;
+  bool boundaryJoined;
+  PlatoIsoChunk* chunks;
+  int numChunks;
+  int chunkLow[3];
+  int chunkHigh[3];
 
   vtkProperty* actorProperties;
   vtkPlane* cutPlane;
   vtkMarchingContourFilter* isoSurface;
+  vtkContourFilter* boundarySurface;
+  vtkPolyDataNormals* boundaryNormals;
+  vtkAppendPolyData* chunkAppend;
+  vtkAppendPolyData* isoAppend;
   vtkPolyDataNormals* isoNormals;
   vtkClipPolyData* isoCutter;
   vtkPolyDataMapper* isoMapper;
   vtkActor* isoActor;
+  vtkPolyData* isoFront;
+  vtkStructuredGrid* wedge;
+  vtkActorCollection* symmetryImages;
 
   PlatoDataReader* data;
 
  private:
   void init();
   void buildPipeline();
+  void updateContours();
+  void buildChunks(int*, int*);
+  void clearChunks();
+  void refreshChunks();
+  static void contourChunk(int, void*);
+  void contourSurfaces();
+  static void setUpNormals(vtkPolyDataNormals*);
+  vtkPolyData* getSurface();
+  vtkPolyData* getOutput();
+  void showSymmetryImages(bool);
+  void configure();
+  void executeUpdate();
+  void setAbortUpdate(bool);
+  void swapBuffers();
+  void attachBuffers();
+  bool isDataStale();
+  bool isWanted();
+  void releaseData();
 
  public:
   PlatoIsoPipeline(PlatoDataReader*);
@@ -83,6 +146,10 @@ class PlatoIsoPipeline : public PlatoVTKPipeline {
   bool isIsoVisible(int);
   void setIsoCutter(bool);
   bool isIsoCutterOn();
+  void setPeriodic(bool);
+  bool isPeriodic();
+  void setSymmetry(PlatoSymmetry*);
+  bool isSymmetryOn();
 };
 
 #define __PLATOISOPIPELINE_H__
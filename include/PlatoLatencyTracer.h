@@ -0,0 +1,120 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOLATENCYTRACER_H__
+
+// the most changes that can be in flight at once, this must be a power of
+// two...
+#define PVS_TRACE_PENDING 256
+
+// latencies are counted in power of two buckets of milliseconds, the last
+// takes everything over 2^(PVS_TRACE_BUCKETS - 2) ms...
+#define PVS_TRACE_BUCKETS 16
+
+// the kinds of steering change that are traced...
+enum PlatoTraceType {
+  PVS_TRACE_ISO_VALUE,
+  PVS_TRACE_ISO_VISIBLE,
+  PVS_TRACE_ORTHOSLICE,
+  PVS_TRACE_CUTPLANE,
+  PVS_TRACE_MOLECULE,
+  PVS_TRACE_FRAME,
+  PVS_TRACE_TYPES
+};
+
+// vtk forward references...
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoVTKPipeline;
+
+// a change on its way to the screen...
+struct PlatoTrace {
+  int id;
+  int type;
+  int state;
+  PlatoVTKPipeline* pipeline;
+  int generation;
+  double received;
+  double applied;
+  double built;
+};
+
+// the latencies of one kind of change...
+struct PlatoTraceStats {
+  int count;
+  int overTarget;
+  int buckets[PVS_TRACE_BUCKETS];
+  double total;
+  double max;
+  double queueTotal;
+  double updateTotal;
+  double drawTotal;
+};
+
+// follows each steering change from the steering thread, through the
+// command queue and the pipeline update, to the first frame drawn with
+// it in and keeps a histogram of how long that took per kind of change.
+// Changes are picked up in the order they're received so nothing needs to
+// be carried through the command queue...
+class PlatoLatencyTracer {
+
+ private:
+  vtkMutexLock* traceLock;
+  PlatoTrace* pending;
+  int nextId;
+  int applyId;
+  int lost;
+  double target;
+  bool verbose;
+  PlatoTraceStats stats[PVS_TRACE_TYPES];
+
+ private:
+  void finishTrace(PlatoTrace*, double);
+
+ public:
+  PlatoLatencyTracer(double = 0.0);
+  ~PlatoLatencyTracer();
+  int receive(int, PlatoVTKPipeline*, double);
+  void startApply();
+  void finishApply(double);
+  void collect(double);
+  void frameDrawn(double);
+  bool isIdle();
+  void setVerbose(bool);
+  double getPercentile(int, double);
+  void printStats();
+  static const char* getTypeName(int);
+};
+
+#define __PLATOLATENCYTRACER_H__
+#endif // __PLATOLATENCYTRACER_H__
@@ -0,0 +1,125 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOMOLECULEGEOMETRY_H__
+
+// atoms are set up on the task pool in batches of at least this many...
+#define PVS_MOLECULE_GRAIN 256
+
+// vtk forward references...
+class vtkCellArray;
+class vtkFloatArray;
+class vtkPoints;
+class vtkPolyData;
+
+// plato forward references...
+class PlatoXYZFrame;
+
+class PlatoMoleculeGeometry {
+
+ private:
+  int numSides;
+  float atomScale;
+  float bondRadius;
+  float moveTolerance;
+  int numAtoms;
+  float* positions;
+  int* types;
+
+  // sphere template copied into every atom's block of points...
+  int sphereVerts;
+  int sphereTris;
+  float* spherePoints;
+  float* sphereNormals;
+  int* sphereCells;
+
+  // persistent cell list for bond finding...
+  float cellOrigin[3];
+  float cellSize[3];
+  int cells[3];
+  int cellReach[3];
+  int* cellHead;
+  int* cellNext;
+  int* atomCell;
+
+  // bond slots; free slots are collapsed and reused...
+  int bondCapacity;
+  int numBondSlots;
+  int numFreeBonds;
+  int* bondAtoms;
+  int* bondNext;
+  int* atomBond;
+  int* freeBonds;
+
+  // per-frame bookkeeping...
+  int numMoved;
+  int* moved;
+  char* crossed;
+
+  vtkPoints* atomPoints;
+  vtkFloatArray* atomNormals;
+  vtkFloatArray* atomScalars;
+  vtkCellArray* atomPolys;
+  vtkPolyData* atomGeometry;
+
+  vtkPoints* bondPoints;
+  vtkFloatArray* bondNormals;
+  vtkFloatArray* bondScalars;
+  vtkCellArray* bondStrips;
+  vtkPolyData* bondGeometry;
+
+ private:
+  void rebuild(PlatoXYZFrame*);
+  void buildCells();
+  int cellOf(const float*);
+  void placeAtom(int);
+  static void setupAtom(int, void*);
+  static void placeMovedAtom(int, void*);
+  void placeBond(int);
+  void findBonds(int);
+  void addBond(int, int);
+  void removeBonds(int);
+  int* bondLink(int, int);
+  void growBonds();
+  void freeArrays();
+
+ public:
+  PlatoMoleculeGeometry(int, float, float);
+  ~PlatoMoleculeGeometry();
+  void update(PlatoXYZFrame*);
+  vtkPolyData* getAtoms();
+  vtkPolyData* getBonds();
+  int getNumberOfMovedAtoms();
+};
+
+#define __PLATOMOLECULEGEOMETRY_H__
+#endif // __PLATOMOLECULEGEOMETRY_H__
@@ -37,9 +37,11 @@
 
 // vtk forward references...
 class vtkActor;
+class vtkAppendPolyData;
 class vtkCutter;
 class vtkLookupTable;
 class vtkPlane;
+class vtkPolyData;
 class vtkPolyDataMapper;
 
 // plato forward references...
@@ -52,17 +54,35 @@ class PlatoOrthoPipeline : public PlatoVTKPipeline {
   double* orthoPlaneCentre;
   double* orthoPlaneNormals;
   bool orthosliceOn;
+  bool periodic;
+  bool sliceWanted;
+  bool sliceStale;
+  bool runSlice;
+  int builtFrame;
+  int builtStamp;
 
   vtkCutter* orthoSlice;
+  vtkCutter* boundarySlice;
+  vtkAppendPolyData* orthoAppend;
   vtkPlane* orthoPlane;
   vtkPolyDataMapper* orthoMapper;
   vtkActor* orthoActor;
+  vtkPolyData* orthoFront;
 
   PlatoDataReader* data;
 
  private:
   void init();
   void buildPipeline();
+  vtkPolyData* getSlice();
+  void configure();
+  void executeUpdate();
+  void setAbortUpdate(bool);
+  void swapBuffers();
+  void attachBuffers();
+  bool isDataStale();
+  bool isWanted();
+  void releaseData();
 
  public:
   PlatoOrthoPipeline(PlatoDataReader*);
@@ -70,6 +90,8 @@ class PlatoOrthoPipeline : public PlatoVTKPipeline {
   ~PlatoOrthoPipeline();
   void setOrthoslice(bool);
   bool isOrthosliceOn();
+  void setPeriodic(bool);
+  bool isPeriodic();
 };
 
 #define __PLATOORTHOPIPELINE_H__
@@ -0,0 +1,84 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOPIPELINEWORKER_H__
+
+// system includes...
+#include <semaphore.h>
+
+// the most pipelines that can be waiting for the worker...
+#define PVS_MAX_PIPELINES 16
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoDataReader;
+class PlatoRenderWindow;
+class PlatoVTKPipeline;
+
+// runs pipeline updates away from the render thread. The pipelines all
+// read the same grid so their updates are run one at a time, in the
+// order they were asked for. New frames of streamed data are only taken
+// between passes through the queue, and every pipeline showing the data
+// is run on each one, so they never show different frames...
+class PlatoPipelineWorker {
+
+ private:
+  PlatoRenderWindow* window;
+  PlatoDataReader* data;
+  PlatoVTKPipeline** pipelines;
+  int numPipelines;
+  PlatoVTKPipeline** queue;
+  int queueLength;
+  int passLength;
+  bool done;
+  int threadID;
+
+  vtkMultiThreader* thread;
+  vtkMutexLock* queueLock;
+  sem_t queueWake;
+
+ private:
+  static void* workerLoop(void*);
+
+ public:
+  PlatoPipelineWorker(PlatoRenderWindow*);
+  ~PlatoPipelineWorker();
+  void setDataReader(PlatoDataReader*);
+  void addPipeline(PlatoVTKPipeline*);
+  void schedule(PlatoVTKPipeline*);
+};
+
+#define __PLATOPIPELINEWORKER_H__
+#endif // __PLATOPIPELINEWORKER_H__
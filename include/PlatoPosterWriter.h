@@ -0,0 +1,71 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOPOSTERWRITER_H__
+
+// zlib level for posters, they're written once and kept...
+#define PVS_POSTER_COMPRESSION 6
+
+// system includes...
+#include <cstdio>
+
+// zlib forward references...
+struct z_stream_s;
+
+// writes an image a few rows at a time, top row first, so that a poster
+// never has to be in memory all at once. A filename ending .ppm gets a
+// PPM, anything else a PNG...
+class PlatoPosterWriter {
+
+ private:
+  FILE* file;
+  bool png;
+  int width;
+  int height;
+  int rowsWritten;
+  unsigned char* row;
+  unsigned char* packed;
+  z_stream_s* stream;
+
+ private:
+  void writeChunk(const char*, const unsigned char*, unsigned int);
+  void deflateRow(int);
+
+ public:
+  PlatoPosterWriter(const char*, int, int);
+  ~PlatoPosterWriter();
+  void writeRow(const unsigned char*);
+  void close();
+};
+
+#define __PLATOPOSTERWRITER_H__
+#endif // __PLATOPOSTERWRITER_H__
@@ -0,0 +1,111 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOPROFILER_H__
+
+// the stages that are timed, the latest of each is kept for steering...
+enum PlatoProfileStage {
+  PVS_PROF_READ,
+  PVS_PROF_BUILD,
+  PVS_PROF_DELAUNAY,
+  PVS_PROF_CONTOUR,
+  PVS_PROF_NORMALS,
+  PVS_PROF_CLIP,
+  PVS_PROF_SLICE,
+  PVS_PROF_MOLECULE,
+  PVS_PROF_RENDER,
+  PVS_PROF_STAGES
+};
+
+// system includes...
+#include <cstdio>
+
+// vtk forward references...
+class vtkMutexLock;
+class vtkObject;
+class vtkPolyData;
+
+// records how long each stage of reading, building, updating and drawing
+// takes, with the triangles made and the resident memory (and the change
+// since the stage recorded before it) as JSON lines or (for a filename
+// ending .json) a Chrome trace. Off unless start() is called, and then
+// nothing is watched or timed...
+class PlatoProfiler {
+
+ private:
+  static bool enabled;
+  static FILE* file;
+  static bool chrome;
+  static bool first;
+  static double origin;
+  static vtkMutexLock* lock;
+  static double stageTimes[PVS_PROF_STAGES];
+  static long stageTriangles[PVS_PROF_STAGES];
+  static long resident;
+
+ private:
+  static void filterCallback(vtkObject*, unsigned long, void*, void*);
+  static void freeWatch(void*);
+
+ public:
+  static inline bool isEnabled() { return enabled; }
+  static void start(const char*);
+  static void finish();
+  static double now();
+  static long getResident();
+  static void record(const char*, int, double, long, long);
+  static void recordCounters(const char*, const double*, int);
+  static void watch(vtkObject*, const char*, int, vtkPolyData* = NULL);
+  static const char* getStageName(int);
+  static double getStageTime(int);
+  static long getStageTriangles(int);
+  static long getLastResident();
+};
+
+// times the rest of the block it's declared in...
+class PlatoProfileScope {
+
+ private:
+  const char* name;
+  int stage;
+  double start;
+  long resident;
+  long triangles;
+
+ public:
+  PlatoProfileScope(const char*, int);
+  ~PlatoProfileScope();
+  void setTriangles(long);
+};
+
+#define __PLATOPROFILER_H__
+#endif // __PLATOPROFILER_H__
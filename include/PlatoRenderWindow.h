@@ -41,8 +41,16 @@ class vtkObject;
 class vtkRenderer;
 class vtkRenderWindow;
 class vtkRenderWindowInteractor;
+class vtkCamera;
+class vtkTextActor;
+
+// plato includes...
+#include "PlatoCommandQueue.h"
 
 // plato forward references...
+class PlatoFrameScheduler;
+class PlatoFrameServer;
+class PlatoLatencyTracer;
 class PlatoVTKPipeline;
 
 class PlatoRenderWindow {
@@ -53,6 +61,33 @@ class PlatoRenderWindow {
   int windowHeight;
 
   bool steered;
+  bool offscreen;
+
+  // steering wakes the render thread by writing to this pipe, which is
+  // waited on directly when there's no interactor...
+  int wakePipe[2];
+  bool running;
+  PlatoLatencyTracer* tracer;
+
+  // ...and queues the changes to be made before it does...
+  PlatoCommandQueue* commands;
+  PlatoCommandCallback commandCallback;
+  void* commandData;
+
+  // ...and swaps in the pipelines' new geometry when it's ready...
+  PlatoVTKPipeline** pipelines;
+  int numPipelines;
+
+  // ...and sends what it drew to a remote viewer...
+  PlatoFrameServer* frameServer;
+  vtkCallbackCommand* frameCallback;
+
+  // ...and keeps interaction smooth by drawing cheaper versions of things...
+  PlatoFrameScheduler* scheduler;
+  bool refinePending;
+
+  // ...and says what's still loading...
+  vtkTextActor* statusText;
 
   vtkCallbackCommand* callback;
   vtkRenderer* renderer;
@@ -61,7 +96,7 @@ class PlatoRenderWindow {
   vtkInteractorStyleTrackballCamera* interactorStyle;
 
  public:
-  PlatoRenderWindow(bool, const char*, int = 500, int = 500);
+  PlatoRenderWindow(bool, bool, const char*, int = 500, int = 500);
   ~PlatoRenderWindow();
   void addActor(vtkActor*);
   void addActors(vtkActorCollection*);
@@ -73,6 +108,24 @@ class PlatoRenderWindow {
   void start();
   void exit();
   bool isSteered();
+  bool isOffscreen();
+  vtkCamera* getCamera();
+  void resetCamera();
+  void setStatus(const char*);
+  int* getSize();
+  void setSize(int, int);
+  void render(bool = true);
+  unsigned char* grabImage(int*, int*);
+  void setFrameServer(PlatoFrameServer*);
+  void publishFrame();
+  void setFrameTime(double);
+  void refineLater();
+  void refineFrame();
+  void setCommandQueue(PlatoCommandQueue*, PlatoCommandCallback, void*);
+  void setLatencyTracer(PlatoLatencyTracer*);
+  PlatoLatencyTracer* getLatencyTracer();
+  void requestRender();
+  void processRenderRequest();
 };
 
 #define __PLATORENDERWINDOW_H__
@@ -0,0 +1,124 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATORHOLOADER_H__
+
+// the file is indexed in chunks of this many bytes, a value is found by
+// skipping through the chunk it's in...
+#define PVS_RHO_CHUNK 65536
+
+// the first level is the coarsest with no more than this many values...
+#define PVS_RHO_PREVIEW_POINTS 32768
+
+// plato includes...
+#include "PlatoDataSource.h"
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// loads a uniform rho file coarse to fine. Every stride'th value in each
+// direction is read first and the rest of the grid filled in between them,
+// then the stride is halved until every value has been read. Each level
+// is sent on as a new frame, so it's picked up (and can be cut short by a
+// steering change) just as a streamed one would be. The file is read into
+// memory and indexed once so any value can be found without reading
+// through all the ones before it. The values are text of no fixed width so
+// even the first level has to wait for that: on one core a 512^3 grid
+// (1.7 GB) shows its first level after about 6 s, where parsing all of it
+// takes 45 s...
+class PlatoRhoLoader : public PlatoDataSource {
+
+ private:
+  char* rhoFilename;
+  char* text;
+  long textLength;
+  char* valuesStart;
+  int numChunks;
+  long* chunkTokens;
+  int dims[3];
+  double cellVectors[9];
+  int firstStride;
+  double startTime;
+
+  // the values read so far, at the end all of them, and the two levels
+  // filled in from them...
+  float* values;
+  float* previews[2];
+  float* front;
+  float* ready;
+  int frontFrame;
+  int readyFrame;
+  bool frameWaiting;
+  bool done;
+
+  // what the level being worked on is made from...
+  int levelStride;
+  float* levelTarget;
+  int* axisLow[3];
+  int* axisHigh[3];
+  float* axisFraction[3];
+
+  PlatoRenderWindow* window;
+  vtkMultiThreader* thread;
+  int threadID;
+  vtkMutexLock* bufferLock;
+
+ private:
+  void readFile();
+  void readCompressed();
+  static void countChunk(int, void*);
+  const char* findToken(long);
+  void readLevel(int);
+  static void readPlane(int, void*);
+  void fillLevel(int, float*);
+  static void fillPlane(int, void*);
+  void publish(float*, int);
+  bool isDone();
+  static void* refineLoop(void*);
+
+ public:
+  PlatoRhoLoader(char*);
+  ~PlatoRhoLoader();
+  void waitForFirstFrame();
+  void start(PlatoRenderWindow*);
+  void stop();
+  int* getDataDimensions();
+  double* getCellVectors();
+  float* getFrontBuffer();
+  int getFrameNumber();
+  bool isFrameWaiting();
+  bool acquireFrame();
+};
+
+#define __PLATORHOLOADER_H__
+#endif // __PLATORHOLOADER_H__
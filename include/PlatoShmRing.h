@@ -0,0 +1,137 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOSHMRING_H__
+
+// system includes...
+#include <semaphore.h>
+
+// plato includes...
+#include "PlatoDataSource.h"
+
+// the version of the shared memory layout...
+#define PVS_SHM_VERSION 1
+
+// the most slots a ring can have...
+#define PVS_SHM_MAX_SLOTS 64
+
+// how many times a slot being written is waited on before giving up until
+// the next frame is asked for...
+#define PVS_SHM_RETRIES 100
+
+// vtk forward references...
+class vtkMultiThreader;
+
+// The shared memory ring, made (and owned) by the producer with shm_open:
+//
+//   0                         PlatoShmHeader
+//   dataOffset                slot 0: PlatoShmSlot
+//   dataOffset + valuesOffset slot 0's grid, page aligned, as in the stream
+//   dataOffset + slotBytes    slot 1 ...
+//
+// The producer never writes the newest slot or the one pvs holds, so with
+// three or more slots it never has to wait. A slot's sequence is odd while
+// it is being written. To take a slot pvs reads an even sequence, sets
+// heldSlot and reads the sequence again: if it hasn't moved the producer
+// will leave the slot alone until heldSlot changes, otherwise it tries
+// again. The producer makes the sequence odd before it checks heldSlot so
+// one side always sees the other. The magic is written last once the
+// header is filled in. The wake semaphore is posted after every frame...
+struct PlatoShmHeader {
+  char magic[4];
+  int version;
+  int numSlots;
+  int dims[3];
+  double cellVectors[9];
+  long dataOffset;
+  long slotBytes;
+  long valuesOffset;
+  sem_t wake;
+
+  // these are only ever accessed atomically...
+  unsigned long published;
+  int latestSlot;
+  int heldSlot;
+};
+
+struct PlatoShmSlot {
+  unsigned long sequence;
+  int frame;
+  double publishTime;
+};
+
+// takes frames from a shared memory ring written by a simulation on the
+// same node. The grid values are used straight out of the ring...
+class PlatoShmRing : public PlatoDataSource {
+
+ private:
+  char* name;
+  int fd;
+  PlatoShmHeader* header;
+  long mappedBytes;
+  int front;
+  int frontFrame;
+  unsigned long taken;
+  bool done;
+
+  // publish to take latency and frames never seen...
+  int numTaken;
+  long dropped;
+  double totalLatency;
+  double maxLatency;
+
+  PlatoRenderWindow* window;
+  vtkMultiThreader* thread;
+  int threadID;
+
+ private:
+  bool isValid();
+  PlatoShmSlot* getSlot(int);
+  static void* watchLoop(void*);
+
+ public:
+  PlatoShmRing(char*);
+  ~PlatoShmRing();
+  void waitForFirstFrame();
+  void start(PlatoRenderWindow*);
+  void stop();
+  int* getDataDimensions();
+  double* getCellVectors();
+  float* getFrontBuffer();
+  int getFrameNumber();
+  bool isFrameWaiting();
+  bool acquireFrame();
+  void printStats();
+};
+
+#define __PLATOSHMRING_H__
+#endif // __PLATOSHMRING_H__
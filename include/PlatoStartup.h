@@ -0,0 +1,113 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOSTARTUP_H__
+
+// the most stages there can be...
+#define PVS_STARTUP_MAX_STAGES 8
+
+// how often the progress is drawn while waiting for the stages (in
+// milliseconds)...
+#define PVS_STARTUP_TICK 100.0
+
+// what nextFinished() returns when nothing finished in time, and when
+// every stage has been handed back...
+#define PVS_STARTUP_WAITING -1
+#define PVS_STARTUP_DONE -2
+
+// system includes...
+#include <semaphore.h>
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoStartup;
+
+// what a stage runs, on its own thread...
+typedef void (*PlatoStageFunction)(void*);
+
+enum PlatoStageState {
+  PVS_STAGE_WAITING,
+  PVS_STAGE_RUNNING,
+  PVS_STAGE_DONE
+};
+
+struct PlatoStartupStage {
+  const char* name;
+  PlatoStageFunction function;
+  void* data;
+  int needs;
+  PlatoStageState state;
+  int threadID;
+  PlatoStartup* startup;
+  int index;
+};
+
+// runs the reading and building that has to be done before anything can
+// be drawn as a graph of stages, each on its own thread as soon as the
+// stages it needs are done. The stages themselves share the task pool for
+// their loops. Whoever started it collects the stages as they finish so
+// their results can be shown straight away...
+class PlatoStartup {
+
+ private:
+  PlatoStartupStage stages[PVS_STARTUP_MAX_STAGES];
+  int numStages;
+  int finished[PVS_STARTUP_MAX_STAGES];
+  int numFinished;
+  int numCollected;
+  double startTime;
+  char progress[256];
+
+  vtkMultiThreader* threads;
+  vtkMutexLock* stageLock;
+  sem_t stageDone;
+
+ private:
+  static void* runStage(void*);
+  void launchReady();
+  void finishStage(int);
+
+ public:
+  PlatoStartup();
+  ~PlatoStartup();
+  int addStage(const char*, PlatoStageFunction, void*);
+  void addDependency(int, int);
+  void start();
+  int nextFinished(double);
+  const char* getProgress();
+};
+
+#define __PLATOSTARTUP_H__
+#endif // __PLATOSTARTUP_H__
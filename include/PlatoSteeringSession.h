@@ -0,0 +1,116 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOSTEERINGSESSION_H__
+
+// the most params that can be registered with a session...
+#define PVS_SESSION_PARAMS 64
+
+// the longest line a session file may have...
+#define PVS_SESSION_LINE 512
+
+// the longest a replay waits for a change to reach the screen before
+// moving on without it (in milliseconds)...
+#define PVS_SESSION_WAIT 5000.0
+
+// system includes...
+#include <cstdio>
+
+// plato forward references...
+class PlatoLatencyTracer;
+
+// a param registered with the steering library, kept so that recorded
+// values can be read from it and replayed values written back into it...
+struct PlatoSessionParam {
+  char* label;
+  void* value;
+  int type;
+};
+
+// sits between the steering loop and the steering library. It can write
+// every param change and command the loop gets to a file, and can play a
+// file like that back in place of the steering library so that a session
+// can be rerun without a client. One change per line, tab separated, #
+// starts a comment:
+//
+//   TIME	param	LABEL	VALUE
+//   TIME	command	ID
+//
+// where TIME is in milliseconds from the start of the session. Lines with
+// the same TIME came from the same poll and are handed back together...
+class PlatoSteeringSession {
+
+ private:
+  FILE* file;
+  char* filename;
+  bool recording;
+  bool replaying;
+  bool fast;
+  bool stopSent;
+  double startTime;
+  double waitStart;
+  double changeTime;
+  int numChanges;
+
+  PlatoSessionParam params[PVS_SESSION_PARAMS];
+  int numParams;
+
+  // the next line of a replay, read ahead to see when it's due...
+  char line[PVS_SESSION_LINE];
+  bool haveLine;
+  double lineTime;
+
+  PlatoLatencyTracer* tracer;
+
+ private:
+  PlatoSessionParam* findParam(const char*);
+  void writeChanges(int, char**, int, int*);
+  bool readLine();
+  bool isSettled(double);
+  bool replayLine(int*, char**, int*, int*);
+
+ public:
+  PlatoSteeringSession();
+  ~PlatoSteeringSession();
+  void record(const char*);
+  void replay(const char*, bool);
+  bool isReplaying();
+  bool isReplayingFast();
+  void setLatencyTracer(PlatoLatencyTracer*);
+  int registerParam(const char*, int, void*, int, const char*, const char*);
+  int control(int, int*, char**, int*, int*, char**);
+  double getChangeTime();
+  void printStats();
+};
+
+#define __PLATOSTEERINGSESSION_H__
+#endif // __PLATOSTEERINGSESSION_H__
@@ -0,0 +1,89 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOSYMMETRY_H__
+
+// vtk forward references...
+class vtkMatrix4x4;
+
+// plato forward references...
+class PlatoDataReader;
+class PlatoXYZFrame;
+
+// the symmetry operations of a crystal that map the rho grid onto itself,
+// and the smallest box of the cell (the wedge) whose images under them
+// tile the whole cell...
+class PlatoSymmetry {
+
+ private:
+  PlatoDataReader* data;
+  int* dataDims;
+  double* cellVectors;
+  double* inverseCell;
+
+  // each operation is a signed permutation of the axes plus a shift, both
+  // in grid units: out[j] = opSign[j] * in[opPerm[j]] + opShift[j]...
+  int numOps;
+  int* opPerm;
+  int* opSign;
+  int* opShift;
+
+  int* wedgeLow;
+  int* wedgeHigh;
+  int numImages;
+  int* imageOps;
+  int* imageShift;
+
+ private:
+  void addOperation(int*, int*, int*);
+  bool gridShift(double, int, int*);
+  bool isGridCompatible(int*);
+  bool isMetricPreserved(int*, int*);
+  bool imageOfBox(int, int*, int*, int*, int*, int*);
+  bool tileWithBox(int*, int*, int*, int*);
+  void toFractional(float*, double*);
+
+ public:
+  PlatoSymmetry(PlatoDataReader*);
+  ~PlatoSymmetry();
+  void readOperations(char*);
+  int detectOperations(PlatoXYZFrame*);
+  bool buildWedge();
+  int getNumberOfOperations();
+  int getNumberOfImages();
+  int* getWedgeLow();
+  int* getWedgeHigh();
+  void getImageMatrix(int, vtkMatrix4x4*);
+};
+
+#define __PLATOSYMMETRY_H__
+#endif // __PLATOSYMMETRY_H__
@@ -0,0 +1,157 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOTASKPOOL_H__
+
+// the most worker threads there can be...
+#define PVS_POOL_MAX_THREADS 64
+
+// the most tasks each worker can have queued, this must be a power of
+// two. Anything more is run by whoever asked for it...
+#define PVS_POOL_QUEUE 256
+
+// a parallel loop is cut into up to this many pieces per thread, so there
+// is something left to steal when some pieces take longer than others...
+#define PVS_POOL_SPLIT 4
+
+// system includes...
+#include <semaphore.h>
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoTaskPool;
+
+// a task is called once for each index in its range...
+typedef void (*PlatoTaskFunction)(int, void*);
+
+// tasks that can be waited for together...
+class PlatoTaskGroup {
+ public:
+  int pending;
+  sem_t done;
+
+ public:
+  PlatoTaskGroup() {
+    pending = 0;
+    sem_init(&done, 0, 0);
+  }
+  ~PlatoTaskGroup() {
+    sem_destroy(&done);
+  }
+};
+
+struct PlatoTask {
+  PlatoTaskFunction function;
+  void* data;
+  int first;
+  int last;
+  PlatoTaskGroup* group;
+};
+
+// each worker takes the newest of its own tasks, while the others steal
+// the oldest...
+struct PlatoTaskQueue {
+  PlatoTask* tasks;
+  int head;
+  int tail;
+  vtkMutexLock* lock;
+
+  // what the worker has done, for working out how busy it is...
+  int cpu;
+  int tasksRun;
+  int tasksStolen;
+  double busyTime;
+  double sampledBusy;
+};
+
+// what a worker thread is started with...
+struct PlatoTaskWorker {
+  PlatoTaskPool* pool;
+  int index;
+};
+
+// the one set of threads that every data-parallel stage shares, so they
+// never have more threads between them than there are cores. Whoever
+// waits on some tasks helps with them (and anything else queued) rather
+// than blocking, so tasks can start more tasks. Workers can be pinned to
+// a list of cpus, e.g. "0-3,8-11"...
+class PlatoTaskPool {
+
+ private:
+  static PlatoTaskPool* pool;
+
+  int numWorkers;
+  int nextQueue;
+  bool stopping;
+  double startTime;
+  double sampleTime;
+  int cpus[PVS_POOL_MAX_THREADS];
+  int numCpus;
+
+  PlatoTaskQueue queues[PVS_POOL_MAX_THREADS];
+  PlatoTaskWorker workers[PVS_POOL_MAX_THREADS];
+  int threadIDs[PVS_POOL_MAX_THREADS];
+  vtkMultiThreader* threads;
+  sem_t tasksWaiting;
+  vtkMutexLock* poolLock;
+
+ private:
+  static void* workerLoop(void*);
+  static void touchPages(int, void*);
+  int parseCpus(const char*);
+  void pinWorker(int);
+  void push(PlatoTask*);
+  bool takeTask(int, PlatoTask*);
+  void runTask(int, PlatoTask*);
+  void submitRange(PlatoTaskGroup*, PlatoTaskFunction, void*, int, int);
+
+ public:
+  PlatoTaskPool(int, const char*);
+  ~PlatoTaskPool();
+  static void start(int, const char*);
+  static PlatoTaskPool* getPool();
+  static void finish();
+  int getNumThreads();
+  int getNumWorkers();
+  void run(PlatoTaskFunction, void*, int, int = 1);
+  void submit(PlatoTaskGroup*, PlatoTaskFunction, void*, int);
+  void wait(PlatoTaskGroup*);
+  void firstTouch(void*, long);
+  double sampleUtilisation(double*);
+  void printStats();
+};
+
+#define __PLATOTASKPOOL_H__
+#endif // __PLATOTASKPOOL_H__
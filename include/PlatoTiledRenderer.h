@@ -0,0 +1,88 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOTILEDRENDERER_H__
+
+// the biggest window a tile is drawn in...
+#define PVS_TILE_MAX_SIZE 1024
+
+// system includes...
+#include <semaphore.h>
+
+// vtk forward references...
+class vtkMultiThreader;
+
+// plato forward references...
+class PlatoPosterWriter;
+class PlatoRenderWindow;
+
+// renders images bigger than the window by zooming the camera in on each
+// tile of the view in turn. Posters are drawn a row of tiles at a time
+// from the top and written out on another thread while the next row is
+// drawn, so only two rows are ever in memory...
+class PlatoTiledRenderer {
+
+ private:
+  PlatoRenderWindow* window;
+  int imageSize[2];
+  int tileSize[2];
+  int numTiles;
+  int windowSize[2];
+  double viewAngle;
+  double parallelScale;
+
+  // the rows of tiles being drawn and written...
+  unsigned char* strips[2];
+  int stripRows[2];
+  sem_t stripFree;
+  sem_t stripReady;
+  PlatoPosterWriter* writer;
+  vtkMultiThreader* thread;
+
+ private:
+  void setUp(int, int);
+  void tearDown();
+  void renderStrip(int, unsigned char*, int);
+  static void* writeLoop(void*);
+
+ public:
+  PlatoTiledRenderer(PlatoRenderWindow*);
+  ~PlatoTiledRenderer();
+  unsigned char* renderImage(int, int);
+  void renderPoster(int, int, const char*);
+  static double getTileViewAngle(double, int, int);
+  static double getTileCentre(int, int, int);
+  static int getTilePixels(int, int, int);
+};
+
+#define __PLATOTILEDRENDERER_H__
+#endif // __PLATOTILEDRENDERER_H__
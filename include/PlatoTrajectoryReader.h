@@ -0,0 +1,103 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+#ifndef __PLATOTRAJECTORYREADER_H__
+
+// macro definitions...
+#define PVS_TRAJ_PREFETCH 4
+
+// system includes...
+#include <semaphore.h>
+
+// vtk forward references...
+class vtkMultiThreader;
+class vtkMutexLock;
+
+// a single decoded frame of a trajectory...
+class PlatoXYZFrame {
+ public:
+  int frameNumber;
+  int numAtoms;
+  int capacity;
+  float* coords;
+  int* atomTypes;
+
+ public:
+  PlatoXYZFrame();
+  ~PlatoXYZFrame();
+  void resize(int);
+  void swap(PlatoXYZFrame*);
+};
+
+class PlatoTrajectoryReader {
+
+ private:
+  char* xyzFilename;
+  int fileDescriptor;
+  char* fileData;
+  long long fileSize;
+  long long fileTime;
+  long long* frameOffsets;
+  int numFrames;
+  int numAtoms;
+
+  // prefetch state, guarded by cacheLock...
+  PlatoXYZFrame* cache;
+  int* cacheState;
+  int wantedFrame;
+  bool prefetchDone;
+  int prefetchThreadId;
+  sem_t prefetchWake;
+  vtkMutexLock* cacheLock;
+  vtkMultiThreader* thread;
+
+ private:
+  void mapFile();
+  void buildIndex();
+  bool buildUniformIndex();
+  void buildSerialIndex();
+  bool loadIndex();
+  void saveIndex();
+  void parseFrame(int, PlatoXYZFrame*);
+  static void* prefetchLoop(void*);
+
+ public:
+  PlatoTrajectoryReader(char*);
+  ~PlatoTrajectoryReader();
+  int getNumberOfFrames();
+  int getNumberOfAtoms();
+  void readFrame(int, PlatoXYZFrame*);
+  static float getCovalentRadius(int);
+};
+
+#define __PLATOTRAJECTORYREADER_H__
+#endif // __PLATOTRAJECTORYREADER_H__
@@ -33,8 +33,14 @@
 #ifndef __PLATOVTKPIPELINE_H__
 
 // vtk forward references...
+class vtkActor;
 class vtkActorCollection;
 class vtkLookupTable;
+class vtkMatrix4x4;
+class vtkMutexLock;
+
+// plato forward references...
+class PlatoPipelineWorker;
 
 class PlatoVTKPipeline {
 
@@ -44,18 +50,63 @@ class PlatoVTKPipeline {
  protected:
   vtkLookupTable* colourTable;
   vtkActorCollection* actors;
+  vtkActorCollection* instances;
+  vtkActorCollection* instanceSources;
+
+  // with a worker the filters are run away from the render thread and the
+  // mappers draw a copy of their last complete output. Each change is a
+  // new generation, a run that finishes for an old one is thrown away...
+  PlatoPipelineWorker* worker;
+  vtkMutexLock* updateLock;
+  int requestedGeneration;
+  int builtGeneration;
+  int shownGeneration;
+  bool updating;
+  bool updateComplete;
+  double builtTime;
+
+  // nothing is built until it's first shown, and what's been hidden for a
+  // while gives its memory back...
+  static double releaseTime;
+  bool built;
+  bool released;
+  double hiddenSince;
+
+ protected:
+  vtkActor* instanceActor(vtkActor*, vtkMatrix4x4*);
+  void setActorVisibility(vtkActor*, bool);
+  void requestUpdate();
+  virtual void configure();
+  virtual void executeUpdate();
+  virtual void setAbortUpdate(bool);
+  virtual void swapBuffers();
+  virtual void attachBuffers();
+  virtual bool isDataStale();
+  virtual bool isWanted();
+  virtual void releaseData();
 
  private:
   virtual void init();
   virtual void buildPipeline() = 0;
+  bool prepare();
 
  public:
   PlatoVTKPipeline();
   PlatoVTKPipeline(vtkLookupTable*);
-  ~PlatoVTKPipeline();
+  virtual ~PlatoVTKPipeline();
   vtkActorCollection* getActors();
   void setColourTable(vtkLookupTable*);
   vtkLookupTable* getColourTable();
+  void replicate(int*, double*);
+  void setWorker(PlatoPipelineWorker*);
+  bool runUpdate();
+  bool swapIfReady();
+  void checkData();
+  void checkIdle(double);
+  int getRequestedGeneration();
+  int getShownGeneration();
+  double getBuiltTime();
+  static void setReleaseTime(double);
 };
 
 #define __PLATOVTKPIPELINE_H__
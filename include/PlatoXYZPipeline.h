@@ -36,14 +36,15 @@
 #include "PlatoVTKPipeline.h"
 
 // vtk forward references...
-class vtkXYZMolReader;
-class vtkSphereSource;
-class vtkGlyph3D;
-class vtkTubeFilter;
 class vtkPolyDataMapper;
 class vtkProperty;
 class vtkActor;
 
+// plato forward references...
+class PlatoMoleculeGeometry;
+class PlatoTrajectoryReader;
+class PlatoXYZFrame;
+
 class PlatoXYZPipeline : public PlatoVTKPipeline {
 
  private:
@@ -53,11 +54,12 @@ class PlatoXYZPipeline : public PlatoVTKPipeline {
   int numAtoms;
   bool moleculeVisible;
   bool bondsVisible;
+  int currentFrame;
+
+  PlatoTrajectoryReader* trajectory;
+  PlatoXYZFrame* frame;
+  PlatoMoleculeGeometry* geometry;
 
-  vtkXYZMolReader* xyzReader;
-  vtkSphereSource* sphere;
-  vtkGlyph3D* atoms;
-  vtkTubeFilter* bonds;
   vtkPolyDataMapper* atomsMapper;
   vtkPolyDataMapper* bondsMapper;
   vtkProperty* actorProperties;
@@ -67,16 +69,21 @@ class PlatoXYZPipeline : public PlatoVTKPipeline {
  private:
   void init();
   void buildPipeline();
+  void loadFrame(int);
 
  public:
   PlatoXYZPipeline(char*);
   ~PlatoXYZPipeline();
   vtkActor* getAtomsActor();
   vtkActor* getBondsActor();
+  PlatoXYZFrame* getAtomFrame();
   void setMoleculeVisible(bool);
   void setBondsVisible(bool);
   bool isMoleculeVisible();
   bool isBondsVisible();
+  void setFrame(int);
+  int getFrame();
+  int getNumberOfFrames();
 };
 
 #define __PLATOXYZPIPELINE_H__
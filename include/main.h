@@ -35,6 +35,11 @@
 // macro definitions...
 #define PVS_VERSION "0.5 pre"
 #define PVS_MAX_ISOS 4
+#define PVS_STREAM_PORT 7600
+#define PVS_FRAME_PORT 7601
+#define PVS_LISTEN_ADDRESS "127.0.0.1"
+#define PVS_FRAME_TIME 100.0
+#define PVS_RELEASE_IDLE 60.0
 
 #ifndef PVS_BIN_NAME
 #define PVS_BIN_NAME "pvs"
@@ -48,31 +53,76 @@ class vtkObject;
 class vtkMutexLock;
 
 // Plato forward references...
+class PlatoCommandQueue;
 class PlatoDataReader;
+class PlatoDataSource;
+class PlatoIsoPipeline;
+class PlatoOrthoPipeline;
+class PlatoPipelineWorker;
 class PlatoRenderWindow;
+class PlatoSteeringSession;
 class PlatoVTKPipeline;
+class PlatoXYZPipeline;
 
 // class for the results of parseOptions...
 class OptionsData {
  public:
   char* rhoFilename;
   char* xyzFilename;
+  char* symmetryFilename;
+  char* shmName;
+  char* batchScript;
+  char* profileFile;
+  char* recordFile;
+  char* replayFile;
+  char* affinity;
+  char* listenAddress;
   int numIsos;
+  int numThreads;
+  int streamPort;
+  int publishPort;
+  double frameTime;
+  double latencyTarget;
+  double releaseIdle;
+  int supercell[3];
   bool useCutplane;
   bool useOrthoslice;
+  bool usePeriodic;
+  bool useProgressive;
   bool useReGIO;
   bool useSteering;
+  bool replayFast;
 
  public:
   OptionsData() {
     // these are the options defaults...
     rhoFilename = NULL;
     xyzFilename = NULL;
+    symmetryFilename = NULL;
+    shmName = NULL;
+    batchScript = NULL;
+    profileFile = NULL;
+    recordFile = NULL;
+    replayFile = NULL;
+    affinity = NULL;
+    listenAddress = (char*) PVS_LISTEN_ADDRESS;
     numIsos = 1;
+    numThreads = 0;
+    streamPort = PVS_STREAM_PORT;
+    publishPort = 0;
+    frameTime = PVS_FRAME_TIME;
+    latencyTarget = 0.0;
+    releaseIdle = PVS_RELEASE_IDLE;
+    supercell[0] = 1;
+    supercell[1] = 1;
+    supercell[2] = 1;
     useCutplane = false;
     useOrthoslice = false;
+    usePeriodic = true;
+    useProgressive = false;
     useReGIO = false;
     useSteering = true;
+    replayFast = false;
   }
 };
 
@@ -83,6 +133,19 @@ struct threadData {
   PlatoVTKPipeline* xyzPipeline;
   PlatoVTKPipeline* isoPipeline;
   PlatoVTKPipeline* orthoPipeline;
+  PlatoCommandQueue* commands;
+  PlatoSteeringSession* session;
+};
+
+// struct to pass data between the startup stages...
+struct startupData {
+  OptionsData* options;
+  PlatoDataSource* source;
+  PlatoDataReader* dataReader;
+  PlatoXYZPipeline* xyzPipeline;
+  PlatoIsoPipeline* isoPipeline;
+  PlatoOrthoPipeline* orthoPipeline;
+  PlatoPipelineWorker* worker;
 };
 
 // global variables...
@@ -91,11 +154,17 @@ extern volatile bool regLoopDone;
 extern vtkMutexLock* renderLock;
 extern vtkMutexLock* loopLock;
 extern sem_t regDone;
+extern sem_t regWake;
 
 // prototypes...
 void parseOptions(int, char*[], OptionsData*);
 void renderCallback(vtkObject*, unsigned long, void*, void*);
+double getTimeMillis();
 void usage();
+void loadMolecule(void*);
+void loadDensity(void*);
+void buildIsosurfaces(void*);
+void buildOrthoslice(void*);
 
 #define __PLATOMAIN_H__
 #endif // __PLATOMAIN_H__
@@ -34,13 +34,21 @@
 
 // Plato forward references...
 class PlatoIsoPipeline;
+class PlatoOrthoPipeline;
 class PlatoXYZPipeline;
+struct PlatoCommand;
+struct threadData;
 
 // prototypes...
 void regInit();
 void* regLoop(void*);
-void moleculeVisibility(PlatoXYZPipeline*, int, int);
-void isoChanged(PlatoIsoPipeline*, const char*, double*, int*);
+void queueCommand(threadData*, int, int, double);
+void applyCommand(PlatoCommand*, void*);
+void moleculeVisibility(PlatoXYZPipeline*, int);
+void bondsVisibility(PlatoXYZPipeline*, int);
+void changeFrame(PlatoXYZPipeline*, int);
+void isoVisibility(PlatoIsoPipeline*, int, int);
+void isoChanged(PlatoIsoPipeline*, int, double);
 void toggleOrthoslice(PlatoOrthoPipeline*, int);
 void toggleCutplane(PlatoIsoPipeline*, int);
 void regFinalise();
@@ -0,0 +1,391 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkCamera.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoBatchScript.h"
+#include "PlatoCommandQueue.h"
+#include "PlatoImageEncoder.h"
+#include "PlatoRenderWindow.h"
+#include "PlatoTaskPool.h"
+#include "PlatoTiledRenderer.h"
+#include "realitygrid.h"
+
+PlatoBatchScript::PlatoBatchScript(const char* name, PlatoRenderWindow* prw,
+				   threadData* td) {
+  filename = new char[strlen(name) + 1];
+  strcpy(filename, name);
+  outputPattern = new char[PVS_SCRIPT_LINE];
+  strcpy(outputPattern, "pvs%04d.png");
+
+  // the images are written on the task pool, which already leaves a
+  // processor for the render thread...
+  numEncoders = PlatoTaskPool::getPool()->getNumWorkers();
+  if(numEncoders < 1)
+    numEncoders = 1;
+  if(numEncoders > PVS_MAX_ENCODERS)
+    numEncoders = PVS_MAX_ENCODERS;
+  resolution[0] = 0;
+  resolution[1] = 0;
+  numImages = 0;
+  startTime = 0.0;
+  renderTime = 0.0;
+
+  window = prw;
+  pipelines = td;
+  encoder = NULL;
+  tiles = new PlatoTiledRenderer(prw);
+}
+
+PlatoBatchScript::~PlatoBatchScript() {
+  delete[] filename;
+  delete[] outputPattern;
+  if(encoder)
+    delete encoder;
+  delete tiles;
+}
+
+void PlatoBatchScript::run() {
+  FILE* script = fopen(filename, "r");
+  char line[PVS_SCRIPT_LINE];
+  int lineNum;
+
+  if(!script) {
+    std::cerr << "Could not open batch script " << filename << "\n";
+    exit(1);
+  }
+
+  // check the whole script first so a typo near the end doesn't cost a
+  // long run...
+  for(int pass = 0; pass < 2; pass++) {
+    rewind(script);
+    lineNum = 0;
+    while(fgets(line, PVS_SCRIPT_LINE, script)) {
+      lineNum++;
+      if(!execute(line, pass == 1)) {
+	std::cerr << filename << ":" << lineNum << ": bad command: " << line;
+	fclose(script);
+	exit(1);
+      }
+    }
+  }
+  fclose(script);
+
+  // wait for the last images to be written before timing the batch...
+  double encodeTime = 0.0;
+  double waitTime = 0.0;
+  int threads = numEncoders;
+  if(encoder) {
+    encoder->finish();
+    threads = encoder->getNumThreads();
+    encodeTime = encoder->getEncodeTime();
+    waitTime = encoder->getWaitTime();
+  }
+  double totalTime = getTimeMillis() - startTime;
+
+  if(numImages == 0)
+    return;
+  std::cout << "Wrote " << numImages << " images in " << totalTime / 1000.0;
+  std::cout << " s (" << (numImages * 1000.0) / totalTime << " frames/s)\n";
+  std::cout << "  render " << renderTime / numImages << " ms/frame, encode ";
+  std::cout << encodeTime / numImages << " ms/frame on " << threads;
+  std::cout << " threads, " << waitTime << " ms waiting for encoders\n";
+}
+
+bool PlatoBatchScript::execute(char* line, bool run) {
+  char word[PVS_SCRIPT_LINE];
+  char arg[PVS_SCRIPT_LINE];
+  int n = 0;
+  int i;
+  double x;
+  double y;
+  int on;
+
+  // strip comments, blank lines are fine...
+  char* hash = strchr(line, '#');
+  if(hash)
+    *hash = '\0';
+  if(sscanf(line, "%s", word) != 1)
+    return true;
+
+  if(strcmp(word, "size") == 0) {
+    if(sscanf(line, "%*s %d %d", &i, &n) != 2 || i < 1 || n < 1)
+      return false;
+    if(run)
+      window->setSize(i, n);
+  }
+  else if(strcmp(word, "resolution") == 0) {
+    if(sscanf(line, "%*s %d %d", &i, &n) != 2 || i < 1 || n < 1)
+      return false;
+    if(run) {
+      resolution[0] = i;
+      resolution[1] = n;
+    }
+  }
+  else if(strcmp(word, "output") == 0) {
+    if(sscanf(line, "%*s %s", arg) != 1)
+      return false;
+    if(!isPattern(arg)) {
+      std::cerr << "The output pattern needs exactly one %d, any other % ";
+      std::cerr << "written as %%.\n";
+      return false;
+    }
+    if(run)
+      strcpy(outputPattern, arg);
+  }
+  else if(strcmp(word, "encoders") == 0) {
+    // the encoder is made by the first render...
+    if(sscanf(line, "%*s %d", &n) != 1 || n < 1 || n > PVS_MAX_ENCODERS)
+      return false;
+    if(run && !encoder)
+      numEncoders = n;
+  }
+  else if(strcmp(word, "camera") == 0) {
+    n = sscanf(line, "%*s %s %lf", arg, &x);
+    if(n == 1 && strcmp(arg, "reset") == 0) {
+      if(run)
+	window->resetCamera();
+      return true;
+    }
+    if(n != 2)
+      return false;
+
+    vtkCamera* camera = window->getCamera();
+    if(strcmp(arg, "azimuth") == 0) {
+      if(run)
+	camera->Azimuth(x);
+    }
+    else if(strcmp(arg, "elevation") == 0) {
+      if(run) {
+	camera->Elevation(x);
+	camera->OrthogonalizeViewUp();
+      }
+    }
+    else if(strcmp(arg, "roll") == 0) {
+      if(run)
+	camera->Roll(x);
+    }
+    else if(strcmp(arg, "zoom") == 0) {
+      if(run)
+	camera->Zoom(x);
+    }
+    else if(strcmp(arg, "dolly") == 0) {
+      if(run)
+	camera->Dolly(x);
+    }
+    else {
+      return false;
+    }
+  }
+  else if(strcmp(word, "iso") == 0) {
+    if(!pipelines->isoPipeline)
+      return false;
+    if(sscanf(line, "%*s %d %s", &i, arg) != 2 || i < 0 || i >= PVS_MAX_ISOS)
+      return false;
+    if(toggle(arg, &on)) {
+      if(run)
+	command(PVS_CMD_ISO_VISIBLE, i, on);
+    }
+    else if(sscanf(arg, "%lf", &x) == 1) {
+      if(run)
+	command(PVS_CMD_ISO_VALUE, i, x);
+    }
+    else {
+      return false;
+    }
+  }
+  else if(strcmp(word, "ortho") == 0) {
+    if(!pipelines->orthoPipeline)
+      return false;
+    if(sscanf(line, "%*s %s", arg) != 1 || !toggle(arg, &on))
+      return false;
+    if(run)
+      command(PVS_CMD_ORTHOSLICE, 0, on);
+  }
+  else if(strcmp(word, "cut") == 0) {
+    if(!pipelines->isoPipeline)
+      return false;
+    if(sscanf(line, "%*s %s", arg) != 1 || !toggle(arg, &on))
+      return false;
+    if(run)
+      command(PVS_CMD_CUTPLANE, 0, on);
+  }
+  else if(strcmp(word, "molecule") == 0 || strcmp(word, "bonds") == 0) {
+    if(!pipelines->xyzPipeline)
+      return false;
+    if(sscanf(line, "%*s %s", arg) != 1 || !toggle(arg, &on))
+      return false;
+    if(run)
+      command((word[0] == 'm') ? PVS_CMD_MOLECULE_VISIBLE :
+	      PVS_CMD_BONDS_VISIBLE, 0, on);
+  }
+  else if(strcmp(word, "frame") == 0) {
+    if(!pipelines->xyzPipeline)
+      return false;
+    if(sscanf(line, "%*s %d", &n) != 1 || n < 0)
+      return false;
+    if(run)
+      command(PVS_CMD_FRAME, 0, n);
+  }
+  else if(strcmp(word, "render") == 0) {
+    n = 1;
+    if(sscanf(line, "%*s %d", &n) == 1 && n < 1)
+      return false;
+    if(run)
+      renderImages(n, 0.0);
+  }
+  else if(strcmp(word, "orbit") == 0) {
+    if(sscanf(line, "%*s %lf %d", &y, &n) != 2 || n < 1)
+      return false;
+    if(run)
+      renderImages(n, y / n);
+  }
+  else if(strcmp(word, "frames") == 0) {
+    if(!pipelines->xyzPipeline)
+      return false;
+    if(sscanf(line, "%*s %d %d", &i, &n) != 2 || i < 0 || n < i)
+      return false;
+    if(run)
+      renderFrames(i, n);
+  }
+  else if(strcmp(word, "poster") == 0) {
+    if(sscanf(line, "%*s %d %d %s", &i, &n, arg) != 3 || i < 1 || n < 1)
+      return false;
+    if(run)
+      tiles->renderPoster(i, n, arg);
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+bool PlatoBatchScript::isPattern(const char* pattern) {
+  // the pattern is given to snprintf with the image number, so it may
+  // only hold the one integer conversion, with flags and a width...
+  int numConversions = 0;
+  const char* p = pattern;
+
+  while(*p != '\0') {
+    if(*p++ != '%')
+      continue;
+    if(*p == '%') {
+      p++;
+      continue;
+    }
+    while(*p != '\0' && strchr("-+ #0", *p))
+      p++;
+    while(*p >= '0' && *p <= '9')
+      p++;
+    if(*p++ != 'd')
+      return false;
+    numConversions++;
+  }
+
+  return (numConversions == 1);
+}
+
+bool PlatoBatchScript::toggle(const char* arg, int* on) {
+  if(strcmp(arg, "on") == 0)
+    *on = 1;
+  else if(strcmp(arg, "off") == 0)
+    *on = 0;
+  else
+    return false;
+
+  return true;
+}
+
+void PlatoBatchScript::command(int type, int index, double value) {
+  // changes are made the same way steering makes them...
+  PlatoCommand cmd;
+  cmd.type = type;
+  cmd.index = index;
+  cmd.value = value;
+  applyCommand(&cmd, pipelines);
+}
+
+void PlatoBatchScript::renderImages(int n, double azimuth) {
+  char name[PVS_SCRIPT_LINE + 32];
+  unsigned char* pixels;
+  int width;
+  int height;
+  double start;
+
+  if(!encoder) {
+    encoder = new PlatoImageEncoder(numEncoders);
+    startTime = getTimeMillis();
+  }
+
+  // the encoders write one image while the next is being drawn...
+  for(int i = 0; i < n; i++) {
+    start = getTimeMillis();
+    if(resolution[0] > 0) {
+      width = resolution[0];
+      height = resolution[1];
+      pixels = tiles->renderImage(width, height);
+    }
+    else {
+      window->render();
+      pixels = window->grabImage(&width, &height);
+    }
+    renderTime += getTimeMillis() - start;
+
+    snprintf(name, sizeof(name), outputPattern, numImages);
+    encoder->encode(pixels, width, height, name);
+    numImages++;
+
+    // turn after each image so an orbit ends turned all the way round and
+    // whatever comes next doesn't repeat its last view...
+    if(azimuth != 0.0)
+      window->getCamera()->Azimuth(azimuth);
+  }
+}
+
+void PlatoBatchScript::renderFrames(int first, int last) {
+  // a movie of the trajectory, the camera stays where it is...
+  for(int frame = first; frame <= last; frame++) {
+    command(PVS_CMD_FRAME, 0, frame);
+    renderImages(1, 0.0);
+  }
+}
@@ -0,0 +1,97 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// plato includes...
+#include "PlatoCommandQueue.h"
+
+PlatoCommandQueue::PlatoCommandQueue() {
+  ring = new PlatoCommand[PVS_CMD_QUEUE_SIZE];
+  drained = new PlatoCommand[PVS_CMD_QUEUE_SIZE];
+  head = 0;
+  tail = 0;
+}
+
+PlatoCommandQueue::~PlatoCommandQueue() {
+  delete[] ring;
+  delete[] drained;
+}
+
+bool PlatoCommandQueue::push(int type, int index, double value) {
+  // the command is written before the render thread can see the new head
+  // (release) and a slot isn't reused until it's been read (acquire)...
+  unsigned int first = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+  // full? the caller can try again once the render thread catches up...
+  if((head - first) == PVS_CMD_QUEUE_SIZE)
+    return false;
+
+  PlatoCommand* cmd = &ring[head & (PVS_CMD_QUEUE_SIZE - 1)];
+  cmd->type = type;
+  cmd->index = index;
+  cmd->value = value;
+  __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+int PlatoCommandQueue::drain(PlatoCommandCallback apply, void* data) {
+  int count = 0;
+  unsigned int last = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+  // take everything that's there now...
+  for(unsigned int i = tail; i != last; i++)
+    drained[count++] = ring[i & (PVS_CMD_QUEUE_SIZE - 1)];
+  __atomic_store_n(&tail, last, __ATOMIC_RELEASE);
+
+  // only the latest of each kind of command matters, so drop any that are
+  // overtaken later in the batch and run the rest in order...
+  int applied = 0;
+  int i, j;
+  for(i = 0; i < count; i++) {
+    for(j = i + 1; j < count; j++) {
+      if(drained[j].type == drained[i].type &&
+	 drained[j].index == drained[i].index)
+	break;
+    }
+    if(j == count) {
+      apply(&drained[i], data);
+      applied++;
+    }
+  }
+
+  return applied;
+}
+
+bool PlatoCommandQueue::isEmpty() {
+  return (__atomic_load_n(&head, __ATOMIC_ACQUIRE) ==
+	  __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+}
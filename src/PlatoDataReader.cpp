@@ -32,10 +32,11 @@
 
 // system includes
 #include <iostream>
-#include <fstream>
+#include <istream>
 
 // vtk includes
 #include "vtkDelaunay3D.h"
+#include "vtkCellType.h"
 #include "vtkFloatArray.h"
 #include "vtkPointData.h"
 #include "vtkPoints.h"
@@ -45,30 +46,67 @@
 
 // plato includes
 #include "PlatoDataReader.h"
+#include "PlatoDataSource.h"
+#include "PlatoInputStream.h"
+#include "PlatoProfiler.h"
+#include "PlatoTaskPool.h"
 
 PlatoDataReader::PlatoDataReader(char* filename) {
   rhoFilename = filename;
+  source = NULL;
   uniformMesh = true;
+  periodic = true;
 
   dataDims = new int[3];
   dataRange = new double[2];
   dataCentre = new double[3];
   dataBounds = new double[6];
+  cellVectors = new double[9];
 
   dataPoints = vtkPoints::New();
   dataValues = vtkFloatArray::New();
   dataSet = NULL;
   delaunay = NULL;
+  boundary = NULL;
+  brickSize = 0;
+  brickStamps = NULL;
+  dataStamp = 0;
 
   readRhoFile();
   buildPipeline();
 }
 
+PlatoDataReader::PlatoDataReader(PlatoDataSource* ds) {
+  rhoFilename = NULL;
+  source = ds;
+  uniformMesh = true;
+  periodic = true;
+
+  dataDims = new int[3];
+  dataRange = new double[2];
+  dataCentre = new double[3];
+  dataBounds = new double[6];
+  cellVectors = new double[9];
+
+  dataPoints = vtkPoints::New();
+  dataValues = vtkFloatArray::New();
+  dataSet = NULL;
+  delaunay = NULL;
+  boundary = NULL;
+  brickSize = 0;
+  brickStamps = NULL;
+  dataStamp = 0;
+
+  readSource();
+  buildPipeline();
+}
+
 PlatoDataReader::~PlatoDataReader() {
   delete[] dataDims;
   delete[] dataRange;
   delete[] dataCentre;
   delete[] dataBounds;
+  delete[] cellVectors;
 
   dataPoints->Delete();
   dataValues->Delete();
@@ -76,73 +114,51 @@ PlatoDataReader::~PlatoDataReader() {
     dataSet->Delete();
   if(delaunay)
     delaunay->Delete();
+  if(boundary)
+    boundary->Delete();
+  delete[] brickStamps;
 }
 
 void PlatoDataReader::readRhoFile() {
+  PlatoProfileScope scope("reader.readRhoFile", PVS_PROF_READ);
+
   int numPoints = 0;
+  long numValues = 0;
   float tmpData[] = {0.0f, 0.0f, 0.0f, 0.0f};
-  float cellVec[9];
-  float bohr = 0.529177f;
+  double cellVec[9];
+  double bohr = 0.529177;
 
-  ifstream fin(rhoFilename);
-  if(!fin) {
+  // the file may be gzip or zstd compressed, it's decompressed as it's
+  // parsed...
+  PlatoInputStream input(rhoFilename);
+  if(!input.isOpen()) {
     std::cerr << "Could not open file: " << rhoFilename << std::endl;
     exit(1);
   }
+  std::istream fin(&input);
 
-  // read in the cellVec data...
-  for(int i = 0; i < 9; i++) {
-    fin >> cellVec[i];
-    cellVec[i] *= bohr;
-  }
+  readRhoHeader(fin, rhoFilename, cellVec, &uniformMesh, dataDims,
+		&numValues);
+  for(int i = 0; i < 9; i++)
+    cellVectors[i] = cellVec[i] * bohr;
+  numPoints = (int) numValues;
 
-  // read two other numbers, second one gives mesh type:
-  // 0: Uniform
-  // 1: Atom centred
-  fin >> numPoints;
-  fin >> numPoints;
-  if(numPoints == 1) {
-    uniformMesh = false;
-  }
-
-  // read number of points...
-  if(uniformMesh) {
-    for(int i = 0; i < 3; i++) {
-      fin >> dataDims[i];
-    }
-    numPoints = dataDims[0] * dataDims[1] * dataDims[2];
-  }
-  else {
-    fin >> numPoints;
-  }
   dataPoints->Allocate(numPoints, 1000);
   dataValues->SetNumberOfComponents(1);
   dataValues->SetNumberOfTuples(numPoints);
 
+  // the values are read in one at a time, so spread the pages over the
+  // workers first or they'd all end up next to this thread...
+  PlatoTaskPool::getPool()->firstTouch(dataValues->GetPointer(0),
+				       (long) numPoints * sizeof(float));
+
   // read points and data...
-  int index;
-  float len1, len2, len3;
   if(uniformMesh) {
-    for(int k = 0; k < dataDims[2]; k++) {
-      len3 = (float) k / (float) dataDims[2];
-      for(int j = 0; j < dataDims[1]; j++) {
-	len2 = (float) j / (float) dataDims[1];
-	for(int i = 0; i < dataDims[0]; i++) {
-	  len1 = (float) i / (float) dataDims[0];
-
-	  index = i + (j * dataDims[0]) + (k * dataDims[0] * dataDims[1]);
-    
-	  fin >> tmpData[3];
-	  dataValues->InsertValue(index, tmpData[3]);
-
-	  tmpData[0] = len1 * cellVec[0] + len2 * cellVec[3] + len3 * cellVec[6];
-	  tmpData[1] = len1 * cellVec[1] + len2 * cellVec[4] + len3 * cellVec[7];
-	  tmpData[2] = len1 * cellVec[2] + len2 * cellVec[5] + len3 * cellVec[8];
-
-	  dataPoints->InsertPoint(index, tmpData[0], tmpData[1], tmpData[2]);
-	} // i
-      } // j
-    } // k
+    for(int i = 0; i < numPoints; i++) {
+      fin >> tmpData[3];
+      dataValues->InsertValue(i, tmpData[3]);
+    }
+    buildUniformPoints();
   }
   else {
     for(int i = 0; i < numPoints; i++) {
@@ -154,11 +170,117 @@ void PlatoDataReader::readRhoFile() {
       dataValues->InsertValue(i, tmpData[3]);
     }
   }
+}
+
+void PlatoDataReader::readRhoHeader(std::istream& fin, const char* filename,
+				    double* cellVec, bool* uniform, int* dims,
+				    long* numPoints) {
+  int meshType = 0;
+
+  // the cell vectors in bohr...
+  for(int i = 0; i < 9; i++)
+    fin >> cellVec[i];
+
+  // read two other numbers, second one gives mesh type:
+  // 0: Uniform
+  // 1: Atom centred
+  fin >> meshType;
+  fin >> meshType;
+  *uniform = (meshType != 1);
 
-  fin.close();
+  // read number of points...
+  if(*uniform) {
+    *numPoints = 1;
+    for(int i = 0; i < 3; i++) {
+      fin >> dims[i];
+      if(dims[i] < 1)
+	fin.setstate(std::ios::failbit);
+      *numPoints *= dims[i];
+    }
+  }
+  else {
+    fin >> *numPoints;
+  }
+
+  if(!fin || *numPoints < 1) {
+    std::cerr << "Bad header in rho file: " << filename << std::endl;
+    exit(1);
+  }
+}
+
+void PlatoDataReader::readSource() {
+  PlatoProfileScope scope("reader.readSource", PVS_PROF_READ);
+
+  int numPoints;
+  double bohr = 0.529177;
+
+  // streamed data is always a uniform grid, the first frame is already in...
+  for(int i = 0; i < 3; i++)
+    dataDims[i] = source->getDataDimensions()[i];
+  for(int i = 0; i < 9; i++)
+    cellVectors[i] = source->getCellVectors()[i] * bohr;
+  numPoints = dataDims[0] * dataDims[1] * dataDims[2];
+
+  // the values are used in place, the source owns the memory...
+  dataValues->SetNumberOfComponents(1);
+  dataValues->SetArray(source->getFrontBuffer(), numPoints, 1);
+
+  dataPoints->Allocate(numPoints, 1000);
+  buildUniformPoints();
+
+  // if the source says which bricks change, remember when each did...
+  brickSize = source->getBrickSize();
+  if(brickSize > 0) {
+    int numBricks = 1;
+    for(int i = 0; i < 3; i++) {
+      brickDims[i] = (dataDims[i] + brickSize - 1) / brickSize;
+      numBricks *= brickDims[i];
+    }
+    brickStamps = new int[numBricks];
+    for(int i = 0; i < numBricks; i++)
+      brickStamps[i] = 0;
+  }
+}
+
+void PlatoDataReader::buildUniformPoints() {
+  // every point is set so the whole array is made at once, then filled a
+  // plane at a time on the task pool, which puts it in the memory of the
+  // threads that will contour it...
+  dataPoints->SetNumberOfPoints(dataDims[0] * dataDims[1] * dataDims[2]);
+  PlatoTaskPool::getPool()->run(fillPointsPlane, this, dataDims[2]);
+}
+
+void PlatoDataReader::fillPointsPlane(int k, void* data) {
+  PlatoDataReader* reader = (PlatoDataReader*) data;
+  int* dims = reader->dataDims;
+  float* points = (float*) reader->dataPoints->GetVoidPointer(0);
+  float* p;
+  float cellVec[9];
+  float len1, len2, len3;
+  int index;
+
+  for(int i = 0; i < 9; i++)
+    cellVec[i] = (float) reader->cellVectors[i];
+
+  len3 = (float) k / (float) dims[2];
+  for(int j = 0; j < dims[1]; j++) {
+    len2 = (float) j / (float) dims[1];
+    for(int i = 0; i < dims[0]; i++) {
+      len1 = (float) i / (float) dims[0];
+
+      index = i + (j * dims[0]) + (k * dims[0] * dims[1]);
+
+      p = &points[3 * index];
+      p[0] = len1 * cellVec[0] + len2 * cellVec[3] + len3 * cellVec[6];
+      p[1] = len1 * cellVec[1] + len2 * cellVec[4] + len3 * cellVec[7];
+      p[2] = len1 * cellVec[2] + len2 * cellVec[5] + len3 * cellVec[8];
+    } // i
+  } // j
 }
 
 void PlatoDataReader::buildPipeline() {
+  PlatoProfileScope scope("reader.buildPipeline", PVS_PROF_BUILD);
+
   if(uniformMesh) {
     dataSet = vtkStructuredGrid::New();
     static_cast<vtkStructuredGrid*>(dataSet)->SetDimensions(dataDims);
@@ -169,20 +291,154 @@ void PlatoDataReader::buildPipeline() {
     dataSet = vtkUnstructuredGrid::New();
     dataSet->SetPoints(dataPoints);
     dataSet->GetPointData()->SetScalars(dataValues);
-
-    // with an unstructured grid a delaunay triangulation is required...
-    delaunay = vtkDelaunay3D::New();
-    delaunay->SetInput(dataSet);
-    delaunay->SetAlpha(0.0);
-    delaunay->SetTolerance(0.0001);
-    delaunay->SetOffset(2.5);
-    delaunay->BoundingTriangulationOff();
   }
 
   dataSet->Update();
   dataSet->GetScalarRange(dataRange);
+  findBounds();
+}
+
+void PlatoDataReader::findBounds() {
   dataSet->GetCenter(dataCentre);
   dataSet->GetBounds(dataBounds);
+
+  // a periodic grid covers the whole cell, not just up to the last sample...
+  if(uniformMesh && periodic) {
+    double corner;
+    for(int d = 0; d < 3; d++) {
+      dataBounds[2 * d] = 0.0;
+      dataBounds[(2 * d) + 1] = 0.0;
+      for(int c = 0; c < 8; c++) {
+	corner = ((c & 1) ? cellVectors[d] : 0.0) +
+	  ((c & 2) ? cellVectors[3 + d] : 0.0) +
+	  ((c & 4) ? cellVectors[6 + d] : 0.0);
+	if(corner < dataBounds[2 * d])
+	  dataBounds[2 * d] = corner;
+	if(corner > dataBounds[(2 * d) + 1])
+	  dataBounds[(2 * d) + 1] = corner;
+      }
+      dataCentre[d] = 0.5 * (cellVectors[d] + cellVectors[3 + d] +
+			     cellVectors[6 + d]);
+    }
+  }
+}
+
+void PlatoDataReader::buildBoundary() {
+  int d0 = dataDims[0];
+  int d1 = dataDims[1];
+  int d2 = dataDims[2];
+  float cellVec[9];
+  float len1, len2, len3;
+  int i, j, k;
+
+  for(i = 0; i < 9; i++)
+    cellVec[i] = (float) cellVectors[i];
+
+  // the grid samples fractional coordinates i/dims so the cells between the
+  // last sample and the first one's periodic image are missing. Rather
+  // than pad the whole field, build just that shell of cells: every cell
+  // of the (dims + 1) grid that touches its last layer in some direction.
+  // Points in a row are numbered in full if the row is in the last two
+  // layers in j or k, otherwise only its last two points exist...
+  int* rowStart = new int[(d1 + 1) * (d2 + 1)];
+  int numPoints = 0;
+  for(k = 0; k <= d2; k++) {
+    for(j = 0; j <= d1; j++) {
+      rowStart[j + ((d1 + 1) * k)] = numPoints;
+      numPoints += (j >= (d1 - 1) || k >= (d2 - 1)) ? (d0 + 1) : 2;
+    }
+  }
+
+  vtkPoints* points = vtkPoints::New();
+  vtkFloatArray* scalars = vtkFloatArray::New();
+  points->SetNumberOfPoints(numPoints);
+  scalars->SetNumberOfComponents(1);
+  scalars->SetNumberOfTuples(numPoints);
+
+  int id = 0;
+  int first;
+  for(k = 0; k <= d2; k++) {
+    len3 = (float) k / (float) d2;
+    for(j = 0; j <= d1; j++) {
+      len2 = (float) j / (float) d1;
+      first = (j >= (d1 - 1) || k >= (d2 - 1)) ? 0 : (d0 - 1);
+      for(i = first; i <= d0; i++) {
+	len1 = (float) i / (float) d0;
+	points->SetPoint(id,
+			 len1 * cellVec[0] + len2 * cellVec[3] + len3 * cellVec[6],
+			 len1 * cellVec[1] + len2 * cellVec[4] + len3 * cellVec[7],
+			 len1 * cellVec[2] + len2 * cellVec[5] + len3 * cellVec[8]);
+	id++;
+      } // i
+    } // j
+  } // k
+
+  // now the hexahedra, again only those that touch the last layer...
+  vtkIdType hex[8];
+  int c[8][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+		 {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
+  int pi, pj, pk, row;
+  boundary = vtkUnstructuredGrid::New();
+  boundary->Allocate((d0 * d1 * d2) - ((d0 - 1) * (d1 - 1) * (d2 - 1)));
+  for(k = 0; k < d2; k++) {
+    for(j = 0; j < d1; j++) {
+      first = (j == (d1 - 1) || k == (d2 - 1)) ? 0 : (d0 - 1);
+      for(i = first; i < d0; i++) {
+	for(int v = 0; v < 8; v++) {
+	  pi = i + c[v][0];
+	  pj = j + c[v][1];
+	  pk = k + c[v][2];
+	  row = pj + ((d1 + 1) * pk);
+	  hex[v] = rowStart[row] + ((pj >= (d1 - 1) || pk >= (d2 - 1)) ? pi :
+				    pi - (d0 - 1));
+	}
+	boundary->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+      } // i
+    } // j
+  } // k
+
+  boundary->SetPoints(points);
+  boundary->GetPointData()->SetScalars(scalars);
+  points->Delete();
+  scalars->Delete();
+  delete[] rowStart;
+
+  fillBoundaryValues();
+}
+
+void PlatoDataReader::fillBoundaryValues() {
+  int d0 = dataDims[0];
+  int d1 = dataDims[1];
+  int d2 = dataDims[2];
+  float* values = dataValues->GetPointer(0);
+  float* scalars =
+    ((vtkFloatArray*) boundary->GetPointData()->GetScalars())->GetPointer(0);
+
+  // the shell points are in the same order they were made in...
+  int id = 0;
+  int first;
+  for(int k = 0; k <= d2; k++) {
+    for(int j = 0; j <= d1; j++) {
+      first = (j >= (d1 - 1) || k >= (d2 - 1)) ? 0 : (d0 - 1);
+      for(int i = first; i <= d0; i++) {
+	scalars[id++] = values[(i % d0) + (d0 * ((j % d1) + (d1 * (k % d2))))];
+      } // i
+    } // j
+  } // k
+
+  boundary->GetPointData()->GetScalars()->Modified();
+  boundary->Modified();
+}
+
+void PlatoDataReader::buildDelaunay() {
+  // with an unstructured grid a delaunay triangulation is required...
+  delaunay = vtkDelaunay3D::New();
+  delaunay->SetInput(dataSet);
+  delaunay->SetAlpha(0.0);
+  delaunay->SetTolerance(0.0001);
+  delaunay->SetOffset(2.5);
+  delaunay->BoundingTriangulationOff();
+  PlatoProfiler::watch(delaunay, "reader.delaunay", PVS_PROF_DELAUNAY);
 }
 
 vtkPointSet* PlatoDataReader::getData() {
@@ -190,6 +446,9 @@ vtkPointSet* PlatoDataReader::getData() {
     return dataSet;
   }
   else {
+    // the triangulation is only made once something asks for it...
+    if(!delaunay)
+      buildDelaunay();
     return delaunay->GetOutput();
   }
 }
@@ -210,6 +469,290 @@ double* PlatoDataReader::getDataBounds() {
   return dataBounds;
 }
 
+double* PlatoDataReader::getCellVectors() {
+  return cellVectors;
+}
+
+vtkUnstructuredGrid* PlatoDataReader::getPeriodicBoundary() {
+  // only the uniform grid is periodic...
+  if(!uniformMesh)
+    return NULL;
+
+  if(!boundary)
+    buildBoundary();
+
+  return boundary;
+}
+
+vtkStructuredGrid* PlatoDataReader::extractRegion(int* low, int* high) {
+  // a block of grid points from low to high inclusive, the upper end may
+  // run on to the periodic images of the first layer. The caller owns
+  // (and has to Delete) the grid...
+  int d0 = dataDims[0];
+  int d1 = dataDims[1];
+  int d2 = dataDims[2];
+  int dims[3];
+  float cellVec[9];
+  float len1, len2, len3;
+
+  for(int i = 0; i < 9; i++)
+    cellVec[i] = (float) cellVectors[i];
+  for(int i = 0; i < 3; i++)
+    dims[i] = high[i] - low[i] + 1;
+
+  vtkPoints* points = vtkPoints::New();
+  vtkFloatArray* scalars = vtkFloatArray::New();
+  points->SetNumberOfPoints(dims[0] * dims[1] * dims[2]);
+  scalars->SetNumberOfComponents(1);
+  scalars->SetNumberOfTuples(dims[0] * dims[1] * dims[2]);
+
+  int id = 0;
+  for(int k = low[2]; k <= high[2]; k++) {
+    len3 = (float) k / (float) d2;
+    for(int j = low[1]; j <= high[1]; j++) {
+      len2 = (float) j / (float) d1;
+      for(int i = low[0]; i <= high[0]; i++) {
+	len1 = (float) i / (float) d0;
+	points->SetPoint(id,
+			 len1 * cellVec[0] + len2 * cellVec[3] + len3 * cellVec[6],
+			 len1 * cellVec[1] + len2 * cellVec[4] + len3 * cellVec[7],
+			 len1 * cellVec[2] + len2 * cellVec[5] + len3 * cellVec[8]);
+	id++;
+      } // i
+    } // j
+  } // k
+
+  vtkStructuredGrid* region = vtkStructuredGrid::New();
+  region->SetDimensions(dims);
+  region->SetPoints(points);
+  region->GetPointData()->SetScalars(scalars);
+  points->Delete();
+  scalars->Delete();
+
+  fillRegion(region, low, high);
+
+  return region;
+}
+
+void PlatoDataReader::fillRegion(vtkStructuredGrid* region, int* low,
+				  int* high) {
+  // (re)load the values of a grid made by extractRegion...
+  int d0 = dataDims[0];
+  int d1 = dataDims[1];
+  int d2 = dataDims[2];
+  float* values = dataValues->GetPointer(0);
+  float* scalars =
+    ((vtkFloatArray*) region->GetPointData()->GetScalars())->GetPointer(0);
+
+  int id = 0;
+  for(int k = low[2]; k <= high[2]; k++) {
+    for(int j = low[1]; j <= high[1]; j++) {
+      for(int i = low[0]; i <= high[0]; i++) {
+	scalars[id++] = values[(i % d0) + (d0 * ((j % d1) + (d1 * (k % d2))))];
+      } // i
+    } // j
+  } // k
+
+  region->GetPointData()->GetScalars()->Modified();
+  region->Modified();
+}
+
 bool PlatoDataReader::isUniformMesh() {
   return uniformMesh;
 }
+
+void PlatoDataReader::setPeriodic(bool toggle) {
+  // the bounds and centre are shared with the pipelines, so they're
+  // changed in place...
+  periodic = toggle;
+  findBounds();
+}
+
+bool PlatoDataReader::isPeriodic() {
+  return periodic;
+}
+
+bool PlatoDataReader::acquireFrame() {
+  // called on the worker thread before the filters run...
+  if(!source || !source->acquireFrame())
+    return false;
+
+  int numPoints = dataDims[0] * dataDims[1] * dataDims[2];
+  dataValues->SetArray(source->getFrontBuffer(), numPoints, 1);
+  dataValues->Modified();
+  dataSet->Modified();
+
+  dataStamp++;
+  if(brickStamps) {
+    const unsigned char* dirty = source->getDirtyBricks();
+    int numBricks = brickDims[0] * brickDims[1] * brickDims[2];
+    for(int i = 0; i < numBricks; i++) {
+      if(!dirty || dirty[i])
+	brickStamps[i] = dataStamp;
+    }
+  }
+
+  if(boundary && isBoundaryDirty(dataStamp - 1))
+    fillBoundaryValues();
+
+  return true;
+}
+
+bool PlatoDataReader::isFrameWaiting() {
+  return (source && source->isFrameWaiting());
+}
+
+int PlatoDataReader::getFrameNumber() {
+  if(!source)
+    return 0;
+
+  return source->getFrameNumber();
+}
+
+bool PlatoDataReader::isStreamed() {
+  return (source != NULL);
+}
+
+int PlatoDataReader::getDataStamp() {
+  return dataStamp;
+}
+
+bool PlatoDataReader::isRegionDirty(int* low, int* high, int since) {
+  // has anything in the block of grid points from low to high (which may
+  // run on to the periodic images as in extractRegion) changed since the
+  // given stamp...
+  if(since >= dataStamp)
+    return false;
+  if(!brickStamps)
+    return true;
+
+  bool* touched[3];
+  for(int a = 0; a < 3; a++) {
+    touched[a] = new bool[brickDims[a]];
+    for(int b = 0; b < brickDims[a]; b++)
+      touched[a][b] = false;
+    for(int i = low[a]; i <= high[a]; i++)
+      touched[a][(i % dataDims[a]) / brickSize] = true;
+  }
+
+  bool found = false;
+  for(int k = 0; k < brickDims[2] && !found; k++) {
+    for(int j = 0; j < brickDims[1] && !found; j++) {
+      for(int i = 0; i < brickDims[0] && !found; i++) {
+	if(touched[0][i] && touched[1][j] && touched[2][k] &&
+	   brickStamps[i + (brickDims[0] * (j + (brickDims[1] * k)))] > since)
+	  found = true;
+      } // i
+    } // j
+  } // k
+
+  for(int a = 0; a < 3; a++)
+    delete[] touched[a];
+
+  return found;
+}
+
+bool PlatoDataReader::isPlaneDirty(double* origin, double* normal,
+				   int since) {
+  // has anything that the plane passes through changed since the given
+  // stamp. A brick is a parallelepiped so it's cut if its corners aren't
+  // all on the same side...
+  if(since >= dataStamp)
+    return false;
+  if(!brickStamps)
+    return true;
+
+  double f[3][2];
+  double strip[3][2];
+  double box[3][2];
+  bool wraps[3];
+  int b[3];
+  int id = 0;
+
+  for(b[2] = 0; b[2] < brickDims[2]; b[2]++) {
+    for(b[1] = 0; b[1] < brickDims[1]; b[1]++) {
+      for(b[0] = 0; b[0] < brickDims[0]; b[0]++, id++) {
+	if(brickStamps[id] <= since)
+	  continue;
+
+	// a brick's points are corners of the cells either side of it, so
+	// it starts a grid point early. The last brick along an edge takes
+	// in the periodic boundary and the first has its images in the
+	// strip of cells next to it...
+	for(int a = 0; a < 3; a++) {
+	  f[a][0] = (double) ((b[a] * brickSize) - 1) / dataDims[a];
+	  f[a][1] = (double) ((b[a] + 1) * brickSize) / dataDims[a];
+	  if(f[a][0] < 0.0)
+	    f[a][0] = 0.0;
+	  if(f[a][1] > 1.0)
+	    f[a][1] = 1.0;
+	  strip[a][0] = (double) (dataDims[a] - 1) / dataDims[a];
+	  strip[a][1] = 1.0;
+	  wraps[a] = (b[a] == 0);
+	}
+
+	// each axis is either the brick or its strip...
+	for(int w = 0; w < 8; w++) {
+	  bool skip = false;
+	  for(int a = 0; a < 3; a++) {
+	    bool inStrip = ((w >> a) & 1) != 0;
+	    if(inStrip && !wraps[a])
+	      skip = true;
+	    box[a][0] = inStrip ? strip[a][0] : f[a][0];
+	    box[a][1] = inStrip ? strip[a][1] : f[a][1];
+	  }
+	  if(!skip && isBoxCut(box, origin, normal))
+	    return true;
+	}
+      } // b[0]
+    } // b[1]
+  } // b[2]
+
+  return false;
+}
+
+bool PlatoDataReader::isBoxCut(double box[3][2], double* origin,
+			       double* normal) {
+  // does the plane pass through the part of the cell between the given
+  // fractional coordinates...
+  double corner[3];
+  double distance;
+  bool below = false;
+  bool above = false;
+
+  for(int c = 0; c < 8; c++) {
+    distance = 0.0;
+    for(int d = 0; d < 3; d++) {
+      corner[d] = (box[0][c & 1] * cellVectors[d]) +
+	(box[1][(c >> 1) & 1] * cellVectors[3 + d]) +
+	(box[2][(c >> 2) & 1] * cellVectors[6 + d]);
+      distance += (corner[d] - origin[d]) * normal[d];
+    }
+    if(distance <= 0.0)
+      below = true;
+    if(distance >= 0.0)
+      above = true;
+  }
+
+  return (below && above);
+}
+
+bool PlatoDataReader::isBoundaryDirty(int since) {
+  // the periodic shell is the last layer of points in each direction and
+  // the images of the first...
+  int low[3];
+  int high[3];
+
+  for(int a = 0; a < 3; a++) {
+    for(int i = 0; i < 3; i++) {
+      low[i] = 0;
+      high[i] = dataDims[i] - 1;
+    }
+    low[a] = dataDims[a] - 1;
+    high[a] = dataDims[a];
+    if(isRegionDirty(low, high, since))
+      return true;
+  }
+
+  return false;
+}
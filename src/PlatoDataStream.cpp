@@ -0,0 +1,499 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoDataStream.h"
+#include "PlatoRenderWindow.h"
+
+PlatoDataStream::PlatoDataStream(const char* listenAddress, int p) {
+  port = p;
+  dataSocket = -1;
+  numValues = 0;
+  swapped = false;
+  for(int i = 0; i < 3; i++) {
+    buffers[i] = NULL;
+    stale[i] = NULL;
+  }
+  latest = NULL;
+  haveLatest = false;
+  numBricks = 0;
+  dirty = NULL;
+  brickValues = NULL;
+  filling = 0;
+  ready = 1;
+  front = 2;
+  frameWaiting = false;
+  frontFrame = 0;
+  readyFrame = 0;
+  done = false;
+
+  window = NULL;
+  thread = vtkMultiThreader::New();
+  threadID = -1;
+  bufferLock = vtkMutexLock::New();
+
+  // the simulation connects to us. Anyone who can connect can send us
+  // data, so it's only this machine unless another interface is asked
+  // for...
+  struct sockaddr_in address;
+  int on = 1;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if(inet_pton(AF_INET, listenAddress, &address.sin_addr) != 1) {
+    std::cerr << "Bad address to listen on: " << listenAddress << std::endl;
+    exit(1);
+  }
+
+  listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if(listenSocket < 0 ||
+     setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+     bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) < 0 ||
+     listen(listenSocket, 1) < 0) {
+    std::cerr << "Could not listen on port " << port << ": ";
+    std::cerr << strerror(errno) << std::endl;
+    exit(1);
+  }
+}
+
+PlatoDataStream::~PlatoDataStream() {
+  stop();
+  close(listenSocket);
+
+  for(int i = 0; i < 3; i++) {
+    free(buffers[i]);
+    delete[] stale[i];
+  }
+  free(latest);
+  delete[] dirty;
+  delete[] brickValues;
+
+  thread->Delete();
+  bufferLock->Delete();
+}
+
+bool PlatoDataStream::acceptConnection() {
+  int s = accept(listenSocket, NULL, NULL);
+
+  bufferLock->Lock();
+  dataSocket = s;
+  bufferLock->Unlock();
+
+  return (s >= 0);
+}
+
+bool PlatoDataStream::readFully(void* buffer, long bytes) {
+  char* next = (char*) buffer;
+  long got;
+
+  while(bytes > 0) {
+    got = recv(dataSocket, next, bytes, 0);
+    if(got < 0 && errno == EINTR)
+      continue;
+    if(got <= 0)
+      return false;
+
+    next += got;
+    bytes -= got;
+  }
+
+  return true;
+}
+
+bool PlatoDataStream::readFrame(int slot, int* frame) {
+  PlatoStreamHeader h;
+
+  if(!readFully(&h, sizeof(h)))
+    return false;
+
+  // a version that only reads right backwards means the sender has the
+  // other byte order...
+  swapped = (h.version != PVS_STREAM_VERSION);
+  if(swapped) {
+    swapBytes(&h.version, sizeof(int), 1);
+    swapBytes(&h.frame, sizeof(int), 1);
+    swapBytes(h.dims, sizeof(int), 3);
+    swapBytes(h.cellVectors, sizeof(double), 9);
+    swapBytes(&h.encoding, sizeof(int), 1);
+    swapBytes(&h.numBricks, sizeof(int), 1);
+    swapBytes(&h.quantum, sizeof(float), 1);
+  }
+
+  if(strncmp(h.magic, "PVSD", 4) != 0 || h.version != PVS_STREAM_VERSION) {
+    std::cerr << "Bad frame header on the data stream.\n";
+    return false;
+  }
+
+  // the first frame sets the grid, the rest must match it. The size is
+  // checked a dimension at a time so it can't overflow...
+  if(!buffers[0]) {
+    long points = 1;
+    for(int i = 0; i < 3; i++) {
+      if(h.dims[i] < 2 || (points * h.dims[i]) > PVS_STREAM_MAX_POINTS) {
+	std::cerr << "Bad grid size on the data stream.\n";
+	return false;
+      }
+      points *= h.dims[i];
+    }
+    header = h;
+    numValues = points;
+
+    // page aligned so the network stack can write them directly...
+    long page = sysconf(_SC_PAGESIZE);
+    for(int i = 0; i < 4; i++) {
+      void* p;
+      if(posix_memalign(&p, page, numValues * sizeof(float)) != 0) {
+	std::cerr << "Could not allocate stream buffers.\n";
+	exit(1);
+      }
+      if(i < 3)
+	buffers[i] = (float*) p;
+      else
+	latest = (float*) p;
+    }
+
+    // each buffer keeps track of the bricks where it's behind the latest
+    // frame...
+    numBricks = 1;
+    for(int i = 0; i < 3; i++) {
+      brickDims[i] = (h.dims[i] + PVS_STREAM_BRICK_SIZE - 1) /
+	PVS_STREAM_BRICK_SIZE;
+      numBricks *= brickDims[i];
+    }
+    for(int i = 0; i < 3; i++) {
+      stale[i] = new unsigned char[numBricks];
+      memset(stale[i], 0, numBricks);
+    }
+    dirty = new unsigned char[numBricks];
+    memset(dirty, 1, numBricks);
+    brickValues = new float[PVS_STREAM_BRICK_SIZE * PVS_STREAM_BRICK_SIZE *
+			    PVS_STREAM_BRICK_SIZE];
+  }
+  else if(h.dims[0] != header.dims[0] || h.dims[1] != header.dims[1] ||
+	  h.dims[2] != header.dims[2]) {
+    std::cerr << "Frame " << h.frame << " doesn't match the grid size.\n";
+    return false;
+  }
+
+  if(h.encoding == PVS_STREAM_FULL) {
+    if(!readFully(buffers[slot], numValues * sizeof(float)))
+      return false;
+    if(swapped)
+      swapBytes(buffers[slot], sizeof(float), numValues);
+
+    // keep a copy for the deltas to build on...
+    memcpy(latest, buffers[slot], numValues * sizeof(float));
+    haveLatest = true;
+    markAllStale(slot);
+  }
+  else if(h.encoding == PVS_STREAM_DELTA ||
+	  h.encoding == PVS_STREAM_DELTA_QUANTISED) {
+    if(!haveLatest) {
+      std::cerr << "Delta frame " << h.frame << " without a full frame ";
+      std::cerr << "before it.\n";
+      return false;
+    }
+    if(!readDelta(&h))
+      return false;
+
+    // now bring this buffer up to date, only the bricks it's behind in...
+    int low[3];
+    int size[3];
+    long row;
+    for(int b = 0; b < numBricks; b++) {
+      if(!stale[slot][b])
+	continue;
+
+      getBrick(b, low, size);
+      for(int k = 0; k < size[2]; k++) {
+	for(int j = 0; j < size[1]; j++) {
+	  row = low[0] + (header.dims[0] * ((low[1] + j) +
+					    (header.dims[1] * (low[2] + k))));
+	  memcpy(buffers[slot] + row, latest + row, size[0] * sizeof(float));
+	} // j
+      } // k
+      stale[slot][b] = 0;
+    }
+  }
+  else {
+    std::cerr << "Unknown encoding on frame " << h.frame << ".\n";
+    return false;
+  }
+
+  *frame = h.frame;
+  return true;
+}
+
+bool PlatoDataStream::readDelta(PlatoStreamHeader* h) {
+  bool quantised = (h->encoding == PVS_STREAM_DELTA_QUANTISED);
+  short* shorts = (short*) brickValues;
+  int low[3];
+  int size[3];
+  int brick;
+  int count;
+  long row;
+
+  // apply each brick to the latest frame as it comes in...
+  for(int n = 0; n < h->numBricks; n++) {
+    if(!readFully(&brick, sizeof(int)))
+      return false;
+    if(swapped)
+      swapBytes(&brick, sizeof(int), 1);
+    if(brick < 0 || brick >= numBricks) {
+      std::cerr << "Bad brick number in frame " << h->frame << ".\n";
+      return false;
+    }
+
+    getBrick(brick, low, size);
+    count = size[0] * size[1] * size[2];
+    if(!readFully(brickValues, count * (quantised ? sizeof(short) :
+					 sizeof(float))))
+      return false;
+    if(swapped)
+      swapBytes(brickValues, quantised ? sizeof(short) : sizeof(float), count);
+
+    count = 0;
+    for(int k = 0; k < size[2]; k++) {
+      for(int j = 0; j < size[1]; j++) {
+	row = low[0] + (header.dims[0] * ((low[1] + j) +
+					  (header.dims[1] * (low[2] + k))));
+	for(int i = 0; i < size[0]; i++) {
+	  if(quantised)
+	    latest[row + i] += (float) shorts[count] * h->quantum;
+	  else
+	    latest[row + i] += brickValues[count];
+	  count++;
+	} // i
+      } // j
+    } // k
+
+    // every buffer is behind here now, including the one being filled...
+    bufferLock->Lock();
+    for(int i = 0; i < 3; i++)
+      stale[i][brick] = 1;
+    bufferLock->Unlock();
+  }
+
+  return true;
+}
+
+void PlatoDataStream::getBrick(int brick, int* low, int* size) {
+  int b[3];
+
+  b[0] = brick % brickDims[0];
+  b[1] = (brick / brickDims[0]) % brickDims[1];
+  b[2] = brick / (brickDims[0] * brickDims[1]);
+
+  // the last bricks along each edge are cut short by the grid...
+  for(int i = 0; i < 3; i++) {
+    low[i] = b[i] * PVS_STREAM_BRICK_SIZE;
+    size[i] = header.dims[i] - low[i];
+    if(size[i] > PVS_STREAM_BRICK_SIZE)
+      size[i] = PVS_STREAM_BRICK_SIZE;
+  }
+}
+
+void PlatoDataStream::swapBytes(void* data, int size, long count) {
+  unsigned char* p = (unsigned char*) data;
+  unsigned char t;
+
+  for(long n = 0; n < count; n++, p += size) {
+    for(int i = 0; i < (size / 2); i++) {
+      t = p[i];
+      p[i] = p[size - 1 - i];
+      p[size - 1 - i] = t;
+    }
+  }
+}
+
+void PlatoDataStream::markAllStale(int slot) {
+  // a full frame leaves every other buffer behind everywhere...
+  bufferLock->Lock();
+  for(int i = 0; i < 3; i++)
+    memset(stale[i], (i == slot) ? 0 : 1, numBricks);
+  bufferLock->Unlock();
+}
+
+void PlatoDataStream::waitForFirstFrame() {
+  std::cout << "Waiting for data on port " << port << "...\n";
+
+  // the pipelines can't be built until we know what the grid is...
+  while(true) {
+    if(!acceptConnection()) {
+      std::cerr << "Could not accept a connection: " << strerror(errno);
+      std::cerr << std::endl;
+      exit(1);
+    }
+    if(readFrame(front, &frontFrame))
+      break;
+
+    close(dataSocket);
+  }
+}
+
+void PlatoDataStream::start(PlatoRenderWindow* prw) {
+  window = prw;
+  threadID = thread->SpawnThread(receiveLoop, this);
+}
+
+void PlatoDataStream::stop() {
+  if(threadID < 0)
+    return;
+
+  // knock the thread out of accept() or recv()...
+  bufferLock->Lock();
+  done = true;
+  if(dataSocket >= 0)
+    shutdown(dataSocket, SHUT_RDWR);
+  bufferLock->Unlock();
+  shutdown(listenSocket, SHUT_RDWR);
+
+  thread->TerminateThread(threadID);
+  threadID = -1;
+}
+
+void* PlatoDataStream::receiveLoop(void* userData) {
+  PlatoDataStream* stream = (PlatoDataStream*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  int frame;
+  int slot;
+  bool done;
+
+  while(true) {
+    if(!stream->readFrame(stream->filling, &frame)) {
+      // the simulation has gone, wait for it (or another) to come back. It
+      // has to start again with a full frame...
+      stream->haveLatest = false;
+      stream->bufferLock->Lock();
+      close(stream->dataSocket);
+      stream->dataSocket = -1;
+      done = stream->done;
+      stream->bufferLock->Unlock();
+
+      if(done || !stream->acceptConnection())
+	break;
+      continue;
+    }
+
+    // this is now the latest frame, any older one not yet taken is dropped
+    // and its buffer filled next...
+    stream->bufferLock->Lock();
+    slot = stream->ready;
+    stream->ready = stream->filling;
+    stream->filling = slot;
+    stream->readyFrame = frame;
+    stream->frameWaiting = true;
+    stream->bufferLock->Unlock();
+
+    stream->window->requestRender();
+  }
+
+  return NULL;
+}
+
+int* PlatoDataStream::getDataDimensions() {
+  return header.dims;
+}
+
+double* PlatoDataStream::getCellVectors() {
+  return header.cellVectors;
+}
+
+float* PlatoDataStream::getFrontBuffer() {
+  return buffers[front];
+}
+
+int PlatoDataStream::getFrameNumber() {
+  int frame;
+
+  bufferLock->Lock();
+  frame = frontFrame;
+  bufferLock->Unlock();
+
+  return frame;
+}
+
+bool PlatoDataStream::isFrameWaiting() {
+  bool waiting;
+
+  bufferLock->Lock();
+  waiting = frameWaiting;
+  bufferLock->Unlock();
+
+  return waiting;
+}
+
+bool PlatoDataStream::acquireFrame() {
+  bool taken = false;
+  int slot;
+
+  // swap the latest frame in, the old one goes back to the receiver...
+  bufferLock->Lock();
+  if(frameWaiting) {
+    // anywhere either buffer is behind the latest frame they may differ...
+    for(int b = 0; b < numBricks; b++)
+      dirty[b] = stale[front][b] | stale[ready][b];
+
+    slot = front;
+    front = ready;
+    ready = slot;
+    frontFrame = readyFrame;
+    frameWaiting = false;
+    taken = true;
+  }
+  bufferLock->Unlock();
+
+  return taken;
+}
+
+int PlatoDataStream::getBrickSize() {
+  return PVS_STREAM_BRICK_SIZE;
+}
+
+const unsigned char* PlatoDataStream::getDirtyBricks() {
+  return dirty;
+}
@@ -0,0 +1,276 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+
+// vtk includes...
+#include "vtkActor.h"
+#include "vtkActorCollection.h"
+#include "vtkCallbackCommand.h"
+#include "vtkCommand.h"
+#include "vtkOutlineFilter.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataMapper.h"
+#include "vtkQuadricClustering.h"
+#include "vtkRenderer.h"
+
+// plato includes...
+#include "PlatoFrameScheduler.h"
+#include "PlatoRenderWindow.h"
+
+PlatoFrameScheduler::PlatoFrameScheduler(PlatoRenderWindow* prw,
+					 vtkRenderer* ren, double time) {
+  frameTime = time;
+  overhead = 0.0;
+  interacting = false;
+  refining = false;
+  lods = new PlatoLOD[PVS_LOD_MAX_MAPPERS];
+  numLODs = 0;
+
+  window = prw;
+  renderer = ren;
+  callback = vtkCallbackCommand::New();
+  callback->SetCallback(eventCallback);
+  callback->SetClientData(this);
+}
+
+PlatoFrameScheduler::~PlatoFrameScheduler() {
+  // the actors still hold on to whichever mapper they were last given...
+  for(int i = 0; i < numLODs; i++) {
+    for(int l = 1; l < PVS_LOD_LEVELS; l++)
+      lods[i].mappers[l]->Delete();
+    lods[i].simplified->Delete();
+    lods[i].outline->Delete();
+  }
+  delete[] lods;
+  callback->Delete();
+}
+
+void PlatoFrameScheduler::watchWindow(vtkObject* obj) {
+  obj->AddObserver(vtkCommand::StartEvent, callback);
+  obj->AddObserver(vtkCommand::EndEvent, callback);
+}
+
+void PlatoFrameScheduler::watchInteraction(vtkObject* obj) {
+  obj->AddObserver(vtkCommand::StartInteractionEvent, callback);
+  obj->AddObserver(vtkCommand::EndInteractionEvent, callback);
+}
+
+void PlatoFrameScheduler::eventCallback(vtkObject* obj, unsigned long eid,
+					void* cd, void* calld) {
+  PlatoFrameScheduler* scheduler = (PlatoFrameScheduler*) cd;
+
+  switch(eid) {
+  case vtkCommand::StartEvent:
+    scheduler->applyLevels();
+    break;
+  case vtkCommand::EndEvent:
+    scheduler->measureCosts();
+    break;
+  case vtkCommand::StartInteractionEvent:
+    scheduler->interacting = true;
+    scheduler->refining = false;
+    break;
+  case vtkCommand::EndInteractionEvent:
+    // the render that ends the interaction is still a cheap one, the full
+    // versions come back in the frames after it...
+    scheduler->interacting = false;
+    scheduler->refining = false;
+    for(int i = 0; i < scheduler->numLODs; i++) {
+      if(scheduler->lods[i].level > 0)
+	scheduler->refining = true;
+    }
+    if(scheduler->refining)
+      scheduler->window->refineLater();
+    break;
+  }
+}
+
+PlatoLOD* PlatoFrameScheduler::findLOD(vtkMapper* mapper) {
+  // each mapper is tracked whichever of its versions it's showing...
+  for(int i = 0; i < numLODs; i++) {
+    for(int l = 0; l < PVS_LOD_LEVELS; l++) {
+      if(lods[i].mappers[l] == mapper)
+	return &lods[i];
+    }
+  }
+
+  vtkPolyDataMapper* full = vtkPolyDataMapper::SafeDownCast(mapper);
+  if(!full || numLODs == PVS_LOD_MAX_MAPPERS)
+    return NULL;
+
+  PlatoLOD* lod = &lods[numLODs++];
+  lod->mappers[0] = full;
+  lod->simplified = vtkQuadricClustering::New();
+  lod->simplified->SetNumberOfDivisions(PVS_LOD_DIVISIONS, PVS_LOD_DIVISIONS,
+					PVS_LOD_DIVISIONS);
+  lod->outline = vtkOutlineFilter::New();
+  for(int l = 1; l < PVS_LOD_LEVELS; l++) {
+    lod->mappers[l] = vtkPolyDataMapper::New();
+    lod->mappers[l]->SetLookupTable(full->GetLookupTable());
+    lod->mappers[l]->SetScalarRange(full->GetScalarRange());
+    lod->mappers[l]->SetScalarVisibility(full->GetScalarVisibility());
+  }
+  lod->mappers[1]->SetInput(lod->simplified->GetOutput());
+  lod->mappers[2]->SetInput(lod->outline->GetOutput());
+  for(int l = 0; l < PVS_LOD_LEVELS; l++)
+    lod->cost[l] = -1.0;
+  lod->level = 0;
+  lod->users = 0;
+
+  return lod;
+}
+
+double PlatoFrameScheduler::getCost(PlatoLOD* lod, int level) {
+  if(lod->cost[level] >= 0.0)
+    return lod->cost[level];
+
+  // a guess until it's been drawn...
+  double full = std::max(lod->cost[0], 0.0);
+  return (level == 1) ? full * 0.1 : full * 0.01;
+}
+
+void PlatoFrameScheduler::chooseLevels() {
+  double total = overhead;
+  PlatoLOD* worst;
+
+  // levels only go down while the camera is moving, so nothing flickers
+  // between versions...
+  for(int i = 0; i < numLODs; i++) {
+    if(lods[i].users > 0)
+      total += getCost(&lods[i], lods[i].level);
+  }
+
+  // ...by cheapening the most expensive thing until the frame fits...
+  while(total > frameTime) {
+    worst = NULL;
+    for(int i = 0; i < numLODs; i++) {
+      if(lods[i].users == 0 || lods[i].level == PVS_LOD_LEVELS - 1)
+	continue;
+      if(!worst || getCost(&lods[i], lods[i].level) >
+	 getCost(worst, worst->level))
+	worst = &lods[i];
+    }
+    if(!worst)
+      break;
+
+    total -= getCost(worst, worst->level);
+    worst->level++;
+    total += getCost(worst, worst->level);
+  }
+}
+
+void PlatoFrameScheduler::applyLevels() {
+  vtkActorCollection* actors = renderer->GetActors();
+  vtkActor* actor;
+  PlatoLOD* lod;
+
+  // count what's going to be drawn with each mapper...
+  for(int i = 0; i < numLODs; i++)
+    lods[i].users = 0;
+  for(int i = 0; i < actors->GetNumberOfItems(); i++) {
+    actor = (vtkActor*) actors->GetItemAsObject(i);
+    if(actor->GetVisibility() && (lod = findLOD(actor->GetMapper())))
+      lod->users++;
+  }
+
+  if(interacting) {
+    chooseLevels();
+  }
+  else if(!refining) {
+    for(int i = 0; i < numLODs; i++)
+      lods[i].level = 0;
+  }
+
+  // the pipelines may have given their mappers new inputs since...
+  for(int i = 0; i < numLODs; i++) {
+    if(lods[i].level > 0) {
+      lods[i].simplified->SetInput(lods[i].mappers[0]->GetInput());
+      lods[i].outline->SetInput(lods[i].mappers[0]->GetInput());
+    }
+  }
+
+  for(int i = 0; i < actors->GetNumberOfItems(); i++) {
+    actor = (vtkActor*) actors->GetItemAsObject(i);
+    lod = findLOD(actor->GetMapper());
+    if(actor->GetVisibility() && lod &&
+       actor->GetMapper() != lod->mappers[lod->level])
+      actor->SetMapper(lod->mappers[lod->level]);
+  }
+}
+
+void PlatoFrameScheduler::measureCosts() {
+  double drawn = 0.0;
+  double time;
+
+  // a mapper's draw time is for the last actor it drew, instances of the
+  // same geometry all cost about the same...
+  for(int i = 0; i < numLODs; i++) {
+    if(lods[i].users == 0)
+      continue;
+
+    time = lods[i].mappers[lods[i].level]->GetTimeToDraw() * 1000.0 *
+      lods[i].users;
+    if(lods[i].cost[lods[i].level] < 0.0)
+      lods[i].cost[lods[i].level] = time;
+    else
+      lods[i].cost[lods[i].level] = (lods[i].cost[lods[i].level] + time) / 2.0;
+    drawn += time;
+  }
+
+  // whatever isn't in the mappers can't be made cheaper...
+  time = std::max((renderer->GetLastRenderTimeInSeconds() * 1000.0) - drawn,
+		  0.0);
+  overhead = (overhead + time) / 2.0;
+}
+
+bool PlatoFrameScheduler::refine() {
+  bool changed = false;
+
+  // one level nearer the real thing each frame...
+  refining = false;
+  for(int i = 0; i < numLODs; i++) {
+    if(lods[i].level > 0) {
+      lods[i].level--;
+      changed = true;
+    }
+    if(lods[i].level > 0)
+      refining = true;
+  }
+
+  return changed;
+}
+
+bool PlatoFrameScheduler::isRefining() {
+  return refining;
+}
@@ -0,0 +1,392 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoFrameServer.h"
+#include "PlatoRenderWindow.h"
+
+PlatoFrameServer::PlatoFrameServer(const char* listenAddress, int p) {
+  port = p;
+  clientSocket = -1;
+  window = NULL;
+
+  pending = NULL;
+  pendingFrame = 0;
+  pendingTime = 0.0;
+  current = NULL;
+  currentFrame = 0;
+  currentTime = 0.0;
+  currentSent = true;
+  sent = NULL;
+  tile = new unsigned char[PVS_FRAME_TILE_SIZE * PVS_FRAME_TILE_SIZE * 3];
+  message = NULL;
+  messageSize = 0;
+  for(int i = 0; i < 2; i++) {
+    pendingSize[i] = 0;
+    currentSize[i] = 0;
+    sentSize[i] = 0;
+  }
+
+  numPublished = 0;
+  numSent = 0;
+  numDropped = 0;
+  bytesSent = 0.0;
+  rawBytes = 0.0;
+  done = false;
+
+  sem_init(&frameWaiting, 0, 0);
+  thread = vtkMultiThreader::New();
+  threadID = -1;
+  frameLock = vtkMutexLock::New();
+
+  // the client connects to us. Accepting doesn't block as the same thread
+  // is waiting for frames. Like the data stream it's only this machine
+  // unless another interface is asked for...
+  struct sockaddr_in address;
+  int on = 1;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if(inet_pton(AF_INET, listenAddress, &address.sin_addr) != 1) {
+    std::cerr << "Bad address to listen on: " << listenAddress << std::endl;
+    exit(1);
+  }
+
+  listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if(listenSocket < 0 ||
+     setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+     bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) < 0 ||
+     listen(listenSocket, 1) < 0) {
+    std::cerr << "Could not listen on port " << port << ": ";
+    std::cerr << strerror(errno) << std::endl;
+    exit(1);
+  }
+  fcntl(listenSocket, F_SETFL, O_NONBLOCK);
+
+  std::cout << "Publishing frames on " << listenAddress << ":" << port;
+  std::cout << "...\n";
+}
+
+PlatoFrameServer::~PlatoFrameServer() {
+  stop();
+  printStats();
+  close(listenSocket);
+
+  delete[] pending;
+  delete[] current;
+  delete[] sent;
+  delete[] tile;
+  delete[] message;
+
+  sem_destroy(&frameWaiting);
+  thread->Delete();
+  frameLock->Delete();
+}
+
+void PlatoFrameServer::start(PlatoRenderWindow* prw) {
+  window = prw;
+  threadID = thread->SpawnThread(sendLoop, this);
+}
+
+void PlatoFrameServer::stop() {
+  if(threadID < 0)
+    return;
+
+  // knock the thread out of send() or its wait for a frame...
+  frameLock->Lock();
+  done = true;
+  if(clientSocket >= 0)
+    shutdown(clientSocket, SHUT_RDWR);
+  frameLock->Unlock();
+  sem_post(&frameWaiting);
+
+  thread->TerminateThread(threadID);
+  threadID = -1;
+  closeConnection();
+}
+
+bool PlatoFrameServer::hasClient() {
+  // the render thread asks before reading the pixels back...
+  frameLock->Lock();
+  bool connected = (clientSocket >= 0);
+  frameLock->Unlock();
+
+  return connected;
+}
+
+void PlatoFrameServer::publish(unsigned char* pixels, int width, int height) {
+  // the pixels are ours now. Anything still waiting was never sent and
+  // never will be...
+  frameLock->Lock();
+  numPublished++;
+  if(pending) {
+    delete[] pending;
+    numDropped++;
+  }
+  pending = pixels;
+  pendingSize[0] = width;
+  pendingSize[1] = height;
+  pendingFrame = numPublished;
+  pendingTime = getTimeMillis();
+  frameLock->Unlock();
+
+  sem_post(&frameWaiting);
+}
+
+bool PlatoFrameServer::acceptConnection() {
+  int s = accept(listenSocket, NULL, NULL);
+  int on = 1;
+
+  if(s < 0)
+    return false;
+
+  // frames are sent whole so don't hold any of them back...
+  fcntl(s, F_SETFL, 0);
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  frameLock->Lock();
+  if(clientSocket >= 0) {
+    // only one client at a time, the newest wins...
+    shutdown(clientSocket, SHUT_RDWR);
+    close(clientSocket);
+  }
+  clientSocket = s;
+  frameLock->Unlock();
+
+  // a new client needs the whole of the next frame. Nothing is published
+  // while no one is watching, so have one drawn...
+  sentSize[0] = 0;
+  sentSize[1] = 0;
+  std::cout << "Frame client connected.\n";
+  window->requestRender();
+
+  return true;
+}
+
+void PlatoFrameServer::closeConnection() {
+  frameLock->Lock();
+  if(clientSocket >= 0)
+    close(clientSocket);
+  clientSocket = -1;
+  frameLock->Unlock();
+}
+
+bool PlatoFrameServer::writeFully(const void* buffer, long bytes) {
+  const char* next = (const char*) buffer;
+  long put;
+
+  while(bytes > 0) {
+    put = send(clientSocket, next, bytes, MSG_NOSIGNAL);
+    if(put < 0 && errno == EINTR)
+      continue;
+    if(put <= 0)
+      return false;
+    next += put;
+    bytes -= put;
+  }
+
+  return true;
+}
+
+bool PlatoFrameServer::sendFrame() {
+  int width = currentSize[0];
+  int height = currentSize[1];
+  int rowBytes = width * 3;
+  int tilesX = (width + PVS_FRAME_TILE_SIZE - 1) / PVS_FRAME_TILE_SIZE;
+  int tilesY = (height + PVS_FRAME_TILE_SIZE - 1) / PVS_FRAME_TILE_SIZE;
+  bool keyframe = (sentSize[0] != width || sentSize[1] != height);
+  PlatoFrameHeader header;
+  PlatoFrameTile* t;
+  unsigned long packed;
+  long used;
+  int offset;
+  bool changed;
+
+  // room for every tile to be sent, uncompressible...
+  long needed = sizeof(PlatoFrameHeader) + (long) tilesX * tilesY *
+    (sizeof(PlatoFrameTile) +
+     compressBound(PVS_FRAME_TILE_SIZE * PVS_FRAME_TILE_SIZE * 3));
+  if(needed > messageSize) {
+    delete[] message;
+    message = new unsigned char[needed];
+    messageSize = needed;
+  }
+  if(keyframe) {
+    delete[] sent;
+    sent = new unsigned char[rowBytes * height];
+    sentSize[0] = width;
+    sentSize[1] = height;
+  }
+
+  memcpy(header.magic, "PVSF", 4);
+  header.version = PVS_FRAME_VERSION;
+  header.frame = currentFrame;
+  header.width = width;
+  header.height = height;
+  header.numTiles = 0;
+  header.publishTime = currentTime;
+  used = sizeof(PlatoFrameHeader);
+
+  // only the tiles that differ from what the client has are sent, and the
+  // client's copy is brought up to date as they go...
+  for(int ty = 0; ty < tilesY; ty++) {
+    for(int tx = 0; tx < tilesX; tx++) {
+      t = (PlatoFrameTile*) (message + used);
+      t->x = tx * PVS_FRAME_TILE_SIZE;
+      t->y = ty * PVS_FRAME_TILE_SIZE;
+      t->width = std::min(PVS_FRAME_TILE_SIZE, width - t->x);
+      t->height = std::min(PVS_FRAME_TILE_SIZE, height - t->y);
+
+      changed = keyframe;
+      for(int row = 0; row < t->height && !changed; row++) {
+	offset = ((t->y + row) * rowBytes) + (t->x * 3);
+	changed = (memcmp(current + offset, sent + offset, t->width * 3) != 0);
+      }
+      if(!changed)
+	continue;
+
+      for(int row = 0; row < t->height; row++) {
+	offset = ((t->y + row) * rowBytes) + (t->x * 3);
+	memcpy(tile + (row * t->width * 3), current + offset, t->width * 3);
+	memcpy(sent + offset, current + offset, t->width * 3);
+      }
+      packed = messageSize - used - sizeof(PlatoFrameTile);
+      compress2(message + used + sizeof(PlatoFrameTile), &packed, tile,
+		t->width * t->height * 3, PVS_FRAME_COMPRESSION);
+      t->bytes = (int) packed;
+
+      used += sizeof(PlatoFrameTile) + packed;
+      header.numTiles++;
+    }
+  }
+
+  // nothing has changed so there's nothing to say...
+  if(header.numTiles == 0)
+    return true;
+
+  memcpy(message, &header, sizeof(PlatoFrameHeader));
+  if(!writeFully(message, used))
+    return false;
+
+  frameLock->Lock();
+  numSent++;
+  bytesSent += used;
+  rawBytes += rowBytes * height;
+  frameLock->Unlock();
+
+  return true;
+}
+
+void* PlatoFrameServer::sendLoop(void* userData) {
+  PlatoFrameServer* server = (PlatoFrameServer*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  struct timespec timeout;
+  bool done;
+
+  while(true) {
+    // wake now and then to see if anyone has connected...
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_nsec += 200000000;
+    if(timeout.tv_nsec >= 1000000000) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= 1000000000;
+    }
+    sem_timedwait(&server->frameWaiting, &timeout);
+
+    // take the latest frame, if there's a new one...
+    server->frameLock->Lock();
+    done = server->done;
+    if(server->pending) {
+      delete[] server->current;
+      server->current = server->pending;
+      server->currentSize[0] = server->pendingSize[0];
+      server->currentSize[1] = server->pendingSize[1];
+      server->currentFrame = server->pendingFrame;
+      server->currentTime = server->pendingTime;
+      server->currentSent = false;
+      server->pending = NULL;
+    }
+    server->frameLock->Unlock();
+    if(done)
+      break;
+
+    // a new client waits for the frame it asked for, anything taken
+    // before it came is out of date...
+    if(server->acceptConnection())
+      server->currentSent = true;
+    if(server->clientSocket < 0 || !server->current || server->currentSent)
+      continue;
+
+    // while this blocks on a slow client newer frames replace each other
+    // in pending...
+    server->currentSent = true;
+    if(!server->sendFrame()) {
+      std::cout << "Frame client disconnected.\n";
+      server->closeConnection();
+    }
+  }
+
+  return NULL;
+}
+
+void PlatoFrameServer::printStats() {
+  if(numPublished == 0)
+    return;
+
+  std::cout << "Published " << numPublished << " frames, sent " << numSent;
+  std::cout << ", dropped " << numDropped;
+  if(numSent > 0) {
+    std::cout << ", " << bytesSent / (1024.0 * 1024.0) << " MB at ";
+    std::cout << (100.0 * bytesSent) / rawBytes << "% of raw";
+  }
+  std::cout << std::endl;
+}
@@ -0,0 +1,178 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// vtk includes...
+#include "vtkImageData.h"
+#include "vtkJPEGWriter.h"
+#include "vtkMutexLock.h"
+#include "vtkPNGWriter.h"
+#include "vtkPNMWriter.h"
+#include "vtkPointData.h"
+#include "vtkUnsignedCharArray.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoImageEncoder.h"
+#include "PlatoTaskPool.h"
+
+PlatoImageEncoder::PlatoImageEncoder(int n) {
+  PlatoTaskPool* pool = PlatoTaskPool::getPool();
+
+  // there's no point having more on the go than the pool can write...
+  numThreads = std::min(n, std::max(pool->getNumWorkers(), 1));
+  if(numThreads < 1)
+    numThreads = 1;
+  if(numThreads > PVS_MAX_ENCODERS)
+    numThreads = PVS_MAX_ENCODERS;
+
+  // a couple of images each is enough to keep them busy...
+  sem_init(&slotsFree, 0, 2 * numThreads);
+  jobs = new PlatoTaskGroup();
+  jobLock = vtkMutexLock::New();
+
+  numWritten = 0;
+  encodeTime = 0.0;
+  waitTime = 0.0;
+}
+
+PlatoImageEncoder::~PlatoImageEncoder() {
+  finish();
+
+  sem_destroy(&slotsFree);
+  jobLock->Delete();
+  delete jobs;
+}
+
+void PlatoImageEncoder::encode(unsigned char* pixels, int width, int height,
+			       const char* filename) {
+  // the pixels are ours now and are deleted once written...
+  double start = getTimeMillis();
+  sem_wait(&slotsFree);
+  waitTime += getTimeMillis() - start;
+
+  PlatoImageJob* job = new PlatoImageJob;
+  job->pixels = pixels;
+  job->width = width;
+  job->height = height;
+  job->filename = new char[strlen(filename) + 1];
+  strcpy(job->filename, filename);
+  job->encoder = this;
+
+  PlatoTaskPool::getPool()->submit(jobs, encodeJob, job, 0);
+}
+
+void PlatoImageEncoder::finish() {
+  // the render thread lends a hand with what's left...
+  PlatoTaskPool::getPool()->wait(jobs);
+}
+
+void PlatoImageEncoder::encodeJob(int index, void* data) {
+  PlatoImageJob* job = (PlatoImageJob*) data;
+  PlatoImageEncoder* encoder = job->encoder;
+
+  double start = getTimeMillis();
+  encoder->write(job);
+  delete[] job->pixels;
+  delete[] job->filename;
+  delete job;
+
+  encoder->jobLock->Lock();
+  encoder->encodeTime += getTimeMillis() - start;
+  encoder->numWritten++;
+  encoder->jobLock->Unlock();
+  sem_post(&encoder->slotsFree);
+}
+
+void PlatoImageEncoder::write(PlatoImageJob* job) {
+  int numBytes = job->width * job->height * 3;
+  const char* type = strrchr(job->filename, '.');
+  vtkImageWriter* writer;
+
+  // each job makes its own vtk objects, nothing here is shared...
+  if(type && (strcmp(type, ".jpg") == 0 || strcmp(type, ".jpeg") == 0))
+    writer = vtkJPEGWriter::New();
+  else if(type && (strcmp(type, ".ppm") == 0 || strcmp(type, ".pnm") == 0))
+    writer = vtkPNMWriter::New();
+  else
+    writer = vtkPNGWriter::New();
+
+  vtkUnsignedCharArray* pixels = vtkUnsignedCharArray::New();
+  pixels->SetNumberOfComponents(3);
+  pixels->SetArray(job->pixels, numBytes, 1);
+
+  vtkImageData* image = vtkImageData::New();
+  image->SetDimensions(job->width, job->height, 1);
+  image->SetScalarTypeToUnsignedChar();
+  image->SetNumberOfScalarComponents(3);
+  image->GetPointData()->SetScalars(pixels);
+
+  writer->SetInput(image);
+  writer->SetFileName(job->filename);
+  writer->Write();
+
+  writer->Delete();
+  image->Delete();
+  pixels->Delete();
+}
+
+int PlatoImageEncoder::getNumThreads() {
+  return numThreads;
+}
+
+int PlatoImageEncoder::getNumWritten() {
+  int n;
+
+  jobLock->Lock();
+  n = numWritten;
+  jobLock->Unlock();
+
+  return n;
+}
+
+double PlatoImageEncoder::getEncodeTime() {
+  double t;
+
+  jobLock->Lock();
+  t = encodeTime;
+  jobLock->Unlock();
+
+  return t;
+}
+
+double PlatoImageEncoder::getWaitTime() {
+  return waitTime;
+}
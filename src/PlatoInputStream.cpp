@@ -0,0 +1,559 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef PVS_USE_ZSTD
+#include <zstd.h>
+#endif
+
+// plato includes...
+#include "PlatoInputStream.h"
+#include "PlatoTaskPool.h"
+
+PlatoInputStream::PlatoInputStream(const char* name) {
+  filename = new char[strlen(name) + 1];
+  strcpy(filename, name);
+  format = PVS_INPUT_PLAIN;
+  mapped = NULL;
+  mappedLength = 0;
+  textLength = -1;
+  blocks = NULL;
+  numBlocks = 0;
+  slots = NULL;
+  numSlots = 0;
+  current = -1;
+  streaming = false;
+  streamEnd = false;
+  streamIn = 0;
+  inflater = NULL;
+  zstd = NULL;
+  setg(NULL, NULL, NULL);
+
+  // the file is mapped rather than read so a compressed one is never held
+  // in memory twice...
+  file = open(filename, O_RDONLY);
+  if(file < 0)
+    return;
+
+  struct stat info;
+  if(fstat(file, &info) == 0 && info.st_size > 0) {
+    void* m = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if(m == MAP_FAILED) {
+      close(file);
+      file = -1;
+      return;
+    }
+    mapped = (unsigned char*) m;
+    mappedLength = info.st_size;
+    madvise(mapped, mappedLength, MADV_SEQUENTIAL);
+  }
+
+  // a plain file is parsed from the mapping as it is...
+  format = checkMagic(mapped, mappedLength);
+  if(format == PVS_INPUT_PLAIN) {
+    setg((char*) mapped, (char*) mapped, (char*) mapped + mappedLength);
+    textLength = mappedLength;
+    return;
+  }
+
+  if(format == PVS_INPUT_GZIP)
+    findGzipMembers();
+  else
+    findZstdFrames();
+
+  // enough blocks in flight to keep the pool busy, but no more than fit in
+  // the memory allowed...
+  long slotLength = PVS_INPUT_BLOCK;
+  if(streaming) {
+    numSlots = 2;
+    startStream();
+  }
+  else {
+    slotLength = 1;
+    for(int b = 0; b < numBlocks; b++)
+      slotLength = std::max(slotLength, blocks[b].outLength);
+    numSlots = PVS_INPUT_AHEAD * PlatoTaskPool::getPool()->getNumThreads();
+    numSlots = std::min(numSlots, (int) std::max(PVS_INPUT_MEMORY / slotLength,
+						 2L));
+    numSlots = std::max(std::min(numSlots, numBlocks), 1);
+  }
+
+  slots = new PlatoInputSlot[numSlots];
+  for(int s = 0; s < numSlots; s++) {
+    slots[s].text = new char[slotLength];
+    slots[s].length = 0;
+    slots[s].block = -1;
+    slots[s].failed = false;
+    slots[s].group = new PlatoTaskGroup();
+    slots[s].stream = this;
+  }
+
+  // start off the first blocks before the parser asks for them...
+  if(streaming) {
+    fill(0, 0);
+  }
+  else {
+    for(int s = 0; s < numSlots; s++)
+      fill(s, s);
+  }
+}
+
+PlatoInputStream::~PlatoInputStream() {
+  // the parser may not have read everything, so anything still being
+  // decompressed has to finish first...
+  for(int s = 0; s < numSlots; s++) {
+    PlatoTaskPool::getPool()->wait(slots[s].group);
+    delete[] slots[s].text;
+    delete slots[s].group;
+  }
+  delete[] slots;
+  delete[] blocks;
+
+  if(inflater) {
+    inflateEnd(inflater);
+    delete inflater;
+  }
+#ifdef PVS_USE_ZSTD
+  if(zstd)
+    ZSTD_freeDCtx(zstd);
+#endif
+
+  if(mapped)
+    munmap(mapped, mappedLength);
+  if(file >= 0)
+    close(file);
+  delete[] filename;
+}
+
+bool PlatoInputStream::isOpen() {
+  return (file >= 0);
+}
+
+int PlatoInputStream::getFormat() {
+  return format;
+}
+
+long PlatoInputStream::getLength() {
+  return textLength;
+}
+
+char* PlatoInputStream::readText(const char* name, long* length) {
+  PlatoInputStream input(name);
+  if(!input.isOpen())
+    return NULL;
+
+  // when the length of the text is known it's read straight into place,
+  // otherwise it's read a piece at a time and the pieces put together at
+  // the end, so the most ever held is twice the text...
+  long capacity = input.getLength();
+  if(capacity < 0)
+    capacity = PVS_INPUT_PIECE;
+  char* text = new char[capacity + 1];
+  long textLength = input.sgetn(text, capacity);
+
+  char** pieces = NULL;
+  long* pieceLengths = NULL;
+  int numPieces = 0;
+  int maxPieces = 0;
+  long total = textLength;
+  while(textLength == capacity && input.sgetc() != traits_type::eof()) {
+    if(numPieces == maxPieces) {
+      maxPieces = std::max(2 * maxPieces, 16);
+      char** morePieces = new char*[maxPieces];
+      long* moreLengths = new long[maxPieces];
+      for(int i = 0; i < numPieces; i++) {
+	morePieces[i] = pieces[i];
+	moreLengths[i] = pieceLengths[i];
+      }
+      delete[] pieces;
+      delete[] pieceLengths;
+      pieces = morePieces;
+      pieceLengths = moreLengths;
+    }
+    pieces[numPieces] = new char[PVS_INPUT_PIECE];
+    pieceLengths[numPieces] = input.sgetn(pieces[numPieces], PVS_INPUT_PIECE);
+    total += pieceLengths[numPieces];
+    numPieces++;
+  }
+
+  if(numPieces > 0) {
+    char* all = new char[total + 1];
+    memcpy(all, text, textLength);
+    delete[] text;
+    text = all;
+    for(int i = 0; i < numPieces; i++) {
+      memcpy(text + textLength, pieces[i], pieceLengths[i]);
+      textLength += pieceLengths[i];
+      delete[] pieces[i];
+    }
+    delete[] pieces;
+    delete[] pieceLengths;
+  }
+
+  text[textLength] = '\0';
+  *length = textLength;
+  return text;
+}
+
+int PlatoInputStream::getFormat(const char* name) {
+  unsigned char magic[4];
+  long length = 0;
+
+  FILE* f = fopen(name, "rb");
+  if(f) {
+    length = fread(magic, 1, 4, f);
+    fclose(f);
+  }
+
+  return checkMagic(magic, length);
+}
+
+int PlatoInputStream::checkMagic(const unsigned char* p, long length) {
+  if(length >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+    return PVS_INPUT_GZIP;
+
+  // a zstd file can start with a skippable frame too...
+  if(length >= 4 && ((p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f &&
+		      p[3] == 0xfd) ||
+		     ((p[0] & 0xf0) == 0x50 && p[1] == 0x2a && p[2] == 0x4d &&
+		      p[3] == 0x18)))
+    return PVS_INPUT_ZSTD;
+
+  return PVS_INPUT_PLAIN;
+}
+
+void PlatoInputStream::findGzipMembers() {
+  const unsigned char* end = mapped + mappedLength;
+
+  // only bgzip members say how long they are, anything else has to be
+  // decompressed in order to find where the next member starts. This is
+  // run twice, once to count them and once to fill them in...
+  for(int pass = 0; pass < 2; pass++) {
+    const unsigned char* p = mapped;
+    int b = 0;
+
+    while(p < end) {
+      long length = 0;
+      if((end - p) >= 18 && p[0] == 0x1f && p[1] == 0x8b && (p[3] & 0x04)) {
+	const unsigned char* extra = p + 12;
+	const unsigned char* extraEnd = extra + (p[10] | (p[11] << 8));
+	while(extraEnd <= end && (extra + 4) <= extraEnd) {
+	  int fieldLength = extra[2] | (extra[3] << 8);
+	  if(extra[0] == 'B' && extra[1] == 'C' && fieldLength == 2 &&
+	     (extra + 6) <= extraEnd) {
+	    length = (extra[4] | (extra[5] << 8)) + 1;
+	    break;
+	  }
+	  extra += 4 + fieldLength;
+	}
+      }
+      if(length < 18 || length > (end - p)) {
+	streaming = true;
+	return;
+      }
+
+      if(pass == 1) {
+	const unsigned char* size = p + length - 4;
+	blocks[b].start = p;
+	blocks[b].length = length;
+	blocks[b].outLength = ((long) size[0]) | ((long) size[1] << 8) |
+	  ((long) size[2] << 16) | ((long) size[3] << 24);
+	if(blocks[b].outLength > PVS_INPUT_MAX_FRAME) {
+	  streaming = true;
+	  return;
+	}
+      }
+      p += length;
+      b++;
+    }
+
+    // a single member is just as quick to do in order...
+    if(pass == 0) {
+      if(b < 2) {
+	streaming = true;
+	return;
+      }
+      numBlocks = b;
+      blocks = new PlatoInputBlock[numBlocks];
+    }
+  }
+
+  textLength = 0;
+  for(int b = 0; b < numBlocks; b++)
+    textLength += blocks[b].outLength;
+}
+
+void PlatoInputStream::findZstdFrames() {
+#ifdef PVS_USE_ZSTD
+  const unsigned char* end = mapped + mappedLength;
+
+  // the frames are found from their headers without decompressing them,
+  // but they can only be done side by side if they all say how big they
+  // are. Those sizes also give the length of the text, even when the file
+  // has to be decompressed in order. This is run twice, once to count them
+  // and once to fill them in...
+  for(int pass = 0; pass < 2; pass++) {
+    const unsigned char* p = mapped;
+    long length = 0;
+    bool split = true;
+    int b = 0;
+
+    while(p < end) {
+      size_t frameLength = ZSTD_findFrameCompressedSize(p, end - p);
+      unsigned long long outLength = ZSTD_getFrameContentSize(p, end - p);
+      if(ZSTD_isError(frameLength) || outLength == ZSTD_CONTENTSIZE_UNKNOWN ||
+	 outLength == ZSTD_CONTENTSIZE_ERROR) {
+	streaming = true;
+	return;
+      }
+      if(outLength > PVS_INPUT_MAX_FRAME)
+	split = false;
+
+      if(pass == 1) {
+	blocks[b].start = p;
+	blocks[b].length = frameLength;
+	blocks[b].outLength = outLength;
+      }
+      length += outLength;
+      p += frameLength;
+      b++;
+    }
+
+    // a single frame is just as quick to do in order...
+    if(pass == 0) {
+      textLength = length;
+      if(!split || b < 2) {
+	streaming = true;
+	return;
+      }
+      numBlocks = b;
+      blocks = new PlatoInputBlock[numBlocks];
+    }
+  }
+#else
+  std::cerr << PVS_BIN_NAME << " was built without zstd support, can't read: ";
+  std::cerr << filename << std::endl;
+  exit(1);
+#endif
+}
+
+void PlatoInputStream::startStream() {
+  if(format == PVS_INPUT_GZIP) {
+    inflater = new z_stream;
+    memset(inflater, 0, sizeof(z_stream));
+    if(inflateInit2(inflater, 15 + 16) != Z_OK) {
+      std::cerr << "Could not decompress file: " << filename << std::endl;
+      exit(1);
+    }
+  }
+#ifdef PVS_USE_ZSTD
+  else {
+    zstd = ZSTD_createDCtx();
+  }
+#endif
+}
+
+void PlatoInputStream::fill(int slot, int block) {
+  slots[slot].block = block;
+  slots[slot].length = 0;
+  slots[slot].failed = false;
+  PlatoTaskPool::getPool()->submit(slots[slot].group, fillSlot, &slots[slot],
+				   0);
+}
+
+void PlatoInputStream::fillSlot(int, void* data) {
+  PlatoInputSlot* slot = (PlatoInputSlot*) data;
+  PlatoInputStream* stream = slot->stream;
+
+  if(stream->format == PVS_INPUT_GZIP) {
+    if(stream->streaming)
+      stream->inflateStream(slot);
+    else
+      stream->inflateBlock(slot);
+  }
+  else {
+    if(stream->streaming)
+      stream->unzstdStream(slot);
+    else
+      stream->unzstdBlock(slot);
+  }
+}
+
+void PlatoInputStream::inflateBlock(PlatoInputSlot* slot) {
+  PlatoInputBlock* block = &blocks[slot->block];
+  z_stream z;
+
+  memset(&z, 0, sizeof(z_stream));
+  if(inflateInit2(&z, 15 + 16) != Z_OK) {
+    slot->failed = true;
+    return;
+  }
+
+  // each member is a whole gzip stream of its own...
+  z.next_in = (Bytef*) block->start;
+  z.avail_in = block->length;
+  z.next_out = (Bytef*) slot->text;
+  z.avail_out = block->outLength;
+  int rc = inflate(&z, Z_FINISH);
+  slot->length = z.total_out;
+  slot->failed = (rc != Z_STREAM_END || slot->length != block->outLength);
+  inflateEnd(&z);
+}
+
+void PlatoInputStream::inflateStream(PlatoInputSlot* slot) {
+  z_stream* z = inflater;
+
+  z->next_out = (Bytef*) slot->text;
+  z->avail_out = PVS_INPUT_BLOCK;
+  while(z->avail_out > 0) {
+    // the input is handed over a gigabyte at a time as zlib only counts
+    // that high...
+    if(z->avail_in == 0) {
+      if(streamIn >= mappedLength) {
+	slot->failed = true;
+	break;
+      }
+      long length = std::min(mappedLength - streamIn, 1L << 30);
+      z->next_in = (Bytef*) (mapped + streamIn);
+      z->avail_in = length;
+      streamIn += length;
+    }
+
+    int rc = inflate(z, Z_NO_FLUSH);
+    if(rc == Z_STREAM_END) {
+      if(z->avail_in == 0 && streamIn >= mappedLength) {
+	streamEnd = true;
+	break;
+      }
+
+      // members one after another (as from cat) just carry on...
+      inflateReset(z);
+    }
+    else if(rc != Z_OK) {
+      slot->failed = true;
+      break;
+    }
+  }
+  slot->length = PVS_INPUT_BLOCK - z->avail_out;
+}
+
+void PlatoInputStream::unzstdBlock(PlatoInputSlot* slot) {
+#ifdef PVS_USE_ZSTD
+  PlatoInputBlock* block = &blocks[slot->block];
+
+  size_t length = ZSTD_decompress(slot->text, block->outLength,
+				  block->start, block->length);
+  slot->failed = (ZSTD_isError(length) || (long) length != block->outLength);
+  slot->length = slot->failed ? 0 : length;
+#else
+  // never reached, a zstd file is refused when it's opened...
+  slot->failed = true;
+#endif
+}
+
+void PlatoInputStream::unzstdStream(PlatoInputSlot* slot) {
+#ifdef PVS_USE_ZSTD
+  ZSTD_inBuffer in = {mapped, (size_t) mappedLength, (size_t) streamIn};
+  ZSTD_outBuffer out = {slot->text, PVS_INPUT_BLOCK, 0};
+
+  // frames one after another are carried on through by zstd itself...
+  while(out.pos < out.size) {
+    size_t rc = ZSTD_decompressStream(zstd, &out, &in);
+    if(ZSTD_isError(rc)) {
+      slot->failed = true;
+      break;
+    }
+    if(in.pos == in.size && out.pos < out.size) {
+      if(rc != 0)
+	slot->failed = true;
+      streamEnd = true;
+      break;
+    }
+  }
+  streamIn = in.pos;
+  slot->length = out.pos;
+#else
+  slot->failed = true;
+#endif
+}
+
+int PlatoInputStream::underflow() {
+  if(gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  if(!slots)
+    return traits_type::eof();
+
+  while(true) {
+    // the block just parsed is finished with, so its slot can go on to
+    // one further ahead...
+    if(!streaming && current >= 0 && (current + numSlots) < numBlocks)
+      fill(current % numSlots, current + numSlots);
+
+    current++;
+    if(!streaming && current >= numBlocks)
+      return traits_type::eof();
+
+    // the parser lends a hand if it catches up...
+    PlatoInputSlot* slot = &slots[current % numSlots];
+    PlatoTaskPool::getPool()->wait(slot->group);
+    if(slot->failed) {
+      std::cerr << "Could not decompress file: " << filename << std::endl;
+      exit(1);
+    }
+
+    // the next piece of a stream is done while this one is parsed...
+    if(streaming) {
+      int next = (current + 1) % numSlots;
+      if(streamEnd)
+	slots[next].length = 0;
+      else
+	fill(next, current + 1);
+    }
+
+    if(slot->length > 0) {
+      setg(slot->text, slot->text, slot->text + slot->length);
+      return traits_type::to_int_type(*gptr());
+    }
+    if(streaming)
+      return traits_type::eof();
+  }
+}
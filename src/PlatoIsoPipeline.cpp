@@ -33,11 +33,16 @@
 // vtk includes...
 #include "vtkActor.h"
 #include "vtkActorCollection.h"
+#include "vtkAppendPolyData.h"
 #include "vtkClipPolyData.h"
+#include "vtkContourFilter.h"
 #include "vtkLookupTable.h"
 #include "vtkMarchingContourFilter.h"
+#include "vtkMatrix4x4.h"
 #include "vtkPlane.h"
+#include "vtkMutexLock.h"
 #include "vtkPointSet.h"
+#include "vtkPolyData.h"
 #include "vtkPolyDataMapper.h"
 #include "vtkPolyDataNormals.h"
 #include "vtkProperty.h"
@@ -48,26 +53,30 @@
 #include "main.h"
 #include "PlatoDataReader.h"
 #include "PlatoIsoPipeline.h"
+#include "PlatoProfiler.h"
+#include "PlatoSymmetry.h"
+#include "PlatoTaskPool.h"
 #include "PlatoVTKPipeline.h"
 
 PlatoIsoPipeline::PlatoIsoPipeline(PlatoDataReader* dr) : PlatoVTKPipeline() {
   data = dr;
 
+  // the filters aren't set up until an isosurface is first shown...
   init();
-  buildPipeline();
 }
 
 PlatoIsoPipeline::PlatoIsoPipeline(PlatoDataReader* dr, vtkLookupTable* clut)
   : PlatoVTKPipeline(clut) {
   data = dr;
 
+  // the filters aren't set up until an isosurface is first shown...
   init();
-  buildPipeline();
 }
 
 PlatoIsoPipeline::~PlatoIsoPipeline() {
   delete[] isoValues;
   delete[] isoVisible;
+  delete[] contourValues;
   delete[] cutPlaneNormals;
 
   // remove actor from collection...
@@ -77,10 +86,19 @@ PlatoIsoPipeline::~PlatoIsoPipeline() {
   cutPlane->Delete();
   actorProperties->Delete();
   isoSurface->Delete();
+  boundarySurface->Delete();
+  boundaryNormals->Delete();
+  clearChunks();
+  chunkAppend->Delete();
+  isoAppend->Delete();
   isoNormals->Delete();
   isoCutter->Delete();
   isoMapper->Delete();
   isoActor->Delete();
+  isoFront->Delete();
+  symmetryImages->Delete();
+  if(wedge)
+    wedge->Delete();
 }
 
 void PlatoIsoPipeline::init() {
@@ -88,12 +106,30 @@ void PlatoIsoPipeline::init() {
   cutPlaneCentre = data->getDataCentre();
   isoValues = new double[PVS_MAX_ISOS];
   isoVisible = new bool[PVS_MAX_ISOS];
+  contourValues = new double[PVS_MAX_ISOS];
+  numContours = -1;
   cutPlaneNormals = new double[3];
   cutPlaneNormals[0] = 0.0;
   cutPlaneNormals[1] = 1.0;
   cutPlaneNormals[2] = 0.0;
 
   cutPlaneOn = false;
+  periodic = false;
+  builtSymmetry = false;
+  builtCut = false;
+  builtFrame = data->getFrameNumber();
+  wedgeFrame = builtFrame;
+
+  // a streamed grid is contoured in blocks so that a frame that only
+  // changes some of it only costs that much...
+  chunked = (data->isStreamed() && data->isUniformMesh());
+  boundaryJoined = false;
+  chunks = NULL;
+  numChunks = 0;
+  for(int i = 0; i < 3; i++) {
+    chunkLow[i] = 0;
+    chunkHigh[i] = -1;
+  }
 
   // keep track of isosurface values and visibilities...
   for(int i = 0; i < PVS_MAX_ISOS; i++) {
@@ -105,55 +141,228 @@ void PlatoIsoPipeline::init() {
   cutPlane = vtkPlane::New();
   actorProperties = vtkProperty::New();
   isoSurface = vtkMarchingContourFilter::New();
+  boundarySurface = vtkContourFilter::New();
+  boundaryNormals = vtkPolyDataNormals::New();
+  chunkAppend = vtkAppendPolyData::New();
+  isoAppend = vtkAppendPolyData::New();
   isoNormals = vtkPolyDataNormals::New();
   isoCutter = vtkClipPolyData::New();
   isoMapper = vtkPolyDataMapper::New();
   isoActor = vtkActor::New();
+  isoFront = vtkPolyData::New();
+  wedge = NULL;
+  symmetryImages = vtkActorCollection::New();
+
+  // set up actor properties...
+  actorProperties->SetInterpolationToGouraud();
+  actorProperties->SetAmbient(0.1);
+  actorProperties->SetDiffuse(0.8);
+  actorProperties->SetSpecular(0.1);
+  actorProperties->SetSpecularPower(30);
+
+  // apply colour map...
+  isoMapper->SetInput(isoNormals->GetOutput());
+  isoMapper->SetScalarRange(dataRange);
+  isoMapper->SetLookupTable(colourTable);
+
+  // put it all into an actor and apply properties, it's hidden until
+  // there's an isosurface to show...
+  isoActor->SetMapper(isoMapper);
+  isoActor->SetProperty(actorProperties);
+  isoActor->SetVisibility(0);
 
   // add actor to the collection...
   actors->AddItem(isoActor);
 }
 
 void PlatoIsoPipeline::buildPipeline() {
+  PlatoProfileScope scope("iso.buildPipeline", PVS_PROF_BUILD);
+
   // set up the cut plane to cut the isosurfaces...
   cutPlane->SetOrigin(cutPlaneCentre);
   cutPlane->SetNormal(cutPlaneNormals);
 
-  // set up actor properties...
-  actorProperties->SetInterpolationToGouraud();
-  actorProperties->SetAmbient(0.1);
-  actorProperties->SetDiffuse(0.8);
-  actorProperties->SetSpecular(0.1);
-  actorProperties->SetSpecularPower(30);
-
   // create isosurfaces...
   isoSurface->SetInput(data->getData());
   isoSurface->UseScalarTreeOn();
 
+  // the periodic boundary cells of a uniform grid are contoured on the
+  // side and joined on to the main surface when needed. The blocks of a
+  // chunked surface come with their normals, so the boundary needs its
+  // own too...
+  isoAppend->AddInput(isoSurface->GetOutput());
+  isoAppend->AddInput(boundarySurface->GetOutput());
+  boundaryNormals->SetInput(boundarySurface->GetOutput());
+  setUpNormals(boundaryNormals);
+
   // set up cut-plane...
-  isoCutter->SetInput(isoSurface->GetOutput());
+  isoCutter->SetInput(getSurface());
   isoCutter->SetClipFunction(cutPlane);
 
   // calculate normals of isosurface...
-  isoNormals->SetInput(isoSurface->GetOutput());
-  isoNormals->ComputeCellNormalsOn();
-  isoNormals->AutoOrientNormalsOff();
-  isoNormals->FlipNormalsOn();
+  isoNormals->SetInput(getSurface());
+  setUpNormals(isoNormals);
+
+  // time each filter as it runs when profiling, the contouring is timed
+  // as a whole in contourSurfaces()...
+  PlatoProfiler::watch(isoCutter, "iso.clip", PVS_PROF_CLIP,
+		       isoCutter->GetOutput());
+  PlatoProfiler::watch(isoNormals, "iso.normals", PVS_PROF_NORMALS,
+		       isoNormals->GetOutput());
+}
 
-  // apply colour map...
-  isoMapper->SetInput(isoNormals->GetOutput());
-  isoMapper->SetScalarRange(dataRange);
-  isoMapper->SetLookupTable(colourTable);
+void PlatoIsoPipeline::updateContours() {
+  double values[PVS_MAX_ISOS];
+  int n = 0;
 
-  // put it all into an actor and apply properties...
-  isoActor->SetMapper(isoMapper);
-  isoActor->SetProperty(actorProperties);
+  // the ones we want...
+  for(int i = 0; i < PVS_MAX_ISOS; i++) {
+    if(isoVisible[i])
+      values[n++] = isoValues[i];
+  }
+
+  // setting the values marks every filter as changed, and so contoured
+  // again, so they're left alone unless one of them is different...
+  bool same = (n == numContours);
+  for(int j = 0; j < n && same; j++)
+    same = (values[j] == contourValues[j]);
+  if(same)
+    return;
+
+  isoSurface->SetNumberOfContours(n);
+  boundarySurface->SetNumberOfContours(n);
+  for(int c = 0; c < numChunks; c++) {
+    chunks[c].contour->SetNumberOfContours(n);
+    chunks[c].contoured = false;
+  }
+  for(int j = 0; j < n; j++) {
+    isoSurface->SetValue(j, values[j]);
+    boundarySurface->SetValue(j, values[j]);
+    for(int c = 0; c < numChunks; c++)
+      chunks[c].contour->SetValue(j, values[j]);
+    contourValues[j] = values[j];
+  }
+  numContours = n;
+}
+
+void PlatoIsoPipeline::buildChunks(int* low, int* high) {
+  int count[3];
+
+  clearChunks();
+
+  // the new blocks need the contour values setting...
+  numContours = -1;
+
+  // neighbouring blocks share a layer of points so their surfaces meet...
+  numChunks = 1;
+  for(int a = 0; a < 3; a++) {
+    chunkLow[a] = low[a];
+    chunkHigh[a] = high[a];
+    count[a] = (high[a] - low[a] + PVS_ISO_CHUNK_SIZE - 1) /
+      PVS_ISO_CHUNK_SIZE;
+    if(count[a] < 1)
+      count[a] = 1;
+    numChunks *= count[a];
+  }
+
+  chunks = new PlatoIsoChunk[numChunks];
+  int c = 0;
+  for(int k = 0; k < count[2]; k++) {
+    for(int j = 0; j < count[1]; j++) {
+      for(int i = 0; i < count[0]; i++, c++) {
+	int n[3] = {i, j, k};
+	for(int a = 0; a < 3; a++) {
+	  chunks[c].low[a] = low[a] + (n[a] * PVS_ISO_CHUNK_SIZE);
+	  chunks[c].high[a] = chunks[c].low[a] + PVS_ISO_CHUNK_SIZE;
+	  if(chunks[c].high[a] > high[a])
+	    chunks[c].high[a] = high[a];
+	}
+	chunks[c].stamp = data->getDataStamp();
+	chunks[c].contoured = false;
+	chunks[c].contour = vtkMarchingContourFilter::New();
+	chunks[c].contour->UseScalarTreeOn();
+	chunks[c].normals = vtkPolyDataNormals::New();
+	chunks[c].normals->SetInput(chunks[c].contour->GetOutput());
+	setUpNormals(chunks[c].normals);
+	chunks[c].surface = vtkPolyData::New();
+	chunkAppend->AddInput(chunks[c].surface);
+      } // i
+    } // j
+  } // k
+}
+
+void PlatoIsoPipeline::clearChunks() {
+  for(int c = 0; c < numChunks; c++) {
+    chunkAppend->RemoveInput(chunks[c].surface);
+    chunks[c].contour->Delete();
+    chunks[c].normals->Delete();
+    chunks[c].surface->Delete();
+  }
+  delete[] chunks;
+  chunks = NULL;
+  numChunks = 0;
+}
+
+void PlatoIsoPipeline::refreshChunks() {
+  int* dims = data->getDataDimensions();
+  int region[6];
+  bool same = true;
+
+  // the symmetry wedge, or all of the cell if the cut plane needs it...
+  for(int a = 0; a < 3; a++) {
+    region[a] = builtSymmetry ? wedgeLow[a] : 0;
+    region[3 + a] = builtSymmetry ? wedgeHigh[a] : dims[a] - 1;
+    if(region[a] != chunkLow[a] || region[3 + a] != chunkHigh[a])
+      same = false;
+  }
+  if(!same) {
+    buildChunks(region, region + 3);
+    return;
+  }
+
+  // only the blocks whose data changed are contoured again, along with
+  // any a run that was cut short left half done...
+  for(int c = 0; c < numChunks; c++) {
+    if(data->isRegionDirty(chunks[c].low, chunks[c].high, chunks[c].stamp))
+      chunks[c].contoured = false;
+    chunks[c].stamp = data->getDataStamp();
+  }
+}
+
+vtkPolyData* PlatoIsoPipeline::getSurface() {
+  // the blocks are joined up with the boundary already, and the symmetry
+  // images of the wedge cover it anyway...
+  if(chunked)
+    return chunkAppend->GetOutput();
+  else if(periodic && !isSymmetryOn())
+    return isoAppend->GetOutput();
+  else
+    return isoSurface->GetOutput();
+}
+
+vtkPolyData* PlatoIsoPipeline::getOutput() {
+  // the blocks have their normals worked out as they're contoured so
+  // only the cut is left to do after they're joined up...
+  if(!chunked)
+    return isoNormals->GetOutput();
+  else if(builtCut)
+    return isoCutter->GetOutput();
+  else
+    return chunkAppend->GetOutput();
+}
+
+void PlatoIsoPipeline::setUpNormals(vtkPolyDataNormals* normals) {
+  normals->ComputeCellNormalsOn();
+  normals->AutoOrientNormalsOff();
+  normals->FlipNormalsOn();
 }
 
 void PlatoIsoPipeline::setIsoValue(int iso, double value) {
   if(isoVisible[iso]) {
+    updateLock->Lock();
     isoValues[iso] = value;
-    isoSurface->SetValue(iso, value);
+    updateLock->Unlock();
+    requestUpdate();
   }
 }
 
@@ -168,19 +377,14 @@ void PlatoIsoPipeline::setIsoVisible(int iso, bool toggle) {
   if((iso < 0) || (iso >= PVS_MAX_ISOS) || (isoVisible[iso] == toggle))
     return;
 
+  updateLock->Lock();
   isoVisible[iso] = toggle;
+  updateLock->Unlock();
+  requestUpdate();
 
-  // turn them all off...
-  isoSurface->SetNumberOfContours(0);
-
-  // turn on the ones we want...
-  int j = 0;
-  for(int i = 0; i < PVS_MAX_ISOS; i++) {
-    if(isoVisible[i]) {
-      isoSurface->SetValue(j, isoValues[i]);
-      j++;
-    }
-  }
+  // with none of them on there's nothing to draw, or to work out...
+  setActorVisibility(isoActor, isWanted());
+  showSymmetryImages(builtSymmetry);
 }
 
 bool PlatoIsoPipeline::isIsoVisible(int iso) {
@@ -191,14 +395,261 @@ bool PlatoIsoPipeline::isIsoVisible(int iso) {
 }
 
 void PlatoIsoPipeline::setIsoCutter(bool toggle) {
+  updateLock->Lock();
   cutPlaneOn = toggle;
+  updateLock->Unlock();
+  requestUpdate();
 
+  // with a worker the images change over with the geometry...
+  if(!worker)
+    showSymmetryImages(isSymmetryOn());
+}
+
+bool PlatoIsoPipeline::isIsoCutterOn() {
+  return cutPlaneOn;
+}
+
+void PlatoIsoPipeline::setPeriodic(bool toggle) {
+  // only uniform grids have a periodic boundary...
+  vtkUnstructuredGrid* boundary = data->getPeriodicBoundary();
+
+  updateLock->Lock();
+  periodic = (toggle && boundary != NULL);
+  updateLock->Unlock();
+  requestUpdate();
+}
+
+bool PlatoIsoPipeline::isPeriodic() {
+  return periodic;
+}
+
+void PlatoIsoPipeline::setSymmetry(PlatoSymmetry* symmetry) {
+  if(wedge || symmetry->getNumberOfImages() < 2)
+    return;
+
+  // contour just the wedge, the first image is the wedge itself and the
+  // rest share its geometry...
+  vtkStructuredGrid* region =
+    data->extractRegion(symmetry->getWedgeLow(), symmetry->getWedgeHigh());
+  for(int i = 0; i < 3; i++) {
+    wedgeLow[i] = symmetry->getWedgeLow()[i];
+    wedgeHigh[i] = symmetry->getWedgeHigh()[i];
+  }
+
+  vtkMatrix4x4* matrix = vtkMatrix4x4::New();
+  for(int i = 1; i < symmetry->getNumberOfImages(); i++) {
+    symmetry->getImageMatrix(i, matrix);
+    symmetryImages->AddItem(instanceActor(isoActor, matrix));
+  }
+  matrix->Delete();
+
+  updateLock->Lock();
+  wedge = region;
+  wedgeFrame = data->getFrameNumber();
+  updateLock->Unlock();
+  requestUpdate();
+
+  if(!worker)
+    showSymmetryImages(isSymmetryOn());
+}
+
+bool PlatoIsoPipeline::isSymmetryOn() {
+  return (wedge != NULL && !cutPlaneOn);
+}
+
+void PlatoIsoPipeline::showSymmetryImages(bool toggle) {
+  toggle = (toggle && isWanted());
+  for(int i = 0; i < symmetryImages->GetNumberOfItems(); i++) {
+    setActorVisibility((vtkActor*) symmetryImages->GetItemAsObject(i),
+		       toggle);
+  }
+}
+
+void PlatoIsoPipeline::configure() {
+  // take the latest frame if the data is streamed in, unless the worker
+  // has taken it for all the pipelines. The wedge is a copy so it needs
+  // refilling...
+  if(!worker)
+    data->acquireFrame();
+  builtFrame = data->getFrameNumber();
+  if(wedge && !chunked && wedgeFrame != builtFrame) {
+    data->fillRegion(wedge, wedgeLow, wedgeHigh);
+    wedgeFrame = builtFrame;
+  }
+
+  // the cut plane has to go through the real cell, not the symmetry
+  // images, so drop back to contouring all of it while it's on...
+  builtSymmetry = isSymmetryOn();
+  builtCut = cutPlaneOn;
+  if(chunked)
+    refreshChunks();
+
+  updateContours();
+
+  // a run that was cut short may have left any of the rest half done...
+  if(!updateComplete) {
+    if(!chunked)
+      isoSurface->Modified();
+    boundarySurface->Modified();
+    boundaryNormals->Modified();
+    chunkAppend->Modified();
+    isoAppend->Modified();
+    isoCutter->Modified();
+    isoNormals->Modified();
+  }
+
+  if(wedge && !chunked) {
+    if(builtSymmetry)
+      isoSurface->SetInput(wedge);
+    else
+      isoSurface->SetInput(data->getData());
+  }
+  if(periodic)
+    boundarySurface->SetInput(data->getPeriodicBoundary());
+  bool boundary = (chunked && periodic && !builtSymmetry);
+  if(boundary != boundaryJoined) {
+    if(boundary)
+      chunkAppend->AddInput(boundaryNormals->GetOutput());
+    else
+      chunkAppend->RemoveInput(boundaryNormals->GetOutput());
+    boundaryJoined = boundary;
+  }
+
+  isoCutter->SetInput(getSurface());
   if(cutPlaneOn)
     isoNormals->SetInput(isoCutter->GetOutput());
   else
-    isoNormals->SetInput(isoSurface->GetOutput());
+    isoNormals->SetInput(getSurface());
 }
 
-bool PlatoIsoPipeline::isIsoCutterOn() {
-  return cutPlaneOn;
+void PlatoIsoPipeline::contourChunk(int c, void* data) {
+  PlatoIsoPipeline* pipeline = (PlatoIsoPipeline*) data;
+  PlatoIsoChunk* chunk = &pipeline->chunks[c];
+
+  // blocks whose data and values haven't changed keep their surface...
+  if(chunk->contoured)
+    return;
+
+  // the block is only cut out of the grid while it's contoured, then the
+  // surface and its normals are all that's kept. One that was given up on
+  // part way through keeps its old surface and is done again next time...
+  vtkStructuredGrid* grid =
+    pipeline->data->extractRegion(chunk->low, chunk->high);
+  chunk->contour->SetInput(grid);
+  chunk->normals->Update();
+  chunk->contoured = (chunk->contour->GetAbortExecute() == 0 &&
+		      chunk->normals->GetAbortExecute() == 0);
+  if(chunk->contoured) {
+    chunk->surface->ShallowCopy(chunk->normals->GetOutput());
+    chunk->surface->Modified();
+  }
+  chunk->contour->SetInput(NULL);
+  grid->Delete();
+  chunk->contour->GetOutput()->ReleaseData();
+  chunk->normals->GetOutput()->ReleaseData();
+}
+
+void PlatoIsoPipeline::contourSurfaces() {
+  // the contour stage is everything up to the append, timed once per
+  // update however many filters or blocks it takes...
+  PlatoProfileScope scope("iso.contour", PVS_PROF_CONTOUR);
+  bool boundary = (periodic && !builtSymmetry);
+  long triangles = 0;
+
+  // the blocks share nothing but their input so they're contoured side by
+  // side first, then the append only has to join them up...
+  if(chunked)
+    PlatoTaskPool::getPool()->run(contourChunk, this, numChunks);
+  else
+    isoSurface->Update();
+  if(boundary) {
+    if(chunked)
+      boundaryNormals->Update();
+    else
+      boundarySurface->Update();
+  }
+
+  if(!PlatoProfiler::isEnabled())
+    return;
+  if(chunked) {
+    for(int c = 0; c < numChunks; c++)
+      triangles += chunks[c].surface->GetNumberOfPolys();
+  }
+  else {
+    triangles = isoSurface->GetOutput()->GetNumberOfPolys();
+  }
+  if(boundary)
+    triangles += boundarySurface->GetOutput()->GetNumberOfPolys();
+  scope.setTriangles(triangles);
+}
+
+void PlatoIsoPipeline::executeUpdate() {
+  contourSurfaces();
+  getOutput()->Update();
+}
+
+void PlatoIsoPipeline::setAbortUpdate(bool toggle) {
+  // the filters check this as they go and give up early...
+  int abort = toggle ? 1 : 0;
+  isoSurface->SetAbortExecute(abort);
+  for(int c = 0; c < numChunks; c++) {
+    chunks[c].contour->SetAbortExecute(abort);
+    chunks[c].normals->SetAbortExecute(abort);
+  }
+  chunkAppend->SetAbortExecute(abort);
+  boundarySurface->SetAbortExecute(abort);
+  boundaryNormals->SetAbortExecute(abort);
+  isoAppend->SetAbortExecute(abort);
+  isoCutter->SetAbortExecute(abort);
+  isoNormals->SetAbortExecute(abort);
+}
+
+void PlatoIsoPipeline::swapBuffers() {
+  // the filters make new arrays every time they run so the front buffer
+  // can keep hold of these while the next update is made...
+  isoFront->ShallowCopy(getOutput());
+  showSymmetryImages(builtSymmetry);
+}
+
+void PlatoIsoPipeline::attachBuffers() {
+  if(worker)
+    isoMapper->SetInput(isoFront);
+  else
+    isoMapper->SetInput(getOutput());
+}
+
+bool PlatoIsoPipeline::isDataStale() {
+  // hidden isosurfaces can wait until they're shown again...
+  if(!isWanted())
+    return false;
+
+  return (data->isFrameWaiting() || data->getFrameNumber() != builtFrame);
+}
+
+bool PlatoIsoPipeline::isWanted() {
+  for(int i = 0; i < PVS_MAX_ISOS; i++) {
+    if(isoVisible[i])
+      return true;
+  }
+
+  return false;
+}
+
+void PlatoIsoPipeline::releaseData() {
+  // every stage keeps its output, which is a lot for a big grid that
+  // isn't being looked at. The blocks hold their surfaces so they go too,
+  // and are contoured again when they're next needed...
+  isoSurface->GetOutput()->ReleaseData();
+  boundarySurface->GetOutput()->ReleaseData();
+  boundaryNormals->GetOutput()->ReleaseData();
+  clearChunks();
+  for(int i = 0; i < 3; i++) {
+    chunkLow[i] = 0;
+    chunkHigh[i] = -1;
+  }
+  chunkAppend->GetOutput()->ReleaseData();
+  isoAppend->GetOutput()->ReleaseData();
+  isoCutter->GetOutput()->ReleaseData();
+  isoNormals->GetOutput()->ReleaseData();
+  isoFront->Initialize();
 }
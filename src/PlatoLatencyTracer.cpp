@@ -0,0 +1,296 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// vtk includes...
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "PlatoLatencyTracer.h"
+#include "PlatoVTKPipeline.h"
+
+// where a change has got to...
+enum PlatoTraceState {
+  PVS_TRACE_FREE,
+  PVS_TRACE_RECEIVED,
+  PVS_TRACE_APPLIED,
+  PVS_TRACE_READY
+};
+
+static const char* typeNames[PVS_TRACE_TYPES] = {
+  "iso value",
+  "iso visibility",
+  "orthoslice",
+  "cut-plane",
+  "molecule",
+  "frame"
+};
+
+PlatoLatencyTracer::PlatoLatencyTracer(double slo) {
+  traceLock = vtkMutexLock::New();
+  pending = new PlatoTrace[PVS_TRACE_PENDING];
+  for(int i = 0; i < PVS_TRACE_PENDING; i++)
+    pending[i].state = PVS_TRACE_FREE;
+  nextId = 0;
+  applyId = -1;
+  lost = 0;
+  target = slo;
+  verbose = false;
+
+  for(int t = 0; t < PVS_TRACE_TYPES; t++) {
+    stats[t].count = 0;
+    stats[t].overTarget = 0;
+    for(int b = 0; b < PVS_TRACE_BUCKETS; b++)
+      stats[t].buckets[b] = 0;
+    stats[t].total = 0.0;
+    stats[t].max = 0.0;
+    stats[t].queueTotal = 0.0;
+    stats[t].updateTotal = 0.0;
+    stats[t].drawTotal = 0.0;
+  }
+}
+
+PlatoLatencyTracer::~PlatoLatencyTracer() {
+  delete[] pending;
+  traceLock->Delete();
+}
+
+int PlatoLatencyTracer::receive(int type, PlatoVTKPipeline* pipeline,
+				double time) {
+  int id;
+
+  // called on the steering thread once the commands for the change are
+  // queued, so they're always drained before (or with) the trace...
+  traceLock->Lock();
+  id = nextId++;
+  PlatoTrace* trace = &pending[id & (PVS_TRACE_PENDING - 1)];
+  if(trace->state != PVS_TRACE_FREE)
+    lost++;
+  trace->id = id;
+  trace->type = type;
+  trace->state = PVS_TRACE_RECEIVED;
+  trace->pipeline = pipeline;
+  trace->generation = 0;
+  trace->received = time;
+  trace->applied = 0.0;
+  trace->built = 0.0;
+  traceLock->Unlock();
+
+  return id;
+}
+
+void PlatoLatencyTracer::startApply() {
+  // everything received up to now is in the queue about to be drained...
+  traceLock->Lock();
+  applyId = nextId - 1;
+  traceLock->Unlock();
+}
+
+void PlatoLatencyTracer::finishApply(double time) {
+  // the change can't be on screen until its pipeline has shown the
+  // generation it asked for. Changes overtaken in the queue are counted as
+  // applied with the one that replaced them...
+  traceLock->Lock();
+  for(int i = 0; i < PVS_TRACE_PENDING; i++) {
+    PlatoTrace* trace = &pending[i];
+    if(trace->state == PVS_TRACE_RECEIVED && trace->id <= applyId) {
+      trace->state = PVS_TRACE_APPLIED;
+      trace->applied = time;
+      if(trace->pipeline)
+	trace->generation = trace->pipeline->getRequestedGeneration();
+    }
+  }
+  traceLock->Unlock();
+}
+
+void PlatoLatencyTracer::collect(double time) {
+  // called on the render thread after the pipelines have swapped in what
+  // they've built. Without a worker the pipeline is updated by the render
+  // itself so building counts as drawing...
+  traceLock->Lock();
+  for(int i = 0; i < PVS_TRACE_PENDING; i++) {
+    PlatoTrace* trace = &pending[i];
+    if(trace->state != PVS_TRACE_APPLIED)
+      continue;
+
+    if(!trace->pipeline) {
+      trace->built = time;
+    }
+    else if(trace->pipeline->getShownGeneration() >= trace->generation) {
+      trace->built = trace->pipeline->getBuiltTime();
+      if(trace->built < trace->applied)
+	trace->built = time;
+    }
+    else {
+      continue;
+    }
+    trace->state = PVS_TRACE_READY;
+  }
+  traceLock->Unlock();
+}
+
+void PlatoLatencyTracer::frameDrawn(double time) {
+  // everything ready went into the frame that's just been drawn...
+  traceLock->Lock();
+  for(int i = 0; i < PVS_TRACE_PENDING; i++) {
+    if(pending[i].state == PVS_TRACE_READY)
+      finishTrace(&pending[i], time);
+  }
+  traceLock->Unlock();
+}
+
+void PlatoLatencyTracer::finishTrace(PlatoTrace* trace, double time) {
+  PlatoTraceStats* s = &stats[trace->type];
+  double latency = time - trace->received;
+
+  // bucket 0 is under a millisecond, bucket b from 2^(b-1) ms...
+  int b = 0;
+  if(latency >= 1.0)
+    b = 1 + (int) floor(log(latency) / log(2.0));
+  if(b >= PVS_TRACE_BUCKETS)
+    b = PVS_TRACE_BUCKETS - 1;
+
+  s->count++;
+  s->buckets[b]++;
+  s->total += latency;
+  if(latency > s->max)
+    s->max = latency;
+  s->queueTotal += trace->applied - trace->received;
+  s->updateTotal += trace->built - trace->applied;
+  s->drawTotal += time - trace->built;
+
+  // each change on its own, for when a replay is being looked at...
+  if(verbose) {
+    std::cout << "Steering change " << trace->id << " (";
+    std::cout << typeNames[trace->type] << "): " << latency << " ms (queue ";
+    std::cout << trace->applied - trace->received << ", update ";
+    std::cout << trace->built - trace->applied << ", draw ";
+    std::cout << time - trace->built << ")\n";
+  }
+
+  if(target > 0.0 && latency > target) {
+    s->overTarget++;
+    std::cerr << "Steering change " << trace->id << " (";
+    std::cerr << typeNames[trace->type] << ") took " << latency;
+    std::cerr << " ms to reach the screen, the target is " << target;
+    std::cerr << " ms\n";
+  }
+
+  trace->state = PVS_TRACE_FREE;
+}
+
+bool PlatoLatencyTracer::isIdle() {
+  bool idle = true;
+
+  // nothing received is still on its way to the screen...
+  traceLock->Lock();
+  for(int i = 0; i < PVS_TRACE_PENDING && idle; i++) {
+    if(pending[i].state != PVS_TRACE_FREE)
+      idle = false;
+  }
+  traceLock->Unlock();
+
+  return idle;
+}
+
+void PlatoLatencyTracer::setVerbose(bool toggle) {
+  verbose = toggle;
+}
+
+double PlatoLatencyTracer::getPercentile(int type, double percent) {
+  double latency = 0.0;
+
+  // only as good as the buckets, so it's the top of the one it's in...
+  traceLock->Lock();
+  PlatoTraceStats* s = &stats[type];
+  int wanted = (int) ceil((s->count * percent) / 100.0);
+  int seen = 0;
+  for(int b = 0; b < PVS_TRACE_BUCKETS && s->count > 0; b++) {
+    seen += s->buckets[b];
+    if(seen >= wanted) {
+      if(b == PVS_TRACE_BUCKETS - 1)
+	latency = s->max;
+      else
+	latency = std::min(s->max, pow(2.0, b));
+      break;
+    }
+  }
+  traceLock->Unlock();
+
+  return latency;
+}
+
+void PlatoLatencyTracer::printStats() {
+  for(int t = 0; t < PVS_TRACE_TYPES; t++) {
+    PlatoTraceStats* s = &stats[t];
+    if(s->count == 0)
+      continue;
+
+    std::cout << "Steering latency for " << typeNames[t] << " over ";
+    std::cout << s->count << " changes: mean " << (s->total / s->count);
+    std::cout << " ms (queue " << (s->queueTotal / s->count) << ", update ";
+    std::cout << (s->updateTotal / s->count) << ", draw ";
+    std::cout << (s->drawTotal / s->count) << "), p50 <= ";
+    std::cout << getPercentile(t, 50.0) << " ms, p95 <= ";
+    std::cout << getPercentile(t, 95.0) << " ms, p99 <= ";
+    std::cout << getPercentile(t, 99.0) << " ms, max " << s->max << " ms\n";
+
+    // the histogram, skipping the empty buckets...
+    std::cout << "  ";
+    for(int b = 0; b < PVS_TRACE_BUCKETS; b++) {
+      if(s->buckets[b] == 0)
+	continue;
+      if(b == PVS_TRACE_BUCKETS - 1)
+	std::cout << ">=" << pow(2.0, b - 1);
+      else
+	std::cout << "<" << pow(2.0, b);
+      std::cout << ":" << s->buckets[b] << " ";
+    }
+    std::cout << std::endl;
+
+    if(target > 0.0) {
+      std::cout << "  " << s->overTarget << " of " << s->count;
+      std::cout << " over the " << target << " ms target\n";
+    }
+  }
+
+  if(lost > 0)
+    std::cout << lost << " steering changes weren't traced\n";
+}
+
+const char* PlatoLatencyTracer::getTypeName(int type) {
+  return typeNames[type];
+}
@@ -0,0 +1,612 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cmath>
+#include <cstring>
+
+// vtk includes...
+#include "vtkCellArray.h"
+#include "vtkFloatArray.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSphereSource.h"
+
+// plato includes...
+#include "PlatoMoleculeGeometry.h"
+#include "PlatoTaskPool.h"
+#include "PlatoTrajectoryReader.h"
+
+PlatoMoleculeGeometry::PlatoMoleculeGeometry(int resolution, float scale,
+					     float radius) {
+  numSides = resolution;
+  atomScale = scale;
+  bondRadius = radius;
+  moveTolerance = 1.0e-4f;
+  numAtoms = 0;
+  positions = NULL;
+  types = NULL;
+
+  cellHead = NULL;
+  cellNext = NULL;
+  atomCell = NULL;
+
+  bondCapacity = 0;
+  numBondSlots = 0;
+  numFreeBonds = 0;
+  bondAtoms = NULL;
+  bondNext = NULL;
+  atomBond = NULL;
+  freeBonds = NULL;
+
+  numMoved = 0;
+  moved = NULL;
+  crossed = NULL;
+
+  // take the atom shape from a sphere source once...
+  vtkSphereSource* sphere = vtkSphereSource::New();
+  sphere->SetThetaResolution(resolution);
+  sphere->SetPhiResolution(resolution);
+  sphere->Update();
+
+  vtkPolyData* spherePD = sphere->GetOutput();
+  vtkDataArray* sn = spherePD->GetPointData()->GetNormals();
+  sphereVerts = spherePD->GetNumberOfPoints();
+  spherePoints = new float[3 * sphereVerts];
+  sphereNormals = new float[3 * sphereVerts];
+  for(int i = 0; i < sphereVerts; i++) {
+    double* p = spherePD->GetPoint(i);
+    double* n = sn->GetTuple3(i);
+    for(int k = 0; k < 3; k++) {
+      spherePoints[(3 * i) + k] = (float) p[k];
+      sphereNormals[(3 * i) + k] = (float) n[k];
+    }
+  }
+
+  vtkIdType npts;
+  vtkIdType* pts;
+  vtkCellArray* polys = spherePD->GetPolys();
+  sphereTris = polys->GetNumberOfCells();
+  sphereCells = new int[3 * sphereTris];
+  polys->InitTraversal();
+  for(int i = 0; polys->GetNextCell(npts, pts); i++) {
+    for(int k = 0; k < 3; k++)
+      sphereCells[(3 * i) + k] = pts[k];
+  }
+  sphere->Delete();
+
+  atomPoints = vtkPoints::New();
+  atomNormals = vtkFloatArray::New();
+  atomNormals->SetNumberOfComponents(3);
+  atomScalars = vtkFloatArray::New();
+  atomScalars->SetName("atom_type");
+  atomPolys = vtkCellArray::New();
+  atomGeometry = vtkPolyData::New();
+  atomGeometry->SetPoints(atomPoints);
+  atomGeometry->SetPolys(atomPolys);
+  atomGeometry->GetPointData()->SetNormals(atomNormals);
+  atomGeometry->GetPointData()->SetScalars(atomScalars);
+
+  bondPoints = vtkPoints::New();
+  bondNormals = vtkFloatArray::New();
+  bondNormals->SetNumberOfComponents(3);
+  bondScalars = vtkFloatArray::New();
+  bondScalars->SetName("atom_type");
+  bondStrips = vtkCellArray::New();
+  bondGeometry = vtkPolyData::New();
+  bondGeometry->SetPoints(bondPoints);
+  bondGeometry->SetStrips(bondStrips);
+  bondGeometry->GetPointData()->SetNormals(bondNormals);
+  bondGeometry->GetPointData()->SetScalars(bondScalars);
+}
+
+PlatoMoleculeGeometry::~PlatoMoleculeGeometry() {
+  freeArrays();
+
+  delete[] spherePoints;
+  delete[] sphereNormals;
+  delete[] sphereCells;
+
+  atomPoints->Delete();
+  atomNormals->Delete();
+  atomScalars->Delete();
+  atomPolys->Delete();
+  atomGeometry->Delete();
+
+  bondPoints->Delete();
+  bondNormals->Delete();
+  bondScalars->Delete();
+  bondStrips->Delete();
+  bondGeometry->Delete();
+}
+
+void PlatoMoleculeGeometry::freeArrays() {
+  if(positions) {
+    delete[] positions;
+    delete[] types;
+    delete[] cellNext;
+    delete[] atomCell;
+    delete[] atomBond;
+    delete[] moved;
+    delete[] crossed;
+  }
+  if(cellHead)
+    delete[] cellHead;
+  if(bondAtoms) {
+    delete[] bondAtoms;
+    delete[] bondNext;
+    delete[] freeBonds;
+  }
+
+  positions = NULL;
+  types = NULL;
+  cellNext = NULL;
+  atomCell = NULL;
+  atomBond = NULL;
+  moved = NULL;
+  crossed = NULL;
+  cellHead = NULL;
+  bondAtoms = NULL;
+  bondNext = NULL;
+  freeBonds = NULL;
+  bondCapacity = 0;
+}
+
+void PlatoMoleculeGeometry::update(PlatoXYZFrame* frame) {
+  float* x;
+  float d[3];
+  int cell;
+  int i;
+
+  // a different molecule means starting again...
+  bool same = (positions != NULL && frame->numAtoms == numAtoms);
+  for(i = 0; same && i < numAtoms; i++)
+    same = (types[i] == frame->atomTypes[i]);
+  if(!same) {
+    rebuild(frame);
+    return;
+  }
+
+  // move the atoms that have moved, noting those that changed cell...
+  numMoved = 0;
+  for(i = 0; i < numAtoms; i++) {
+    x = &frame->coords[3 * i];
+    for(int k = 0; k < 3; k++)
+      d[k] = x[k] - positions[(3 * i) + k];
+    if(((d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2])) <=
+       (moveTolerance * moveTolerance))
+      continue;
+
+    memcpy(&positions[3 * i], x, 3 * sizeof(float));
+    moved[numMoved++] = i;
+
+    cell = cellOf(x);
+    if(cell != atomCell[i]) {
+      int* p = &cellHead[atomCell[i]];
+      while(*p != i)
+	p = &cellNext[*p];
+      *p = cellNext[i];
+      cellNext[i] = cellHead[cell];
+      cellHead[cell] = i;
+      atomCell[i] = cell;
+      crossed[i] = 1;
+    }
+  }
+
+  if(numMoved == 0)
+    return;
+
+  // the spheres don't overlap so they're put in place on the task pool...
+  PlatoTaskPool::getPool()->run(placeMovedAtom, this, numMoved,
+				PVS_MOLECULE_GRAIN);
+
+  // only atoms that changed cell get their bonds found again, everything
+  // else keeps the bonds it had...
+  for(i = 0; i < numMoved; i++) {
+    if(crossed[moved[i]])
+      removeBonds(moved[i]);
+  }
+  for(i = 0; i < numMoved; i++) {
+    if(crossed[moved[i]])
+      findBonds(moved[i]);
+  }
+  for(i = 0; i < numMoved; i++)
+    crossed[moved[i]] = 0;
+
+  // and move the ends of the bonds of every atom that moved...
+  for(i = 0; i < numMoved; i++) {
+    for(int b = atomBond[moved[i]]; b >= 0; b = *bondLink(b, moved[i]))
+      placeBond(b);
+  }
+
+  atomPoints->Modified();
+  bondPoints->Modified();
+  bondNormals->Modified();
+  bondScalars->Modified();
+  atomGeometry->Modified();
+  bondGeometry->Modified();
+}
+
+void PlatoMoleculeGeometry::rebuild(PlatoXYZFrame* frame) {
+  int i;
+
+  freeArrays();
+  numAtoms = frame->numAtoms;
+  positions = new float[3 * (numAtoms + 1)];
+  types = new int[numAtoms + 1];
+  cellNext = new int[numAtoms + 1];
+  atomCell = new int[numAtoms + 1];
+  atomBond = new int[numAtoms + 1];
+  moved = new int[numAtoms + 1];
+  crossed = new char[numAtoms + 1];
+  memcpy(positions, frame->coords, 3 * numAtoms * sizeof(float));
+  memcpy(types, frame->atomTypes, numAtoms * sizeof(int));
+
+  // one sphere's worth of points and triangles per atom...
+  atomPoints->SetNumberOfPoints(numAtoms * sphereVerts);
+  atomNormals->SetNumberOfTuples(numAtoms * sphereVerts);
+  atomScalars->SetNumberOfTuples(numAtoms * sphereVerts);
+  PlatoTaskPool::getPool()->run(setupAtom, this, numAtoms,
+				PVS_MOLECULE_GRAIN);
+
+  vtkIdType tri[3];
+  atomPolys->Reset();
+  for(i = 0; i < numAtoms; i++) {
+    for(int t = 0; t < sphereTris; t++) {
+      for(int k = 0; k < 3; k++)
+	tri[k] = (i * sphereVerts) + sphereCells[(3 * t) + k];
+      atomPolys->InsertNextCell(3, tri);
+    }
+  }
+
+  // bin the atoms and find all the bonds...
+  buildCells();
+  numBondSlots = 0;
+  numFreeBonds = 0;
+  growBonds();
+  for(i = 0; i < numAtoms; i++) {
+    atomBond[i] = -1;
+    crossed[i] = 1;
+  }
+  for(i = 0; i < numAtoms; i++)
+    findBonds(i);
+  for(i = 0; i < numAtoms; i++)
+    crossed[i] = 0;
+
+  atomPoints->Modified();
+  atomNormals->Modified();
+  atomScalars->Modified();
+  atomPolys->Modified();
+  atomGeometry->Modified();
+  bondPoints->Modified();
+  bondGeometry->Modified();
+}
+
+void PlatoMoleculeGeometry::buildCells() {
+  float bounds[6];
+  float maxRadius = 0.0f;
+  int i;
+
+  for(int k = 0; k < 3; k++) {
+    bounds[2 * k] = numAtoms ? positions[k] : 0.0f;
+    bounds[(2 * k) + 1] = bounds[2 * k];
+  }
+  for(i = 0; i < numAtoms; i++) {
+    for(int k = 0; k < 3; k++) {
+      if(positions[(3 * i) + k] < bounds[2 * k])
+	bounds[2 * k] = positions[(3 * i) + k];
+      if(positions[(3 * i) + k] > bounds[(2 * k) + 1])
+	bounds[(2 * k) + 1] = positions[(3 * i) + k];
+    }
+    if(PlatoTrajectoryReader::getCovalentRadius(types[i]) > maxRadius)
+      maxRadius = PlatoTrajectoryReader::getCovalentRadius(types[i]);
+  }
+
+  // cells as big as the longest bond, but no more than 128 along an axis
+  // so a big or sparse system doesn't get an enormous list. There's a
+  // margin of one cell around the first frame for atoms to move into, and
+  // atoms that go further are clamped into the edge cells, which only ever
+  // brings them nearer to the others in the search...
+  for(int k = 0; k < 3; k++) {
+    cellSize[k] = (2.0f * maxRadius) + 0.56f;
+    cellOrigin[k] = bounds[2 * k] - cellSize[k];
+    cells[k] = (int) ((bounds[(2 * k) + 1] - bounds[2 * k]) / cellSize[k]) + 3;
+    if(cells[k] > 128) {
+      cells[k] = 128;
+      cellSize[k] = (bounds[(2 * k) + 1] - bounds[2 * k]) / 126.0f;
+      cellOrigin[k] = bounds[2 * k] - cellSize[k];
+    }
+
+    // the search reaches as many cells as the longest bond covers, so it
+    // doesn't depend on what size the cells ended up...
+    cellReach[k] = (int) ceil(((2.0f * maxRadius) + 0.56f) / cellSize[k]);
+    if(cellReach[k] < 1)
+      cellReach[k] = 1;
+  }
+
+  cellHead = new int[cells[0] * cells[1] * cells[2]];
+  for(i = 0; i < cells[0] * cells[1] * cells[2]; i++)
+    cellHead[i] = -1;
+  for(i = 0; i < numAtoms; i++) {
+    atomCell[i] = cellOf(&positions[3 * i]);
+    cellNext[i] = cellHead[atomCell[i]];
+    cellHead[atomCell[i]] = i;
+  }
+}
+
+int PlatoMoleculeGeometry::cellOf(const float* x) {
+  int c[3];
+
+  for(int k = 0; k < 3; k++) {
+    c[k] = (int) floor((x[k] - cellOrigin[k]) / cellSize[k]);
+    if(c[k] < 0)
+      c[k] = 0;
+    if(c[k] >= cells[k])
+      c[k] = cells[k] - 1;
+  }
+
+  return c[0] + (cells[0] * (c[1] + (cells[1] * c[2])));
+}
+
+void PlatoMoleculeGeometry::setupAtom(int atom, void* data) {
+  PlatoMoleculeGeometry* g = (PlatoMoleculeGeometry*) data;
+  float* n = g->atomNormals->GetPointer(0);
+  float* s = g->atomScalars->GetPointer(0);
+  int verts = g->sphereVerts;
+
+  memcpy(&n[3 * atom * verts], g->sphereNormals, 3 * verts * sizeof(float));
+  for(int v = 0; v < verts; v++)
+    s[(atom * verts) + v] = (float) g->types[atom];
+  g->placeAtom(atom);
+}
+
+void PlatoMoleculeGeometry::placeMovedAtom(int i, void* data) {
+  PlatoMoleculeGeometry* g = (PlatoMoleculeGeometry*) data;
+  g->placeAtom(g->moved[i]);
+}
+
+void PlatoMoleculeGeometry::placeAtom(int atom) {
+  float* p = &((float*) atomPoints->GetVoidPointer(0))[3 * atom * sphereVerts];
+  float* x = &positions[3 * atom];
+
+  for(int v = 0; v < sphereVerts; v++) {
+    for(int k = 0; k < 3; k++)
+      p[(3 * v) + k] = x[k] + (atomScale * spherePoints[(3 * v) + k]);
+  }
+}
+
+void PlatoMoleculeGeometry::placeBond(int bond) {
+  int base = 2 * numSides * bond;
+  float* p = &((float*) bondPoints->GetVoidPointer(0))[3 * base];
+  float* n = &bondNormals->GetPointer(0)[3 * base];
+  float* s = &bondScalars->GetPointer(0)[base];
+  int a = bondAtoms[2 * bond];
+  int c = bondAtoms[(2 * bond) + 1];
+  float axis[3];
+  float u[3];
+  float v[3];
+  float len;
+  double angle;
+
+  // free slots are collapsed to nothing...
+  if(a < 0) {
+    memset(p, 0, 6 * numSides * sizeof(float));
+    memset(n, 0, 6 * numSides * sizeof(float));
+    return;
+  }
+
+  for(int k = 0; k < 3; k++)
+    axis[k] = positions[(3 * c) + k] - positions[(3 * a) + k];
+  len = sqrt((axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]));
+  if(len < 1.0e-6f)
+    len = 1.0e-6f;
+  for(int k = 0; k < 3; k++)
+    axis[k] /= len;
+
+  // two vectors perpendicular to the bond to sweep the tube with...
+  if(fabs(axis[0]) < 0.6f) {
+    u[0] = 0.0f;
+    u[1] = axis[2];
+    u[2] = -axis[1];
+  }
+  else {
+    u[0] = -axis[2];
+    u[1] = 0.0f;
+    u[2] = axis[0];
+  }
+  len = sqrt((u[0] * u[0]) + (u[1] * u[1]) + (u[2] * u[2]));
+  for(int k = 0; k < 3; k++)
+    u[k] /= len;
+  v[0] = (axis[1] * u[2]) - (axis[2] * u[1]);
+  v[1] = (axis[2] * u[0]) - (axis[0] * u[2]);
+  v[2] = (axis[0] * u[1]) - (axis[1] * u[0]);
+
+  for(int i = 0; i < numSides; i++) {
+    angle = (2.0 * M_PI * i) / numSides;
+    for(int k = 0; k < 3; k++) {
+      n[(6 * i) + k] = (float) ((cos(angle) * u[k]) + (sin(angle) * v[k]));
+      n[(6 * i) + 3 + k] = n[(6 * i) + k];
+      p[(6 * i) + k] = positions[(3 * a) + k] + (bondRadius * n[(6 * i) + k]);
+      p[(6 * i) + 3 + k] = positions[(3 * c) + k] +
+	(bondRadius * n[(6 * i) + k]);
+    }
+    s[2 * i] = (float) types[a];
+    s[(2 * i) + 1] = (float) types[c];
+  }
+}
+
+void PlatoMoleculeGeometry::findBonds(int atom) {
+  int c[3];
+  int cell;
+  float d[3];
+  float cutoff;
+  float r = PlatoTrajectoryReader::getCovalentRadius(types[atom]);
+
+  c[0] = atomCell[atom] % cells[0];
+  c[1] = (atomCell[atom] / cells[0]) % cells[1];
+  c[2] = atomCell[atom] / (cells[0] * cells[1]);
+
+  // bond atoms closer than the sum of their covalent radii plus a bit, as
+  // vtkMoleculeReaderBase does, but never bond two hydrogens. Pairs of
+  // atoms that are both being searched are only bonded once...
+  for(int dk = -cellReach[2]; dk <= cellReach[2]; dk++) {
+    if((c[2] + dk) < 0 || (c[2] + dk) >= cells[2])
+      continue;
+    for(int dj = -cellReach[1]; dj <= cellReach[1]; dj++) {
+      if((c[1] + dj) < 0 || (c[1] + dj) >= cells[1])
+	continue;
+      for(int di = -cellReach[0]; di <= cellReach[0]; di++) {
+	if((c[0] + di) < 0 || (c[0] + di) >= cells[0])
+	  continue;
+
+	cell = (c[0] + di) + (cells[0] * ((c[1] + dj) +
+					  (cells[1] * (c[2] + dk))));
+	for(int j = cellHead[cell]; j >= 0; j = cellNext[j]) {
+	  if(j == atom || (crossed[j] && j < atom) ||
+	     (types[atom] == 0 && types[j] == 0))
+	    continue;
+
+	  for(int k = 0; k < 3; k++)
+	    d[k] = positions[(3 * atom) + k] - positions[(3 * j) + k];
+	  cutoff = r + PlatoTrajectoryReader::getCovalentRadius(types[j]) +
+	    0.56f;
+	  if(((d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2])) <
+	     (cutoff * cutoff))
+	    addBond(atom, j);
+	}
+      }
+    }
+  }
+}
+
+int* PlatoMoleculeGeometry::bondLink(int bond, int atom) {
+  return &bondNext[(2 * bond) + ((bondAtoms[2 * bond] == atom) ? 0 : 1)];
+}
+
+void PlatoMoleculeGeometry::addBond(int a, int c) {
+  int bond;
+
+  if(numFreeBonds == 0 && numBondSlots == bondCapacity)
+    growBonds();
+  bond = (numFreeBonds > 0) ? freeBonds[--numFreeBonds] : numBondSlots++;
+
+  bondAtoms[2 * bond] = a;
+  bondAtoms[(2 * bond) + 1] = c;
+  bondNext[2 * bond] = atomBond[a];
+  atomBond[a] = bond;
+  bondNext[(2 * bond) + 1] = atomBond[c];
+  atomBond[c] = bond;
+
+  placeBond(bond);
+}
+
+void PlatoMoleculeGeometry::removeBonds(int atom) {
+  int bond;
+  int other;
+  int* p;
+
+  while(atomBond[atom] >= 0) {
+    bond = atomBond[atom];
+    atomBond[atom] = *bondLink(bond, atom);
+
+    // unhook it from the atom at the other end too...
+    other = bondAtoms[2 * bond];
+    if(other == atom)
+      other = bondAtoms[(2 * bond) + 1];
+    p = &atomBond[other];
+    while(*p != bond)
+      p = bondLink(*p, other);
+    *p = *bondLink(bond, other);
+
+    bondAtoms[2 * bond] = -1;
+    bondAtoms[(2 * bond) + 1] = -1;
+    freeBonds[numFreeBonds++] = bond;
+    placeBond(bond);
+  }
+}
+
+void PlatoMoleculeGeometry::growBonds() {
+  int oldCapacity = bondCapacity;
+  int* oldAtoms = bondAtoms;
+  int* oldNext = bondNext;
+
+  bondCapacity = (bondCapacity > 0) ? 2 * bondCapacity : 2 * numAtoms + 16;
+  bondAtoms = new int[2 * bondCapacity];
+  bondNext = new int[2 * bondCapacity];
+  if(freeBonds)
+    delete[] freeBonds;
+  freeBonds = new int[bondCapacity];
+  for(int i = 0; i < 2 * bondCapacity; i++)
+    bondAtoms[i] = -1;
+  if(oldAtoms) {
+    memcpy(bondAtoms, oldAtoms, 2 * oldCapacity * sizeof(int));
+    memcpy(bondNext, oldNext, 2 * oldCapacity * sizeof(int));
+    delete[] oldAtoms;
+    delete[] oldNext;
+  }
+
+  // every slot has a fixed strip of points; growing loses the old points
+  // so they are all placed again, which is amortised by the doubling...
+  int ringPoints = 2 * numSides;
+  bondPoints->SetNumberOfPoints(bondCapacity * ringPoints);
+  bondNormals->SetNumberOfTuples(bondCapacity * ringPoints);
+  bondScalars->SetNumberOfTuples(bondCapacity * ringPoints);
+
+  vtkIdType* strip = new vtkIdType[ringPoints + 2];
+  bondStrips->Reset();
+  for(int b = 0; b < bondCapacity; b++) {
+    for(int i = 0; i <= numSides; i++) {
+      strip[2 * i] = (b * ringPoints) + (2 * (i % numSides));
+      strip[(2 * i) + 1] = (b * ringPoints) + (2 * (i % numSides)) + 1;
+    }
+    bondStrips->InsertNextCell(ringPoints + 2, strip);
+    placeBond(b);
+  }
+  delete[] strip;
+
+  bondNormals->Modified();
+  bondScalars->Modified();
+  bondStrips->Modified();
+}
+
+vtkPolyData* PlatoMoleculeGeometry::getAtoms() {
+  return atomGeometry;
+}
+
+vtkPolyData* PlatoMoleculeGeometry::getBonds() {
+  return bondGeometry;
+}
+
+int PlatoMoleculeGeometry::getNumberOfMovedAtoms() {
+  return numMoved;
+}
@@ -35,31 +35,36 @@
 // vtk includes...
 #include "vtkActor.h"
 #include "vtkActorCollection.h"
+#include "vtkAppendPolyData.h"
 #include "vtkCutter.h"
 #include "vtkLookupTable.h"
+#include "vtkMutexLock.h"
 #include "vtkPlane.h"
+#include "vtkPolyData.h"
 #include "vtkPolyDataMapper.h"
+#include "vtkUnstructuredGrid.h"
 
 // plato includes...
 #include "main.h"
 #include "PlatoDataReader.h"
 #include "PlatoOrthoPipeline.h"
+#include "PlatoProfiler.h"
 #include "PlatoVTKPipeline.h"
 
 PlatoOrthoPipeline::PlatoOrthoPipeline(PlatoDataReader* dr)
   : PlatoVTKPipeline() {
   data = dr;
 
+  // the slice itself isn't set up until it's first shown...
   init();
-  buildPipeline();
 }
 
 PlatoOrthoPipeline::PlatoOrthoPipeline(PlatoDataReader* dr, vtkLookupTable* clut)
   : PlatoVTKPipeline(clut) {
   data = dr;
 
+  // the slice itself isn't set up until it's first shown...
   init();
-  buildPipeline();
 }
 
 PlatoOrthoPipeline::~PlatoOrthoPipeline() {
@@ -71,8 +76,11 @@ PlatoOrthoPipeline::~PlatoOrthoPipeline() {
   // delete all vtk objects...
   orthoPlane->Delete();
   orthoSlice->Delete();
+  boundarySlice->Delete();
+  orthoAppend->Delete();
   orthoMapper->Delete();
   orthoActor->Delete();
+  orthoFront->Delete();
 }
 
 void PlatoOrthoPipeline::init() {
@@ -84,11 +92,29 @@ void PlatoOrthoPipeline::init() {
   orthoPlaneNormals[2] = 1.0;
 
   orthosliceOn = false;
+  periodic = false;
+  sliceWanted = false;
+  sliceStale = true;
+  runSlice = false;
+  builtFrame = data->getFrameNumber();
+  builtStamp = data->getDataStamp();
 
   orthoPlane = vtkPlane::New();
   orthoSlice = vtkCutter::New();
+  boundarySlice = vtkCutter::New();
+  orthoAppend = vtkAppendPolyData::New();
   orthoMapper = vtkPolyDataMapper::New();
   orthoActor = vtkActor::New();
+  orthoFront = vtkPolyData::New();
+
+  // apply colour map...
+  orthoMapper->SetInput(orthoSlice->GetOutput());
+  orthoMapper->SetScalarRange(dataRange);
+  orthoMapper->SetLookupTable(colourTable);
+
+  // put it into an actor, hidden until the slice is wanted...
+  orthoActor->SetMapper(orthoMapper);
+  orthoActor->SetVisibility(0);
 
   // add actor to the collection...
   actors->AddItem(orthoActor);
@@ -103,22 +129,122 @@ void PlatoOrthoPipeline::buildPipeline() {
   orthoSlice->SetInput(data->getData());
   orthoSlice->SetCutFunction(orthoPlane);
 
-  // apply colour map...
-  orthoMapper->SetInput(orthoSlice->GetOutput());
-  orthoMapper->SetScalarRange(dataRange);
-  orthoMapper->SetLookupTable(colourTable);
+  // the periodic boundary cells are sliced separately and joined on...
+  boundarySlice->SetCutFunction(orthoPlane);
+  orthoAppend->AddInput(orthoSlice->GetOutput());
+  orthoAppend->AddInput(boundarySlice->GetOutput());
 
-  // put it into an actor and set it's state...
-  orthoActor->SetMapper(orthoMapper);
-  setOrthoslice(orthosliceOn);
+  // time the slicing as it runs when profiling...
+  PlatoProfiler::watch(orthoSlice, "ortho.slice", PVS_PROF_SLICE,
+		       orthoSlice->GetOutput());
+  PlatoProfiler::watch(boundarySlice, "ortho.boundary", PVS_PROF_SLICE,
+		       boundarySlice->GetOutput());
 }
 
 void PlatoOrthoPipeline::setOrthoslice(bool toggle) {
+  updateLock->Lock();
   orthosliceOn = toggle;
+  sliceStale = true;
+  updateLock->Unlock();
 
-  orthosliceOn ? orthoActor->SetVisibility(1) : orthoActor->SetVisibility(0);
+  // the slice is only made when it's wanted...
+  setActorVisibility(orthoActor, orthosliceOn);
+  if(orthosliceOn)
+    requestUpdate();
 }
 
 bool PlatoOrthoPipeline::isOrthosliceOn() {
   return orthosliceOn;
 }
+
+void PlatoOrthoPipeline::setPeriodic(bool toggle) {
+  // only uniform grids have a periodic boundary...
+  vtkUnstructuredGrid* boundary = data->getPeriodicBoundary();
+
+  updateLock->Lock();
+  periodic = (toggle && boundary != NULL);
+  sliceStale = true;
+  updateLock->Unlock();
+  requestUpdate();
+  attachBuffers();
+}
+
+bool PlatoOrthoPipeline::isPeriodic() {
+  return periodic;
+}
+
+vtkPolyData* PlatoOrthoPipeline::getSlice() {
+  if(periodic)
+    return orthoAppend->GetOutput();
+  else
+    return orthoSlice->GetOutput();
+}
+
+void PlatoOrthoPipeline::configure() {
+  // with a worker the frame is taken for all the pipelines at once...
+  if(!worker)
+    data->acquireFrame();
+  builtFrame = data->getFrameNumber();
+
+  // new data only needs slicing again if some of what changed is on the
+  // plane. A run that was cut short has to be done again...
+  if(data->isPlaneDirty(orthoPlaneCentre, orthoPlaneNormals, builtStamp))
+    sliceStale = true;
+  builtStamp = data->getDataStamp();
+  if(!updateComplete) {
+    orthoSlice->Modified();
+    boundarySlice->Modified();
+    sliceStale = true;
+  }
+
+  sliceWanted = orthosliceOn;
+  runSlice = (sliceWanted && sliceStale);
+  if(runSlice)
+    sliceStale = false;
+  if(periodic)
+    boundarySlice->SetInput(data->getPeriodicBoundary());
+}
+
+void PlatoOrthoPipeline::executeUpdate() {
+  if(runSlice)
+    getSlice()->Update();
+}
+
+void PlatoOrthoPipeline::setAbortUpdate(bool toggle) {
+  int abort = toggle ? 1 : 0;
+  orthoSlice->SetAbortExecute(abort);
+  boundarySlice->SetAbortExecute(abort);
+  orthoAppend->SetAbortExecute(abort);
+}
+
+void PlatoOrthoPipeline::swapBuffers() {
+  orthoFront->ShallowCopy(getSlice());
+}
+
+void PlatoOrthoPipeline::attachBuffers() {
+  if(worker)
+    orthoMapper->SetInput(orthoFront);
+  else
+    orthoMapper->SetInput(getSlice());
+}
+
+bool PlatoOrthoPipeline::isDataStale() {
+  // a hidden slice can wait until it's shown again...
+  if(!isWanted())
+    return false;
+
+  return (data->isFrameWaiting() || data->getFrameNumber() != builtFrame);
+}
+
+bool PlatoOrthoPipeline::isWanted() {
+  return orthosliceOn;
+}
+
+void PlatoOrthoPipeline::releaseData() {
+  // the slice is cut again from scratch when it's next shown...
+  orthoSlice->GetOutput()->ReleaseData();
+  boundarySlice->GetOutput()->ReleaseData();
+  orthoAppend->GetOutput()->ReleaseData();
+  orthoFront->Initialize();
+  sliceStale = true;
+}
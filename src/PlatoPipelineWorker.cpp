@@ -0,0 +1,151 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "PlatoDataReader.h"
+#include "PlatoPipelineWorker.h"
+#include "PlatoRenderWindow.h"
+#include "PlatoVTKPipeline.h"
+
+PlatoPipelineWorker::PlatoPipelineWorker(PlatoRenderWindow* prw) {
+  window = prw;
+  data = NULL;
+  pipelines = new PlatoVTKPipeline*[PVS_MAX_PIPELINES];
+  numPipelines = 0;
+  queue = new PlatoVTKPipeline*[PVS_MAX_PIPELINES];
+  queueLength = 0;
+  passLength = 0;
+  done = false;
+
+  queueLock = vtkMutexLock::New();
+  sem_init(&queueWake, 0, 0);
+  thread = vtkMultiThreader::New();
+  threadID = thread->SpawnThread(workerLoop, this);
+}
+
+PlatoPipelineWorker::~PlatoPipelineWorker() {
+  // stop the thread, any update it's running is allowed to finish...
+  queueLock->Lock();
+  done = true;
+  queueLock->Unlock();
+  sem_post(&queueWake);
+  thread->TerminateThread(threadID);
+
+  thread->Delete();
+  queueLock->Delete();
+  sem_destroy(&queueWake);
+  delete[] pipelines;
+  delete[] queue;
+}
+
+void PlatoPipelineWorker::setDataReader(PlatoDataReader* dr) {
+  data = dr;
+}
+
+void PlatoPipelineWorker::addPipeline(PlatoVTKPipeline* pipeline) {
+  queueLock->Lock();
+  if(numPipelines < PVS_MAX_PIPELINES)
+    pipelines[numPipelines++] = pipeline;
+  queueLock->Unlock();
+}
+
+void PlatoPipelineWorker::schedule(PlatoVTKPipeline* pipeline) {
+  bool queued = false;
+
+  // a pipeline only needs to be in the queue once, when its turn comes
+  // it'll update to whatever it was last asked for...
+  queueLock->Lock();
+  for(int i = 0; i < queueLength; i++) {
+    if(queue[i] == pipeline)
+      queued = true;
+  }
+  if(!queued && queueLength < PVS_MAX_PIPELINES)
+    queue[queueLength++] = pipeline;
+  else
+    queued = true;
+  queueLock->Unlock();
+
+  if(!queued)
+    sem_post(&queueWake);
+}
+
+void* PlatoPipelineWorker::workerLoop(void* userData) {
+  PlatoPipelineWorker* worker = (PlatoPipelineWorker*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  PlatoVTKPipeline* pipeline;
+  int numPipelines;
+  bool newPass;
+
+  while(true) {
+    sem_wait(&worker->queueWake);
+
+    worker->queueLock->Lock();
+    if(worker->done) {
+      worker->queueLock->Unlock();
+      break;
+    }
+    newPass = (worker->passLength == 0);
+    numPipelines = worker->numPipelines;
+    worker->queueLock->Unlock();
+
+    // the frame is taken once for the whole pass. Anything showing the
+    // data that isn't already queued is queued now so it's run on the
+    // same frame...
+    if(newPass) {
+      if(worker->data && worker->data->acquireFrame()) {
+	for(int i = 0; i < numPipelines; i++)
+	  worker->pipelines[i]->checkData();
+      }
+      worker->queueLock->Lock();
+      worker->passLength = worker->queueLength;
+      worker->queueLock->Unlock();
+    }
+
+    worker->queueLock->Lock();
+    worker->passLength--;
+    pipeline = worker->queue[0];
+    worker->queueLength--;
+    for(int i = 0; i < worker->queueLength; i++)
+      worker->queue[i] = worker->queue[i + 1];
+    worker->queueLock->Unlock();
+
+    // if the result is still wanted get it on screen...
+    if(pipeline->runUpdate())
+      worker->window->requestRender();
+  }
+
+  return NULL;
+}
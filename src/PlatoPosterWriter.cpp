@@ -0,0 +1,179 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+
+// plato includes...
+#include "PlatoPosterWriter.h"
+
+// the size of the IDAT chunks written...
+#define PVS_POSTER_CHUNK 65536
+
+static void putInt(unsigned char* buffer, unsigned int value) {
+  // PNG is big endian throughout...
+  buffer[0] = (value >> 24) & 0xff;
+  buffer[1] = (value >> 16) & 0xff;
+  buffer[2] = (value >> 8) & 0xff;
+  buffer[3] = value & 0xff;
+}
+
+PlatoPosterWriter::PlatoPosterWriter(const char* filename, int w, int h) {
+  const char* type = strrchr(filename, '.');
+
+  width = w;
+  height = h;
+  rowsWritten = 0;
+  png = !(type && (strcmp(type, ".ppm") == 0 || strcmp(type, ".pnm") == 0));
+  row = NULL;
+  packed = NULL;
+  stream = NULL;
+
+  file = fopen(filename, "wb");
+  if(!file) {
+    std::cerr << "Could not write " << filename << std::endl;
+    exit(1);
+  }
+
+  if(!png) {
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    return;
+  }
+
+  // 8 bit RGB, not interlaced...
+  unsigned char header[13];
+  putInt(header, width);
+  putInt(header + 4, height);
+  header[8] = 8;
+  header[9] = 2;
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = 0;
+  fwrite("\211PNG\r\n\032\n", 1, 8, file);
+  writeChunk("IHDR", header, 13);
+
+  // each row is deflated as it comes with a filter byte on the front...
+  row = new unsigned char[(width * 3) + 1];
+  packed = new unsigned char[PVS_POSTER_CHUNK];
+  stream = new z_stream;
+  memset(stream, 0, sizeof(z_stream));
+  deflateInit(stream, PVS_POSTER_COMPRESSION);
+  stream->next_out = packed;
+  stream->avail_out = PVS_POSTER_CHUNK;
+}
+
+PlatoPosterWriter::~PlatoPosterWriter() {
+  close();
+}
+
+void PlatoPosterWriter::writeChunk(const char* type, const unsigned char* data,
+				   unsigned int length) {
+  unsigned char word[4];
+  unsigned long crc = crc32(0L, (const Bytef*) type, 4);
+
+  if(length > 0)
+    crc = crc32(crc, data, length);
+
+  putInt(word, length);
+  fwrite(word, 1, 4, file);
+  fwrite(type, 1, 4, file);
+  fwrite(data, 1, length, file);
+  putInt(word, (unsigned int) crc);
+  fwrite(word, 1, 4, file);
+}
+
+void PlatoPosterWriter::deflateRow(int flush) {
+  int status;
+
+  // pass full chunks on as they fill, finishing can take more than one...
+  do {
+    status = deflate(stream, flush);
+    if(stream->avail_out == 0 || status == Z_STREAM_END) {
+      writeChunk("IDAT", packed, PVS_POSTER_CHUNK - stream->avail_out);
+      stream->next_out = packed;
+      stream->avail_out = PVS_POSTER_CHUNK;
+    }
+  } while(stream->avail_in > 0 ||
+	  (flush == Z_FINISH && status != Z_STREAM_END));
+}
+
+void PlatoPosterWriter::writeRow(const unsigned char* pixels) {
+  if(!file || rowsWritten == height)
+    return;
+  rowsWritten++;
+
+  if(!png) {
+    fwrite(pixels, 1, width * 3, file);
+    return;
+  }
+
+  // the "sub" filter, each byte less the one a pixel to the left. It's
+  // cheap and makes the smooth parts of a render pack a lot better...
+  row[0] = 1;
+  memcpy(row + 1, pixels, 3);
+  for(int i = 3; i < width * 3; i++)
+    row[i + 1] = pixels[i] - pixels[i - 3];
+
+  stream->next_in = row;
+  stream->avail_in = (width * 3) + 1;
+  deflateRow(Z_NO_FLUSH);
+}
+
+void PlatoPosterWriter::close() {
+  if(!file)
+    return;
+
+  // anything not given is left black...
+  unsigned char* black = new unsigned char[width * 3];
+  memset(black, 0, width * 3);
+  while(rowsWritten < height)
+    writeRow(black);
+  delete[] black;
+
+  if(png) {
+    stream->next_in = NULL;
+    stream->avail_in = 0;
+    deflateRow(Z_FINISH);
+    deflateEnd(stream);
+    writeChunk("IEND", NULL, 0);
+
+    delete stream;
+    delete[] row;
+    delete[] packed;
+  }
+
+  fclose(file);
+  file = NULL;
+}
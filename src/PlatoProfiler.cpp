@@ -0,0 +1,308 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkCallbackCommand.h"
+#include "vtkCommand.h"
+#include "vtkMutexLock.h"
+#include "vtkPolyData.h"
+
+// plato includes...
+#include "PlatoProfiler.h"
+
+// a filter being timed from its start event to its end event...
+struct PlatoProfileWatch {
+  const char* name;
+  int stage;
+  vtkPolyData* output;
+  double start;
+  long resident;
+};
+
+static const char* stageCategories[PVS_PROF_STAGES] = {
+  "read", "build", "delaunay", "contour", "normals", "clip", "slice",
+  "molecule", "render"
+};
+
+static const char* stageNames[PVS_PROF_STAGES] = {
+  "Read time (ms)",
+  "Build time (ms)",
+  "Delaunay time (ms)",
+  "Contour time (ms)",
+  "Normals time (ms)",
+  "Clip time (ms)",
+  "Slice time (ms)",
+  "Molecule time (ms)",
+  "Render time (ms)"
+};
+
+bool PlatoProfiler::enabled = false;
+FILE* PlatoProfiler::file = NULL;
+bool PlatoProfiler::chrome = false;
+bool PlatoProfiler::first = true;
+double PlatoProfiler::origin = 0.0;
+vtkMutexLock* PlatoProfiler::lock = NULL;
+double PlatoProfiler::stageTimes[PVS_PROF_STAGES];
+long PlatoProfiler::stageTriangles[PVS_PROF_STAGES];
+long PlatoProfiler::resident = 0;
+
+void PlatoProfiler::start(const char* filename) {
+  const char* type = strrchr(filename, '.');
+
+  file = fopen(filename, "w");
+  if(!file) {
+    std::cerr << "Could not write profile " << filename << std::endl;
+    exit(1);
+  }
+
+  // a trace is a JSON array, which chrome://tracing will read even if we
+  // never get to close it...
+  chrome = (type && strcmp(type, ".json") == 0);
+  if(chrome)
+    fprintf(file, "[\n");
+
+  for(int i = 0; i < PVS_PROF_STAGES; i++) {
+    stageTimes[i] = 0.0;
+    stageTriangles[i] = 0;
+  }
+  lock = vtkMutexLock::New();
+  origin = 0.0;
+  origin = now();
+  resident = getResident();
+  enabled = true;
+}
+
+void PlatoProfiler::finish() {
+  if(!enabled)
+    return;
+
+  enabled = false;
+  if(chrome)
+    fprintf(file, "\n]\n");
+  fclose(file);
+  file = NULL;
+  lock->Delete();
+  lock = NULL;
+}
+
+double PlatoProfiler::now() {
+  struct timeval t;
+  gettimeofday(&t, NULL);
+
+  // in microseconds, as the trace wants...
+  return (t.tv_sec * 1000000.0) + t.tv_usec - origin;
+}
+
+long PlatoProfiler::getResident() {
+  long pages = 0;
+  long size;
+
+  // the second number is the resident set in pages...
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if(!statm)
+    return 0;
+  if(fscanf(statm, "%ld %ld", &size, &pages) != 2)
+    pages = 0;
+  fclose(statm);
+
+  return (pages * sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+void PlatoProfiler::record(const char* name, int stage, double start,
+			   long triangles, long residentBefore) {
+  // memory is only read as a stage ends, the change is from whatever was
+  // recorded last...
+  double end = now();
+  long residentAfter = getResident();
+  long thread = syscall(SYS_gettid);
+
+  lock->Lock();
+  stageTimes[stage] = (end - start) / 1000.0;
+  if(triangles >= 0)
+    stageTriangles[stage] = triangles;
+  resident = residentAfter;
+
+  if(chrome) {
+    fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",",
+	    first ? "" : ",\n", name, stageCategories[stage]);
+    fprintf(file, "\"ts\":%.0f,\"dur\":%.0f,\"pid\":%d,\"tid\":%ld,", start,
+	    end - start, (int) getpid(), thread);
+    fprintf(file, "\"args\":{\"triangles\":%ld,\"rss_kb\":%ld,", triangles,
+	    residentAfter);
+    fprintf(file, "\"rss_delta_kb\":%ld}}", residentAfter - residentBefore);
+  }
+  else {
+    fprintf(file, "{\"name\":\"%s\",\"stage\":\"%s\",\"ts_us\":%.0f,",
+	    name, stageCategories[stage], start);
+    fprintf(file, "\"dur_us\":%.0f,\"thread\":%ld,\"triangles\":%ld,",
+	    end - start, thread, triangles);
+    fprintf(file, "\"rss_kb\":%ld,\"rss_delta_kb\":%ld}\n", residentAfter,
+	    residentAfter - residentBefore);
+  }
+  first = false;
+  lock->Unlock();
+}
+
+void PlatoProfiler::recordCounters(const char* name, const double* values,
+				  int n) {
+  if(!enabled)
+    return;
+
+  double time = now();
+
+  // a counter track per value in the trace, an array in the lines...
+  lock->Lock();
+  if(chrome) {
+    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.0f,",
+	    first ? "" : ",\n", name, time);
+    fprintf(file, "\"pid\":%d,\"args\":{", (int) getpid());
+    for(int i = 0; i < n; i++)
+      fprintf(file, "%s\"%d\":%.1f", (i > 0) ? "," : "", i, values[i]);
+    fprintf(file, "}}");
+  }
+  else {
+    fprintf(file, "{\"name\":\"%s\",\"ts_us\":%.0f,\"values\":[", name,
+	    time);
+    for(int i = 0; i < n; i++)
+      fprintf(file, "%s%.1f", (i > 0) ? "," : "", values[i]);
+    fprintf(file, "]}\n");
+  }
+  first = false;
+  lock->Unlock();
+}
+
+void PlatoProfiler::watch(vtkObject* filter, const char* name, int stage,
+			  vtkPolyData* output) {
+  if(!enabled)
+    return;
+
+  PlatoProfileWatch* w = new PlatoProfileWatch;
+  w->name = name;
+  w->stage = stage;
+  w->output = output;
+  w->start = 0.0;
+  w->resident = 0;
+
+  // the filter owns the callback, and the callback the watch, so it all
+  // goes when the filter does...
+  vtkCallbackCommand* callback = vtkCallbackCommand::New();
+  callback->SetCallback(filterCallback);
+  callback->SetClientData(w);
+  callback->SetClientDataDeleteCallback(freeWatch);
+  filter->AddObserver(vtkCommand::StartEvent, callback);
+  filter->AddObserver(vtkCommand::EndEvent, callback);
+  callback->Delete();
+}
+
+void PlatoProfiler::filterCallback(vtkObject* obj, unsigned long eid,
+				   void* cd, void* calld) {
+  PlatoProfileWatch* w = (PlatoProfileWatch*) cd;
+
+  if(!enabled)
+    return;
+
+  if(eid == vtkCommand::StartEvent) {
+    w->start = now();
+    w->resident = getLastResident();
+  }
+  else {
+    record(w->name, w->stage, w->start,
+	   w->output ? (long) w->output->GetNumberOfPolys() : -1, w->resident);
+  }
+}
+
+void PlatoProfiler::freeWatch(void* cd) {
+  delete (PlatoProfileWatch*) cd;
+}
+
+const char* PlatoProfiler::getStageName(int stage) {
+  return stageNames[stage];
+}
+
+double PlatoProfiler::getStageTime(int stage) {
+  double time;
+
+  lock->Lock();
+  time = stageTimes[stage];
+  lock->Unlock();
+
+  return time;
+}
+
+long PlatoProfiler::getStageTriangles(int stage) {
+  long triangles;
+
+  lock->Lock();
+  triangles = stageTriangles[stage];
+  lock->Unlock();
+
+  return triangles;
+}
+
+long PlatoProfiler::getLastResident() {
+  long kb;
+
+  lock->Lock();
+  kb = resident;
+  lock->Unlock();
+
+  return kb;
+}
+
+PlatoProfileScope::PlatoProfileScope(const char* n, int s) {
+  name = n;
+  stage = s;
+  start = -1.0;
+  triangles = -1;
+  if(!PlatoProfiler::isEnabled())
+    return;
+
+  start = PlatoProfiler::now();
+  resident = PlatoProfiler::getLastResident();
+}
+
+PlatoProfileScope::~PlatoProfileScope() {
+  if(start >= 0.0 && PlatoProfiler::isEnabled())
+    PlatoProfiler::record(name, stage, start, triangles, resident);
+}
+
+void PlatoProfileScope::setTriangles(long n) {
+  triangles = n;
+}
@@ -31,28 +31,85 @@
 ---------------------------------------------------------------------------*/
 
 // system includes
+#include <fcntl.h>
 #include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <X11/Intrinsic.h>
 
 // vtk includes
 #include "vtkActor.h"
 #include "vtkActorCollection.h"
 #include "vtkCallbackCommand.h"
+#include "vtkCamera.h"
 #include "vtkRenderer.h"
 #include "vtkRenderWindow.h"
 #include "vtkRenderWindowInteractor.h"
 #include "vtkInteractorStyleTrackballCamera.h"
+#include "vtkMutexLock.h"
+#include "vtkTextActor.h"
+#include "vtkTextProperty.h"
+#include "vtkXRenderWindowInteractor.h"
 
 //plato includes
 #include "main.h"
+#include "PlatoFrameScheduler.h"
+#include "PlatoFrameServer.h"
+#include "PlatoLatencyTracer.h"
+#include "PlatoPipelineWorker.h"
+#include "PlatoProfiler.h"
 #include "PlatoRenderWindow.h"
 #include "PlatoVTKPipeline.h"
 
-PlatoRenderWindow::PlatoRenderWindow(bool steer, const char* name, int width, int height) {
+// the gap between the frames that bring back the detail after moving the
+// camera (in milliseconds)...
+#define PVS_REFINE_DELAY 10
+
+// called by Xt when the steering thread writes to the wake pipe...
+static void wakeCallback(XtPointer clientData, int* fd, XtInputId* id) {
+  ((PlatoRenderWindow*) clientData)->processRenderRequest();
+}
+
+// called by Xt when it's time to draw the next more detailed frame...
+static void refineCallback(XtPointer clientData, XtIntervalId* id) {
+  ((PlatoRenderWindow*) clientData)->refineFrame();
+}
+
+// called by vtk after every render, whoever asked for it...
+static void frameDrawn(vtkObject* obj, unsigned long eid, void* cd, void* calld) {
+  ((PlatoRenderWindow*) cd)->publishFrame();
+}
+
+PlatoRenderWindow::PlatoRenderWindow(bool steer, bool offscr, const char* name, int width, int height) {
   steered = steer;
+  offscreen = offscr;
 
-  if(steered) {
+  wakePipe[0] = -1;
+  wakePipe[1] = -1;
+  tracer = NULL;
+  commands = NULL;
+  commandCallback = NULL;
+  commandData = NULL;
+  pipelines = new PlatoVTKPipeline*[PVS_MAX_PIPELINES];
+  numPipelines = 0;
+  frameServer = NULL;
+  frameCallback = NULL;
+  scheduler = NULL;
+  refinePending = false;
+  running = false;
+  statusText = NULL;
+
+  if(steered && !offscreen) {
     callback = vtkCallbackCommand::New();
     callback->SetCallback(renderCallback);
+    callback->SetClientData(this);
+  }
+  if(steered) {
+    // neither end may block, a full pipe already means a render is due...
+    if(pipe(wakePipe) == 0) {
+      fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+      fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
   }
 
   windowName = const_cast<char*>(name);
@@ -65,6 +122,16 @@ PlatoRenderWindow::PlatoRenderWindow(bool steer, const char* name, int width, in
   window->AddRenderer(renderer);
   window->SetWindowName(windowName);
   window->SetSize(windowWidth, windowHeight);
+  PlatoProfiler::watch(window, "render", PVS_PROF_RENDER);
+
+  // without a display there's nothing to interact with, vtk has to have
+  // been built against offscreen Mesa for this to work...
+  if(offscreen) {
+    window->SetOffScreenRendering(1);
+    interactorStyle = NULL;
+    interactor = NULL;
+    return;
+  }
 
   interactorStyle = vtkInteractorStyleTrackballCamera::New();
 
@@ -73,19 +140,42 @@ PlatoRenderWindow::PlatoRenderWindow(bool steer, const char* name, int width, in
   interactor->SetInteractorStyle(interactorStyle);
   interactor->Initialize();
   if(steered) {
-    interactor->AddObserver(vtkCommand::TimerEvent, callback);
-    interactor->CreateTimer(VTKI_TIMER_FIRST);
+    // with X the pipe goes straight into the event loop so nothing runs
+    // until there is something to draw, otherwise fall back to polling
+    // on a timer...
+    vtkXRenderWindowInteractor* xInteractor =
+      vtkXRenderWindowInteractor::SafeDownCast(interactor);
+    if(xInteractor && wakePipe[0] >= 0) {
+      XtAppAddInput(xInteractor->GetApp(), wakePipe[0],
+		    (XtPointer) XtInputReadMask, wakeCallback, this);
+    }
+    else {
+      interactor->AddObserver(vtkCommand::TimerEvent, callback);
+      interactor->CreateTimer(VTKI_TIMER_FIRST);
+    }
   }
 }
 
 PlatoRenderWindow::~PlatoRenderWindow() {
-  if(steered)
+  if(steered && !offscreen)
     callback->Delete();
+  if(wakePipe[0] >= 0) {
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+  }
+  delete[] pipelines;
+  if(frameCallback)
+    frameCallback->Delete();
+  if(scheduler)
+    delete scheduler;
+  if(statusText)
+    statusText->Delete();
   renderer->Delete();
   window->Delete();
   if(interactor)
     interactor->Delete();
-  interactorStyle->Delete();
+  if(interactorStyle)
+    interactorStyle->Delete();
 }
 
 void PlatoRenderWindow::addActor(vtkActor* actor) {
@@ -114,6 +204,8 @@ void PlatoRenderWindow::removeAllActors() {
 
 void PlatoRenderWindow::addPipeline(PlatoVTKPipeline* pipe) {
   addActors(pipe->getActors());
+  if(numPipelines < PVS_MAX_PIPELINES)
+    pipelines[numPipelines++] = pipe;
 }
 
 vtkRenderWindowInteractor* PlatoRenderWindow::getInteractor() {
@@ -121,13 +213,240 @@ vtkRenderWindowInteractor* PlatoRenderWindow::getInteractor() {
 }
 
 void PlatoRenderWindow::start() {
-  interactor->Start();
+  struct pollfd wake;
+
+  if(interactor) {
+    interactor->Start();
+    return;
+  }
+
+  // without a display there's no event loop, so a steered window just
+  // waits on the pipe for something to draw until it's told to stop...
+  if(wakePipe[0] < 0)
+    return;
+  wake.fd = wakePipe[0];
+  wake.events = POLLIN;
+  running = true;
+  while(running) {
+    if(poll(&wake, 1, -1) > 0)
+      processRenderRequest();
+  }
 }
 
 void PlatoRenderWindow::exit() {
-  interactor->ExitCallback();
+  if(interactor)
+    interactor->ExitCallback();
+  running = false;
 }
 
 bool PlatoRenderWindow::isSteered() {
   return steered;
 }
+
+bool PlatoRenderWindow::isOffscreen() {
+  return offscreen;
+}
+
+vtkCamera* PlatoRenderWindow::getCamera() {
+  return renderer->GetActiveCamera();
+}
+
+void PlatoRenderWindow::resetCamera() {
+  renderer->ResetCamera();
+}
+
+void PlatoRenderWindow::setStatus(const char* text) {
+  // a line of text in the corner of the window, taken away again when
+  // there's nothing to say...
+  if(!text) {
+    if(statusText) {
+      renderer->RemoveActor2D(statusText);
+      statusText->Delete();
+      statusText = NULL;
+    }
+    return;
+  }
+
+  if(!statusText) {
+    statusText = vtkTextActor::New();
+    statusText->GetTextProperty()->SetFontSize(14);
+    statusText->GetTextProperty()->SetColor(1.0, 1.0, 1.0);
+    statusText->SetDisplayPosition(10, 10);
+    renderer->AddActor2D(statusText);
+  }
+  statusText->SetInput(text);
+}
+
+int* PlatoRenderWindow::getSize() {
+  return window->GetSize();
+}
+
+void PlatoRenderWindow::setSize(int width, int height) {
+  windowWidth = width;
+  windowHeight = height;
+  window->SetSize(windowWidth, windowHeight);
+}
+
+void PlatoRenderWindow::render(bool update) {
+  // with no interactor the frame boundary is wherever the caller says it
+  // is, so any new data is taken here too. Unless it's the same frame
+  // drawn again from somewhere else...
+  if(update && commands)
+    commands->drain(commandCallback, commandData);
+  double now = getTimeMillis();
+  for(int i = 0; i < numPipelines && update; i++) {
+    pipelines[i]->checkData();
+    pipelines[i]->swapIfReady();
+    pipelines[i]->checkIdle(now);
+  }
+
+  renderer->ResetCameraClippingRange();
+  window->Render();
+}
+
+unsigned char* PlatoRenderWindow::grabImage(int* width, int* height) {
+  int* size = window->GetSize();
+
+  // the pixels are RGB from the bottom row up and belong to the caller. A
+  // window on screen has already swapped what it drew to the front...
+  *width = size[0];
+  *height = size[1];
+
+  return window->GetPixelData(0, 0, size[0] - 1, size[1] - 1,
+			      offscreen ? 0 : 1);
+}
+
+void PlatoRenderWindow::setFrameServer(PlatoFrameServer* server) {
+  frameServer = server;
+
+  // interaction renders without going through us, so listen to the
+  // window itself...
+  frameCallback = vtkCallbackCommand::New();
+  frameCallback->SetCallback(frameDrawn);
+  frameCallback->SetClientData(this);
+  window->AddObserver(vtkCommand::EndEvent, frameCallback);
+}
+
+void PlatoRenderWindow::publishFrame() {
+  int width;
+  int height;
+
+  // reading the pixels back stalls the render, so don't for no one...
+  if(!frameServer->hasClient())
+    return;
+
+  // the copy is all that's done here, the server does the rest on its own
+  // thread...
+  unsigned char* pixels = grabImage(&width, &height);
+  frameServer->publish(pixels, width, height);
+}
+
+void PlatoRenderWindow::setCommandQueue(PlatoCommandQueue* queue,
+					PlatoCommandCallback apply,
+					void* data) {
+  commands = queue;
+  commandCallback = apply;
+  commandData = data;
+}
+
+void PlatoRenderWindow::setLatencyTracer(PlatoLatencyTracer* t) {
+  tracer = t;
+}
+
+PlatoLatencyTracer* PlatoRenderWindow::getLatencyTracer() {
+  return tracer;
+}
+
+void PlatoRenderWindow::requestRender() {
+  renderLock->Lock();
+  reRender = true;
+  renderLock->Unlock();
+
+  if(wakePipe[1] >= 0)
+    write(wakePipe[1], "r", 1);
+}
+
+void PlatoRenderWindow::processRenderRequest() {
+  bool render;
+  char drain[64];
+
+  // empty the pipe, any number of requests are dealt with by one render...
+  if(wakePipe[0] >= 0)
+    while(read(wakePipe[0], drain, 64) > 0);
+
+  // take the request before rendering so that changes made during the
+  // render ask for another one...
+  renderLock->Lock();
+  render = reRender;
+  reRender = false;
+  renderLock->Unlock();
+
+  // the pipelines are only ever changed here, never mid-render...
+  if(tracer)
+    tracer->startApply();
+  if(commands)
+    commands->drain(commandCallback, commandData);
+  if(tracer)
+    tracer->finishApply(getTimeMillis());
+
+  // this is a frame boundary so any finished updates can be shown, any
+  // new data sent off to be worked on, and anything long hidden tidied up...
+  double now = getTimeMillis();
+  for(int i = 0; i < numPipelines; i++) {
+    pipelines[i]->checkData();
+    if(pipelines[i]->swapIfReady())
+      render = true;
+    pipelines[i]->checkIdle(now);
+  }
+  if(tracer)
+    tracer->collect(getTimeMillis());
+
+  if(render) {
+    if(interactor) {
+      interactor->Render();
+    }
+    else {
+      renderer->ResetCameraClippingRange();
+      window->Render();
+    }
+    if(tracer)
+      tracer->frameDrawn(getTimeMillis());
+  }
+}
+
+void PlatoRenderWindow::setFrameTime(double time) {
+  // only worth doing when someone's moving the camera...
+  if(!interactor)
+    return;
+
+  scheduler = new PlatoFrameScheduler(this, renderer, time);
+  scheduler->watchWindow(window);
+  scheduler->watchInteraction(interactorStyle);
+}
+
+void PlatoRenderWindow::refineLater() {
+  vtkXRenderWindowInteractor* xInteractor =
+    vtkXRenderWindowInteractor::SafeDownCast(interactor);
+
+  // give the event loop a chance to start another interaction before
+  // each step, without X there's nothing to do but go straight there...
+  if(!xInteractor) {
+    while(scheduler->refine());
+    interactor->Render();
+    return;
+  }
+
+  if(!refinePending) {
+    refinePending = true;
+    XtAppAddTimeOut(xInteractor->GetApp(), PVS_REFINE_DELAY, refineCallback,
+		    this);
+  }
+}
+
+void PlatoRenderWindow::refineFrame() {
+  refinePending = false;
+  if(scheduler->refine())
+    interactor->Render();
+  if(scheduler->isRefining())
+    refineLater();
+}
@@ -0,0 +1,551 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <istream>
+#include <streambuf>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoDataReader.h"
+#include "PlatoInputStream.h"
+#include "PlatoProfiler.h"
+#include "PlatoRenderWindow.h"
+#include "PlatoRhoLoader.h"
+#include "PlatoTaskPool.h"
+
+// 1 for the characters that separate values, looked up rather than asked
+// of isspace() as every byte of the file goes through it...
+static unsigned char spaces[256];
+
+// the text of the file where it is in memory, for reading the header...
+class PlatoTextBuffer : public std::streambuf {
+
+ public:
+  PlatoTextBuffer(char* text, long length) { setg(text, text, text + length); }
+  char* getPosition() { return gptr(); }
+};
+
+PlatoRhoLoader::PlatoRhoLoader(char* filename) {
+  rhoFilename = filename;
+  text = NULL;
+  textLength = 0;
+  valuesStart = NULL;
+  numChunks = 0;
+  chunkTokens = NULL;
+  firstStride = 1;
+  startTime = 0.0;
+
+  values = NULL;
+  previews[0] = NULL;
+  previews[1] = NULL;
+  front = NULL;
+  ready = NULL;
+  frontFrame = 0;
+  readyFrame = 0;
+  frameWaiting = false;
+  done = false;
+
+  levelStride = 1;
+  levelTarget = NULL;
+  for(int a = 0; a < 3; a++) {
+    axisLow[a] = NULL;
+    axisHigh[a] = NULL;
+    axisFraction[a] = NULL;
+  }
+
+  window = NULL;
+  thread = vtkMultiThreader::New();
+  threadID = -1;
+  bufferLock = vtkMutexLock::New();
+
+  for(int c = 0; c < 256; c++)
+    spaces[c] = isspace(c) ? 1 : 0;
+}
+
+PlatoRhoLoader::~PlatoRhoLoader() {
+  stop();
+
+  delete[] text;
+  delete[] chunkTokens;
+  delete[] values;
+  delete[] previews[0];
+  delete[] previews[1];
+  for(int a = 0; a < 3; a++) {
+    delete[] axisLow[a];
+    delete[] axisHigh[a];
+    delete[] axisFraction[a];
+  }
+
+  thread->Delete();
+  bufferLock->Delete();
+}
+
+void PlatoRhoLoader::readCompressed() {
+  text = PlatoInputStream::readText(rhoFilename, &textLength);
+  if(!text) {
+    std::cerr << "Could not open file: " << rhoFilename << std::endl;
+    exit(1);
+  }
+}
+
+void PlatoRhoLoader::readFile() {
+  PlatoProfileScope scope("loader.readFile", PVS_PROF_READ);
+
+  // a compressed file is unpacked into memory as it can't be indexed
+  // where it is...
+  if(PlatoInputStream::getFormat(rhoFilename) != PVS_INPUT_PLAIN) {
+    readCompressed();
+  }
+  else {
+    FILE* file = fopen(rhoFilename, "rb");
+    if(!file) {
+      std::cerr << "Could not open file: " << rhoFilename << std::endl;
+      exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    textLength = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text = new char[textLength + 1];
+    textLength = fread(text, 1, textLength, file);
+    text[textLength] = '\0';
+    fclose(file);
+  }
+
+  // the header is read the same way as a whole file is, the values start
+  // where it ends...
+  PlatoTextBuffer header(text, textLength);
+  std::istream fin(&header);
+  bool uniform;
+  long numPoints;
+  PlatoDataReader::readRhoHeader(fin, rhoFilename, cellVectors, &uniform,
+				 dims, &numPoints);
+  if(!uniform) {
+    std::cerr << "Only a uniform grid can be loaded progressively: ";
+    std::cerr << rhoFilename << std::endl;
+    exit(1);
+  }
+  valuesStart = header.getPosition();
+
+  // count the values that start in each chunk of the file side by side,
+  // then add them up to give the first value of each chunk...
+  long valuesLength = textLength - (valuesStart - text);
+  numChunks = (int) ((valuesLength + PVS_RHO_CHUNK - 1) / PVS_RHO_CHUNK);
+  if(numChunks < 1)
+    numChunks = 1;
+  chunkTokens = new long[numChunks + 1];
+  chunkTokens[0] = 0;
+  PlatoTaskPool::getPool()->run(countChunk, this, numChunks);
+  for(int c = 0; c < numChunks; c++)
+    chunkTokens[c + 1] += chunkTokens[c];
+}
+
+void PlatoRhoLoader::countChunk(int c, void* data) {
+  PlatoRhoLoader* loader = (PlatoRhoLoader*) data;
+  const unsigned char* p = (const unsigned char*) loader->valuesStart +
+    ((long) c * PVS_RHO_CHUNK);
+  const unsigned char* end = p + PVS_RHO_CHUNK;
+  const unsigned char* textEnd =
+    (const unsigned char*) loader->text + loader->textLength;
+  unsigned char space;
+  long count = 0;
+
+  if(end > textEnd)
+    end = textEnd;
+
+  // a value starts wherever a separator is followed by anything else. One
+  // that runs on from the chunk before belongs to that one...
+  unsigned char last = 1;
+  if(p > (const unsigned char*) loader->valuesStart)
+    last = spaces[p[-1]];
+  for(; p < end; p++) {
+    space = spaces[*p];
+    count += last & (space ^ 1);
+    last = space;
+  }
+
+  loader->chunkTokens[c + 1] = count;
+}
+
+const char* PlatoRhoLoader::findToken(long n) {
+  int low = 0;
+  int high = numChunks - 1;
+  int mid;
+
+  // the last chunk that starts at or before the value...
+  while(low < high) {
+    mid = (low + high + 1) / 2;
+    if(chunkTokens[mid] <= n)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+
+  // ...then skip through it...
+  const char* p = valuesStart + ((long) low * PVS_RHO_CHUNK);
+  if(p > valuesStart && !isspace((unsigned char) p[-1])) {
+    while(*p && !isspace((unsigned char) *p))
+      p++;
+  }
+  for(long skip = n - chunkTokens[low]; skip > 0; skip--) {
+    while(isspace((unsigned char) *p))
+      p++;
+    while(*p && !isspace((unsigned char) *p))
+      p++;
+  }
+
+  return p;
+}
+
+void PlatoRhoLoader::readLevel(int stride) {
+  PlatoProfileScope scope("loader.readLevel", PVS_PROF_READ);
+
+  // the planes of the level are read side by side...
+  levelStride = stride;
+  PlatoTaskPool::getPool()->run(readPlane, this,
+				(dims[2] + stride - 1) / stride);
+}
+
+void PlatoRhoLoader::readPlane(int p, void* data) {
+  PlatoRhoLoader* loader = (PlatoRhoLoader*) data;
+  int s = loader->levelStride;
+  int* d = loader->dims;
+  int k = p * s;
+  long plane = (long) d[0] * d[1];
+  float* v = loader->values + (k * plane);
+  const char* t;
+  char* end;
+
+  if(loader->isDone())
+    return;
+
+  // every value in the plane is wanted at the last level...
+  if(s == 1) {
+    t = loader->findToken(k * plane);
+    for(long n = 0; n < plane; n++) {
+      v[n] = strtof(t, &end);
+      t = end;
+    }
+    return;
+  }
+
+  // ...otherwise every s'th value of every s'th row, skipping the rest.
+  // Nearby rows are walked on to rather than found from the index. A
+  // short file just leaves zeros...
+  long perChunk = loader->chunkTokens[loader->numChunks] / loader->numChunks;
+  long at = k * plane;
+  long want;
+  t = loader->findToken(at);
+  for(int j = 0; j < d[1]; j += s) {
+    want = (k * plane) + ((long) j * d[0]);
+    if((want - at) > (perChunk / 2)) {
+      t = loader->findToken(want);
+      at = want;
+    }
+    for(; at < want + d[0]; at++) {
+      if(at >= want && ((at - want) % s) == 0) {
+	v[(at - want) + (j * d[0])] = strtof(t, &end);
+	t = end;
+	continue;
+      }
+      while(isspace((unsigned char) *t))
+	t++;
+      while(*t && !isspace((unsigned char) *t))
+	t++;
+    }
+  }
+}
+
+void PlatoRhoLoader::fillLevel(int stride, float* target) {
+  PlatoProfileScope scope("loader.fillLevel", PVS_PROF_READ);
+
+  // for each point along each axis, the samples either side of it and how
+  // far it is between them. The grid is periodic so the last samples are
+  // joined on to the first...
+  for(int a = 0; a < 3; a++) {
+    if(!axisLow[a]) {
+      axisLow[a] = new int[dims[a]];
+      axisHigh[a] = new int[dims[a]];
+      axisFraction[a] = new float[dims[a]];
+    }
+    for(int x = 0; x < dims[a]; x++) {
+      int low = x - (x % stride);
+      int high = low + stride;
+      int span = stride;
+      if(high >= dims[a]) {
+	high = 0;
+	span = dims[a] - low;
+      }
+      axisLow[a][x] = low;
+      axisHigh[a][x] = high;
+      axisFraction[a][x] = (float) (x - low) / (float) span;
+    }
+  }
+
+  levelStride = stride;
+  levelTarget = target;
+  PlatoTaskPool::getPool()->run(fillPlane, this, dims[2]);
+}
+
+void PlatoRhoLoader::fillPlane(int k, void* data) {
+  PlatoRhoLoader* loader = (PlatoRhoLoader*) data;
+  int* d = loader->dims;
+  long plane = (long) d[0] * d[1];
+  float* out = loader->levelTarget + (k * plane);
+  int* iLow = loader->axisLow[0];
+  int* iHigh = loader->axisHigh[0];
+  float* iFraction = loader->axisFraction[0];
+  const float* k0 = loader->values + (loader->axisLow[2][k] * plane);
+  const float* k1 = loader->values + (loader->axisHigh[2][k] * plane);
+  float fk = loader->axisFraction[2][k];
+  const float* r00;
+  const float* r10;
+  const float* r01;
+  const float* r11;
+  float fi, fj, a, b, c, e;
+  int i0, i1;
+
+  if(loader->isDone())
+    return;
+
+  // fill in between the samples read so far...
+  for(int j = 0; j < d[1]; j++) {
+    r00 = k0 + (loader->axisLow[1][j] * d[0]);
+    r10 = k0 + (loader->axisHigh[1][j] * d[0]);
+    r01 = k1 + (loader->axisLow[1][j] * d[0]);
+    r11 = k1 + (loader->axisHigh[1][j] * d[0]);
+    fj = loader->axisFraction[1][j];
+    for(int i = 0; i < d[0]; i++) {
+      i0 = iLow[i];
+      i1 = iHigh[i];
+      fi = iFraction[i];
+      a = r00[i0] + (fi * (r00[i1] - r00[i0]));
+      b = r10[i0] + (fi * (r10[i1] - r10[i0]));
+      c = r01[i0] + (fi * (r01[i1] - r01[i0]));
+      e = r11[i0] + (fi * (r11[i1] - r11[i0]));
+      a += fj * (b - a);
+      c += fj * (e - c);
+      out[i + (j * d[0])] = a + (fk * (c - a));
+    } // i
+  } // j
+}
+
+void PlatoRhoLoader::waitForFirstFrame() {
+  long numPoints;
+
+  startTime = getTimeMillis();
+  readFile();
+  numPoints = (long) dims[0] * dims[1] * dims[2];
+
+  // start with the finest level that's still quick to read and contour...
+  firstStride = 1;
+  while(((long) ((dims[0] + firstStride - 1) / firstStride) *
+	 ((dims[1] + firstStride - 1) / firstStride) *
+	 ((dims[2] + firstStride - 1) / firstStride)) > PVS_RHO_PREVIEW_POINTS)
+    firstStride *= 2;
+
+  values = new float[numPoints];
+  PlatoTaskPool::getPool()->firstTouch(values, numPoints * sizeof(float));
+  readLevel(firstStride);
+
+  if(firstStride == 1) {
+    front = values;
+    delete[] text;
+    text = NULL;
+  }
+  else {
+    previews[0] = new float[numPoints];
+    previews[1] = new float[numPoints];
+    fillLevel(firstStride, previews[0]);
+    front = previews[0];
+  }
+  frontFrame = 1;
+  readyFrame = 1;
+
+  std::cout << "Density at 1/" << firstStride << " resolution after ";
+  std::cout << (int) (getTimeMillis() - startTime) << "ms.\n";
+}
+
+void PlatoRhoLoader::start(PlatoRenderWindow* prw) {
+  // the rest of the levels are read in the background...
+  window = prw;
+  if(firstStride > 1)
+    threadID = thread->SpawnThread(refineLoop, this);
+}
+
+void PlatoRhoLoader::stop() {
+  if(threadID < 0)
+    return;
+
+  // the level being read is given up at the next plane...
+  bufferLock->Lock();
+  done = true;
+  bufferLock->Unlock();
+
+  thread->TerminateThread(threadID);
+  threadID = -1;
+}
+
+bool PlatoRhoLoader::isDone() {
+  bool stopping;
+
+  bufferLock->Lock();
+  stopping = done;
+  bufferLock->Unlock();
+
+  return stopping;
+}
+
+void PlatoRhoLoader::publish(float* buffer, int stride) {
+  // this is now the latest level, anything older not yet taken is dropped...
+  bufferLock->Lock();
+  ready = buffer;
+  readyFrame++;
+  frameWaiting = true;
+  bufferLock->Unlock();
+
+  window->requestRender();
+
+  if(stride == 1)
+    std::cout << "Density at full resolution after ";
+  else
+    std::cout << "Density at 1/" << stride << " resolution after ";
+  std::cout << (int) (getTimeMillis() - startTime) << "ms.\n";
+}
+
+void* PlatoRhoLoader::refineLoop(void* userData) {
+  PlatoRhoLoader* loader = (PlatoRhoLoader*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  float* target;
+
+  for(int s = loader->firstStride / 2; s >= 1; s /= 2) {
+    loader->readLevel(s);
+    if(loader->isDone())
+      break;
+
+    // the values are the last level as they are...
+    if(s == 1) {
+      loader->publish(loader->values, s);
+      break;
+    }
+
+    // ...otherwise fill in whichever preview isn't being drawn, taking back
+    // the level before if it hasn't been picked up yet...
+    loader->bufferLock->Lock();
+    if(loader->front == loader->previews[0])
+      target = loader->previews[1];
+    else
+      target = loader->previews[0];
+    if(loader->ready == target) {
+      loader->ready = NULL;
+      loader->frameWaiting = false;
+    }
+    loader->bufferLock->Unlock();
+
+    loader->fillLevel(s, target);
+    if(loader->isDone())
+      break;
+    loader->publish(target, s);
+  }
+
+  // every value has been read so the file isn't needed...
+  delete[] loader->text;
+  loader->text = NULL;
+
+  return NULL;
+}
+
+int* PlatoRhoLoader::getDataDimensions() {
+  return dims;
+}
+
+double* PlatoRhoLoader::getCellVectors() {
+  return cellVectors;
+}
+
+float* PlatoRhoLoader::getFrontBuffer() {
+  return front;
+}
+
+int PlatoRhoLoader::getFrameNumber() {
+  int frame;
+
+  bufferLock->Lock();
+  frame = frontFrame;
+  bufferLock->Unlock();
+
+  return frame;
+}
+
+bool PlatoRhoLoader::isFrameWaiting() {
+  bool waiting;
+
+  bufferLock->Lock();
+  waiting = frameWaiting;
+  bufferLock->Unlock();
+
+  return waiting;
+}
+
+bool PlatoRhoLoader::acquireFrame() {
+  bool taken = false;
+
+  // called on the worker thread before the filters run...
+  bufferLock->Lock();
+  if(frameWaiting) {
+    front = ready;
+    ready = NULL;
+    frontFrame = readyFrame;
+    frameWaiting = false;
+    taken = true;
+
+    // once every value is in the previews aren't needed...
+    if(front == values) {
+      delete[] previews[0];
+      delete[] previews[1];
+      previews[0] = NULL;
+      previews[1] = NULL;
+    }
+  }
+  bufferLock->Unlock();
+
+  return taken;
+}
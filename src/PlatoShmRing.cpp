@@ -0,0 +1,308 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoRenderWindow.h"
+#include "PlatoShmRing.h"
+
+PlatoShmRing::PlatoShmRing(char* shmName) {
+  name = shmName;
+  fd = -1;
+  header = NULL;
+  mappedBytes = 0;
+  front = -1;
+  frontFrame = 0;
+  taken = 0;
+  done = false;
+
+  numTaken = 0;
+  dropped = 0;
+  totalLatency = 0.0;
+  maxLatency = 0.0;
+
+  window = NULL;
+  thread = vtkMultiThreader::New();
+  threadID = -1;
+}
+
+PlatoShmRing::~PlatoShmRing() {
+  stop();
+  printStats();
+
+  if(header) {
+    // let the producer have all the slots back...
+    __atomic_store_n(&header->heldSlot, -1, __ATOMIC_SEQ_CST);
+    munmap(header, mappedBytes);
+  }
+  if(fd >= 0)
+    close(fd);
+
+  thread->Delete();
+}
+
+bool PlatoShmRing::isValid() {
+  long points = 1;
+
+  if(header->version != PVS_SHM_VERSION || header->numSlots < 3 ||
+     header->numSlots > PVS_SHM_MAX_SLOTS)
+    return false;
+
+  // every slot has to fit in what's mapped...
+  if(header->dataOffset < (long) sizeof(PlatoShmHeader) ||
+     header->slotBytes <= 0 || header->slotBytes > mappedBytes ||
+     header->dataOffset + (header->numSlots * header->slotBytes) >
+     mappedBytes)
+    return false;
+
+  // ...and every slot has to hold a whole grid after its header. The size
+  // is built up a dimension at a time so it can't overflow...
+  if(header->valuesOffset < (long) sizeof(PlatoShmSlot) ||
+     header->valuesOffset > header->slotBytes)
+    return false;
+  for(int i = 0; i < 3; i++) {
+    if(header->dims[i] < 1)
+      return false;
+    points *= header->dims[i];
+    if((header->valuesOffset + (points * (long) sizeof(float))) >
+       header->slotBytes)
+      return false;
+  }
+
+  return true;
+}
+
+PlatoShmSlot* PlatoShmRing::getSlot(int slot) {
+  return (PlatoShmSlot*) ((char*) header + header->dataOffset +
+			  (slot * header->slotBytes));
+}
+
+void PlatoShmRing::waitForFirstFrame() {
+  struct stat info;
+  void* map;
+  int magic;
+
+  memcpy(&magic, "PVSR", 4);
+  std::cout << "Waiting for shared memory " << name << "...\n";
+
+  // the producer makes the ring, so wait for it to turn up and be filled
+  // in...
+  while(!header) {
+    fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0 && errno != ENOENT) {
+      std::cerr << "Could not open shared memory " << name << ": ";
+      std::cerr << strerror(errno) << std::endl;
+      exit(1);
+    }
+
+    if(fd >= 0 && fstat(fd, &info) == 0 &&
+       info.st_size >= (long) sizeof(PlatoShmHeader)) {
+      map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+		 0);
+      if(map == MAP_FAILED) {
+	std::cerr << "Could not map shared memory " << name << ": ";
+	std::cerr << strerror(errno) << std::endl;
+	exit(1);
+      }
+
+      if(__atomic_load_n((int*) map, __ATOMIC_ACQUIRE) == magic) {
+	header = (PlatoShmHeader*) map;
+	mappedBytes = info.st_size;
+	break;
+      }
+      munmap(map, info.st_size);
+    }
+
+    if(fd >= 0)
+      close(fd);
+    fd = -1;
+    usleep(100000);
+  }
+
+  if(!isValid()) {
+    std::cerr << "Shared memory " << name << " is not a pvs ring.\n";
+    exit(1);
+  }
+
+  // ...and for the first frame...
+  struct timespec timeout;
+  while(!acquireFrame()) {
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_nsec += 100000000;
+    if(timeout.tv_nsec >= 1000000000) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= 1000000000;
+    }
+    sem_timedwait(&header->wake, &timeout);
+  }
+}
+
+void PlatoShmRing::start(PlatoRenderWindow* prw) {
+  window = prw;
+  threadID = thread->SpawnThread(watchLoop, this);
+}
+
+void PlatoShmRing::stop() {
+  if(threadID < 0)
+    return;
+
+  __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+  sem_post(&header->wake);
+
+  thread->TerminateThread(threadID);
+  threadID = -1;
+}
+
+void* PlatoShmRing::watchLoop(void* userData) {
+  PlatoShmRing* ring = (PlatoShmRing*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  PlatoShmHeader* header = ring->header;
+  unsigned long seen = __atomic_load_n(&header->published, __ATOMIC_ACQUIRE);
+  unsigned long published;
+  struct timespec timeout;
+
+  // nothing is copied here, just pass on the news. The timeout is only in
+  // case the producer dies in the middle of a post...
+  while(!__atomic_load_n(&ring->done, __ATOMIC_ACQUIRE)) {
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_nsec += 200000000;
+    if(timeout.tv_nsec >= 1000000000) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= 1000000000;
+    }
+    sem_timedwait(&header->wake, &timeout);
+
+    published = __atomic_load_n(&header->published, __ATOMIC_ACQUIRE);
+    if(published != seen) {
+      seen = published;
+      ring->window->requestRender();
+    }
+  }
+
+  return NULL;
+}
+
+int* PlatoShmRing::getDataDimensions() {
+  return header->dims;
+}
+
+double* PlatoShmRing::getCellVectors() {
+  return header->cellVectors;
+}
+
+float* PlatoShmRing::getFrontBuffer() {
+  return (float*) ((char*) getSlot(front) + header->valuesOffset);
+}
+
+int PlatoShmRing::getFrameNumber() {
+  return __atomic_load_n(&frontFrame, __ATOMIC_ACQUIRE);
+}
+
+bool PlatoShmRing::isFrameWaiting() {
+  return (__atomic_load_n(&header->published, __ATOMIC_ACQUIRE) !=
+	  __atomic_load_n(&taken, __ATOMIC_ACQUIRE));
+}
+
+bool PlatoShmRing::acquireFrame() {
+  unsigned long published;
+  unsigned long sequence;
+  PlatoShmSlot* slot;
+  int latest;
+
+  // called on the worker thread (or before it starts). Once heldSlot is
+  // moved the old front can be overwritten, but it's swapped out of the
+  // data array before anything reads it again. A slot caught being written
+  // is given up on after a while, the frame is still waiting so it'll be
+  // tried again...
+  for(int tries = 0; ; tries++) {
+    if(tries > 0)
+      sched_yield();
+    if(tries == PVS_SHM_RETRIES)
+      return false;
+
+    published = __atomic_load_n(&header->published, __ATOMIC_ACQUIRE);
+    if(published == taken)
+      return false;
+
+    latest = __atomic_load_n(&header->latestSlot, __ATOMIC_ACQUIRE);
+    if(latest < 0 || latest >= header->numSlots)
+      continue;
+    slot = getSlot(latest);
+    sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    if(sequence & 1)
+      continue;
+
+    __atomic_store_n(&header->heldSlot, latest, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) == sequence)
+      break;
+  }
+
+  double latency = getTimeMillis() - slot->publishTime;
+  totalLatency += latency;
+  if(latency > maxLatency)
+    maxLatency = latency;
+  // frames published before we first looked aren't counted as dropped...
+  if(numTaken > 0)
+    dropped += published - taken - 1;
+  numTaken++;
+
+  front = latest;
+  __atomic_store_n(&frontFrame, slot->frame, __ATOMIC_RELEASE);
+  __atomic_store_n(&taken, published, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+void PlatoShmRing::printStats() {
+  if(numTaken == 0)
+    return;
+
+  std::cout << "Shared memory frames: " << numTaken << " taken, ";
+  std::cout << dropped << " dropped, publish to take latency mean ";
+  std::cout << (totalLatency / numTaken) << " ms, max " << maxLatency;
+  std::cout << " ms\n";
+}
@@ -0,0 +1,201 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoProfiler.h"
+#include "PlatoStartup.h"
+
+PlatoStartup::PlatoStartup() {
+  numStages = 0;
+  numFinished = 0;
+  numCollected = 0;
+  startTime = 0.0;
+  progress[0] = '\0';
+
+  threads = vtkMultiThreader::New();
+  stageLock = vtkMutexLock::New();
+  sem_init(&stageDone, 0, 0);
+}
+
+PlatoStartup::~PlatoStartup() {
+  // the stages have all finished by now, but their threads still need
+  // tidying up...
+  for(int s = 0; s < numStages; s++) {
+    if(stages[s].state != PVS_STAGE_WAITING)
+      threads->TerminateThread(stages[s].threadID);
+  }
+
+  threads->Delete();
+  stageLock->Delete();
+  sem_destroy(&stageDone);
+}
+
+int PlatoStartup::addStage(const char* name, PlatoStageFunction function,
+			   void* data) {
+  if(numStages == PVS_STARTUP_MAX_STAGES)
+    return -1;
+
+  PlatoStartupStage* stage = &stages[numStages];
+  stage->name = name;
+  stage->function = function;
+  stage->data = data;
+  stage->needs = 0;
+  stage->state = PVS_STAGE_WAITING;
+  stage->threadID = -1;
+  stage->startup = this;
+  stage->index = numStages;
+
+  return numStages++;
+}
+
+void PlatoStartup::addDependency(int stage, int on) {
+  // a stage can only wait for one added before it, so there can't be a
+  // loop...
+  if(stage < 0 || stage >= numStages || on < 0 || on >= stage)
+    return;
+
+  stages[stage].needs |= (1 << on);
+}
+
+void PlatoStartup::start() {
+  startTime = getTimeMillis();
+
+  stageLock->Lock();
+  launchReady();
+  stageLock->Unlock();
+}
+
+void PlatoStartup::launchReady() {
+  int done = 0;
+
+  // called with the lock held...
+  for(int s = 0; s < numStages; s++) {
+    if(stages[s].state == PVS_STAGE_DONE)
+      done |= (1 << s);
+  }
+  for(int s = 0; s < numStages; s++) {
+    if(stages[s].state == PVS_STAGE_WAITING &&
+       (stages[s].needs & done) == stages[s].needs) {
+      stages[s].state = PVS_STAGE_RUNNING;
+      stages[s].threadID = threads->SpawnThread(runStage, &stages[s]);
+    }
+  }
+}
+
+void* PlatoStartup::runStage(void* userData) {
+  PlatoStartupStage* stage = (PlatoStartupStage*)
+    ((ThreadInfoStruct*) userData)->UserData;
+
+  {
+    PlatoProfileScope scope(stage->name, PVS_PROF_BUILD);
+    stage->function(stage->data);
+  }
+  stage->startup->finishStage(stage->index);
+
+  return NULL;
+}
+
+void PlatoStartup::finishStage(int s) {
+  // anything that was only waiting for this one can go now...
+  stageLock->Lock();
+  stages[s].state = PVS_STAGE_DONE;
+  finished[numFinished++] = s;
+  launchReady();
+  stageLock->Unlock();
+
+  sem_post(&stageDone);
+}
+
+int PlatoStartup::nextFinished(double timeout) {
+  struct timespec wakeTime;
+  int stage;
+
+  stageLock->Lock();
+  stage = (numCollected == numStages) ? PVS_STARTUP_DONE : PVS_STARTUP_WAITING;
+  stageLock->Unlock();
+  if(stage == PVS_STARTUP_DONE)
+    return stage;
+
+  // wait for the next stage to finish, or for it to be time to show how
+  // things are going. A negative timeout waits as long as it takes...
+  if(timeout < 0.0) {
+    while(sem_wait(&stageDone) != 0)
+      ;
+  }
+  else {
+    long wait = (long) timeout;
+    clock_gettime(CLOCK_REALTIME, &wakeTime);
+    wakeTime.tv_nsec += (wait % 1000) * 1000000L;
+    wakeTime.tv_sec += (wait / 1000) + (wakeTime.tv_nsec / 1000000000L);
+    wakeTime.tv_nsec %= 1000000000L;
+    if(sem_timedwait(&stageDone, &wakeTime) != 0)
+      return PVS_STARTUP_WAITING;
+  }
+
+  stageLock->Lock();
+  stage = finished[numCollected++];
+  stageLock->Unlock();
+
+  return stage;
+}
+
+const char* PlatoStartup::getProgress() {
+  int len;
+  int n = 0;
+
+  // the stages still to finish, and how long it's been so far...
+  stageLock->Lock();
+  len = sprintf(progress, "Loading");
+  for(int s = 0; s < numStages; s++) {
+    if(stages[s].state == PVS_STAGE_DONE || len > 160)
+      continue;
+    len += snprintf(progress + len, 64, "%s %s", (n++ > 0) ? "," : "",
+		    stages[s].name);
+  }
+  stageLock->Unlock();
+  if(n == 0)
+    len = sprintf(progress, "Loaded in");
+  snprintf(progress + len, sizeof(progress) - len, "%s %.1fs",
+	   (n > 0) ? "..." : "", (getTimeMillis() - startTime) / 1000.0);
+
+  return progress;
+}
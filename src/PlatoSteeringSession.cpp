@@ -0,0 +1,334 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// RealityGrid includes...
+#include "ReG_Steer_Appside.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoLatencyTracer.h"
+#include "PlatoSteeringSession.h"
+
+PlatoSteeringSession::PlatoSteeringSession() {
+  file = NULL;
+  filename = NULL;
+  recording = false;
+  replaying = false;
+  fast = false;
+  stopSent = false;
+  startTime = getTimeMillis();
+  waitStart = startTime;
+  changeTime = startTime;
+  numChanges = 0;
+  numParams = 0;
+  haveLine = false;
+  lineTime = 0.0;
+  tracer = NULL;
+}
+
+PlatoSteeringSession::~PlatoSteeringSession() {
+  if(file)
+    fclose(file);
+  if(filename)
+    delete[] filename;
+  for(int i = 0; i < numParams; i++)
+    delete[] params[i].label;
+}
+
+void PlatoSteeringSession::record(const char* name) {
+  file = fopen(name, "w");
+  if(!file) {
+    std::cerr << "Could not open steering session " << name << "\n";
+    exit(1);
+  }
+  filename = new char[strlen(name) + 1];
+  strcpy(filename, name);
+  recording = true;
+
+  fprintf(file, "# %s steering session: TIME\tparam\tLABEL\tVALUE",
+	  PVS_BIN_NAME);
+  fprintf(file, " or TIME\tcommand\tID\n");
+  fflush(file);
+  startTime = getTimeMillis();
+}
+
+void PlatoSteeringSession::replay(const char* name, bool asFast) {
+  file = fopen(name, "r");
+  if(!file) {
+    std::cerr << "Could not open steering session " << name << "\n";
+    exit(1);
+  }
+  filename = new char[strlen(name) + 1];
+  strcpy(filename, name);
+  replaying = true;
+  fast = asFast;
+
+  haveLine = readLine();
+  startTime = getTimeMillis();
+  waitStart = startTime;
+}
+
+bool PlatoSteeringSession::isReplaying() {
+  return replaying;
+}
+
+bool PlatoSteeringSession::isReplayingFast() {
+  return (replaying && fast);
+}
+
+void PlatoSteeringSession::setLatencyTracer(PlatoLatencyTracer* t) {
+  tracer = t;
+}
+
+int PlatoSteeringSession::registerParam(const char* label, int steerable,
+					void* value, int type,
+					const char* min, const char* max) {
+  // keep hold of where the value lives so it can be read and written by
+  // label...
+  if(numParams < PVS_SESSION_PARAMS) {
+    params[numParams].label = new char[strlen(label) + 1];
+    strcpy(params[numParams].label, label);
+    params[numParams].value = value;
+    params[numParams].type = type;
+    numParams++;
+  }
+
+  // a replay stands in for the steering library so nothing else is told...
+  if(replaying)
+    return REG_SUCCESS;
+
+  return Register_param((char*) label, steerable, value, type, (char*) min,
+			(char*) max);
+}
+
+int PlatoSteeringSession::control(int loop, int* numChanged, char** labels,
+				  int* numCmds, int* cmds, char** cmdParams) {
+  if(!replaying) {
+    int status = Steering_control(loop, numChanged, labels, numCmds, cmds,
+				  cmdParams);
+    changeTime = getTimeMillis();
+    if(recording && status == REG_SUCCESS &&
+       (*numChanged > 0 || *numCmds > 0))
+      writeChanges(*numChanged, labels, *numCmds, cmds);
+    return status;
+  }
+
+  *numChanged = 0;
+  *numCmds = 0;
+  double now = getTimeMillis();
+  changeTime = now;
+
+  // once it's all been played stop pvs, but not before the last changes
+  // have made it to the screen...
+  if(!haveLine) {
+    if(!stopSent && isSettled(now)) {
+      cmds[(*numCmds)++] = REG_STR_STOP;
+      stopSent = true;
+    }
+    return REG_SUCCESS;
+  }
+
+  // at real speed each poll is handed back when it's due. As fast as
+  // possible it's as soon as the one before is on the screen...
+  double due = now - startTime;
+  if(fast) {
+    if(!isSettled(now))
+      return REG_SUCCESS;
+    due = lineTime;
+  }
+  else if(haveLine && lineTime <= due) {
+    // at real speed the changes are timed from when they were due, the
+    // earliest of them if there's more than one, so the wait for the poll
+    // counts too...
+    changeTime = startTime + lineTime;
+  }
+
+  while(haveLine && lineTime <= due) {
+    // if there's no room left the rest go out with the next poll...
+    if(!replayLine(numChanged, labels, numCmds, cmds))
+      break;
+    haveLine = readLine();
+  }
+  waitStart = now;
+
+  return REG_SUCCESS;
+}
+
+PlatoSessionParam* PlatoSteeringSession::findParam(const char* label) {
+  for(int i = 0; i < numParams; i++) {
+    if(!strcmp(params[i].label, label))
+      return &params[i];
+  }
+
+  return NULL;
+}
+
+void PlatoSteeringSession::writeChanges(int numChanged, char** labels,
+					int numCmds, int* cmds) {
+  double time = getTimeMillis() - startTime;
+
+  // the library has already put the new values into the params...
+  for(int i = 0; i < numCmds; i++) {
+    fprintf(file, "%.1f\tcommand\t%d\n", time, cmds[i]);
+    numChanges++;
+  }
+  for(int i = 0; i < numChanged; i++) {
+    PlatoSessionParam* param = findParam(labels[i]);
+    if(!param)
+      continue;
+
+    switch(param->type) {
+    case REG_INT:
+      fprintf(file, "%.1f\tparam\t%s\t%d\n", time, param->label,
+	      *((int*) param->value));
+      break;
+    case REG_FLOAT:
+      fprintf(file, "%.1f\tparam\t%s\t%.9g\n", time, param->label,
+	      *((float*) param->value));
+      break;
+    case REG_DBL:
+      fprintf(file, "%.1f\tparam\t%s\t%.17g\n", time, param->label,
+	      *((double*) param->value));
+      break;
+    default:
+      continue;
+    }
+    numChanges++;
+  }
+
+  // written as we go so a session that ends badly is still there...
+  fflush(file);
+}
+
+bool PlatoSteeringSession::readLine() {
+  char* end;
+  char* kind;
+
+  while(fgets(line, PVS_SESSION_LINE, file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if(line[0] == '#' || line[0] == '\0')
+      continue;
+
+    lineTime = strtod(line, &end);
+    kind = (end != line && *end == '\t') ? end + 1 : NULL;
+    if(kind && (!strncmp(kind, "command\t", 8) ||
+		(!strncmp(kind, "param\t", 6) && strchr(kind + 6, '\t'))))
+      return true;
+
+    std::cerr << filename << ": bad line, skipping it: " << line << "\n";
+  }
+
+  return false;
+}
+
+bool PlatoSteeringSession::isSettled(double now) {
+  // settled means everything handed out so far is on the screen, unless
+  // something has got lost on the way...
+  if(!tracer || tracer->isIdle())
+    return true;
+
+  return ((now - waitStart) >= PVS_SESSION_WAIT);
+}
+
+bool PlatoSteeringSession::replayLine(int* numChanged, char** labels,
+				      int* numCmds, int* cmds) {
+  char* kind = strchr(line, '\t') + 1;
+
+  if(!strncmp(kind, "command\t", 8)) {
+    if(*numCmds >= REG_MAX_NUM_STR_CMDS)
+      return false;
+    cmds[(*numCmds)++] = atoi(kind + 8);
+    numChanges++;
+    return true;
+  }
+
+  if(*numChanged >= REG_MAX_NUM_STR_PARAMS)
+    return false;
+
+  char* label = kind + 6;
+  char* value = strchr(label, '\t');
+  *value++ = '\0';
+
+  // a param that isn't there this time (no trajectory, say) is skipped...
+  PlatoSessionParam* param = findParam(label);
+  if(!param) {
+    std::cerr << filename << ": " << label << " isn't registered, ";
+    std::cerr << "skipping it\n";
+    return true;
+  }
+
+  // ...otherwise it's written into the param just as the library would...
+  switch(param->type) {
+  case REG_INT:
+    *((int*) param->value) = atoi(value);
+    break;
+  case REG_FLOAT:
+    *((float*) param->value) = (float) atof(value);
+    break;
+  case REG_DBL:
+    *((double*) param->value) = atof(value);
+    break;
+  default:
+    return true;
+  }
+
+  strncpy(labels[*numChanged], label, REG_MAX_STRING_LENGTH - 1);
+  labels[*numChanged][REG_MAX_STRING_LENGTH - 1] = '\0';
+  (*numChanged)++;
+  numChanges++;
+
+  return true;
+}
+
+double PlatoSteeringSession::getChangeTime() {
+  // when the changes handed back by the last poll were made...
+  return changeTime;
+}
+
+void PlatoSteeringSession::printStats() {
+  double time = (getTimeMillis() - startTime) / 1000.0;
+
+  if(recording) {
+    std::cout << "Recorded " << numChanges << " steering changes to ";
+    std::cout << filename << " over " << time << " s\n";
+  }
+  if(replaying) {
+    std::cout << "Replayed " << numChanges << " steering changes from ";
+    std::cout << filename << " in " << time << " s";
+    std::cout << (fast ? " (as fast as possible)\n" : " (real speed)\n");
+  }
+}
@@ -0,0 +1,576 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <istream>
+
+// vtk includes...
+#include "vtkMatrix4x4.h"
+
+// plato includes...
+#include "PlatoDataReader.h"
+#include "PlatoInputStream.h"
+#include "PlatoSymmetry.h"
+#include "PlatoTrajectoryReader.h"
+
+// how close (as a fraction of the cell) two atoms have to be to match...
+#define PVS_SYM_TOLERANCE 2.0e-3
+
+PlatoSymmetry::PlatoSymmetry(PlatoDataReader* dr) {
+  data = dr;
+  dataDims = data->getDataDimensions();
+  cellVectors = data->getCellVectors();
+  inverseCell = new double[9];
+
+  numOps = 0;
+  opPerm = NULL;
+  opSign = NULL;
+  opShift = NULL;
+
+  wedgeLow = new int[3];
+  wedgeHigh = new int[3];
+  numImages = 0;
+  imageOps = NULL;
+  imageShift = NULL;
+  for(int d = 0; d < 3; d++) {
+    wedgeLow[d] = 0;
+    wedgeHigh[d] = dataDims[d];
+  }
+
+  // invert the cell, its vectors are the columns of the matrix...
+  double* a = cellVectors;
+  double det = a[0] * ((a[4] * a[8]) - (a[7] * a[5]))
+    - a[3] * ((a[1] * a[8]) - (a[7] * a[2]))
+    + a[6] * ((a[1] * a[5]) - (a[4] * a[2]));
+  inverseCell[0] = ((a[4] * a[8]) - (a[7] * a[5])) / det;
+  inverseCell[1] = ((a[6] * a[5]) - (a[3] * a[8])) / det;
+  inverseCell[2] = ((a[3] * a[7]) - (a[6] * a[4])) / det;
+  inverseCell[3] = ((a[7] * a[2]) - (a[1] * a[8])) / det;
+  inverseCell[4] = ((a[0] * a[8]) - (a[6] * a[2])) / det;
+  inverseCell[5] = ((a[6] * a[1]) - (a[0] * a[7])) / det;
+  inverseCell[6] = ((a[1] * a[5]) - (a[4] * a[2])) / det;
+  inverseCell[7] = ((a[3] * a[2]) - (a[0] * a[5])) / det;
+  inverseCell[8] = ((a[0] * a[4]) - (a[3] * a[1])) / det;
+}
+
+PlatoSymmetry::~PlatoSymmetry() {
+  delete[] inverseCell;
+  delete[] wedgeLow;
+  delete[] wedgeHigh;
+
+  if(numOps > 0) {
+    delete[] opPerm;
+    delete[] opSign;
+    delete[] opShift;
+    delete[] imageOps;
+    delete[] imageShift;
+  }
+}
+
+void PlatoSymmetry::addOperation(int* perm, int* sign, int* shift) {
+  int o;
+  int d;
+
+  // ignore anything we already have...
+  for(o = 0; o < numOps; o++) {
+    for(d = 0; d < 3; d++) {
+      if(opPerm[(3 * o) + d] != perm[d] || opSign[(3 * o) + d] != sign[d] ||
+	 opShift[(3 * o) + d] != shift[d])
+	break;
+    }
+    if(d == 3)
+      return;
+  }
+
+  // grow the tables one at a time, there are never very many...
+  int* newPerm = new int[3 * (numOps + 1)];
+  int* newSign = new int[3 * (numOps + 1)];
+  int* newShift = new int[3 * (numOps + 1)];
+  if(numOps > 0) {
+    memcpy(newPerm, opPerm, 3 * numOps * sizeof(int));
+    memcpy(newSign, opSign, 3 * numOps * sizeof(int));
+    memcpy(newShift, opShift, 3 * numOps * sizeof(int));
+    delete[] opPerm;
+    delete[] opSign;
+    delete[] opShift;
+    delete[] imageOps;
+    delete[] imageShift;
+  }
+  for(d = 0; d < 3; d++) {
+    newPerm[(3 * numOps) + d] = perm[d];
+    newSign[(3 * numOps) + d] = sign[d];
+    newShift[(3 * numOps) + d] = shift[d];
+  }
+  opPerm = newPerm;
+  opSign = newSign;
+  opShift = newShift;
+  numOps++;
+
+  // the tiling can use every operation at most once...
+  imageOps = new int[numOps];
+  imageShift = new int[3 * numOps];
+}
+
+bool PlatoSymmetry::gridShift(double t, int dim, int* shift) {
+  // a translation has to move grid points onto grid points...
+  double s = t * dim;
+  int r = (int) floor(s + 0.5);
+  if(fabs(s - r) > (PVS_SYM_TOLERANCE * dim))
+    return false;
+
+  *shift = ((r % dim) + dim) % dim;
+  return true;
+}
+
+bool PlatoSymmetry::isGridCompatible(int* perm) {
+  // axes can only be swapped if they are sampled the same...
+  for(int j = 0; j < 3; j++) {
+    if(dataDims[perm[j]] != dataDims[j])
+      return false;
+  }
+
+  return true;
+}
+
+bool PlatoSymmetry::isMetricPreserved(int* perm, int* sign) {
+  double g[9];
+  double scale = 0.0;
+  int j, k;
+
+  for(j = 0; j < 3; j++) {
+    for(k = 0; k < 3; k++) {
+      g[(3 * j) + k] = (cellVectors[3 * j] * cellVectors[3 * k]) +
+	(cellVectors[(3 * j) + 1] * cellVectors[(3 * k) + 1]) +
+	(cellVectors[(3 * j) + 2] * cellVectors[(3 * k) + 2]);
+      if(fabs(g[(3 * j) + k]) > scale)
+	scale = fabs(g[(3 * j) + k]);
+    }
+  }
+
+  // the lengths of and angles between the cell vectors must survive...
+  for(j = 0; j < 3; j++) {
+    for(k = 0; k < 3; k++) {
+      if(fabs((sign[j] * sign[k] * g[(3 * j) + k]) -
+	      g[(3 * perm[j]) + perm[k]]) > (PVS_SYM_TOLERANCE * scale))
+	return false;
+    }
+  }
+
+  return true;
+}
+
+void PlatoSymmetry::toFractional(float* x, double* f) {
+  for(int i = 0; i < 3; i++) {
+    f[i] = (inverseCell[3 * i] * x[0]) + (inverseCell[(3 * i) + 1] * x[1]) +
+      (inverseCell[(3 * i) + 2] * x[2]);
+    f[i] -= floor(f[i]);
+  }
+}
+
+void PlatoSymmetry::readOperations(char* filename) {
+  int identity[] = {0, 1, 2};
+  int plus[] = {1, 1, 1};
+  int zero[] = {0, 0, 0};
+  addOperation(identity, plus, zero);
+
+  PlatoInputStream input(filename);
+  if(!input.isOpen()) {
+    std::cerr << "Could not open file: " << filename << std::endl;
+    exit(1);
+  }
+  std::istream fin(&input);
+
+  // one operation per line in the usual "-y,x+1/2,z" form...
+  char line[256];
+  int lineNum = 0;
+  while(fin.getline(line, 256)) {
+    lineNum++;
+    char* c = line;
+    while(*c == ' ' || *c == '\t')
+      c++;
+    if(*c == '\0' || *c == '#' || *c == '\r')
+      continue;
+
+    int perm[3];
+    int sign[3];
+    int shift[3];
+    double t[3];
+    int axes;
+    int row = 0;
+    bool bad = false;
+    int termSign;
+    char* end;
+
+    for(row = 0; row < 3 && !bad; row++) {
+      perm[row] = -1;
+      sign[row] = 0;
+      t[row] = 0.0;
+      axes = 0;
+      termSign = 1;
+      while(*c != ',' && *c != '\0' && *c != '\r' && !bad) {
+	if(*c == ' ' || *c == '\t' || *c == '\'' || *c == '"' || *c == '+') {
+	  c++;
+	}
+	else if(*c == '-') {
+	  termSign = -termSign;
+	  c++;
+	}
+	else if(*c >= 'x' && *c <= 'z') {
+	  perm[row] = *c - 'x';
+	  sign[row] = termSign;
+	  termSign = 1;
+	  axes++;
+	  c++;
+	}
+	else if(*c >= 'X' && *c <= 'Z') {
+	  perm[row] = *c - 'X';
+	  sign[row] = termSign;
+	  termSign = 1;
+	  axes++;
+	  c++;
+	}
+	else {
+	  double value = strtod(c, &end);
+	  if(end == c) {
+	    bad = true;
+	    break;
+	  }
+	  c = end;
+	  if(*c == '/') {
+	    double denom = strtod(c + 1, &end);
+	    if(end == (c + 1) || denom == 0.0) {
+	      bad = true;
+	      break;
+	    }
+	    value /= denom;
+	    c = end;
+	  }
+	  t[row] += termSign * value;
+	  termSign = 1;
+	}
+      }
+
+      // only signed permutations of the axes map the grid box to itself...
+      if(axes != 1)
+	bad = true;
+      if(*c == ',')
+	c++;
+      else if(row < 2)
+	bad = true;
+    }
+
+    if(!bad && (perm[0] == perm[1] || perm[0] == perm[2] ||
+		perm[1] == perm[2]))
+      bad = true;
+    if(bad) {
+      std::cerr << filename << ":" << lineNum
+		<< ": not a symmetry operation: " << line << std::endl;
+      exit(1);
+    }
+
+    // drop (with a warning) anything this grid can't support...
+    if(!isGridCompatible(perm) || !gridShift(t[0], dataDims[0], &shift[0]) ||
+       !gridShift(t[1], dataDims[1], &shift[1]) ||
+       !gridShift(t[2], dataDims[2], &shift[2])) {
+      std::cerr << filename << ":" << lineNum
+		<< ": operation does not fit the rho grid, ignoring it: "
+		<< line << std::endl;
+      continue;
+    }
+
+    addOperation(perm, sign, shift);
+  }
+}
+
+int PlatoSymmetry::detectOperations(PlatoXYZFrame* frame) {
+  int perms[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+		     {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  int numAtoms = frame->numAtoms;
+  int* types = frame->atomTypes;
+  if(numAtoms < 1)
+    return numOps;
+
+  double* fract = new double[3 * numAtoms];
+  for(int a = 0; a < numAtoms; a++)
+    toFractional(&frame->coords[3 * a], &fract[3 * a]);
+
+  // try every signed permutation of the axes that keeps the cell's shape,
+  // with each translation that takes the first atom onto one of its own
+  // kind, and keep those that map every atom onto a matching one...
+  int sign[3];
+  int shift[3];
+  double diff;
+  double image;
+  bool match;
+  int a, b, d;
+  for(int p = 0; p < 6; p++) {
+    int* perm = perms[p];
+    if(!isGridCompatible(perm))
+      continue;
+
+    for(int s = 0; s < 8; s++) {
+      for(d = 0; d < 3; d++)
+	sign[d] = (s & (1 << d)) ? -1 : 1;
+      if(!isMetricPreserved(perm, sign))
+	continue;
+
+      for(int target = 0; target < numAtoms; target++) {
+	if(types[target] != types[0])
+	  continue;
+	for(d = 0; d < 3; d++) {
+	  if(!gridShift(fract[(3 * target) + d] -
+			(sign[d] * fract[perm[d]]), dataDims[d], &shift[d]))
+	    break;
+	}
+	if(d < 3)
+	  continue;
+
+	for(a = 0; a < numAtoms; a++) {
+	  for(b = 0; b < numAtoms; b++) {
+	    if(types[b] != types[a])
+	      continue;
+	    match = true;
+	    for(d = 0; d < 3 && match; d++) {
+	      image = (sign[d] * fract[(3 * a) + perm[d]]) +
+		((double) shift[d] / (double) dataDims[d]);
+	      diff = image - fract[(3 * b) + d];
+	      diff -= floor(diff + 0.5);
+	      match = (fabs(diff) < PVS_SYM_TOLERANCE);
+	    }
+	    if(match)
+	      break;
+	  }
+	  if(b == numAtoms)
+	    break;
+	}
+
+	if(a == numAtoms)
+	  addOperation(perm, sign, shift);
+      } // target
+    } // s
+  } // p
+
+  delete[] fract;
+
+  return numOps;
+}
+
+bool PlatoSymmetry::imageOfBox(int op, int* lo, int* hi,
+			       int* outLo, int* outHi, int* outShift) {
+  int* perm = &opPerm[3 * op];
+  int* sign = &opSign[3 * op];
+  int* shift = &opShift[3 * op];
+  int a, b, k;
+
+  for(int j = 0; j < 3; j++) {
+    if(sign[j] > 0) {
+      a = lo[perm[j]] + shift[j];
+      b = hi[perm[j]] + shift[j];
+    }
+    else {
+      a = shift[j] - hi[perm[j]];
+      b = shift[j] - lo[perm[j]];
+    }
+
+    // bring it back into the cell, it has to land there in one piece...
+    k = (a >= 0) ? (a / dataDims[j]) : -(((-a) + dataDims[j] - 1) / dataDims[j]);
+    k *= dataDims[j];
+    if((b - k) > dataDims[j])
+      return false;
+
+    outLo[j] = a - k;
+    outHi[j] = b - k;
+    outShift[j] = shift[j] - k;
+  }
+
+  return true;
+}
+
+bool PlatoSymmetry::tileWithBox(int* lo, int* hi, int* blocks,
+				int* blockSize) {
+  int numBlocks = blocks[0] * blocks[1] * blocks[2];
+  bool* covered = new bool[numBlocks];
+  int numCovered = 0;
+  int outLo[3];
+  int outHi[3];
+  int outShift[3];
+  int i, j, k, d;
+  bool clear;
+
+  for(i = 0; i < numBlocks; i++)
+    covered[i] = false;
+
+  // greedily take each image that doesn't overlap what we have so far, the
+  // identity is always first so the box itself is the first image...
+  numImages = 0;
+  for(int op = 0; op < numOps && numCovered < numBlocks; op++) {
+    for(d = 0; d < 3; d++) {
+      if((opShift[(3 * op) + d] % blockSize[d]) != 0)
+	break;
+    }
+    if(d < 3 || !imageOfBox(op, lo, hi, outLo, outHi, outShift))
+      continue;
+
+    clear = true;
+    for(k = outLo[2] / blockSize[2]; k < outHi[2] / blockSize[2]; k++) {
+      for(j = outLo[1] / blockSize[1]; j < outHi[1] / blockSize[1]; j++) {
+	for(i = outLo[0] / blockSize[0]; i < outHi[0] / blockSize[0]; i++) {
+	  if(covered[i + (blocks[0] * (j + (blocks[1] * k)))])
+	    clear = false;
+	}
+      }
+    }
+    if(!clear)
+      continue;
+
+    for(k = outLo[2] / blockSize[2]; k < outHi[2] / blockSize[2]; k++) {
+      for(j = outLo[1] / blockSize[1]; j < outHi[1] / blockSize[1]; j++) {
+	for(i = outLo[0] / blockSize[0]; i < outHi[0] / blockSize[0]; i++) {
+	  covered[i + (blocks[0] * (j + (blocks[1] * k)))] = true;
+	  numCovered++;
+	}
+      }
+    }
+    imageOps[numImages] = op;
+    for(d = 0; d < 3; d++)
+      imageShift[(3 * numImages) + d] = outShift[d];
+    numImages++;
+  }
+
+  delete[] covered;
+
+  return (numCovered == numBlocks);
+}
+
+bool PlatoSymmetry::buildWedge() {
+  int blocks[3];
+  int blockSize[3];
+  int size[3];
+  int pos[3];
+  int lo[3];
+  int hi[3];
+  int d;
+
+  if(!data->isUniformMesh() || numOps < 2)
+    return false;
+
+  // the wedge is made of whole blocks of the grid, a quarter of the cell
+  // along each axis if the grid divides that finely...
+  for(d = 0; d < 3; d++) {
+    blocks[d] = ((dataDims[d] % 4) == 0) ? 4 :
+      (((dataDims[d] % 2) == 0) ? 2 : 1);
+    blockSize[d] = dataDims[d] / blocks[d];
+  }
+  int numBlocks = blocks[0] * blocks[1] * blocks[2];
+
+  // try the boxes smallest first, the first one whose images tile the
+  // cell is the wedge...
+  for(int volume = 1; volume < numBlocks; volume++) {
+    for(size[2] = 1; size[2] <= blocks[2]; size[2]++) {
+      for(size[1] = 1; size[1] <= blocks[1]; size[1]++) {
+	for(size[0] = 1; size[0] <= blocks[0]; size[0]++) {
+	  if((size[0] * size[1] * size[2]) != volume)
+	    continue;
+
+	  for(pos[2] = 0; pos[2] <= (blocks[2] - size[2]); pos[2]++) {
+	    for(pos[1] = 0; pos[1] <= (blocks[1] - size[1]); pos[1]++) {
+	      for(pos[0] = 0; pos[0] <= (blocks[0] - size[0]); pos[0]++) {
+		for(d = 0; d < 3; d++) {
+		  lo[d] = pos[d] * blockSize[d];
+		  hi[d] = (pos[d] + size[d]) * blockSize[d];
+		}
+		if(tileWithBox(lo, hi, blocks, blockSize)) {
+		  for(d = 0; d < 3; d++) {
+		    wedgeLow[d] = lo[d];
+		    wedgeHigh[d] = hi[d];
+		  }
+		  return true;
+		}
+	      } // pos[0]
+	    } // pos[1]
+	  } // pos[2]
+	} // size[0]
+      } // size[1]
+    } // size[2]
+  } // volume
+
+  // no reduction possible, the wedge is the whole cell...
+  numImages = 0;
+  return false;
+}
+
+int PlatoSymmetry::getNumberOfOperations() {
+  return numOps;
+}
+
+int PlatoSymmetry::getNumberOfImages() {
+  return numImages;
+}
+
+int* PlatoSymmetry::getWedgeLow() {
+  return wedgeLow;
+}
+
+int* PlatoSymmetry::getWedgeHigh() {
+  return wedgeHigh;
+}
+
+void PlatoSymmetry::getImageMatrix(int image, vtkMatrix4x4* matrix) {
+  int op = imageOps[image];
+  int* perm = &opPerm[3 * op];
+  int* sign = &opSign[3 * op];
+  int* shift = &imageShift[3 * image];
+  double value;
+
+  // the operation works in fractional coordinates so in cartesian space
+  // it's A.R.inverse(A), followed by the shift...
+  matrix->Identity();
+  for(int d = 0; d < 3; d++) {
+    for(int e = 0; e < 3; e++) {
+      value = 0.0;
+      for(int j = 0; j < 3; j++) {
+	value += cellVectors[(3 * j) + d] * sign[j] *
+	  inverseCell[(3 * perm[j]) + e];
+      }
+      matrix->SetElement(d, e, value);
+    }
+
+    value = 0.0;
+    for(int j = 0; j < 3; j++)
+      value += cellVectors[(3 * j) + d] * shift[j] / (double) dataDims[j];
+    matrix->SetElement(d, 3, value);
+  }
+}
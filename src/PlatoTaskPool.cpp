@@ -0,0 +1,456 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoTaskPool.h"
+
+// a buffer to be touched a piece at a time...
+struct PlatoTouchData {
+  char* buffer;
+  long bytes;
+  int pieces;
+};
+
+PlatoTaskPool* PlatoTaskPool::pool = NULL;
+
+// which worker this thread is, if any...
+static __thread int currentWorker = -1;
+
+PlatoTaskPool::PlatoTaskPool(int numThreads, const char* affinity) {
+  numCpus = parseCpus(affinity);
+
+  // one thread per core (or per cpu they're pinned to) by default. The
+  // thread that asks for the work does its share too so it counts as
+  // one...
+  if(numThreads < 1)
+    numThreads = (numCpus > 0) ? numCpus :
+      (int) sysconf(_SC_NPROCESSORS_ONLN);
+  numWorkers = std::min(std::max(numThreads - 1, 0), PVS_POOL_MAX_THREADS);
+
+  nextQueue = 0;
+  stopping = false;
+  startTime = getTimeMillis();
+  sampleTime = startTime;
+  sem_init(&tasksWaiting, 0, 0);
+  poolLock = vtkMutexLock::New();
+
+  // the first cpu is left for the thread that started us...
+  for(int i = 0; i < numWorkers; i++) {
+    queues[i].tasks = new PlatoTask[PVS_POOL_QUEUE];
+    queues[i].head = 0;
+    queues[i].tail = 0;
+    queues[i].lock = vtkMutexLock::New();
+    queues[i].cpu = (numCpus > 0) ? cpus[(i + 1) % numCpus] : -1;
+    queues[i].tasksRun = 0;
+    queues[i].tasksStolen = 0;
+    queues[i].busyTime = 0.0;
+    queues[i].sampledBusy = 0.0;
+  }
+
+  threads = vtkMultiThreader::New();
+  for(int i = 0; i < numWorkers; i++) {
+    workers[i].pool = this;
+    workers[i].index = i;
+    threadIDs[i] = threads->SpawnThread(workerLoop, &workers[i]);
+  }
+}
+
+PlatoTaskPool::~PlatoTaskPool() {
+  // anything still queued is dropped, everyone should have waited for
+  // their tasks by now...
+  poolLock->Lock();
+  stopping = true;
+  poolLock->Unlock();
+  for(int i = 0; i < numWorkers; i++)
+    sem_post(&tasksWaiting);
+  for(int i = 0; i < numWorkers; i++)
+    threads->TerminateThread(threadIDs[i]);
+
+  for(int i = 0; i < numWorkers; i++) {
+    delete[] queues[i].tasks;
+    queues[i].lock->Delete();
+  }
+  threads->Delete();
+  sem_destroy(&tasksWaiting);
+  poolLock->Delete();
+}
+
+void PlatoTaskPool::start(int numThreads, const char* affinity) {
+  // call this before any other threads are started...
+  if(!pool)
+    pool = new PlatoTaskPool(numThreads, affinity);
+}
+
+PlatoTaskPool* PlatoTaskPool::getPool() {
+  // anything that runs without start() being called gets the defaults...
+  if(!pool)
+    pool = new PlatoTaskPool(0, NULL);
+
+  return pool;
+}
+
+void PlatoTaskPool::finish() {
+  if(pool)
+    delete pool;
+  pool = NULL;
+}
+
+int PlatoTaskPool::getNumThreads() {
+  return numWorkers + 1;
+}
+
+int PlatoTaskPool::getNumWorkers() {
+  return numWorkers;
+}
+
+int PlatoTaskPool::parseCpus(const char* list) {
+  const char* p = list;
+  char* end;
+  long first;
+  long last;
+  int n = 0;
+
+  if(!list || strcmp(list, "none") == 0)
+    return 0;
+
+  // comma separated cpus or ranges of them...
+  while(*p) {
+    first = strtol(p, &end, 10);
+    last = first;
+    if(end != p && *end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+    }
+    if(end == p || first < 0 || last < first || last >= CPU_SETSIZE ||
+       (*end != ',' && *end != '\0')) {
+      std::cerr << "Bad cpu list: " << list << "\n";
+      exit(1);
+    }
+    for(long c = first; c <= last && n < PVS_POOL_MAX_THREADS; c++)
+      cpus[n++] = (int) c;
+    p = (*end == ',') ? end + 1 : end;
+  }
+
+  return n;
+}
+
+void PlatoTaskPool::pinWorker(int worker) {
+  cpu_set_t set;
+  int cpu = queues[worker].cpu;
+
+  if(cpu < 0)
+    return;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    std::cerr << "Could not pin task worker " << worker << " to cpu ";
+    std::cerr << cpu << "\n";
+  }
+}
+
+void* PlatoTaskPool::workerLoop(void* userData) {
+  PlatoTaskWorker* worker = (PlatoTaskWorker*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  PlatoTaskPool* p = worker->pool;
+  PlatoTask task;
+  bool stop;
+
+  currentWorker = worker->index;
+  p->pinWorker(worker->index);
+
+  // there's a post for every task queued, but someone helping out may
+  // have got to it first...
+  while(true) {
+    sem_wait(&p->tasksWaiting);
+
+    p->poolLock->Lock();
+    stop = p->stopping;
+    p->poolLock->Unlock();
+    if(stop)
+      break;
+
+    if(p->takeTask(worker->index, &task))
+      p->runTask(worker->index, &task);
+  }
+
+  return NULL;
+}
+
+void PlatoTaskPool::push(PlatoTask* task) {
+  int q;
+
+  // a worker keeps the tasks it makes for itself, anyone else's are dealt
+  // out in turn...
+  if(currentWorker >= 0) {
+    q = currentWorker;
+  }
+  else {
+    poolLock->Lock();
+    q = nextQueue;
+    nextQueue = (nextQueue + 1) % numWorkers;
+    poolLock->Unlock();
+  }
+
+  for(int i = 0; i < numWorkers; i++) {
+    PlatoTaskQueue* queue = &queues[(q + i) % numWorkers];
+    queue->lock->Lock();
+    if((queue->tail - queue->head) < PVS_POOL_QUEUE) {
+      queue->tasks[queue->tail & (PVS_POOL_QUEUE - 1)] = *task;
+      queue->tail++;
+      queue->lock->Unlock();
+      sem_post(&tasksWaiting);
+      return;
+    }
+    queue->lock->Unlock();
+  }
+
+  // everyone's full up so it's done here and now...
+  runTask(currentWorker, task);
+}
+
+bool PlatoTaskPool::takeTask(int worker, PlatoTask* task) {
+  PlatoTaskQueue* queue;
+
+  // the newest of our own first, it's the most likely to still be in
+  // cache...
+  if(worker >= 0) {
+    queue = &queues[worker];
+    queue->lock->Lock();
+    if(queue->tail > queue->head) {
+      queue->tail--;
+      *task = queue->tasks[queue->tail & (PVS_POOL_QUEUE - 1)];
+      queue->lock->Unlock();
+      return true;
+    }
+    queue->lock->Unlock();
+  }
+
+  // ...then the oldest of someone else's...
+  for(int i = 0; i < numWorkers; i++) {
+    int victim = (worker + 1 + i) % numWorkers;
+    if(victim == worker)
+      continue;
+
+    queue = &queues[victim];
+    queue->lock->Lock();
+    if(queue->tail > queue->head) {
+      *task = queue->tasks[queue->head & (PVS_POOL_QUEUE - 1)];
+      queue->head++;
+      queue->lock->Unlock();
+
+      if(worker >= 0) {
+	queues[worker].lock->Lock();
+	queues[worker].tasksStolen++;
+	queues[worker].lock->Unlock();
+      }
+      return true;
+    }
+    queue->lock->Unlock();
+  }
+
+  return false;
+}
+
+void PlatoTaskPool::runTask(int worker, PlatoTask* task) {
+  double start = getTimeMillis();
+
+  for(int i = task->first; i < task->last; i++)
+    task->function(i, task->data);
+
+  if(worker >= 0) {
+    queues[worker].lock->Lock();
+    queues[worker].tasksRun++;
+    queues[worker].busyTime += getTimeMillis() - start;
+    queues[worker].lock->Unlock();
+  }
+
+  // the post is made under the lock so the group can't be gone by the
+  // time it's made...
+  poolLock->Lock();
+  if(--task->group->pending == 0)
+    sem_post(&task->group->done);
+  poolLock->Unlock();
+}
+
+void PlatoTaskPool::submitRange(PlatoTaskGroup* group,
+				PlatoTaskFunction function, void* data,
+				int first, int last) {
+  PlatoTask task;
+  task.function = function;
+  task.data = data;
+  task.first = first;
+  task.last = last;
+  task.group = group;
+
+  poolLock->Lock();
+  group->pending++;
+  poolLock->Unlock();
+
+  if(numWorkers == 0)
+    runTask(currentWorker, &task);
+  else
+    push(&task);
+}
+
+void PlatoTaskPool::run(PlatoTaskFunction function, void* data, int n,
+			int grain) {
+  PlatoTaskGroup group;
+
+  if(n <= 0)
+    return;
+
+  // cut into pieces of at least grain indices, but not so many that
+  // queueing them costs more than running them...
+  int pieces = std::max(n / std::max(grain, 1), 1);
+  pieces = std::min(pieces, PVS_POOL_SPLIT * getNumThreads());
+  if(numWorkers == 0 || pieces < 2) {
+    for(int i = 0; i < n; i++)
+      function(i, data);
+    return;
+  }
+
+  for(int p = 1; p < pieces; p++) {
+    submitRange(&group, function, data,
+		(int) (((long long) n * p) / pieces),
+		(int) (((long long) n * (p + 1)) / pieces));
+  }
+
+  // the caller does the first piece itself, then helps with the rest...
+  int first = (int) ((long long) n / pieces);
+  for(int i = 0; i < first; i++)
+    function(i, data);
+  wait(&group);
+}
+
+void PlatoTaskPool::submit(PlatoTaskGroup* group, PlatoTaskFunction function,
+			   void* data, int index) {
+  submitRange(group, function, data, index, index + 1);
+}
+
+void PlatoTaskPool::wait(PlatoTaskGroup* group) {
+  PlatoTask task;
+  int pending;
+
+  // only sleep when there's nothing left to help with, so anything still
+  // in the group is already running...
+  while(true) {
+    poolLock->Lock();
+    pending = group->pending;
+    poolLock->Unlock();
+    if(pending == 0)
+      break;
+
+    if(takeTask(currentWorker, &task))
+      runTask(currentWorker, &task);
+    else
+      sem_wait(&group->done);
+  }
+
+  // use up any posts made along the way so the group can be used again...
+  while(sem_trywait(&group->done) == 0);
+}
+
+void PlatoTaskPool::touchPages(int piece, void* data) {
+  PlatoTouchData* td = (PlatoTouchData*) data;
+  long first = (td->bytes * piece) / td->pieces;
+  long last = (td->bytes * (piece + 1)) / td->pieces;
+
+  memset(td->buffer + first, 0, last - first);
+}
+
+void PlatoTaskPool::firstTouch(void* buffer, long bytes) {
+  PlatoTouchData td;
+
+  // memory goes on the node of whichever thread writes to it first, so
+  // zero a big buffer across the workers before it's filled and it's
+  // spread over the nodes that will work on it...
+  td.buffer = (char*) buffer;
+  td.bytes = bytes;
+  td.pieces = getNumThreads();
+  run(touchPages, &td, td.pieces);
+}
+
+double PlatoTaskPool::sampleUtilisation(double* perWorker) {
+  double now = getTimeMillis();
+  double elapsed = now - sampleTime;
+  double total = 0.0;
+  double busy;
+
+  // tasks are counted when they finish, so a long one can make a worker
+  // look more than busy...
+  for(int i = 0; i < numWorkers; i++) {
+    queues[i].lock->Lock();
+    busy = queues[i].busyTime - queues[i].sampledBusy;
+    queues[i].sampledBusy = queues[i].busyTime;
+    queues[i].lock->Unlock();
+
+    busy = (elapsed > 0.0) ? std::min((100.0 * busy) / elapsed, 100.0) : 0.0;
+    if(perWorker)
+      perWorker[i] = busy;
+    total += busy;
+  }
+  sampleTime = now;
+
+  return (numWorkers > 0) ? (total / numWorkers) : 0.0;
+}
+
+void PlatoTaskPool::printStats() {
+  double elapsed = getTimeMillis() - startTime;
+
+  std::cout << "Task pool of " << numWorkers << " workers over ";
+  std::cout << elapsed / 1000.0 << " s:\n";
+  for(int i = 0; i < numWorkers; i++) {
+    queues[i].lock->Lock();
+    std::cout << "  worker " << i;
+    if(queues[i].cpu >= 0)
+      std::cout << " (cpu " << queues[i].cpu << ")";
+    std::cout << ": busy " << (100.0 * queues[i].busyTime) / elapsed;
+    std::cout << "%, " << queues[i].tasksRun << " tasks, ";
+    std::cout << queues[i].tasksStolen << " stolen\n";
+    queues[i].lock->Unlock();
+  }
+}
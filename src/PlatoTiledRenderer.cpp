@@ -0,0 +1,243 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// vtk includes...
+#include "vtkCamera.h"
+#include "vtkMultiThreader.h"
+
+// plato includes...
+#include "main.h"
+#include "PlatoPosterWriter.h"
+#include "PlatoRenderWindow.h"
+#include "PlatoTiledRenderer.h"
+
+PlatoTiledRenderer::PlatoTiledRenderer(PlatoRenderWindow* prw) {
+  window = prw;
+  numTiles = 1;
+  for(int i = 0; i < 2; i++) {
+    imageSize[i] = 0;
+    tileSize[i] = 0;
+    windowSize[i] = 0;
+    strips[i] = NULL;
+    stripRows[i] = 0;
+  }
+  viewAngle = 0.0;
+  parallelScale = 0.0;
+  writer = NULL;
+  thread = vtkMultiThreader::New();
+}
+
+PlatoTiledRenderer::~PlatoTiledRenderer() {
+  thread->Delete();
+}
+
+void PlatoTiledRenderer::setUp(int width, int height) {
+  vtkCamera* camera = window->getCamera();
+
+  imageSize[0] = width;
+  imageSize[1] = height;
+
+  // the same number of tiles each way keeps the tiles the shape of the
+  // image...
+  numTiles = std::max((width + PVS_TILE_MAX_SIZE - 1) / PVS_TILE_MAX_SIZE,
+		      (height + PVS_TILE_MAX_SIZE - 1) / PVS_TILE_MAX_SIZE);
+  tileSize[0] = (width + numTiles - 1) / numTiles;
+  tileSize[1] = (height + numTiles - 1) / numTiles;
+
+  windowSize[0] = window->getSize()[0];
+  windowSize[1] = window->getSize()[1];
+  window->setSize(tileSize[0], tileSize[1]);
+
+  // narrow the view so the window sees one tile's worth of pixels of it.
+  // The tiles are all the same size, so unless the image is a whole number
+  // of them the last ones hang over its edge and are cut off...
+  viewAngle = camera->GetViewAngle();
+  parallelScale = camera->GetParallelScale();
+  camera->SetViewAngle(getTileViewAngle(viewAngle, tileSize[1], height));
+  camera->SetParallelScale(parallelScale * tileSize[1] / height);
+}
+
+double PlatoTiledRenderer::getTileViewAngle(double angle, int tileSize,
+					    int imageSize) {
+  // the image plane is split into pixels evenly, so it's the tangent of the
+  // half angle that's scaled, not the angle...
+  return atan(tan(angle * M_PI / 360.0) * tileSize / imageSize) *
+    360.0 / M_PI;
+}
+
+double PlatoTiledRenderer::getTileCentre(int first, int tileSize,
+					 int imageSize) {
+  // window centres are in units of half the tile's view, measured from
+  // the middle of the whole image...
+  return ((2.0 * first) + tileSize - imageSize) / tileSize;
+}
+
+int PlatoTiledRenderer::getTilePixels(int tile, int tileSize, int imageSize) {
+  return std::min(tileSize, imageSize - (tile * tileSize));
+}
+
+void PlatoTiledRenderer::tearDown() {
+  vtkCamera* camera = window->getCamera();
+
+  camera->SetWindowCenter(0.0, 0.0);
+  camera->SetViewAngle(viewAngle);
+  camera->SetParallelScale(parallelScale);
+  window->setSize(windowSize[0], windowSize[1]);
+}
+
+void PlatoTiledRenderer::renderStrip(int y, unsigned char* strip, int rows) {
+  vtkCamera* camera = window->getCamera();
+  unsigned char* pixels;
+  int width;
+  int height;
+  int left;
+  int columns;
+
+  for(int x = 0; x < numTiles; x++) {
+    left = x * tileSize[0];
+    columns = getTilePixels(x, tileSize[0], imageSize[0]);
+    if(columns <= 0)
+      break;
+
+    // move the window over this tile. New data is only taken before the
+    // first tile, at the left of the top row with any pixels in it, so
+    // they all show the same thing...
+    camera->SetWindowCenter(getTileCentre(left, tileSize[0], imageSize[0]),
+			    getTileCentre(y * tileSize[1], tileSize[1],
+					  imageSize[1]));
+    window->render(x == 0 &&
+		   getTilePixels(y + 1, tileSize[1], imageSize[1]) <= 0);
+    pixels = window->grabImage(&width, &height);
+
+    for(int row = 0; row < rows && row < height; row++) {
+      memcpy(strip + (((row * imageSize[0]) + left) * 3),
+	     pixels + (row * width * 3), columns * 3);
+    }
+    delete[] pixels;
+  }
+}
+
+unsigned char* PlatoTiledRenderer::renderImage(int width, int height) {
+  unsigned char* image = new unsigned char[width * height * 3];
+  int rows;
+
+  // bottom row first, the same as a grab from the window. Drawn from the
+  // top like a poster so the first tile is the same...
+  setUp(width, height);
+  for(int y = numTiles - 1; y >= 0; y--) {
+    rows = getTilePixels(y, tileSize[1], height);
+    if(rows > 0)
+      renderStrip(y, image + (y * tileSize[1] * width * 3), rows);
+  }
+  tearDown();
+
+  return image;
+}
+
+void PlatoTiledRenderer::renderPoster(int width, int height,
+				      const char* filename) {
+  double start = getTimeMillis();
+  int slot = 0;
+  int rows;
+  int threadID;
+
+  setUp(width, height);
+  for(int i = 0; i < 2; i++)
+    strips[i] = new unsigned char[tileSize[1] * width * 3];
+  sem_init(&stripFree, 0, 2);
+  sem_init(&stripReady, 0, 0);
+  writer = new PlatoPosterWriter(filename, width, height);
+  threadID = thread->SpawnThread(writeLoop, this);
+
+  // one row of tiles is compressed while the next is drawn, the file
+  // goes from the top down...
+  for(int y = numTiles - 1; y >= -1; y--) {
+    rows = 0;
+    if(y >= 0) {
+      rows = getTilePixels(y, tileSize[1], height);
+      if(rows <= 0)
+	continue;
+    }
+
+    sem_wait(&stripFree);
+    if(rows > 0)
+      renderStrip(y, strips[slot], rows);
+    stripRows[slot] = rows;
+    sem_post(&stripReady);
+    slot = 1 - slot;
+  }
+  thread->TerminateThread(threadID);
+  tearDown();
+
+  writer->close();
+  delete writer;
+  writer = NULL;
+  for(int i = 0; i < 2; i++) {
+    delete[] strips[i];
+    strips[i] = NULL;
+  }
+  sem_destroy(&stripFree);
+  sem_destroy(&stripReady);
+
+  std::cout << "Wrote " << width << "x" << height << " poster " << filename;
+  std::cout << " from " << numTiles << "x" << numTiles << " tiles in ";
+  std::cout << (getTimeMillis() - start) / 1000.0 << " s\n";
+}
+
+void* PlatoTiledRenderer::writeLoop(void* userData) {
+  PlatoTiledRenderer* tiles = (PlatoTiledRenderer*)
+    ((ThreadInfoStruct*) userData)->UserData;
+  int rowBytes = tiles->imageSize[0] * 3;
+  int slot = 0;
+  int rows;
+
+  // an empty strip is the end of the poster...
+  while(true) {
+    sem_wait(&tiles->stripReady);
+    rows = tiles->stripRows[slot];
+    if(rows == 0)
+      break;
+
+    for(int row = rows - 1; row >= 0; row--)
+      tiles->writer->writeRow(tiles->strips[slot] + (row * rowBytes));
+    sem_post(&tiles->stripFree);
+    slot = 1 - slot;
+  }
+
+  return NULL;
+}
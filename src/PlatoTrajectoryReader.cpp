@@ -0,0 +1,712 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// system includes...
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// vtk includes...
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+
+// plato includes...
+#include "PlatoInputStream.h"
+#include "PlatoTaskPool.h"
+#include "PlatoTrajectoryReader.h"
+
+// element symbols and covalent radii (Angstroms) indexed by atom type, which
+// is the atomic number minus one as in vtkMoleculeReaderBase...
+static const int numElements = 54;
+static const char* elementSymbols[] = {
+  "H",  "He", "Li", "Be", "B",  "C",  "N",  "O",  "F",  "Ne",
+  "Na", "Mg", "Al", "Si", "P",  "S",  "Cl", "Ar", "K",  "Ca",
+  "Sc", "Ti", "V",  "Cr", "Mn", "Fe", "Co", "Ni", "Cu", "Zn",
+  "Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr", "Y",  "Zr",
+  "Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn",
+  "Sb", "Te", "I",  "Xe"
+};
+static const float covalentRadii[] = {
+  0.31f, 0.28f, 1.28f, 0.96f, 0.84f, 0.76f, 0.71f, 0.66f, 0.57f, 0.58f,
+  1.66f, 1.41f, 1.21f, 1.11f, 1.07f, 1.05f, 1.02f, 1.06f, 2.03f, 1.76f,
+  1.70f, 1.60f, 1.53f, 1.39f, 1.39f, 1.32f, 1.26f, 1.24f, 1.32f, 1.22f,
+  1.22f, 1.20f, 1.19f, 1.20f, 1.20f, 1.16f, 2.20f, 1.95f, 1.90f, 1.75f,
+  1.64f, 1.54f, 1.47f, 1.46f, 1.42f, 1.39f, 1.45f, 1.44f, 1.42f, 1.39f,
+  1.39f, 1.38f, 1.39f, 1.40f
+};
+static const float defaultRadius = 1.5f;
+
+// index file identification...
+static const char indexMagic[8] = {'P', 'V', 'S', 'X', 'Y', 'Z', 'I', '1'};
+
+// states of the prefetch cache slots...
+enum { SLOT_EMPTY, SLOT_BUSY, SLOT_READY };
+
+// shared data for the parallel index scan...
+struct scanData {
+  const char* data;
+  long long size;
+  int numChunks;
+  int pass;
+  int linesPerFrame;
+  long long* lineCounts;
+  long long* firstLine;
+  long long* frameBase;
+  long long* offsets;
+};
+
+// parsing helpers that never run off the end of the mapped file...
+static inline bool isSpace(char c) {
+  return (c == ' ' || c == '\t' || c == '\r');
+}
+
+static inline const char* nextLine(const char* p, const char* end) {
+  const char* nl = (const char*) memchr(p, '\n', end - p);
+  return nl ? nl + 1 : end;
+}
+
+static int parseInt(const char*& p, const char* end) {
+  int value = 0;
+  while(p < end && isSpace(*p))
+    p++;
+  if(p == end || *p < '0' || *p > '9')
+    return -1;
+  while(p < end && *p >= '0' && *p <= '9')
+    value = (value * 10) + (*p++ - '0');
+
+  return value;
+}
+
+static float parseFloat(const char*& p, const char* end) {
+  double value = 0.0;
+  double scale = 1.0;
+  bool negative = false;
+  int exponent = 0;
+  bool negExponent = false;
+
+  while(p < end && isSpace(*p))
+    p++;
+  if(p < end && (*p == '-' || *p == '+'))
+    negative = (*p++ == '-');
+  while(p < end && *p >= '0' && *p <= '9')
+    value = (value * 10.0) + (*p++ - '0');
+  if(p < end && *p == '.') {
+    p++;
+    while(p < end && *p >= '0' && *p <= '9') {
+      scale *= 0.1;
+      value += (*p++ - '0') * scale;
+    }
+  }
+  if(p < end && (*p == 'e' || *p == 'E' || *p == 'd' || *p == 'D')) {
+    p++;
+    if(p < end && (*p == '-' || *p == '+'))
+      negExponent = (*p++ == '-');
+    while(p < end && *p >= '0' && *p <= '9')
+      exponent = (exponent * 10) + (*p++ - '0');
+    while(exponent-- > 0)
+      negExponent ? value *= 0.1 : value *= 10.0;
+  }
+
+  return (float) (negative ? -value : value);
+}
+
+static int atomType(const char*& p, const char* end) {
+  char symbol[3] = {'\0', '\0', '\0'};
+
+  while(p < end && isSpace(*p))
+    p++;
+  if(p < end && isalpha(*p))
+    symbol[0] = toupper(*p++);
+  if(p < end && isalpha(*p))
+    symbol[1] = tolower(*p++);
+
+  // skip any labels attached to the symbol, e.g. "C12"...
+  while(p < end && !isSpace(*p) && *p != '\n')
+    p++;
+
+  for(int i = 0; i < numElements; i++) {
+    if(!strcmp(symbol, elementSymbols[i]))
+      return i;
+  }
+
+  // try again with just the first letter...
+  symbol[1] = '\0';
+  for(int i = 0; i < numElements; i++) {
+    if(!strcmp(symbol, elementSymbols[i]))
+      return i;
+  }
+
+  return numElements;
+}
+
+static void scanChunk(int t, void* userData) {
+  scanData* sd = (scanData*) userData;
+  int n = sd->numChunks;
+
+  const char* p = sd->data + ((sd->size * t) / n);
+  const char* end = sd->data + ((sd->size * (t + 1)) / n);
+
+  if(sd->pass == 0) {
+    // first pass: just count lines...
+    long long count = 0;
+    while((p = (const char*) memchr(p, '\n', end - p)) != NULL) {
+      count++;
+      p++;
+    }
+    sd->lineCounts[t] = count;
+  }
+  else {
+    // second pass: record the start of every (linesPerFrame)th line...
+    long long line = sd->firstLine[t];
+    long long frame = sd->frameBase[t];
+    while((p = (const char*) memchr(p, '\n', end - p)) != NULL) {
+      line++;
+      p++;
+      if((line % sd->linesPerFrame) == 0)
+	sd->offsets[frame++] = p - sd->data;
+    }
+  }
+}
+
+PlatoXYZFrame::PlatoXYZFrame() {
+  frameNumber = -1;
+  numAtoms = 0;
+  capacity = 0;
+  coords = NULL;
+  atomTypes = NULL;
+}
+
+PlatoXYZFrame::~PlatoXYZFrame() {
+  if(coords)
+    delete[] coords;
+  if(atomTypes)
+    delete[] atomTypes;
+}
+
+void PlatoXYZFrame::resize(int atoms) {
+  if(atoms > capacity) {
+    if(coords)
+      delete[] coords;
+    if(atomTypes)
+      delete[] atomTypes;
+    coords = new float[3 * atoms];
+    atomTypes = new int[atoms];
+    capacity = atoms;
+  }
+
+  numAtoms = atoms;
+}
+
+void PlatoXYZFrame::swap(PlatoXYZFrame* other) {
+  int tmpInt;
+  float* tmpCoords;
+  int* tmpTypes;
+
+  tmpInt = frameNumber;
+  frameNumber = other->frameNumber;
+  other->frameNumber = tmpInt;
+
+  tmpInt = numAtoms;
+  numAtoms = other->numAtoms;
+  other->numAtoms = tmpInt;
+
+  tmpInt = capacity;
+  capacity = other->capacity;
+  other->capacity = tmpInt;
+
+  tmpCoords = coords;
+  coords = other->coords;
+  other->coords = tmpCoords;
+
+  tmpTypes = atomTypes;
+  atomTypes = other->atomTypes;
+  other->atomTypes = tmpTypes;
+}
+
+PlatoTrajectoryReader::PlatoTrajectoryReader(char* filename) {
+  xyzFilename = filename;
+  fileDescriptor = -1;
+  fileData = NULL;
+  fileSize = 0;
+  fileTime = 0;
+  frameOffsets = NULL;
+  numFrames = 0;
+  numAtoms = 0;
+
+  cache = NULL;
+  cacheState = NULL;
+  wantedFrame = 0;
+  prefetchDone = false;
+  prefetchThreadId = -1;
+  cacheLock = NULL;
+  thread = NULL;
+
+  mapFile();
+  if(!loadIndex()) {
+    buildIndex();
+    saveIndex();
+  }
+
+  // only trajectories need the prefetcher...
+  if(numFrames > 1) {
+    cache = new PlatoXYZFrame[PVS_TRAJ_PREFETCH];
+    cacheState = new int[PVS_TRAJ_PREFETCH];
+    for(int i = 0; i < PVS_TRAJ_PREFETCH; i++)
+      cacheState[i] = SLOT_EMPTY;
+
+    cacheLock = vtkMutexLock::New();
+    sem_init(&prefetchWake, 0, 0);
+    thread = vtkMultiThreader::New();
+    prefetchThreadId = thread->SpawnThread(prefetchLoop, this);
+  }
+}
+
+PlatoTrajectoryReader::~PlatoTrajectoryReader() {
+  if(thread) {
+    // tell the prefetcher to finish and wait for it...
+    cacheLock->Lock();
+    prefetchDone = true;
+    cacheLock->Unlock();
+    sem_post(&prefetchWake);
+    thread->TerminateThread(prefetchThreadId);
+
+    thread->Delete();
+    cacheLock->Delete();
+    sem_destroy(&prefetchWake);
+    delete[] cache;
+    delete[] cacheState;
+  }
+
+  if(frameOffsets)
+    delete[] frameOffsets;
+
+  if(fileDescriptor >= 0) {
+    munmap(fileData, fileSize);
+    close(fileDescriptor);
+  }
+  else {
+    delete[] fileData;
+  }
+}
+
+void PlatoTrajectoryReader::mapFile() {
+  struct stat fileStat;
+
+  fileDescriptor = open(xyzFilename, O_RDONLY);
+  if(fileDescriptor < 0 || fstat(fileDescriptor, &fileStat) != 0) {
+    std::cerr << "Could not open file: " << xyzFilename << std::endl;
+    exit(1);
+  }
+
+  fileSize = fileStat.st_size;
+  fileTime = fileStat.st_mtime;
+
+  // a compressed file can't be mapped so it is unpacked into memory, and
+  // its index is of the unpacked text...
+  if(PlatoInputStream::getFormat(xyzFilename) != PVS_INPUT_PLAIN) {
+    close(fileDescriptor);
+    fileDescriptor = -1;
+
+    long length;
+    fileData = PlatoInputStream::readText(xyzFilename, &length);
+    if(!fileData) {
+      std::cerr << "Could not open file: " << xyzFilename << std::endl;
+      exit(1);
+    }
+    fileSize = length;
+  }
+
+  if(fileSize == 0) {
+    std::cerr << "No atoms in file: " << xyzFilename << std::endl;
+    exit(1);
+  }
+  if(fileData)
+    return;
+
+  fileData = (char*) mmap(NULL, fileSize, PROT_READ, MAP_SHARED,
+			  fileDescriptor, 0);
+  if(fileData == MAP_FAILED) {
+    fileData = NULL;
+    std::cerr << "Could not map file: " << xyzFilename << std::endl;
+    exit(1);
+  }
+}
+
+void PlatoTrajectoryReader::buildIndex() {
+  const char* p = fileData;
+  numAtoms = parseInt(p, fileData + fileSize);
+  if(numAtoms < 0) {
+    std::cerr << "Bad atom count in file: " << xyzFilename << std::endl;
+    exit(1);
+  }
+
+  // most trajectories have the same number of atoms in every frame so the
+  // frame starts can be found in parallel, otherwise walk the file...
+  if(fileDescriptor >= 0)
+    madvise(fileData, fileSize, MADV_SEQUENTIAL);
+  if(!buildUniformIndex())
+    buildSerialIndex();
+  if(fileDescriptor >= 0)
+    madvise(fileData, fileSize, MADV_RANDOM);
+}
+
+bool PlatoTrajectoryReader::buildUniformIndex() {
+  scanData sd;
+  PlatoTaskPool* pool = PlatoTaskPool::getPool();
+  int numThreads = pool->getNumThreads();
+  long long linesPerFrame = numAtoms + 2;
+
+  // not worth the threads for small files...
+  if(fileSize < (1 << 20))
+    numThreads = 1;
+
+  sd.data = fileData;
+  sd.size = fileSize;
+  sd.numChunks = numThreads;
+  sd.linesPerFrame = linesPerFrame;
+  sd.lineCounts = new long long[numThreads];
+  sd.firstLine = new long long[numThreads];
+  sd.frameBase = new long long[numThreads];
+
+  // count the lines in each chunk...
+  sd.pass = 0;
+  pool->run(scanChunk, &sd, numThreads);
+
+  // work out where each chunk's frame starts go in the index...
+  long long line = 0;
+  long long frames = 1;
+  for(int t = 0; t < numThreads; t++) {
+    sd.firstLine[t] = line;
+    sd.frameBase[t] = frames;
+    frames += ((line + sd.lineCounts[t]) / linesPerFrame) -
+      (line / linesPerFrame);
+    line += sd.lineCounts[t];
+  }
+
+  // and find them...
+  sd.offsets = new long long[frames + 1];
+  sd.offsets[0] = 0;
+  sd.pass = 1;
+  pool->run(scanChunk, &sd, numThreads);
+
+  delete[] sd.lineCounts;
+  delete[] sd.firstLine;
+  delete[] sd.frameBase;
+
+  // drop any trailing "frames" that are just the end of the file...
+  const char* end = fileData + fileSize;
+  const char* p;
+  while(frames > 0) {
+    p = fileData + sd.offsets[frames - 1];
+    while(p < end && (isSpace(*p) || *p == '\n'))
+      p++;
+    if(p < end)
+      break;
+    frames--;
+  }
+
+  // check every frame really does start with the same atom count...
+  for(long long f = 0; f < frames; f++) {
+    p = fileData + sd.offsets[f];
+    if(parseInt(p, end) != numAtoms) {
+      delete[] sd.offsets;
+      return false;
+    }
+  }
+
+  sd.offsets[frames] = fileSize;
+  frameOffsets = sd.offsets;
+  numFrames = frames;
+
+  return true;
+}
+
+void PlatoTrajectoryReader::buildSerialIndex() {
+  const char* end = fileData + fileSize;
+  const char* p = fileData;
+  int size = 1024;
+  int atoms;
+
+  numFrames = 0;
+  frameOffsets = new long long[size];
+
+  while(true) {
+    // skip blank lines between frames...
+    while(p < end && (isSpace(*p) || *p == '\n'))
+      p++;
+    if(p == end)
+      break;
+
+    if(numFrames == (size - 1)) {
+      long long* tmp = new long long[size * 2];
+      memcpy(tmp, frameOffsets, size * sizeof(long long));
+      delete[] frameOffsets;
+      frameOffsets = tmp;
+      size *= 2;
+    }
+    frameOffsets[numFrames++] = p - fileData;
+
+    atoms = parseInt(p, end);
+    if(atoms < 0) {
+      std::cerr << "Bad atom count in frame " << numFrames - 1;
+      std::cerr << " of file: " << xyzFilename << std::endl;
+      exit(1);
+    }
+    for(int i = 0; i < (atoms + 2); i++)
+      p = nextLine(p, end);
+  }
+
+  frameOffsets[numFrames] = fileSize;
+}
+
+bool PlatoTrajectoryReader::loadIndex() {
+  char magic[8];
+  long long size;
+  long long time;
+  int frames;
+  int atoms;
+
+  char* indexFilename = new char[strlen(xyzFilename) + 5];
+  sprintf(indexFilename, "%s.idx", xyzFilename);
+  ifstream fin(indexFilename, std::ios::in | std::ios::binary);
+  delete[] indexFilename;
+  if(!fin)
+    return false;
+
+  // the index is only good if the file hasn't changed since it was made...
+  fin.read(magic, 8);
+  fin.read((char*) &size, sizeof(long long));
+  fin.read((char*) &time, sizeof(long long));
+  fin.read((char*) &frames, sizeof(int));
+  fin.read((char*) &atoms, sizeof(int));
+  if(!fin || memcmp(magic, indexMagic, 8) || size != fileSize ||
+     time != fileTime || frames < 1 || frames > fileSize)
+    return false;
+
+  frameOffsets = new long long[frames + 1];
+  fin.read((char*) frameOffsets, (frames + 1) * sizeof(long long));
+
+  // the times are only to the second and the index may have been cut short
+  // or damaged, so the offsets must fit the file and each be at the start
+  // of an atom count before they are used to read it...
+  bool good = (fin && frameOffsets[0] >= 0 &&
+	       frameOffsets[frames] == fileSize);
+  for(int f = 0; good && f < frames; f++)
+    good = (frameOffsets[f] < frameOffsets[f + 1]);
+  for(int f = 0; good && f < frames; f++) {
+    const char* p = fileData + frameOffsets[f];
+    if(f > 0 && !isSpace(p[-1]) && p[-1] != '\n')
+      good = false;
+    else
+      good = (parseInt(p, fileData + frameOffsets[f + 1]) >= 0);
+  }
+  if(good) {
+    const char* p = fileData;
+    good = (parseInt(p, fileData + fileSize) == atoms);
+  }
+  if(!good) {
+    delete[] frameOffsets;
+    frameOffsets = NULL;
+    return false;
+  }
+
+  numFrames = frames;
+  numAtoms = atoms;
+  fin.close();
+
+  return true;
+}
+
+void PlatoTrajectoryReader::saveIndex() {
+  // single frames are quicker to read than to index...
+  if(numFrames < 2)
+    return;
+
+  char* indexFilename = new char[strlen(xyzFilename) + 5];
+  sprintf(indexFilename, "%s.idx", xyzFilename);
+  ofstream fout(indexFilename, std::ios::out | std::ios::binary);
+  delete[] indexFilename;
+
+  // not being able to write the index beside the data is not an error...
+  if(!fout)
+    return;
+
+  fout.write(indexMagic, 8);
+  fout.write((char*) &fileSize, sizeof(long long));
+  fout.write((char*) &fileTime, sizeof(long long));
+  fout.write((char*) &numFrames, sizeof(int));
+  fout.write((char*) &numAtoms, sizeof(int));
+  fout.write((char*) frameOffsets, (numFrames + 1) * sizeof(long long));
+  fout.close();
+}
+
+void PlatoTrajectoryReader::parseFrame(int frame, PlatoXYZFrame* out) {
+  const char* p = fileData + frameOffsets[frame];
+  const char* end = fileData + frameOffsets[frame + 1];
+  int atoms = parseInt(p, end);
+  float* xyz;
+
+  // skip the rest of the atom count line and the comment line...
+  p = nextLine(p, end);
+  p = nextLine(p, end);
+
+  out->resize((atoms > 0) ? atoms : 0);
+  out->frameNumber = frame;
+  for(int i = 0; i < out->numAtoms; i++) {
+    if(p == end) {
+      out->numAtoms = i;
+      break;
+    }
+
+    xyz = &out->coords[3 * i];
+    out->atomTypes[i] = atomType(p, end);
+    xyz[0] = parseFloat(p, end);
+    xyz[1] = parseFloat(p, end);
+    xyz[2] = parseFloat(p, end);
+    p = nextLine(p, end);
+  }
+}
+
+void* PlatoTrajectoryReader::prefetchLoop(void* userData) {
+  PlatoTrajectoryReader* ptr =
+    (PlatoTrajectoryReader*) ((ThreadInfoStruct*) userData)->UserData;
+  int target;
+  int slot;
+  int f;
+  int s;
+
+  while(true) {
+    sem_wait(&ptr->prefetchWake);
+
+    // keep decoding until the frames after the wanted one are all cached...
+    while(true) {
+      ptr->cacheLock->Lock();
+      if(ptr->prefetchDone) {
+	ptr->cacheLock->Unlock();
+	return VTK_THREAD_RETURN_VALUE;
+      }
+
+      target = -1;
+      for(f = ptr->wantedFrame + 1; target < 0 && f < ptr->numFrames &&
+	    f <= ptr->wantedFrame + PVS_TRAJ_PREFETCH; f++) {
+	target = f;
+	for(s = 0; s < PVS_TRAJ_PREFETCH; s++) {
+	  if(ptr->cacheState[s] != SLOT_EMPTY &&
+	     ptr->cache[s].frameNumber == f) {
+	    target = -1;
+	    break;
+	  }
+	}
+      }
+
+      // find a slot that is empty or holds a frame we've moved away from...
+      slot = -1;
+      for(s = 0; target >= 0 && slot < 0 && s < PVS_TRAJ_PREFETCH; s++) {
+	if(ptr->cacheState[s] == SLOT_EMPTY)
+	  slot = s;
+      }
+      for(s = 0; target >= 0 && slot < 0 && s < PVS_TRAJ_PREFETCH; s++) {
+	f = ptr->cache[s].frameNumber;
+	if(ptr->cacheState[s] == SLOT_READY && (f <= ptr->wantedFrame ||
+	   f > ptr->wantedFrame + PVS_TRAJ_PREFETCH))
+	  slot = s;
+      }
+
+      if(slot < 0) {
+	ptr->cacheLock->Unlock();
+	break;
+      }
+
+      ptr->cacheState[slot] = SLOT_BUSY;
+      ptr->cache[slot].frameNumber = target;
+      ptr->cacheLock->Unlock();
+
+      ptr->parseFrame(target, &ptr->cache[slot]);
+
+      ptr->cacheLock->Lock();
+      ptr->cacheState[slot] = SLOT_READY;
+      ptr->cacheLock->Unlock();
+    }
+  }
+}
+
+int PlatoTrajectoryReader::getNumberOfFrames() {
+  return numFrames;
+}
+
+int PlatoTrajectoryReader::getNumberOfAtoms() {
+  return numAtoms;
+}
+
+void PlatoTrajectoryReader::readFrame(int frame, PlatoXYZFrame* out) {
+  bool cached = false;
+
+  if(frame >= numFrames)
+    frame = numFrames - 1;
+  if(frame < 0)
+    frame = 0;
+
+  if(thread) {
+    // take the frame from the cache if the prefetcher got there first...
+    cacheLock->Lock();
+    for(int s = 0; s < PVS_TRAJ_PREFETCH; s++) {
+      if(cacheState[s] == SLOT_READY && cache[s].frameNumber == frame) {
+	out->swap(&cache[s]);
+	cacheState[s] = SLOT_EMPTY;
+	cached = true;
+	break;
+      }
+    }
+    wantedFrame = frame;
+    cacheLock->Unlock();
+
+    // start on the following frames while we deal with this one...
+    sem_post(&prefetchWake);
+  }
+
+  if(!cached)
+    parseFrame(frame, out);
+}
+
+float PlatoTrajectoryReader::getCovalentRadius(int type) {
+  if((type < 0) || (type >= numElements))
+    return defaultRadius;
+
+  return covalentRadii[type];
+}
@@ -31,12 +31,19 @@
 ---------------------------------------------------------------------------*/
 
 // vtk includes
+#include "vtkActor.h"
 #include "vtkActorCollection.h"
 #include "vtkLookupTable.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMutexLock.h"
 
 // plato includes
+#include "main.h"
+#include "PlatoPipelineWorker.h"
 #include "PlatoVTKPipeline.h"
 
+double PlatoVTKPipeline::releaseTime = PVS_RELEASE_IDLE * 1000.0;
+
 PlatoVTKPipeline::PlatoVTKPipeline() {
   // set up internal colour table...
   colourTable = vtkLookupTable::New();
@@ -60,10 +67,27 @@ PlatoVTKPipeline::~PlatoVTKPipeline() {
     colourTable->Delete();
 
   actors->Delete();
+  instances->Delete();
+  instanceSources->Delete();
+  updateLock->Delete();
 }
 
 void PlatoVTKPipeline::init() {
   actors = vtkActorCollection::New();
+  instances = vtkActorCollection::New();
+  instanceSources = vtkActorCollection::New();
+
+  worker = NULL;
+  updateLock = vtkMutexLock::New();
+  requestedGeneration = 0;
+  builtGeneration = 0;
+  shownGeneration = 0;
+  updating = false;
+  updateComplete = true;
+  builtTime = 0.0;
+  built = false;
+  released = false;
+  hiddenSince = 0.0;
 }
 
 vtkActorCollection* PlatoVTKPipeline::getActors() {
@@ -84,3 +108,266 @@ void PlatoVTKPipeline::setColourTable(vtkLookupTable* clut) {
 vtkLookupTable* PlatoVTKPipeline::getColourTable() {
   return colourTable;
 }
+
+void PlatoVTKPipeline::replicate(int* cells, double* cellVectors) {
+  int numActors = actors->GetNumberOfItems();
+  vtkActor** originals = new vtkActor*[numActors];
+  vtkMatrix4x4* translation = vtkMatrix4x4::New();
+
+  // take a copy of the actor list as the replicas get added to it...
+  for(int a = 0; a < numActors; a++)
+    originals[a] = (vtkActor*) actors->GetItemAsObject(a);
+
+  // every replica shares the geometry of the unit cell and is just moved
+  // into place...
+  for(int k = 0; k < cells[2]; k++) {
+    for(int j = 0; j < cells[1]; j++) {
+      for(int i = 0; i < cells[0]; i++) {
+	if(i == 0 && j == 0 && k == 0)
+	  continue;
+
+	translation->Identity();
+	for(int d = 0; d < 3; d++) {
+	  translation->SetElement(d, 3, (i * cellVectors[d]) +
+				  (j * cellVectors[3 + d]) +
+				  (k * cellVectors[6 + d]));
+	}
+	for(int a = 0; a < numActors; a++)
+	  instanceActor(originals[a], translation);
+      }
+    }
+  }
+
+  translation->Delete();
+  delete[] originals;
+}
+
+vtkActor* PlatoVTKPipeline::instanceActor(vtkActor* source,
+					  vtkMatrix4x4* matrix) {
+  vtkActor* instance = vtkActor::New();
+  vtkMatrix4x4* m = vtkMatrix4x4::New();
+
+  // an instance shares the mapper and properties of its source so the
+  // geometry is only ever built once...
+  instance->SetMapper(source->GetMapper());
+  instance->SetProperty(source->GetProperty());
+  instance->SetVisibility(source->GetVisibility());
+
+  // instances of instances stack their transforms...
+  if(source->GetUserMatrix())
+    vtkMatrix4x4::Multiply4x4(matrix, source->GetUserMatrix(), m);
+  else
+    m->DeepCopy(matrix);
+  instance->SetUserMatrix(m);
+  m->Delete();
+
+  // ...and track the visibility of the actor they were made from...
+  actors->AddItem(instance);
+  instances->AddItem(instance);
+  instanceSources->AddItem(source);
+  instance->Delete();
+
+  return instance;
+}
+
+void PlatoVTKPipeline::setActorVisibility(vtkActor* actor, bool toggle) {
+  actor->SetVisibility(toggle ? 1 : 0);
+
+  // instances of instances are followed down too...
+  vtkActor* instance;
+  for(int i = 0; i < instances->GetNumberOfItems(); i++) {
+    if(instanceSources->GetItemAsObject(i) == actor) {
+      instance = (vtkActor*) instances->GetItemAsObject(i);
+      setActorVisibility(instance, toggle);
+    }
+  }
+}
+
+void PlatoVTKPipeline::requestUpdate() {
+  // without a worker the changes are picked up by the next render...
+  if(!worker) {
+    prepare();
+    return;
+  }
+
+  // a new generation supersedes anything in flight...
+  updateLock->Lock();
+  requestedGeneration++;
+  if(updating)
+    setAbortUpdate(true);
+  updateLock->Unlock();
+
+  worker->schedule(this);
+}
+
+void PlatoVTKPipeline::configure() {
+}
+
+void PlatoVTKPipeline::executeUpdate() {
+}
+
+void PlatoVTKPipeline::setAbortUpdate(bool toggle) {
+}
+
+void PlatoVTKPipeline::swapBuffers() {
+}
+
+void PlatoVTKPipeline::attachBuffers() {
+}
+
+bool PlatoVTKPipeline::isDataStale() {
+  return false;
+}
+
+bool PlatoVTKPipeline::isWanted() {
+  return true;
+}
+
+void PlatoVTKPipeline::releaseData() {
+}
+
+bool PlatoVTKPipeline::prepare() {
+  // the filters aren't put together until there's something to show, and
+  // aren't run at all while there isn't...
+  if(!isWanted())
+    return false;
+
+  if(!built) {
+    buildPipeline();
+    built = true;
+  }
+  released = false;
+  configure();
+
+  return true;
+}
+
+void PlatoVTKPipeline::setWorker(PlatoPipelineWorker* w) {
+  // fill the buffers here so there's something to draw straight away...
+  if(prepare())
+    executeUpdate();
+  swapBuffers();
+
+  worker = w;
+  worker->addPipeline(this);
+  attachBuffers();
+}
+
+bool PlatoVTKPipeline::runUpdate() {
+  int generation;
+  bool wanted;
+
+  // called on the worker thread. The state and the filter settings are
+  // only touched under the lock, then the filters are left to run...
+  updateLock->Lock();
+  generation = requestedGeneration;
+  if(generation == builtGeneration) {
+    updateLock->Unlock();
+    return false;
+  }
+  wanted = prepare();
+  setAbortUpdate(false);
+  updating = true;
+  updateLock->Unlock();
+
+  if(wanted)
+    executeUpdate();
+
+  // if something changed while we were running the output is out of date
+  // (and may be incomplete if it was aborted) so another run is due...
+  bool current;
+  updateLock->Lock();
+  updating = false;
+  current = (generation == requestedGeneration);
+  updateComplete = current;
+  if(current) {
+    builtGeneration = generation;
+    builtTime = getTimeMillis();
+  }
+  updateLock->Unlock();
+
+  return current;
+}
+
+bool PlatoVTKPipeline::swapIfReady() {
+  bool swapped = false;
+
+  // called on the render thread between frames, never while the filters
+  // are running...
+  updateLock->Lock();
+  if(!updating && builtGeneration > shownGeneration) {
+    swapBuffers();
+    shownGeneration = builtGeneration;
+    swapped = true;
+  }
+  updateLock->Unlock();
+
+  return swapped;
+}
+
+void PlatoVTKPipeline::checkData() {
+  bool stale;
+
+  // new data is picked up once the current update is finished rather than
+  // aborting it, otherwise a fast enough stream would never be drawn...
+  updateLock->Lock();
+  stale = (!updating && requestedGeneration == builtGeneration &&
+	   isDataStale());
+  updateLock->Unlock();
+
+  if(stale)
+    requestUpdate();
+}
+
+void PlatoVTKPipeline::checkIdle(double now) {
+  // called on the render thread between frames. The outputs can only be
+  // let go of while the worker isn't using them, they're made again the
+  // next time they're shown...
+  updateLock->Lock();
+  if(!built || isWanted()) {
+    hiddenSince = 0.0;
+  }
+  else if(hiddenSince == 0.0) {
+    hiddenSince = now;
+  }
+  else if(releaseTime > 0.0 && !released && !updating &&
+	  (now - hiddenSince) >= releaseTime) {
+    releaseData();
+    released = true;
+  }
+  updateLock->Unlock();
+}
+
+int PlatoVTKPipeline::getRequestedGeneration() {
+  int generation;
+
+  updateLock->Lock();
+  generation = requestedGeneration;
+  updateLock->Unlock();
+
+  return generation;
+}
+
+int PlatoVTKPipeline::getShownGeneration() {
+  int generation;
+
+  updateLock->Lock();
+  generation = shownGeneration;
+  updateLock->Unlock();
+
+  return generation;
+}
+
+void PlatoVTKPipeline::setReleaseTime(double seconds) {
+  releaseTime = seconds * 1000.0;
+}
+
+double PlatoVTKPipeline::getBuiltTime() {
+  double time;
+
+  updateLock->Lock();
+  time = builtTime;
+  updateLock->Unlock();
+
+  return time;
+}
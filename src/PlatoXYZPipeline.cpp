@@ -32,15 +32,14 @@
 
 // vtk includes
 #include "vtkActorCollection.h"
-#include "vtkGlyph3D.h"
 #include "vtkActor.h"
 #include "vtkPolyDataMapper.h"
 #include "vtkProperty.h"
-#include "vtkSphereSource.h"
-#include "vtkTubeFilter.h"
-#include "vtkXYZMolReader.h"
 
 //plato includes
+#include "PlatoMoleculeGeometry.h"
+#include "PlatoProfiler.h"
+#include "PlatoTrajectoryReader.h"
 #include "PlatoXYZPipeline.h"
 
 PlatoXYZPipeline::PlatoXYZPipeline(char* filename) : PlatoVTKPipeline() {
@@ -51,20 +50,24 @@ PlatoXYZPipeline::PlatoXYZPipeline(char* filename) : PlatoVTKPipeline() {
 
   moleculeVisible = true;
   bondsVisible = true;
+  currentFrame = -1;
 
+  // the molecule is shown from the start so it's built straight away...
   init();
   buildPipeline();
+  built = true;
 }
 
 PlatoXYZPipeline::~PlatoXYZPipeline() {
   // remove actor from collection...
   actors->RemoveAllItems();
 
+  // delete the trajectory...
+  delete trajectory;
+  delete frame;
+  delete geometry;
+
   // delete all vtk objects...
-  xyzReader->Delete();
-  sphere->Delete();
-  atoms->Delete();
-  bonds->Delete();
   atomsMapper->Delete();
   bondsMapper->Delete();
   actorProperties->Delete();
@@ -73,11 +76,15 @@ PlatoXYZPipeline::~PlatoXYZPipeline() {
 }
 
 void PlatoXYZPipeline::init() {
+  // open the trajectory, which may only have the one frame...
+  trajectory = new PlatoTrajectoryReader(xyzFilename);
+  frame = new PlatoXYZFrame();
+
+  // atoms are spheres half the default size and bonds are 0.2 thick tubes,
+  // both updated in place as the atoms move...
+  geometry = new PlatoMoleculeGeometry(drawResolution, sphereScale, 0.2f);
+
   // allocate memory for all the vtk objects...
-  xyzReader = vtkXYZMolReader::New();
-  sphere = vtkSphereSource::New();
-  atoms = vtkGlyph3D::New();
-  bonds = vtkTubeFilter::New();
   atomsMapper = vtkPolyDataMapper::New();
   bondsMapper = vtkPolyDataMapper::New();
   actorProperties = vtkProperty::New();
@@ -90,6 +97,8 @@ void PlatoXYZPipeline::init() {
 }
 
 void PlatoXYZPipeline::buildPipeline() {
+  PlatoProfileScope scope("xyz.buildPipeline", PVS_PROF_BUILD);
+
   // set up actor properties...
   actorProperties->SetRepresentationToSurface();
   actorProperties->SetInterpolationToGouraud();
@@ -101,21 +110,10 @@ void PlatoXYZPipeline::buildPipeline() {
   actorProperties->SetColor(1.0, 1.0, 1.0);
 
   // load model...
-  xyzReader->SetFileName(xyzFilename);
-  numAtoms = xyzReader->GetNumberOfAtoms();
-
-  // create the atom glyph and the glyph itself...
-  sphere->SetThetaResolution(drawResolution);
-  sphere->SetPhiResolution(drawResolution);
-  atoms->SetInput(xyzReader->GetOutput());
-  atoms->SetOrient(1);
-  atoms->SetColorMode(1);
-  atoms->SetScaleMode(2);
-  atoms->SetScaleFactor(sphereScale);
-  atoms->SetSource(sphere->GetOutput());
+  loadFrame(0);
 
   // colour the atoms...
-  atomsMapper->SetInput(atoms->GetOutput());
+  atomsMapper->SetInput(geometry->getAtoms());
   atomsMapper->SetImmediateModeRendering(1);
   atomsMapper->UseLookupTableScalarRangeOff();
   atomsMapper->SetScalarVisibility(1);
@@ -125,16 +123,8 @@ void PlatoXYZPipeline::buildPipeline() {
   atomsActor->SetMapper(atomsMapper);
   atomsActor->SetProperty(actorProperties);
 
-  // create the tube glyph for the bonds...
-  bonds->SetInput(xyzReader->GetOutput());
-  bonds->SetNumberOfSides(drawResolution);
-  bonds->SetCapping(0);
-  bonds->SetRadius(0.2);
-  bonds->SetVaryRadius(0);
-  bonds->SetRadiusFactor(10);
-
   // colour the bonds...
-  bondsMapper->SetInput(bonds->GetOutput());
+  bondsMapper->SetInput(geometry->getBonds());
   bondsMapper->SetImmediateModeRendering(1);
   bondsMapper->UseLookupTableScalarRangeOff();
   bondsMapper->SetScalarVisibility(1);
@@ -145,6 +135,17 @@ void PlatoXYZPipeline::buildPipeline() {
   bondsActor->SetProperty(actorProperties);
 }
 
+void PlatoXYZPipeline::loadFrame(int f) {
+  PlatoProfileScope scope("xyz.loadFrame", PVS_PROF_MOLECULE);
+
+  trajectory->readFrame(f, frame);
+  currentFrame = frame->frameNumber;
+  numAtoms = frame->numAtoms;
+
+  // only the atoms that moved since the last frame are touched...
+  geometry->update(frame);
+}
+
 vtkActor* PlatoXYZPipeline::getAtomsActor() {
   return atomsActor;
 }
@@ -153,14 +154,18 @@ vtkActor* PlatoXYZPipeline::getBondsActor() {
   return bondsActor;
 }
 
+PlatoXYZFrame* PlatoXYZPipeline::getAtomFrame() {
+  return frame;
+}
+
 void PlatoXYZPipeline::setMoleculeVisible(bool toggle) {
   // toggle the atoms...
   moleculeVisible = toggle;
-  toggle ? atomsActor->SetVisibility(1) : atomsActor->SetVisibility(0);
+  setActorVisibility(atomsActor, toggle);
 
   // if needs be, toggle the bonds...
   if(bondsVisible) {
-    toggle ? bondsActor->SetVisibility(1) : bondsActor->SetVisibility(0);
+    setActorVisibility(bondsActor, toggle);
   }
 }
 
@@ -171,7 +176,7 @@ void PlatoXYZPipeline::setBondsVisible(bool toggle) {
 
   // toggle the bonds...
   bondsVisible = toggle;
-  toggle ? bondsActor->SetVisibility(1) : bondsActor->SetVisibility(0);
+  setActorVisibility(bondsActor, toggle);
 }
 
 bool PlatoXYZPipeline::isMoleculeVisible() {
@@ -185,3 +190,18 @@ bool PlatoXYZPipeline::isBondsVisible() {
 
   return bondsVisible;
 }
+
+void PlatoXYZPipeline::setFrame(int f) {
+  if(f == currentFrame)
+    return;
+
+  loadFrame(f);
+}
+
+int PlatoXYZPipeline::getFrame() {
+  return currentFrame;
+}
+
+int PlatoXYZPipeline::getNumberOfFrames() {
+  return trajectory->getNumberOfFrames();
+}
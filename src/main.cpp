@@ -35,6 +35,7 @@
 #include <cstring>
 #include <iostream>
 #include <semaphore.h>
+#include <sys/time.h>
 
 // vtk includes...
 #include "vtkCommand.h"
@@ -47,10 +48,25 @@
 
 // plato includes...
 #include "main.h"
+#include "PlatoBatchScript.h"
+#include "PlatoCommandQueue.h"
 #include "PlatoDataReader.h"
+#include "PlatoDataSource.h"
+#include "PlatoDataStream.h"
+#include "PlatoFrameServer.h"
 #include "PlatoIsoPipeline.h"
+#include "PlatoLatencyTracer.h"
 #include "PlatoOrthoPipeline.h"
+#include "PlatoPipelineWorker.h"
+#include "PlatoProfiler.h"
 #include "PlatoRenderWindow.h"
+#include "PlatoRhoLoader.h"
+#include "PlatoShmRing.h"
+#include "PlatoStartup.h"
+#include "PlatoSteeringSession.h"
+#include "PlatoSymmetry.h"
+#include "PlatoTaskPool.h"
+#include "PlatoVTKPipeline.h"
 #include "PlatoXYZPipeline.h"
 #include "realitygrid.h"
 
@@ -60,49 +76,160 @@ volatile bool regLoopDone = false;
 vtkMutexLock* renderLock;
 vtkMutexLock* loopLock;
 sem_t regDone;
+sem_t regWake;
 
 int main(int argc, char** argv) {
   vtkMultiThreader* thread;
   threadData* td;
+  PlatoPipelineWorker* worker;
+  PlatoDataSource* source = NULL;
+  PlatoFrameServer* frames = NULL;
+  PlatoLatencyTracer* tracer = NULL;
 
   // parse options...
   OptionsData* options = new OptionsData();
   parseOptions(argc, argv, options);
 
-  // create vtk window...
-  char windowTitle[100];
-  sprintf(windowTitle, "Plato Visualization System (%s)", PVS_BIN_NAME);
-  PlatoRenderWindow* prw = new PlatoRenderWindow(options->useSteering, windowTitle);
+  // start profiling before anything is read so that gets timed too...
+  if(options->profileFile)
+    PlatoProfiler::start(options->profileFile);
 
-  PlatoXYZPipeline* xyz = NULL;
-  if(options->xyzFilename) {
-    xyz = new PlatoXYZPipeline(options->xyzFilename);
-    prw->addPipeline(xyz);
-  }
+  // every data-parallel stage shares the one set of threads...
+  PlatoTaskPool::start(options->numThreads, options->affinity);
 
-  PlatoDataReader* pdr;
-  PlatoIsoPipeline* pip;
-  PlatoOrthoPipeline* pop;
-  if(options->rhoFilename) {
-    pdr = new PlatoDataReader(options->rhoFilename);
-    pip = new PlatoIsoPipeline(pdr);
-    for(int i = 0; i < options->numIsos; i++)
-      pip->setIsoVisible(i, true);
-    pip->setIsoCutter(options->useCutplane);
-    pop = new PlatoOrthoPipeline(pdr);
-    pop->setOrthoslice(options->useOrthoslice);
-    prw->addPipeline(pip);
-    prw->addPipeline(pop);
+  // steering and streamed data both change things from other threads...
+  bool threaded = (options->useSteering || options->useReGIO ||
+		   options->shmName != NULL || options->useProgressive);
+
+  // create vtk window, offscreen if we're running a batch or replaying a
+  // steering session...
+  bool batch = (options->batchScript != NULL);
+  bool offscreen = (batch || options->replayFile != NULL);
+  char windowTitle[100];
+  sprintf(windowTitle, "Plato Visualization System (%s)", PVS_BIN_NAME);
+  PlatoRenderWindow* prw = new PlatoRenderWindow(threaded, offscreen,
+						 windowTitle);
+  if(options->frameTime > 0.0)
+    prw->setFrameTime(options->frameTime);
+
+  // the symmetry can only be found from the atoms...
+  bool autoSymmetry = (options->symmetryFilename &&
+		       strcmp(options->symmetryFilename, "auto") == 0);
+  if(autoSymmetry && !options->xyzFilename) {
+    std::cerr << "Finding the symmetry needs an XYZFILE.\n\n";
+    usage();
+    exit(1);
   }
 
   // if we're not using realitygrid stuff we can ignore all this...
-  if(options->useSteering) {
+  worker = NULL;
+  if(threaded) {
     // initialise thread stuff...
     renderLock = vtkMutexLock::New();
     loopLock = vtkMutexLock::New();
     sem_init(&regDone, 0, 0);
+    sem_init(&regWake, 0, 0);
     thread = vtkMultiThreader::New();
 
+    // steering changes and new frames are contoured in the background
+    // while the window keeps drawing the last complete surfaces. A batch
+    // wants every image complete so it updates them as it renders...
+    if(!batch)
+      worker = new PlatoPipelineWorker(prw);
+  }
+
+  // the pipelines only build and run their filters for what's shown, so
+  // an orthoslice that's never turned on costs next to nothing...
+  PlatoVTKPipeline::setReleaseTime(options->releaseIdle);
+
+  if(options->shmName)
+    source = new PlatoShmRing(options->shmName);
+  else if(options->useReGIO)
+    source = new PlatoDataStream(options->listenAddress,
+				 options->streamPort);
+  else if(options->useProgressive && options->rhoFilename)
+    source = new PlatoRhoLoader(options->rhoFilename);
+  bool density = (source || options->rhoFilename);
+
+  // the molecule and the density are read side by side, then the
+  // isosurfaces and the orthoslice are built from the density one after
+  // the other as they share it. Replicating the molecule needs the cell
+  // and finding the symmetry needs the molecule...
+  startupData sd;
+  sd.options = options;
+  sd.source = source;
+  sd.dataReader = NULL;
+  sd.xyzPipeline = NULL;
+  sd.isoPipeline = NULL;
+  sd.orthoPipeline = NULL;
+  sd.worker = worker;
+
+  int* sc = options->supercell;
+  PlatoStartup* startup = new PlatoStartup();
+  int densityStage = -1;
+  int moleculeStage = -1;
+  int isoStage = -1;
+  int orthoStage = -1;
+  if(density)
+    densityStage = startup->addStage("density", loadDensity, &sd);
+  if(options->xyzFilename) {
+    moleculeStage = startup->addStage("molecule", loadMolecule, &sd);
+    if(density && (sc[0] * sc[1] * sc[2]) > 1)
+      startup->addDependency(moleculeStage, densityStage);
+  }
+  if(density) {
+    isoStage = startup->addStage("isosurfaces", buildIsosurfaces, &sd);
+    startup->addDependency(isoStage, densityStage);
+    if(autoSymmetry)
+      startup->addDependency(isoStage, moleculeStage);
+    orthoStage = startup->addStage("orthoslice", buildOrthoslice, &sd);
+    startup->addDependency(orthoStage, isoStage);
+  }
+
+  // each part goes into the window as soon as it's ready, so there's
+  // something to look at while the rest is still loading. Without a
+  // display it's all just waited for...
+  int stage;
+  startup->start();
+  while((stage = startup->nextFinished(offscreen ? -1.0 : PVS_STARTUP_TICK))
+	!= PVS_STARTUP_DONE) {
+    if(stage == moleculeStage)
+      prw->addPipeline(sd.xyzPipeline);
+    else if(stage == isoStage)
+      prw->addPipeline(sd.isoPipeline);
+    else if(stage == orthoStage)
+      prw->addPipeline(sd.orthoPipeline);
+    if(!offscreen) {
+      if(stage != PVS_STARTUP_WAITING)
+	prw->resetCamera();
+      prw->setStatus(startup->getProgress());
+      prw->render(false);
+    }
+  }
+  delete startup;
+  if(!offscreen) {
+    prw->setStatus(NULL);
+    prw->render(false);
+  }
+
+  PlatoXYZPipeline* xyz = sd.xyzPipeline;
+  PlatoDataReader* pdr = sd.dataReader;
+  PlatoIsoPipeline* pip = sd.isoPipeline;
+  PlatoOrthoPipeline* pop = sd.orthoPipeline;
+
+  // send what's drawn to a remote viewer...
+  if(options->publishPort) {
+    frames = new PlatoFrameServer(options->listenAddress,
+				  options->publishPort);
+    frames->start(prw);
+    prw->setFrameServer(frames);
+  }
+
+  // new frames can come in now there's something to put them in...
+  if(threaded && source)
+    source->start(prw);
+
+  if(options->useSteering) {
     // initialise and start the RealityGrid loop...
     td = new threadData;
     td->window = prw;
@@ -110,11 +237,46 @@ int main(int argc, char** argv) {
     td->xyzPipeline = xyz;
     td->isoPipeline = pip;
     td->orthoPipeline = pop;
+    td->commands = new PlatoCommandQueue();
+    prw->setCommandQueue(td->commands, applyCommand, td);
+
+    // follow each change through to the screen...
+    tracer = new PlatoLatencyTracer(options->latencyTarget);
+    prw->setLatencyTracer(tracer);
+
+    // the changes can be kept to be played back later without a client,
+    // when how long each one took is wanted too...
+    td->session = new PlatoSteeringSession();
+    if(options->recordFile)
+      td->session->record(options->recordFile);
+    if(options->replayFile) {
+      td->session->replay(options->replayFile, options->replayFast);
+      td->session->setLatencyTracer(tracer);
+      tracer->setVerbose(true);
+    }
     thread->SpawnThread(regLoop, td);
   }
 
-  // start the vtk interactor (this blocks the main thread)...
-  prw->start();
+  // start the vtk interactor (this blocks the main thread), or work
+  // through the batch script...
+  if(batch) {
+    threadData batchData;
+    batchData.window = prw;
+    batchData.dataReader = pdr;
+    batchData.xyzPipeline = xyz;
+    batchData.isoPipeline = pip;
+    batchData.orthoPipeline = pop;
+    batchData.commands = NULL;
+    batchData.session = NULL;
+
+    PlatoBatchScript* batch = new PlatoBatchScript(options->batchScript,
+						   prw, &batchData);
+    batch->run();
+    delete batch;
+  }
+  else {
+    prw->start();
+  }
   
   if(options->useSteering) {
     // the interactor is finished so tell the loop to finish...
@@ -122,20 +284,40 @@ int main(int argc, char** argv) {
     regLoopDone = true;
     loopLock->Unlock();
 
-    // wait for it to finish...
+    // wake it if it's between polls and wait for it to finish...
+    sem_post(&regWake);
     sem_wait(&regDone);
   }
+  if(source)
+    source->stop();
+  if(frames)
+    frames->stop();
+  if(tracer)
+    tracer->printStats();
+  if(options->useSteering)
+    td->session->printStats();
 
   // clean up everything...
   if(options->useSteering) {
+    delete td->session;
+    delete td->commands;
+    delete td;
+  }
+  if(threaded) {
+    if(worker)
+      delete worker;
     thread->Delete();
     sem_destroy(&regDone);
+    sem_destroy(&regWake);
     renderLock->Delete();
     loopLock->Delete();
-    delete td;
   }
 
   delete prw;
+  if(frames)
+    delete frames;
+  if(tracer)
+    delete tracer;
   if(xyz)
     delete xyz;
   if(pop)
@@ -144,31 +326,115 @@ int main(int argc, char** argv) {
     delete pip;
   if(pdr)
     delete pdr;
+  if(source)
+    delete source;
 
+  if(options->profileFile)
+    PlatoTaskPool::getPool()->printStats();
+  PlatoTaskPool::finish();
+  PlatoProfiler::finish();
   delete options;
 
   return 0;
 }
 
 void renderCallback(vtkObject* obj, unsigned long eid, void* cd, void* calld) {
-  bool render;
+  // only used when the window can't wait on the steering pipe itself...
+  ((PlatoRenderWindow*) cd)->processRenderRequest();
 
-  renderLock->Lock();
-  render = reRender;
-  renderLock->Unlock();
+  // reset the timer on the interactor...
+  ((vtkRenderWindowInteractor*) obj)->CreateTimer(VTKI_TIMER_UPDATE);
+}
+
+double getTimeMillis() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  return (now.tv_sec * 1000.0) + (now.tv_usec / 1000.0);
+}
+
+void loadMolecule(void* data) {
+  startupData* sd = (startupData*) data;
+  int* sc = sd->options->supercell;
 
-  if(render) {
-    // render via the interactor...
-    ((vtkRenderWindowInteractor*) obj)->Render();
+  sd->xyzPipeline = new PlatoXYZPipeline(sd->options->xyzFilename);
 
-    // reset reRender...
-    renderLock->Lock();
-    reRender = false;
-    renderLock->Unlock();
+  // the replicas have to be made before the actors go into the window...
+  if(sd->dataReader && (sc[0] * sc[1] * sc[2]) > 1)
+    sd->xyzPipeline->replicate(sc, sd->dataReader->getCellVectors());
+}
+
+void loadDensity(void* data) {
+  startupData* sd = (startupData*) data;
+
+  if(sd->source) {
+    // the grid isn't known until the simulation sends something...
+    sd->source->waitForFirstFrame();
+    sd->dataReader = new PlatoDataReader(sd->source);
+  }
+  else {
+    sd->dataReader = new PlatoDataReader(sd->options->rhoFilename);
   }
 
-  // reset the timer on the interactor...
-  ((vtkRenderWindowInteractor*) obj)->CreateTimer(VTKI_TIMER_UPDATE);
+  // a grid that isn't periodic only reaches as far as its last sample...
+  sd->dataReader->setPeriodic(sd->options->usePeriodic);
+
+  // new frames are taken by the worker for every pipeline at once...
+  if(sd->worker)
+    sd->worker->setDataReader(sd->dataReader);
+}
+
+void buildIsosurfaces(void* data) {
+  startupData* sd = (startupData*) data;
+  OptionsData* options = sd->options;
+  PlatoDataReader* pdr = sd->dataReader;
+  int* sc = options->supercell;
+
+  PlatoIsoPipeline* pip = new PlatoIsoPipeline(pdr);
+  for(int i = 0; i < options->numIsos; i++)
+    pip->setIsoVisible(i, true);
+  pip->setIsoCutter(options->useCutplane);
+
+  // close the gap at the cell boundary of uniform grids...
+  pip->setPeriodic(options->usePeriodic);
+
+  // only contour the part of the cell that the symmetry doesn't give
+  // us for free...
+  if(options->symmetryFilename) {
+    PlatoSymmetry* sym = new PlatoSymmetry(pdr);
+    if(strcmp(options->symmetryFilename, "auto") == 0)
+      sym->detectOperations(sd->xyzPipeline->getAtomFrame());
+    else
+      sym->readOperations(options->symmetryFilename);
+    if(sym->buildWedge())
+      pip->setSymmetry(sym);
+    delete sym;
+  }
+
+  // replicate the unit cell if asked to...
+  if((sc[0] * sc[1] * sc[2]) > 1)
+    pip->replicate(sc, pdr->getCellVectors());
+
+  // the first surfaces are made here, off the render thread...
+  if(sd->worker)
+    pip->setWorker(sd->worker);
+  sd->isoPipeline = pip;
+}
+
+void buildOrthoslice(void* data) {
+  startupData* sd = (startupData*) data;
+  OptionsData* options = sd->options;
+  PlatoDataReader* pdr = sd->dataReader;
+  int* sc = options->supercell;
+
+  PlatoOrthoPipeline* pop = new PlatoOrthoPipeline(pdr);
+  pop->setOrthoslice(options->useOrthoslice);
+  pop->setPeriodic(options->usePeriodic);
+  if((sc[0] * sc[1] * sc[2]) > 1)
+    pop->replicate(sc, pdr->getCellVectors());
+  if(sd->worker)
+    pop->setWorker(sd->worker);
+  sd->orthoPipeline = pop;
 }
 
 void parseOptions(int argc, char* argv[], OptionsData* options) {
@@ -203,8 +469,32 @@ void parseOptions(int argc, char* argv[], OptionsData* options) {
 	shortOptDone = (argStr[j+1] == '\0');
 	nextArgStr = (((argNum + 1) < argc) ? argv[argNum + 1] : NULL);
 
-	if(shortOpt == 'c' || (isLongOpt = strcmp("--cut", argv[argNum])) == 0)
+	if((isLongOpt = strcmp("--affinity", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->affinity = nextArgStr;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No cpus given for the task pool.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if(shortOpt == 'c' || (isLongOpt = strcmp("--cut", argv[argNum])) == 0)
 	  options->useCutplane = true;
+	else if((isLongOpt = strcmp("--frame-time", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->frameTime = atof(nextArgStr);
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Frame time not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
 	else if(shortOpt == 'h' || (isLongOpt = strcmp("--help", argv[argNum])) == 0)
 	  showHelp = true;
 	else if(shortOpt == 'i' || (isLongOpt = strcmp("--isosurfaces", argv[argNum])) == 0) {
@@ -221,8 +511,95 @@ void parseOptions(int argc, char* argv[], OptionsData* options) {
 	    exit(1);
 	  }
 	}
+	else if((isLongOpt = strcmp("--latency-target", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->latencyTarget = atof(nextArgStr);
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Latency target not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--listen", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->listenAddress = nextArgStr;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Listen address not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--no-periodic", argv[argNum])) == 0)
+	  options->usePeriodic = false;
 	else if(shortOpt == 'o' || (isLongOpt = strcmp("--ortho", argv[argNum])) == 0)
 	  options->useOrthoslice = true;
+	else if((isLongOpt = strcmp("--offscreen", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->batchScript = nextArgStr;
+	    options->useSteering = false;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No filename supplied for SCRIPT.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--port", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->streamPort = atoi(nextArgStr);
+	    if(options->streamPort < 1 || options->streamPort > 65535) {
+	      cerr << "Bad port number: " << nextArgStr << "\n\n";
+	      usage();
+	      exit(1);
+	    }
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Port number not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--profile", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->profileFile = nextArgStr;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No filename supplied for the profile.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--progressive", argv[argNum])) == 0)
+	  options->useProgressive = true;
+	else if((isLongOpt = strcmp("--publish", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->publishPort = atoi(nextArgStr);
+	    if(options->publishPort < 1 || options->publishPort > 65535) {
+	      cerr << "Bad port number: " << nextArgStr << "\n\n";
+	      usage();
+	      exit(1);
+	    }
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Publish port number not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
 	else if((shortOpt == 'r' && shortOptDone) || (isLongOpt = strcmp("--rho", argv[argNum])) == 0) {
 	  if(nextArgStr) {
 	    options->rhoFilename = nextArgStr;
@@ -237,6 +614,104 @@ void parseOptions(int argc, char* argv[], OptionsData* options) {
 	}
 	else if(shortOpt == 'R' || (isLongOpt = strcmp("--reg-io", argv[argNum])) == 0)
 	  options->useReGIO = true;
+	else if((isLongOpt = strcmp("--record", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->recordFile = nextArgStr;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No filename supplied for the steering session.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--release-idle", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->releaseIdle = atof(nextArgStr);
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Idle time not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--replay", argv[argNum])) == 0 || (isLongOpt = strcmp("--replay-fast", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->replayFile = nextArgStr;
+	    options->replayFast = (strcmp("--replay-fast", argv[argNum]) == 0);
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No filename supplied for the steering session.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((shortOpt == 's' && shortOptDone) || (isLongOpt = strcmp("--supercell", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    int* sc = options->supercell;
+	    int n = sscanf(nextArgStr, "%dx%dx%d", &sc[0], &sc[1], &sc[2]);
+	    if(n == 1)
+	      sc[1] = sc[2] = sc[0];
+	    if((n != 1 && n != 3) || sc[0] < 1 || sc[1] < 1 || sc[2] < 1) {
+	      cerr << "Bad supercell size: " << nextArgStr << "\n\n";
+	      usage();
+	      exit(1);
+	    }
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Supercell size not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--shm", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->shmName = nextArgStr;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No shared memory name supplied.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--symmetry", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->symmetryFilename = nextArgStr;
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "No filename supplied for SYMFILE.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
+	else if((isLongOpt = strcmp("--threads", argv[argNum])) == 0) {
+	  if(nextArgStr) {
+	    options->numThreads = atoi(nextArgStr);
+	    if(options->numThreads < 1) {
+	      cerr << "Bad number of threads: " << nextArgStr << "\n\n";
+	      usage();
+	      exit(1);
+	    }
+	    argNum++;
+	    break;
+	  }
+	  else {
+	    cerr << "Number of threads not specified.\n\n";
+	    usage();
+	    exit(1);
+	  }
+	}
 	else if((isLongOpt = strcmp("--view-only", argv[argNum])) == 0 || (isLongOpt = strcmp("--no-steering", argv[argNum])) == 0)
 	  options->useSteering = false;
 	else if(shortOpt == 'v' || (isLongOpt = strcmp("--version", argv[argNum])) == 0)
@@ -280,7 +755,31 @@ void parseOptions(int argc, char* argv[], OptionsData* options) {
     exit(0);
 
   // check that all required options are present...
-  if(!options->rhoFilename) {
+  if(!options->rhoFilename && !options->useReGIO && !options->shmName) {
+    usage();
+    exit(1);
+  }
+
+  // a session can only be replayed in place of the steering library...
+  if(options->replayFile && (!options->useSteering || options->recordFile)) {
+    cerr << "A steering session can't be replayed with --offscreen, ";
+    cerr << "--record or\n--view-only.\n\n";
+    usage();
+    exit(1);
+  }
+
+  // a batch wants the finished density in every image...
+  if(options->useProgressive && options->batchScript) {
+    cerr << "Progressive loading can't be used with --offscreen.\n\n";
+    usage();
+    exit(1);
+  }
+
+  // the images of a cell only meet up if the gap at its boundary is
+  // filled in...
+  int* sc = options->supercell;
+  if(!options->usePeriodic && (sc[0] * sc[1] * sc[2]) > 1) {
+    cerr << "A supercell can't be shown with --no-periodic.\n\n";
     usage();
     exit(1);
   }
@@ -296,16 +795,62 @@ void usage() {
   using std::cout;
 
   cout << "Usage: " << PVS_BIN_NAME << " [options]\nOptions:\n";
+  cout << "      --affinity CPUS\tPin the task pool threads to CPUS, e.g.";
+  cout << " \"0-3,8-11\".\n";
   cout << "  -c, --cut\t\tEnable a cut plane through the data.\n";
+  cout << "      --frame-time MS\tDraw simpler versions of things while";
+  cout << " moving the\n\t\t\tcamera to keep frames under MS ms (default ";
+  cout << PVS_FRAME_TIME << ",\n\t\t\t0 to always draw everything).\n";
   cout << "  -h, --help\t\tPrint this message and exit.\n";
   cout << "  -i N, --isosurfaces N\n\t\t\tThe number of visible isosurfaces";
   cout << " on startup.\n";
+  cout << "      --latency-target MS\n\t\t\tWarn about steering changes";
+  cout << " that take more than MS ms\n\t\t\tto reach the screen.\n";
+  cout << "      --listen ADDRESS\n\t\t\tAccept streamed data and frame";
+  cout << " clients on the\n\t\t\tinterface with ADDRESS (default ";
+  cout << PVS_LISTEN_ADDRESS << ",\n\t\t\t0.0.0.0 for all of them).\n";
+  cout << "      --no-periodic\tDon't treat uniform grids as periodic.\n";
   cout << "  -o, --ortho\t\tEnable an orthoslice through the data.\n";
-  cout << "  -r RHOFILE, --rho RHOFILE\n\t\t\tInput rho file for viewing.\n";
-  cout << "  -R, --reg-io\t\tGet data from a RealityGrid socket.\n";
+  cout << "      --offscreen SCRIPT\n\t\t\tRender without a display, writing";
+  cout << " images as told by\n\t\t\tSCRIPT. Needs vtk built with offscreen";
+  cout << " Mesa.\n";
+  cout << "      --port N\t\tListen on port N for streamed data (default ";
+  cout << PVS_STREAM_PORT << ").\n";
+  cout << "      --profile FILE\tTime each stage of reading, updating and";
+  cout << "\n\t\t\tdrawing into FILE as JSON lines, or as a Chrome";
+  cout << "\n\t\t\ttrace if FILE ends in .json.\n";
+  cout << "      --progressive\tShow a coarse version of a uniform RHOFILE";
+  cout << " first and\n\t\t\trefine it as the rest is read.\n";
+  cout << "      --publish PORT\tSend compressed frames to a pvs-view client";
+  cout << "\n\t\t\ton PORT (eg " << PVS_FRAME_PORT << ").\n";
+  cout << "  -r RHOFILE, --rho RHOFILE\n\t\t\tInput rho file for viewing, which";
+  cout << " may be gzip\n\t\t\tor zstd compressed.\n";
+  cout << "  -R, --reg-io\t\tGet data frames streamed from a running";
+  cout << " simulation\n\t\t\tinstead of a RHOFILE.\n";
+  cout << "      --record FILE\tWrite every steering change to FILE so it";
+  cout << " can be\n\t\t\treplayed later.\n";
+  cout << "      --release-idle SECONDS\n\t\t\tFree the filter outputs of";
+  cout << " anything that's\n\t\t\tbeen hidden for SECONDS (default ";
+  cout << PVS_RELEASE_IDLE << ",\n\t\t\t0 to keep everything).\n";
+  cout << "      --replay FILE\tReplay the steering changes in FILE at the";
+  cout << " speed\n\t\t\tthey were made, without a display or client,";
+  cout << "\n\t\t\tprinting how long each took to draw.\n";
+  cout << "      --replay-fast FILE\n\t\t\tAs --replay, but make each";
+  cout << " change as soon as the\n\t\t\tone before is on the screen.\n";
+  cout << "  -s NxMxK, --supercell NxMxK\n\t\t\tShow an NxMxK block of";
+  cout << " periodic images of the cell.\n";
+  cout << "      --shm NAME\tGet data frames from the shared memory ring NAME";
+  cout << "\n\t\t\tmade by a simulation on the same node.\n";
+  cout << "      --symmetry SYMFILE\n\t\t\tOnly contour the part of the cell not";
+  cout << " given by the\n\t\t\tsymmetry operations in SYMFILE (\"x,-y,z\"";
+  cout << " per line),\n\t\t\tor found from the XYZFILE if SYMFILE is";
+  cout << " \"auto\".\n";
+  cout << "      --threads N\tUse N threads for reading, contouring and";
+  cout << " writing\n\t\t\timages (default one per core).\n";
   cout << "  -v, --version\t\tPrint the version number and exit.\n";
   cout << "      --view-only, --no-steering\n\t\t\tUse " << PVS_BIN_NAME;
   cout << " as a viewer only - no interface control.\n";
-  cout << "  -x XYZFILE, --xyz XYZFILE\n\t\t\tInput xyz file for viewing.\n";
+  cout << "  -x XYZFILE, --xyz XYZFILE\n\t\t\tInput xyz file for viewing, which";
+  cout << " may be gzip\n\t\t\tor zstd compressed.\n";
   cout << "\nReport bugs to <www.kato.mvc.mcc.ac.uk/bugzilla>\n";
 }
@@ -31,9 +31,11 @@
 ---------------------------------------------------------------------------*/
 
 // system includes...
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <ctime>
 #include <semaphore.h>
 #include <unistd.h>
 
@@ -46,13 +48,28 @@
 
 // plato includes...
 #include "main.h"
+#include "PlatoCommandQueue.h"
 #include "PlatoDataReader.h"
 #include "PlatoIsoPipeline.h"
+#include "PlatoLatencyTracer.h"
 #include "PlatoOrthoPipeline.h"
+#include "PlatoProfiler.h"
 #include "PlatoRenderWindow.h"
+#include "PlatoSteeringSession.h"
+#include "PlatoTaskPool.h"
 #include "PlatoXYZPipeline.h"
 #include "realitygrid.h"
 
+// the steering library is polled quickly while things are changing and
+// backs off to the slow rate when they're not (in milliseconds). Building
+// with both set to 200 gives the old fixed poll, to compare against...
+#ifndef PVS_REG_MIN_INTERVAL
+#define PVS_REG_MIN_INTERVAL 10
+#endif
+#ifndef PVS_REG_MAX_INTERVAL
+#define PVS_REG_MAX_INTERVAL 200
+#endif
+
 void regInit() {
   Steering_enable(REG_TRUE);
   int cmds[] = {REG_STR_STOP};
@@ -69,17 +86,30 @@ void* regLoop(void* userData) {
   char** recvdCmdParams;
   bool done;
   bool needRefresh = false;
+  int interval = PVS_REG_MIN_INTERVAL;
+  double changeTime;
+  struct timespec wakeTime;
 
   // params to be registered...
   int mVis;
   int bVis;
+  int frame;
   double isoValue[PVS_MAX_ISOS];
   int isoVis[PVS_MAX_ISOS];
   int orthoslice;
   int cutplane;
 
+  // monitored params, only there when profiling...
+  double stageTime[PVS_PROF_STAGES];
+  int triangles;
+  double memory;
+  double poolBusy;
+  double workerBusy[PVS_POOL_MAX_THREADS];
+
   // thread data...
   threadData* td = (threadData*) ((ThreadInfoStruct*) userData)->UserData;
+  PlatoLatencyTracer* tracer = td->window->getLatencyTracer();
+  PlatoSteeringSession* session = td->session;
 
   // allocate memory...
   changedParamLabels = Alloc_string_array(REG_MAX_STRING_LENGTH,
@@ -87,17 +117,29 @@ void* regLoop(void* userData) {
   recvdCmdParams = Alloc_string_array(REG_MAX_STRING_LENGTH,
 				      REG_MAX_NUM_STR_CMDS);
 
-  // initialise steering library...
-  regInit();
+  // initialise steering library, unless a session is being replayed in
+  // its place...
+  if(!session->isReplaying())
+    regInit();
 
   // register params...
   if(td->xyzPipeline) {
     ((PlatoXYZPipeline*) td->xyzPipeline)->isMoleculeVisible() ? mVis = 1 : mVis = 0;
-    status = Register_param("Molecule visible?", REG_TRUE, (void*) &mVis,
-			    REG_INT, "0", "1");
+    status = session->registerParam("Molecule visible?", REG_TRUE, (void*) &mVis,
+				    REG_INT, "0", "1");
     ((PlatoXYZPipeline*) td->xyzPipeline)->isBondsVisible() ? bVis = 1 : bVis = 0;
-    status = Register_param("Bonds visible?", REG_TRUE, (void*) &bVis,
-			    REG_INT, "0", "1");
+    status = session->registerParam("Bonds visible?", REG_TRUE, (void*) &bVis,
+				    REG_INT, "0", "1");
+
+    // only trajectories get a frame to steer...
+    int numFrames = ((PlatoXYZPipeline*) td->xyzPipeline)->getNumberOfFrames();
+    if(numFrames > 1) {
+      char frameMax[12];
+      snprintf(frameMax, 12, "%d", numFrames - 1);
+      frame = ((PlatoXYZPipeline*) td->xyzPipeline)->getFrame();
+      status = session->registerParam("Frame", REG_TRUE, (void*) &frame,
+				      REG_INT, "0", frameMax);
+    }
   }
 
   double* isoRange = ((PlatoDataReader*) td->dataReader)->getDataRange();
@@ -109,23 +151,43 @@ void* regLoop(void* userData) {
   for(int i = 0; i < PVS_MAX_ISOS; i++) {
     snprintf(isoLabel, 20, "Iso %d visible?", i);
     ((PlatoIsoPipeline*) td->isoPipeline)->isIsoVisible(i) ? isoVis[i] = 1 : isoVis[i] = 0;
-    status = Register_param(isoLabel, REG_TRUE, (void*) &isoVis[i],
-			    REG_INT, "0", "1");
+    status = session->registerParam(isoLabel, REG_TRUE, (void*) &isoVis[i],
+				    REG_INT, "0", "1");
     snprintf(isoLabel, 20, "Iso %d value", i);
     isoValue[i] = ((PlatoIsoPipeline*) td->isoPipeline)->getIsoValue(i);
-    status = Register_param(isoLabel, REG_TRUE, (void*) &isoValue[i],
-			    REG_DBL, isoMin, isoMax);
+    status = session->registerParam(isoLabel, REG_TRUE, (void*) &isoValue[i],
+				    REG_DBL, isoMin, isoMax);
   }
 
   ((PlatoOrthoPipeline*) td->orthoPipeline)->isOrthosliceOn() ? orthoslice = 1
     : orthoslice = 0;
-  status = Register_param("Orthoslice?", REG_TRUE, (void*) &orthoslice,
-			  REG_INT, "0", "1");
+  status = session->registerParam("Orthoslice?", REG_TRUE, (void*) &orthoslice,
+				  REG_INT, "0", "1");
 
   ((PlatoIsoPipeline*) td->isoPipeline)->isIsoCutterOn() ? cutplane = 1 :
     cutplane = 0;
-  status = Register_param("Cut-plane?", REG_TRUE, (void*) &cutplane,
-			  REG_INT, "0", "1");
+  status = session->registerParam("Cut-plane?", REG_TRUE, (void*) &cutplane,
+				  REG_INT, "0", "1");
+
+  // the latest time taken by each stage can be watched from the client...
+  bool profiling = PlatoProfiler::isEnabled();
+  if(profiling) {
+    for(int i = 0; i < PVS_PROF_STAGES; i++) {
+      stageTime[i] = 0.0;
+      status = session->registerParam(PlatoProfiler::getStageName(i),
+				      REG_FALSE, (void*) &stageTime[i],
+				      REG_DBL, "", "");
+    }
+    triangles = 0;
+    status = session->registerParam("Contour triangles", REG_FALSE,
+				    (void*) &triangles, REG_INT, "", "");
+    memory = 0.0;
+    status = session->registerParam("Memory (MB)", REG_FALSE, (void*) &memory,
+				    REG_DBL, "", "");
+    poolBusy = PlatoTaskPool::getPool()->sampleUtilisation(NULL);
+    status = session->registerParam("Task pool busy (%)", REG_FALSE,
+				    (void*) &poolBusy, REG_DBL, "", "");
+  }
 
   loopLock->Lock();
   done = regLoopDone;
@@ -133,23 +195,54 @@ void* regLoop(void* userData) {
 
   // go into loop until told to finish...
   while(!done) {
-    // sleep for 0.2 seconds...
-    usleep(200000);
+    // wait until the next poll is due or we're told to finish...
+    clock_gettime(CLOCK_REALTIME, &wakeTime);
+    wakeTime.tv_nsec += (interval % 1000) * 1000000L;
+    wakeTime.tv_sec += (interval / 1000) + (wakeTime.tv_nsec / 1000000000L);
+    wakeTime.tv_nsec %= 1000000000L;
+    if(sem_timedwait(&regWake, &wakeTime) == 0)
+      break;
+
+    // monitored params are sent with every call...
+    if(profiling) {
+      for(int i = 0; i < PVS_PROF_STAGES; i++)
+	stageTime[i] = PlatoProfiler::getStageTime(i);
+      // the triangles drawn are what come out of the normals filter...
+      triangles = (int) PlatoProfiler::getStageTriangles(PVS_PROF_NORMALS);
+      memory = PlatoProfiler::getLastResident() / 1024.0;
+
+      // how busy each worker has been since the last poll goes in the
+      // profile too...
+      PlatoTaskPool* pool = PlatoTaskPool::getPool();
+      poolBusy = pool->sampleUtilisation(workerBusy);
+      PlatoProfiler::recordCounters("pool.busy", workerBusy,
+				    pool->getNumWorkers());
+    }
 
-    status = Steering_control(l, &numParamsChanged, changedParamLabels,
+    status = session->control(l, &numParamsChanged, changedParamLabels,
 			      &numRecvdCmds, recvdCmds, recvdCmdParams);
+    changeTime = session->getChangeTime();
 
     if(status != REG_SUCCESS) {
       std::cerr << "Call to Steering_control failed...\n";
       continue;
     }
 
-    // deal with commands from steering library...
+    // more changes tend to follow a change. A real speed replay is polled
+    // just like the library so that it waits as long, one as fast as
+    // possible has nothing to wait for...
+    if(numParamsChanged > 0 || numRecvdCmds > 0 || session->isReplayingFast())
+      interval = PVS_REG_MIN_INTERVAL;
+    else if(interval < PVS_REG_MAX_INTERVAL)
+      interval = std::min(interval * 2, PVS_REG_MAX_INTERVAL);
+
+    // nothing is changed from here, the changes are queued up for the
+    // render thread to make between frames...
     for(int i = 0; i < numRecvdCmds; i++) {
       switch(recvdCmds[i]) {
       case REG_STR_STOP:
-	//td->window->getInteractor()->InvokeEvent(vtkCommand::ExitEvent);
-	td->window->exit();
+	queueCommand(td, PVS_CMD_STOP, 0, 0.0);
+	needRefresh = true;
 	break;
       }
     }
@@ -158,26 +251,47 @@ void* regLoop(void* userData) {
     for(int i = 0; i < numParamsChanged; i++) {
       if(strstr(changedParamLabels[i], "Molecule") || 
 	 strstr(changedParamLabels[i], "Bonds")) {
-	moleculeVisibility((PlatoXYZPipeline*) td->xyzPipeline, mVis, bVis);
+	queueCommand(td, PVS_CMD_MOLECULE_VISIBLE, 0, mVis);
+	queueCommand(td, PVS_CMD_BONDS_VISIBLE, 0, bVis);
+	if(tracer)
+	  tracer->receive(PVS_TRACE_MOLECULE, td->xyzPipeline, changeTime);
+	needRefresh = true;
+	continue;
+      }
+
+      if(!strcmp(changedParamLabels[i], "Frame")) {
+	queueCommand(td, PVS_CMD_FRAME, 0, frame);
+	if(tracer)
+	  tracer->receive(PVS_TRACE_FRAME, td->xyzPipeline, changeTime);
 	needRefresh = true;
 	continue;
       }
 
       if(!strncmp(changedParamLabels[i], "Iso", 3)) {
-	isoChanged((PlatoIsoPipeline*) td->isoPipeline,
-		   changedParamLabels[i], isoValue, isoVis);
+	int iso = strtol(&changedParamLabels[i][4], NULL, 10);
+	queueCommand(td, PVS_CMD_ISO_VISIBLE, iso, isoVis[iso]);
+	queueCommand(td, PVS_CMD_ISO_VALUE, iso, isoValue[iso]);
+	if(tracer) {
+	  tracer->receive(strstr(changedParamLabels[i], "value") ?
+			  PVS_TRACE_ISO_VALUE : PVS_TRACE_ISO_VISIBLE,
+			  td->isoPipeline, changeTime);
+	}
 	needRefresh = true;
 	continue;
       }
 
       if(!strcmp(changedParamLabels[i], "Orthoslice?")) {
-	toggleOrthoslice((PlatoOrthoPipeline*) td->orthoPipeline, orthoslice);
+	queueCommand(td, PVS_CMD_ORTHOSLICE, 0, orthoslice);
+	if(tracer)
+	  tracer->receive(PVS_TRACE_ORTHOSLICE, td->orthoPipeline, changeTime);
 	needRefresh = true;
 	continue;
       }
 
       if(!strcmp(changedParamLabels[i], "Cut-plane?")) {
-	toggleCutplane((PlatoIsoPipeline*) td->isoPipeline, cutplane);
+	queueCommand(td, PVS_CMD_CUTPLANE, 0, cutplane);
+	if(tracer)
+	  tracer->receive(PVS_TRACE_CUTPLANE, td->isoPipeline, changeTime);
 	needRefresh = true;
 	continue;
       }
@@ -185,9 +299,7 @@ void* regLoop(void* userData) {
 
     // tell the interactor to render if needs be...
     if(needRefresh) {
-      renderLock->Lock();
-      reRender = true;
-      renderLock->Unlock();
+      td->window->requestRender();
       needRefresh = false;
     }
 
@@ -201,29 +313,82 @@ void* regLoop(void* userData) {
   }
 
   // clean up steering library...
-  regFinalise();
+  if(!session->isReplaying())
+    regFinalise();
 
   // tell main thread that this one is done...
   sem_post(&regDone);
 }
 
-void moleculeVisibility(PlatoXYZPipeline* xyz, int mVis, int bVis) {
+void queueCommand(threadData* td, int type, int index, double value) {
+  bool done = false;
+
+  // if the queue is full wait for the render thread to empty it, unless
+  // it has already stopped...
+  while(!td->commands->push(type, index, value) && !done) {
+    td->window->requestRender();
+    usleep(1000);
+    loopLock->Lock();
+    done = regLoopDone;
+    loopLock->Unlock();
+  }
+}
+
+void applyCommand(PlatoCommand* cmd, void* data) {
+  threadData* td = (threadData*) data;
+  int toggle = (int) cmd->value;
+
+  // this runs on the render thread, between frames...
+  switch(cmd->type) {
+  case PVS_CMD_STOP:
+    td->window->exit();
+    break;
+  case PVS_CMD_MOLECULE_VISIBLE:
+    moleculeVisibility((PlatoXYZPipeline*) td->xyzPipeline, toggle);
+    break;
+  case PVS_CMD_BONDS_VISIBLE:
+    bondsVisibility((PlatoXYZPipeline*) td->xyzPipeline, toggle);
+    break;
+  case PVS_CMD_FRAME:
+    changeFrame((PlatoXYZPipeline*) td->xyzPipeline, toggle);
+    break;
+  case PVS_CMD_ISO_VISIBLE:
+    isoVisibility((PlatoIsoPipeline*) td->isoPipeline, cmd->index, toggle);
+    break;
+  case PVS_CMD_ISO_VALUE:
+    isoChanged((PlatoIsoPipeline*) td->isoPipeline, cmd->index, cmd->value);
+    break;
+  case PVS_CMD_ORTHOSLICE:
+    toggleOrthoslice((PlatoOrthoPipeline*) td->orthoPipeline, toggle);
+    break;
+  case PVS_CMD_CUTPLANE:
+    toggleCutplane((PlatoIsoPipeline*) td->isoPipeline, toggle);
+    break;
+  }
+}
+
+void moleculeVisibility(PlatoXYZPipeline* xyz, int mVis) {
   std::cout << "Molecule state changed...\n";
   (mVis == 1) ? xyz->setMoleculeVisible(true) : xyz->setMoleculeVisible(false);
+}
+
+void bondsVisibility(PlatoXYZPipeline* xyz, int bVis) {
+  std::cout << "Bonds state changed...\n";
   (bVis == 1) ? xyz->setBondsVisible(true) : xyz->setBondsVisible(false);
 }
 
-void isoChanged(PlatoIsoPipeline* pip, const char* label,
-		double* values, int* visible) {
-  int iso = strtol(&label[4], NULL, 10);
-  std::cout << "Iso " << iso << " changed: " << values[iso] << std::endl;
-  if(visible[iso] == 1) {
-    pip->setIsoVisible(iso, true);
-    pip->setIsoValue(iso, values[iso]);
-  }
-  else {
-    pip->setIsoVisible(iso, false);
-  }
+void changeFrame(PlatoXYZPipeline* xyz, int frame) {
+  std::cout << "Frame changed: " << frame << std::endl;
+  xyz->setFrame(frame);
+}
+
+void isoVisibility(PlatoIsoPipeline* pip, int iso, int visible) {
+  (visible == 1) ? pip->setIsoVisible(iso, true) : pip->setIsoVisible(iso, false);
+}
+
+void isoChanged(PlatoIsoPipeline* pip, int iso, double value) {
+  std::cout << "Iso " << iso << " changed: " << value << std::endl;
+  pip->setIsoValue(iso, value);
 }
 
 void toggleOrthoslice(PlatoOrthoPipeline* pop, int toggle) {
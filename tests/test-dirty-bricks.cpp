@@ -0,0 +1,139 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// checks that a change to a single brick of a streamed grid is seen by
+// the planes that pass through it, including the cells it shares with the
+// brick before it and, for the first brick, with the periodic boundary...
+
+// system includes...
+#include <cstdlib>
+#include <iostream>
+
+// plato includes...
+#include "PlatoDataReader.h"
+#include "PlatoDataSource.h"
+
+#define PVS_TEST_DIMS 63
+#define PVS_TEST_BRICK 8
+
+// a cubic grid that changes one brick along x each frame...
+class PlatoTestSource : public PlatoDataSource {
+
+ private:
+  int dims[3];
+  double cell[9];
+  float* values;
+  int numBricks;
+  unsigned char* dirty;
+
+ public:
+  PlatoTestSource() {
+    for(int i = 0; i < 3; i++)
+      dims[i] = PVS_TEST_DIMS;
+    for(int i = 0; i < 9; i++)
+      cell[i] = (i % 4 == 0) ? 10.0 : 0.0;
+    values = new float[PVS_TEST_DIMS * PVS_TEST_DIMS * PVS_TEST_DIMS];
+    for(int i = 0; i < PVS_TEST_DIMS * PVS_TEST_DIMS * PVS_TEST_DIMS; i++)
+      values[i] = 0.0f;
+    int edge = (PVS_TEST_DIMS + PVS_TEST_BRICK - 1) / PVS_TEST_BRICK;
+    numBricks = edge * edge * edge;
+    dirty = new unsigned char[numBricks];
+  }
+  ~PlatoTestSource() {
+    delete[] values;
+    delete[] dirty;
+  }
+
+  // the x index of the brick the next frame changes, in the first row...
+  void change(int brick) {
+    for(int i = 0; i < numBricks; i++)
+      dirty[i] = 0;
+    dirty[brick] = 1;
+  }
+
+  void waitForFirstFrame() {}
+  void start(PlatoRenderWindow*) {}
+  void stop() {}
+  int* getDataDimensions() { return dims; }
+  double* getCellVectors() { return cell; }
+  float* getFrontBuffer() { return values; }
+  int getFrameNumber() { return 0; }
+  bool isFrameWaiting() { return true; }
+  bool acquireFrame() { return true; }
+  int getBrickSize() { return PVS_TEST_BRICK; }
+  const unsigned char* getDirtyBricks() { return dirty; }
+};
+
+static int failures = 0;
+
+static void check(PlatoDataReader* reader, PlatoTestSource* source,
+		  int brick, double at, bool expected) {
+  // a plane across x at the fraction of the cell given...
+  double origin[3];
+  double normal[3] = {1.0, 0.0, 0.0};
+  for(int i = 0; i < 3; i++)
+    origin[i] = at * reader->getCellVectors()[i];
+
+  source->change(brick);
+  reader->acquireFrame();
+  bool dirty = reader->isPlaneDirty(origin, normal,
+				    reader->getDataStamp() - 1);
+
+  std::cout << (dirty == expected ? "ok" : "FAIL") << ": brick " << brick;
+  std::cout << " changed, plane at " << at << " is ";
+  std::cout << (dirty ? "dirty" : "clean") << std::endl;
+  if(dirty != expected)
+    failures++;
+}
+
+int main(int argc, char** argv) {
+  PlatoTestSource* source = new PlatoTestSource();
+  PlatoDataReader* reader = new PlatoDataReader(source);
+
+  // brick 4 starts at point 32, the plane runs through the cells between
+  // points 31 and 32...
+  check(reader, source, 4, 0.5, true);
+  check(reader, source, 3, 0.5, true);
+  check(reader, source, 2, 0.5, false);
+  check(reader, source, 5, 0.5, false);
+
+  // past the last point is the image of the first...
+  double last = (PVS_TEST_DIMS - 0.5) / PVS_TEST_DIMS;
+  check(reader, source, 0, last, true);
+  check(reader, source, 7, last, true);
+  check(reader, source, 6, last, false);
+
+  delete reader;
+  delete source;
+
+  return (failures == 0) ? 0 : 1;
+}
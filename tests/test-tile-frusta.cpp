@@ -0,0 +1,105 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// checks that the tiles of a big image cover every pixel of it once, and
+// that the view of each, side by side, is exactly the view of the whole
+// image whether or not the image is a whole number of tiles...
+
+// system includes...
+#include <cmath>
+#include <iostream>
+
+// plato includes...
+#include "PlatoTiledRenderer.h"
+
+#define PVS_TEST_TOLERANCE 1.0e-9
+
+static const double viewAngles[] = {1.0, 10.0, 30.0, 60.0, 90.0, 150.0};
+static const int imageSizes[] = {1, 7, 100, 1000, 1023, 1024, 1025, 3001,
+				 4096, 9999};
+
+// the tiles of one axis of an image, in the tangent of the angle from the
+// view direction, as the tiled renderer sets them up...
+static bool checkTiles(double angle, int imageSize, int tiles) {
+  int tileSize = (imageSize + tiles - 1) / tiles;
+  double whole = tan(angle * M_PI / 360.0);
+  double half = tan(PlatoTiledRenderer::getTileViewAngle(angle, tileSize,
+							 imageSize) *
+		    M_PI / 360.0);
+  int next = 0;
+
+  for(int t = 0; t < tiles; t++) {
+    int first = t * tileSize;
+    int pixels = PlatoTiledRenderer::getTilePixels(t, tileSize, imageSize);
+    if(pixels <= 0)
+      continue;
+
+    // each tile takes up where the last one stopped...
+    if(first != next)
+      return false;
+    next = first + pixels;
+
+    // and its window sees exactly its pixels of the whole view, the part
+    // hanging over the edge of the image included...
+    double centre = PlatoTiledRenderer::getTileCentre(first, tileSize,
+						      imageSize) * half;
+    double low = whole * ((2.0 * first / imageSize) - 1.0);
+    double high = whole * ((2.0 * (first + tileSize) / imageSize) - 1.0);
+    if(fabs((centre - half) - low) > PVS_TEST_TOLERANCE * whole ||
+       fabs((centre + half) - high) > PVS_TEST_TOLERANCE * whole)
+      return false;
+  }
+
+  return (next == imageSize);
+}
+
+int main(int argc, char** argv) {
+  int failures = 0;
+
+  for(int a = 0; a < 6; a++) {
+    for(int i = 0; i < 10; i++) {
+      for(int tiles = 1; tiles <= 16; tiles++) {
+	if(!checkTiles(viewAngles[a], imageSizes[i], tiles)) {
+	  std::cout << "FAIL: " << tiles << " tiles don't cover ";
+	  std::cout << imageSizes[i] << " pixels of a " << viewAngles[a];
+	  std::cout << " degree view" << std::endl;
+	  failures++;
+	}
+      }
+    }
+  }
+
+  if(failures == 0)
+    std::cout << "ok: tiles cover the image at every size and angle\n";
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,656 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// makes test data bigger than the shipped sets: a rho file (and an xyz
+// file of the atoms it came from) for any lattice, grid, number of atoms
+// and mesh type. The density is a sum of a gaussian on every atom, made by
+// a pool of threads a block at a time and written in order as it's made,
+// so only a few blocks are ever held and multi-GB files don't wait on one
+// core...
+
+// system includes...
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+// the gaussians are cut off at this many widths...
+#define GEN_CUTOFF 4.0
+
+// the atoms per block of an atom centred mesh...
+#define GEN_ATOM_BLOCK 256
+
+// the blocks in flight for each thread...
+#define GEN_BLOCKS_PER_THREAD 2
+
+// where a block has got to...
+#define GEN_BLOCK_FREE 0
+#define GEN_BLOCK_BUSY 1
+#define GEN_BLOCK_DONE 2
+
+static const char* elements[] = {
+  "H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne", "Na", "Mg", "Al",
+  "Si", "P", "S", "Cl", "Ar", "K", "Ca", "Sc", "Ti", "V", "Cr", "Mn", "Fe",
+  "Co", "Ni", "Cu", "Zn", "Ga", "Ge", "As", "Se", "Br", "Kr"
+};
+
+// a block of formatted output, made by one thread and written by the
+// main one...
+struct GenBlock {
+  int index;
+  int state;
+  std::vector<char> text;
+};
+
+struct GenState {
+  // the lattice vectors as rows, in angstroms, and the inverse to take
+  // points back to fractions of them...
+  double cell[9];
+  double inverse[9];
+  double sigma;
+  double cutoff;
+
+  int numAtoms;
+  double* atoms;
+  double* fractions;
+
+  // atoms binned by fractional position, at least a cutoff wide...
+  int bins[3];
+  std::vector<int> binHead;
+  std::vector<int> binNext;
+
+  // the mesh...
+  bool uniform;
+  int dims[3];
+  int pointsPerAtom;
+  double* offsets;
+
+  // the blocks, taken in order by the workers...
+  int numBlocks;
+  int nextBlock;
+  int written;
+  int numSlots;
+  GenBlock* slots;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+};
+
+static double now() {
+  struct timeval t;
+  gettimeofday(&t, NULL);
+
+  return t.tv_sec + (t.tv_usec / 1000000.0);
+}
+
+static void genUsage() {
+  using std::cout;
+
+  cout << "Usage: pvs-gen [options] NAME\n";
+  cout << "Writes NAME.rho and NAME.xyz.\nOptions:\n";
+  cout << "  -a N\t\t\tThe number of atoms (default 64).\n";
+  cout << "  -c CELL\t\tThe lattice in angstroms, one length for a cube,";
+  cout << " three\n\t\t\tfor a box or nine for the vectors, comma";
+  cout << " separated\n\t\t\t(default 20).\n";
+  cout << "  -e SYMBOL\t\tThe element of the atoms (default C).\n";
+  cout << "  -g NxMxK\t\tThe size of a uniform grid, or N for NxNxN";
+  cout << "\n\t\t\t(default 64).\n";
+  cout << "  -m MESH\t\t\"uniform\" or \"atoms\" for an atom centred";
+  cout << " mesh\n\t\t\t(default uniform).\n";
+  cout << "  -p N\t\t\tThe points around each atom of an atom centred";
+  cout << " mesh\n\t\t\t(default 100).\n";
+  cout << "  -s SEED\t\tWhere to start the random numbers (default 1).\n";
+  cout << "  -t N\t\t\tThe number of threads (default one per core).\n";
+  cout << "  -w WIDTH\t\tThe width of the gaussians in angstroms";
+  cout << " (default 0.5).\n";
+}
+
+// a small generator of our own so the same seed gives the same atoms
+// everywhere...
+static unsigned long long randomState;
+
+static double nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 7;
+  randomState ^= randomState << 17;
+
+  return (randomState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void invert(const double* m, double* inv) {
+  double det = m[0] * ((m[4] * m[8]) - (m[5] * m[7])) -
+    m[1] * ((m[3] * m[8]) - (m[5] * m[6])) +
+    m[2] * ((m[3] * m[7]) - (m[4] * m[6]));
+
+  if(fabs(det) < 1.0e-12) {
+    std::cerr << "The lattice vectors don't make a cell.\n";
+    exit(1);
+  }
+
+  inv[0] = ((m[4] * m[8]) - (m[5] * m[7])) / det;
+  inv[1] = ((m[2] * m[7]) - (m[1] * m[8])) / det;
+  inv[2] = ((m[1] * m[5]) - (m[2] * m[4])) / det;
+  inv[3] = ((m[5] * m[6]) - (m[3] * m[8])) / det;
+  inv[4] = ((m[0] * m[8]) - (m[2] * m[6])) / det;
+  inv[5] = ((m[2] * m[3]) - (m[0] * m[5])) / det;
+  inv[6] = ((m[3] * m[7]) - (m[4] * m[6])) / det;
+  inv[7] = ((m[1] * m[6]) - (m[0] * m[7])) / det;
+  inv[8] = ((m[0] * m[4]) - (m[1] * m[3])) / det;
+}
+
+// fractions of the lattice vectors from a point and back again...
+static void toFractions(const GenState* gen, const double* x, double* f) {
+  for(int a = 0; a < 3; a++) {
+    f[a] = (x[0] * gen->inverse[a]) + (x[1] * gen->inverse[3 + a]) +
+      (x[2] * gen->inverse[6 + a]);
+  }
+}
+
+static void toPoint(const GenState* gen, const double* f, double* x) {
+  for(int a = 0; a < 3; a++) {
+    x[a] = (f[0] * gen->cell[a]) + (f[1] * gen->cell[3 + a]) +
+      (f[2] * gen->cell[6 + a]);
+  }
+}
+
+static void placeAtoms(GenState* gen) {
+  // spread them over a jittered lattice so none sit on top of each
+  // other, picking which sites get an atom at random...
+  int side = 1;
+  while(side * side * side < gen->numAtoms)
+    side++;
+  int numSites = side * side * side;
+  std::vector<int> sites(numSites);
+  for(int i = 0; i < numSites; i++)
+    sites[i] = i;
+
+  gen->atoms = new double[3 * gen->numAtoms];
+  gen->fractions = new double[3 * gen->numAtoms];
+  for(int n = 0; n < gen->numAtoms; n++) {
+    int pick = n + (int) (nextRandom() * (numSites - n));
+    std::swap(sites[n], sites[pick]);
+    int s[3] = {sites[n] % side, (sites[n] / side) % side,
+		sites[n] / (side * side)};
+
+    double* f = &gen->fractions[3 * n];
+    for(int a = 0; a < 3; a++) {
+      f[a] = (s[a] + 0.5 + (0.3 * (nextRandom() - 0.5))) / side;
+      f[a] -= floor(f[a]);
+    }
+    toPoint(gen, f, &gen->atoms[3 * n]);
+  }
+}
+
+static void binAtoms(GenState* gen) {
+  // a bin is at least a cutoff across in every direction, the width of
+  // the cell across each pair of faces is its volume over their area...
+  const double* c = gen->cell;
+  double volume = fabs(c[0] * ((c[4] * c[8]) - (c[5] * c[7])) -
+		       c[1] * ((c[3] * c[8]) - (c[5] * c[6])) +
+		       c[2] * ((c[3] * c[7]) - (c[4] * c[6])));
+  for(int a = 0; a < 3; a++) {
+    const double* u = &c[3 * ((a + 1) % 3)];
+    const double* v = &c[3 * ((a + 2) % 3)];
+    double cross[3] = {(u[1] * v[2]) - (u[2] * v[1]),
+		       (u[2] * v[0]) - (u[0] * v[2]),
+		       (u[0] * v[1]) - (u[1] * v[0])};
+    double area = sqrt((cross[0] * cross[0]) + (cross[1] * cross[1]) +
+		       (cross[2] * cross[2]));
+    gen->bins[a] = (int) ((volume / area) / gen->cutoff);
+    if(gen->bins[a] < 1)
+      gen->bins[a] = 1;
+  }
+
+  gen->binHead.assign(gen->bins[0] * gen->bins[1] * gen->bins[2], -1);
+  gen->binNext.assign(gen->numAtoms, -1);
+  for(int n = 0; n < gen->numAtoms; n++) {
+    const double* f = &gen->fractions[3 * n];
+    int b[3];
+    for(int a = 0; a < 3; a++)
+      b[a] = std::min((int) (f[a] * gen->bins[a]), gen->bins[a] - 1);
+    int bin = b[0] + (gen->bins[0] * (b[1] + (gen->bins[1] * b[2])));
+    gen->binNext[n] = gen->binHead[bin];
+    gen->binHead[bin] = n;
+  }
+}
+
+// the density at a point, from the nearest image of every atom within
+// the cutoff...
+static double density(const GenState* gen, const double* x) {
+  double f[3];
+  int low[3];
+  int high[3];
+  double scale = 1.0 / (2.0 * gen->sigma * gen->sigma);
+  double cutoff2 = gen->cutoff * gen->cutoff;
+  double value = 0.0;
+
+  toFractions(gen, x, f);
+  for(int a = 0; a < 3; a++) {
+    f[a] -= floor(f[a]);
+    int b = std::min((int) (f[a] * gen->bins[a]), gen->bins[a] - 1);
+
+    // with fewer than three bins the neighbours would be visited twice...
+    if(gen->bins[a] < 3) {
+      low[a] = 0;
+      high[a] = gen->bins[a] - 1;
+    }
+    else {
+      low[a] = b - 1;
+      high[a] = b + 1;
+    }
+  }
+
+  for(int k = low[2]; k <= high[2]; k++) {
+    int bk = (k + gen->bins[2]) % gen->bins[2];
+    for(int j = low[1]; j <= high[1]; j++) {
+      int bj = (j + gen->bins[1]) % gen->bins[1];
+      for(int i = low[0]; i <= high[0]; i++) {
+	int bi = (i + gen->bins[0]) % gen->bins[0];
+	int bin = bi + (gen->bins[0] * (bj + (gen->bins[1] * bk)));
+
+	for(int n = gen->binHead[bin]; n >= 0; n = gen->binNext[n]) {
+	  double d[3];
+	  double r[3];
+	  for(int a = 0; a < 3; a++) {
+	    d[a] = f[a] - gen->fractions[(3 * n) + a];
+	    d[a] -= floor(d[a] + 0.5);
+	  }
+	  toPoint(gen, d, r);
+	  double r2 = (r[0] * r[0]) + (r[1] * r[1]) + (r[2] * r[2]);
+	  if(r2 < cutoff2)
+	    value += exp(-r2 * scale);
+	}
+      } // i
+    } // j
+  } // k
+
+  return value;
+}
+
+static void appendText(std::vector<char>* text, const char* format,
+		       double a, double b = 0.0, double c = 0.0,
+		       double d = 0.0) {
+  char line[128];
+  int length = snprintf(line, 128, format, a, b, c, d);
+  text->insert(text->end(), line, line + length);
+}
+
+static void makeBlock(const GenState* gen, int index,
+		      std::vector<char>* text) {
+  double f[3];
+  double x[3];
+
+  text->clear();
+
+  // a uniform grid is written a plane at a time, x fastest, five to a
+  // line as it always has been...
+  if(gen->uniform) {
+    int k = index;
+    long perPlane = (long) gen->dims[0] * gen->dims[1];
+    long n = k * perPlane;
+    f[2] = (double) k / gen->dims[2];
+    for(int j = 0; j < gen->dims[1]; j++) {
+      f[1] = (double) j / gen->dims[1];
+      for(int i = 0; i < gen->dims[0]; i++) {
+	f[0] = (double) i / gen->dims[0];
+	toPoint(gen, f, x);
+	appendText(text, (++n % 5) ? "%.6e " : "%.6e\n", density(gen, x));
+      }
+    }
+    return;
+  }
+
+  // ...an atom centred mesh a few atoms at a time, each point in
+  // angstroms with its value...
+  int first = index * GEN_ATOM_BLOCK;
+  int last = std::min(first + GEN_ATOM_BLOCK, gen->numAtoms);
+  for(int n = first; n < last; n++) {
+    for(int p = 0; p < gen->pointsPerAtom; p++) {
+      for(int a = 0; a < 3; a++)
+	x[a] = gen->atoms[(3 * n) + a] + gen->offsets[(3 * p) + a];
+      appendText(text, "%18.10f %18.10f %18.10f %.9e\n", x[0], x[1], x[2],
+		 density(gen, x));
+    }
+  }
+}
+
+static void* genWorker(void* data) {
+  GenState* gen = (GenState*) data;
+
+  while(true) {
+    // take the next block once its slot has been written out...
+    pthread_mutex_lock(&gen->lock);
+    int index = gen->nextBlock;
+    if(index >= gen->numBlocks) {
+      pthread_mutex_unlock(&gen->lock);
+      break;
+    }
+    gen->nextBlock++;
+    GenBlock* slot = &gen->slots[index % gen->numSlots];
+    while(slot->state != GEN_BLOCK_FREE)
+      pthread_cond_wait(&gen->changed, &gen->lock);
+    slot->state = GEN_BLOCK_BUSY;
+    slot->index = index;
+    pthread_mutex_unlock(&gen->lock);
+
+    makeBlock(gen, index, &slot->text);
+
+    pthread_mutex_lock(&gen->lock);
+    slot->state = GEN_BLOCK_DONE;
+    pthread_cond_broadcast(&gen->changed);
+    pthread_mutex_unlock(&gen->lock);
+  }
+
+  return NULL;
+}
+
+static void makeOffsets(GenState* gen) {
+  // shells of points out to the cutoff, closer together near the atom,
+  // with the directions on each shell spread out on a spiral...
+  int numShells = (int) ceil(sqrt(gen->pointsPerAtom / 4.0));
+  int perShell = (gen->pointsPerAtom + numShells - 1) / numShells;
+  double golden = M_PI * (3.0 - sqrt(5.0));
+
+  gen->offsets = new double[3 * gen->pointsPerAtom];
+  for(int p = 0; p < gen->pointsPerAtom; p++) {
+    int shell = p / perShell;
+    int q = p % perShell;
+    double radius = gen->cutoff * pow((shell + 0.5) / numShells, 2.0);
+    double z = 1.0 - ((2.0 * q + 1.0) / perShell);
+    double r = sqrt(1.0 - (z * z));
+    double phi = (golden * q) + shell;
+
+    gen->offsets[(3 * p)] = radius * r * cos(phi);
+    gen->offsets[(3 * p) + 1] = radius * r * sin(phi);
+    gen->offsets[(3 * p) + 2] = radius * z;
+  }
+}
+
+static void writeXYZ(const GenState* gen, const char* filename,
+		     const char* symbol) {
+  FILE* out = fopen(filename, "w");
+  if(!out) {
+    std::cerr << "Could not write file: " << filename << std::endl;
+    exit(1);
+  }
+
+  fprintf(out, "%d\nmade by pvs-gen\n", gen->numAtoms);
+  for(int n = 0; n < gen->numAtoms; n++) {
+    fprintf(out, "%-2s %16.8f %16.8f %16.8f\n", symbol, gen->atoms[3 * n],
+	    gen->atoms[(3 * n) + 1], gen->atoms[(3 * n) + 2]);
+  }
+
+  if(fclose(out) != 0) {
+    std::cerr << "Could not write file: " << filename << std::endl;
+    exit(1);
+  }
+}
+
+static void writeRho(GenState* gen, const char* filename, int numThreads) {
+  double bohr = 0.529177;
+
+  FILE* out = fopen(filename, "w");
+  if(!out) {
+    std::cerr << "Could not write file: " << filename << std::endl;
+    exit(1);
+  }
+
+  // the cell is in bohr, then the mesh type...
+  for(int i = 0; i < 3; i++) {
+    fprintf(out, "%14.8f %14.8f %14.8f\n", gen->cell[3 * i] / bohr,
+	    gen->cell[(3 * i) + 1] / bohr, gen->cell[(3 * i) + 2] / bohr);
+  }
+  if(gen->uniform) {
+    fprintf(out, "0 0\n%d %d %d\n", gen->dims[0], gen->dims[1],
+	    gen->dims[2]);
+    gen->numBlocks = gen->dims[2];
+  }
+  else {
+    fprintf(out, "0 1\n%ld\n", (long) gen->numAtoms * gen->pointsPerAtom);
+    gen->numBlocks = (gen->numAtoms + GEN_ATOM_BLOCK - 1) / GEN_ATOM_BLOCK;
+  }
+
+  gen->nextBlock = 0;
+  gen->written = 0;
+  gen->numSlots = numThreads * GEN_BLOCKS_PER_THREAD;
+  gen->slots = new GenBlock[gen->numSlots];
+  for(int i = 0; i < gen->numSlots; i++)
+    gen->slots[i].state = GEN_BLOCK_FREE;
+  pthread_mutex_init(&gen->lock, NULL);
+  pthread_cond_init(&gen->changed, NULL);
+
+  pthread_t* threads = new pthread_t[numThreads];
+  for(int t = 0; t < numThreads; t++)
+    pthread_create(&threads[t], NULL, genWorker, gen);
+
+  // write the blocks out in order as they're finished...
+  bool failed = false;
+  for(int index = 0; index < gen->numBlocks; index++) {
+    GenBlock* slot = &gen->slots[index % gen->numSlots];
+
+    pthread_mutex_lock(&gen->lock);
+    while(slot->state != GEN_BLOCK_DONE || slot->index != index)
+      pthread_cond_wait(&gen->changed, &gen->lock);
+    pthread_mutex_unlock(&gen->lock);
+
+    if(!slot->text.empty() &&
+       fwrite(&slot->text[0], 1, slot->text.size(), out) != slot->text.size())
+      failed = true;
+
+    pthread_mutex_lock(&gen->lock);
+    slot->state = GEN_BLOCK_FREE;
+    gen->written++;
+    pthread_cond_broadcast(&gen->changed);
+    pthread_mutex_unlock(&gen->lock);
+  }
+  fprintf(out, "\n");
+
+  for(int t = 0; t < numThreads; t++)
+    pthread_join(threads[t], NULL);
+  delete[] threads;
+  delete[] gen->slots;
+  pthread_mutex_destroy(&gen->lock);
+  pthread_cond_destroy(&gen->changed);
+
+  if(fclose(out) != 0 || failed) {
+    std::cerr << "Could not write file: " << filename << std::endl;
+    exit(1);
+  }
+}
+
+static int parseList(const char* list, double* values, int max) {
+  const char* p = list;
+  char* end;
+  int count = 0;
+
+  while(*p != '\0' && count < max) {
+    values[count++] = strtod(p, &end);
+    if(end == p)
+      return -1;
+    p = end;
+    if(*p == ',' || *p == 'x')
+      p++;
+  }
+
+  return (*p == '\0') ? count : -1;
+}
+
+int main(int argc, char** argv) {
+  GenState gen;
+  const char* symbol = "C";
+  const char* name = NULL;
+  int numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  double values[9];
+  int count;
+
+  for(int i = 0; i < 9; i++)
+    gen.cell[i] = (i % 4 == 0) ? 20.0 : 0.0;
+  gen.sigma = 0.5;
+  gen.numAtoms = 64;
+  gen.uniform = true;
+  gen.dims[0] = gen.dims[1] = gen.dims[2] = 64;
+  gen.pointsPerAtom = 100;
+  gen.offsets = NULL;
+  randomState = 1;
+
+  // parse options...
+  int argNum;
+  for(argNum = 1; argNum < argc && argv[argNum][0] == '-'; argNum++) {
+    if(strcmp(argv[argNum], "-h") == 0) {
+      genUsage();
+      exit(0);
+    }
+    if(argNum + 1 >= argc) {
+      genUsage();
+      exit(1);
+    }
+    if(strcmp(argv[argNum], "-a") == 0)
+      gen.numAtoms = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-c") == 0) {
+      count = parseList(argv[++argNum], values, 9);
+      if(count == 1 || count == 3) {
+	for(int i = 0; i < 9; i++)
+	  gen.cell[i] = 0.0;
+	for(int i = 0; i < 3; i++)
+	  gen.cell[4 * i] = values[(count == 1) ? 0 : i];
+      }
+      else if(count == 9) {
+	for(int i = 0; i < 9; i++)
+	  gen.cell[i] = values[i];
+      }
+      else {
+	std::cerr << "Bad lattice: " << argv[argNum] << "\n\n";
+	genUsage();
+	exit(1);
+      }
+    }
+    else if(strcmp(argv[argNum], "-e") == 0)
+      symbol = argv[++argNum];
+    else if(strcmp(argv[argNum], "-g") == 0) {
+      count = parseList(argv[++argNum], values, 3);
+      if(count != 1 && count != 3) {
+	std::cerr << "Bad grid size: " << argv[argNum] << "\n\n";
+	genUsage();
+	exit(1);
+      }
+      for(int i = 0; i < 3; i++)
+	gen.dims[i] = (int) values[(count == 1) ? 0 : i];
+    }
+    else if(strcmp(argv[argNum], "-m") == 0) {
+      argNum++;
+      if(strcmp(argv[argNum], "uniform") == 0)
+	gen.uniform = true;
+      else if(strcmp(argv[argNum], "atoms") == 0)
+	gen.uniform = false;
+      else {
+	std::cerr << "Unknown mesh type " << argv[argNum] << "\n\n";
+	genUsage();
+	exit(1);
+      }
+    }
+    else if(strcmp(argv[argNum], "-p") == 0)
+      gen.pointsPerAtom = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-s") == 0)
+      randomState = strtoull(argv[++argNum], NULL, 10);
+    else if(strcmp(argv[argNum], "-t") == 0)
+      numThreads = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-w") == 0)
+      gen.sigma = atof(argv[++argNum]);
+    else {
+      std::cerr << "Unknown option " << argv[argNum] << "\n\n";
+      genUsage();
+      exit(1);
+    }
+  }
+  if(argNum != argc - 1) {
+    genUsage();
+    exit(1);
+  }
+  name = argv[argNum];
+
+  if(gen.numAtoms < 1 || gen.pointsPerAtom < 1 || gen.sigma <= 0.0 ||
+     gen.dims[0] < 2 || gen.dims[1] < 2 || gen.dims[2] < 2) {
+    std::cerr << "The atoms, points, width and grid must all be more than";
+    std::cerr << " nothing.\n";
+    exit(1);
+  }
+  if(numThreads < 1)
+    numThreads = 1;
+
+  // a bad seed would give nothing but zeros...
+  if(randomState == 0)
+    randomState = 1;
+
+  // the element only matters for the xyz file, pvs knows these...
+  bool known = false;
+  for(unsigned int i = 0; i < sizeof(elements) / sizeof(elements[0]); i++)
+    known = known || (strcmp(symbol, elements[i]) == 0);
+  if(!known)
+    std::cerr << "Warning: pvs may not know the element " << symbol << ".\n";
+
+  invert(gen.cell, gen.inverse);
+  gen.cutoff = GEN_CUTOFF * gen.sigma;
+  placeAtoms(&gen);
+  binAtoms(&gen);
+  if(!gen.uniform)
+    makeOffsets(&gen);
+
+  std::string xyzName = std::string(name) + ".xyz";
+  std::string rhoName = std::string(name) + ".rho";
+  writeXYZ(&gen, xyzName.c_str(), symbol);
+
+  double start = now();
+  writeRho(&gen, rhoName.c_str(), numThreads);
+  double elapsed = now() - start;
+
+  FILE* check = fopen(rhoName.c_str(), "r");
+  fseek(check, 0, SEEK_END);
+  double megabytes = ftell(check) / (1024.0 * 1024.0);
+  fclose(check);
+
+  std::cout << "Wrote " << rhoName << " (" << megabytes << " MB) and ";
+  std::cout << xyzName << " in " << elapsed << " s with " << numThreads;
+  std::cout << " threads, " << (megabytes / elapsed) << " MB/s\n";
+
+  delete[] gen.atoms;
+  delete[] gen.fractions;
+  if(gen.offsets)
+    delete[] gen.offsets;
+
+  return 0;
+}
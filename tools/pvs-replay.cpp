@@ -0,0 +1,632 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// a stand-in for a running simulation: replays uniform rho files (or made
+// up frames of any size) to pvs, either down a socket to pvs -R or through
+// a shared memory ring to pvs --shm, round and round at a given frame rate,
+// and reports how fast it's getting them out...
+
+// system includes...
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+// plato includes...
+#include "main.h"
+#include "PlatoDataStream.h"
+#include "PlatoShmRing.h"
+
+// the number of frames made up for a synthetic grid...
+#define REPLAY_SYNTHETIC_FRAMES 16
+
+struct ReplayFrame {
+  PlatoStreamHeader header;
+  float* values;
+};
+
+// what pvs has been sent so far, for working out deltas against...
+struct ReplayDelta {
+  float threshold;
+  float quantum;
+  int keyframes;
+  float* sent;
+  std::vector<char> message;
+};
+
+static double now() {
+  struct timeval t;
+  gettimeofday(&t, NULL);
+
+  return t.tv_sec + (t.tv_usec / 1000000.0);
+}
+
+static void replayUsage() {
+  using std::cout;
+
+  cout << "Usage: pvs-replay [options] RHOFILE [RHOFILE...]\n";
+  cout << "       pvs-replay [options] -g N\nOptions:\n";
+  cout << "  -g N\t\t\tSend made up frames on an NxNxN grid instead of";
+  cout << " files.\n";
+  cout << "  -H HOST\t\tThe host pvs is running on (default 127.0.0.1).\n";
+  cout << "  -p PORT\t\tThe port pvs is listening on (default ";
+  cout << PVS_STREAM_PORT << ").\n";
+  cout << "  -s NAME\t\tWrite to the shared memory ring NAME (eg /pvs)";
+  cout << " instead\n\t\t\tof a socket. It is left in place for the next";
+  cout << " run.\n";
+  cout << "  -S SLOTS\t\tThe number of slots in a new ring (default 4).\n";
+  cout << "  -r FPS\t\tFrames per second to send, 0 for as fast as";
+  cout << " possible\n\t\t\t(default 10).\n";
+  cout << "  -n N\t\t\tStop after N frames (default: never).\n";
+  cout << "  -d THRESHOLD\t\tAfter the first frame only send the bricks";
+  cout << " where a\n\t\t\tvalue has changed by more than THRESHOLD";
+  cout << " (socket only).\n";
+  cout << "  -q QUANTUM\t\tSend deltas as shorts in steps of QUANTUM.\n";
+  cout << "  -k N\t\t\tSend a full frame every N frames when sending";
+  cout << " deltas.\n";
+}
+
+static void readFrame(char* filename, ReplayFrame* frame) {
+  int meshType;
+  int numPoints;
+
+  // a full frame has everything else zero...
+  memset(&frame->header, 0, sizeof(PlatoStreamHeader));
+
+  std::ifstream fin(filename);
+  if(!fin) {
+    std::cerr << "Could not open file: " << filename << std::endl;
+    exit(1);
+  }
+
+  // same layout as PlatoDataReader reads, but only uniform grids can be
+  // streamed. The cell vectors stay in bohr...
+  for(int i = 0; i < 9; i++)
+    fin >> frame->header.cellVectors[i];
+  fin >> meshType;
+  fin >> meshType;
+  if(meshType != 0) {
+    std::cerr << filename << " is not a uniform grid.\n";
+    exit(1);
+  }
+  for(int i = 0; i < 3; i++)
+    fin >> frame->header.dims[i];
+
+  numPoints = frame->header.dims[0] * frame->header.dims[1] *
+    frame->header.dims[2];
+  frame->values = new float[numPoints];
+  for(int i = 0; i < numPoints; i++)
+    fin >> frame->values[i];
+
+  if(!fin) {
+    std::cerr << "Could not read all of " << filename << std::endl;
+    exit(1);
+  }
+  fin.close();
+
+  memcpy(frame->header.magic, "PVSD", 4);
+  frame->header.version = PVS_STREAM_VERSION;
+}
+
+static void makeFrame(int n, int step, ReplayFrame* frame) {
+  double cell = 20.0;
+  double sigma = 0.1;
+  double centre[3];
+  double d, r2;
+  float* v;
+
+  // a blob going round the cell, with the distance taken to its nearest
+  // periodic image so the field wraps properly...
+  double angle = (2.0 * M_PI * step) / REPLAY_SYNTHETIC_FRAMES;
+  centre[0] = 0.5 + (0.25 * cos(angle));
+  centre[1] = 0.5 + (0.25 * sin(angle));
+  centre[2] = 0.5;
+
+  memset(&frame->header, 0, sizeof(PlatoStreamHeader));
+  memcpy(frame->header.magic, "PVSD", 4);
+  frame->header.version = PVS_STREAM_VERSION;
+  for(int i = 0; i < 3; i++)
+    frame->header.dims[i] = n;
+  for(int i = 0; i < 9; i++)
+    frame->header.cellVectors[i] = (i % 4 == 0) ? cell : 0.0;
+
+  frame->values = new float[n * n * n];
+  v = frame->values;
+  for(int k = 0; k < n; k++) {
+    for(int j = 0; j < n; j++) {
+      for(int i = 0; i < n; i++) {
+	r2 = 0.0;
+	int g[3] = {i, j, k};
+	for(int a = 0; a < 3; a++) {
+	  d = ((double) g[a] / n) - centre[a];
+	  d -= floor(d + 0.5);
+	  r2 += d * d;
+	}
+	*v++ = (float) exp(-r2 / (2.0 * sigma * sigma));
+      } // i
+    } // j
+  } // k
+}
+
+static bool sendFully(int s, const void* buffer, long bytes) {
+  const char* next = (const char*) buffer;
+  long sent;
+
+  while(bytes > 0) {
+    sent = send(s, next, bytes, MSG_NOSIGNAL);
+    if(sent < 0 && errno == EINTR)
+      continue;
+    if(sent <= 0)
+      return false;
+
+    next += sent;
+    bytes -= sent;
+  }
+
+  return true;
+}
+
+static long sendDelta(int s, ReplayFrame* frame, ReplayDelta* delta,
+		      long sent) {
+  PlatoStreamHeader header = frame->header;
+  int* dims = header.dims;
+  int brickDims[3];
+  int numBricks = 1;
+  long numValues = (long) dims[0] * dims[1] * dims[2];
+  std::vector<char>& message = delta->message;
+
+  // the first frame (and any key frames) go in full...
+  if(!delta->sent) {
+    delta->sent = new float[numValues];
+  }
+  else if(delta->keyframes == 0 || (sent % delta->keyframes) != 0) {
+    header.encoding = (delta->quantum > 0.0f) ? PVS_STREAM_DELTA_QUANTISED :
+      PVS_STREAM_DELTA;
+    header.quantum = delta->quantum;
+  }
+  if(header.encoding == PVS_STREAM_FULL) {
+    memcpy(delta->sent, frame->values, numValues * sizeof(float));
+    if(!sendFully(s, &header, sizeof(PlatoStreamHeader)) ||
+       !sendFully(s, frame->values, numValues * sizeof(float)))
+      return -1;
+    return sizeof(PlatoStreamHeader) + (numValues * sizeof(float));
+  }
+
+  for(int a = 0; a < 3; a++) {
+    brickDims[a] = (dims[a] + PVS_STREAM_BRICK_SIZE - 1) /
+      PVS_STREAM_BRICK_SIZE;
+    numBricks *= brickDims[a];
+  }
+
+  // a brick goes if anything in it has moved far enough. The change is
+  // made to our copy exactly as pvs will make it so the two never drift
+  // apart...
+  int low[3];
+  int size[3];
+  long row;
+  float change;
+  short step;
+  bool changed;
+  message.clear();
+  for(int b = 0; b < numBricks; b++) {
+    low[0] = (b % brickDims[0]) * PVS_STREAM_BRICK_SIZE;
+    low[1] = ((b / brickDims[0]) % brickDims[1]) * PVS_STREAM_BRICK_SIZE;
+    low[2] = (b / (brickDims[0] * brickDims[1])) * PVS_STREAM_BRICK_SIZE;
+    for(int a = 0; a < 3; a++) {
+      size[a] = dims[a] - low[a];
+      if(size[a] > PVS_STREAM_BRICK_SIZE)
+	size[a] = PVS_STREAM_BRICK_SIZE;
+    }
+
+    changed = false;
+    for(int k = 0; k < size[2] && !changed; k++) {
+      for(int j = 0; j < size[1] && !changed; j++) {
+	row = low[0] + (dims[0] * ((low[1] + j) + (dims[1] * (low[2] + k))));
+	for(int i = 0; i < size[0]; i++) {
+	  change = fabs(frame->values[row + i] - delta->sent[row + i]);
+	  if(change > delta->threshold ||
+	     (delta->threshold == 0.0f && change != 0.0f))
+	    changed = true;
+	} // i
+      } // j
+    } // k
+    if(!changed)
+      continue;
+
+    message.insert(message.end(), (char*) &b, (char*) &b + sizeof(int));
+    for(int k = 0; k < size[2]; k++) {
+      for(int j = 0; j < size[1]; j++) {
+	row = low[0] + (dims[0] * ((low[1] + j) + (dims[1] * (low[2] + k))));
+	for(int i = 0; i < size[0]; i++) {
+	  change = frame->values[row + i] - delta->sent[row + i];
+	  if(delta->quantum > 0.0f) {
+	    double q = floor((change / delta->quantum) + 0.5);
+	    if(q > 32767.0)
+	      q = 32767.0;
+	    if(q < -32767.0)
+	      q = -32767.0;
+	    step = (short) q;
+	    message.insert(message.end(), (char*) &step,
+			   (char*) &step + sizeof(short));
+	    delta->sent[row + i] += (float) step * delta->quantum;
+	  }
+	  else {
+	    message.insert(message.end(), (char*) &change,
+			   (char*) &change + sizeof(float));
+	    delta->sent[row + i] += change;
+	  }
+	} // i
+      } // j
+    } // k
+    header.numBricks++;
+  }
+
+  if(!sendFully(s, &header, sizeof(PlatoStreamHeader)) ||
+     (!message.empty() && !sendFully(s, &message[0], message.size())))
+    return -1;
+
+  return sizeof(PlatoStreamHeader) + message.size();
+}
+
+static int connectStream(const char* host, int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if(inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+    std::cerr << "Bad host address: " << host << std::endl;
+    exit(1);
+  }
+
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  if(s < 0 || connect(s, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    std::cerr << "Could not connect to " << host << ":" << port << ": ";
+    std::cerr << strerror(errno) << std::endl;
+    exit(1);
+  }
+
+  return s;
+}
+
+static long roundToPage(long bytes) {
+  long page = sysconf(_SC_PAGESIZE);
+
+  return ((bytes + page - 1) / page) * page;
+}
+
+static PlatoShmSlot* getSlot(PlatoShmHeader* ring, int slot) {
+  return (PlatoShmSlot*) ((char*) ring + ring->dataOffset +
+			  (slot * ring->slotBytes));
+}
+
+static PlatoShmHeader* openRing(const char* name, int slots,
+				PlatoStreamHeader* first) {
+  int magic;
+  int fd;
+  void* map;
+  struct stat info;
+  long valuesOffset = roundToPage(sizeof(PlatoShmSlot));
+  long slotBytes = valuesOffset + roundToPage(sizeof(float) * first->dims[0] *
+					      first->dims[1] *
+					      first->dims[2]);
+  long dataOffset = roundToPage(sizeof(PlatoShmHeader));
+  long size = dataOffset + (slots * slotBytes);
+
+  memcpy(&magic, "PVSR", 4);
+
+  // carry on with an old ring if it's the same shape, pvs may still have
+  // it mapped...
+  fd = shm_open(name, O_RDWR, 0);
+  if(fd >= 0) {
+    if(fstat(fd, &info) == 0 && info.st_size == size) {
+      map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      PlatoShmHeader* ring = (PlatoShmHeader*) map;
+      if(map != MAP_FAILED && memcmp(ring->magic, &magic, 4) == 0 &&
+	 ring->version == PVS_SHM_VERSION && ring->numSlots == slots &&
+	 memcmp(ring->dims, first->dims, sizeof(int) * 3) == 0) {
+	close(fd);
+	return ring;
+      }
+      if(map != MAP_FAILED)
+	munmap(map, size);
+    }
+    close(fd);
+    shm_unlink(name);
+  }
+
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if(fd < 0 || ftruncate(fd, size) < 0) {
+    std::cerr << "Could not make shared memory " << name << ": ";
+    std::cerr << strerror(errno) << std::endl;
+    exit(1);
+  }
+  map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED) {
+    std::cerr << "Could not map shared memory " << name << ": ";
+    std::cerr << strerror(errno) << std::endl;
+    exit(1);
+  }
+  close(fd);
+
+  // a new segment is all zeroes, fill in the header and then the magic so
+  // pvs knows it's ready...
+  PlatoShmHeader* ring = (PlatoShmHeader*) map;
+  ring->version = PVS_SHM_VERSION;
+  ring->numSlots = slots;
+  memcpy(ring->dims, first->dims, sizeof(int) * 3);
+  memcpy(ring->cellVectors, first->cellVectors, sizeof(double) * 9);
+  ring->dataOffset = dataOffset;
+  ring->slotBytes = slotBytes;
+  ring->valuesOffset = valuesOffset;
+  sem_init(&ring->wake, 1, 0);
+  ring->heldSlot = -1;
+  __atomic_store_n((int*) ring->magic, magic, __ATOMIC_RELEASE);
+
+  return ring;
+}
+
+static void publishFrame(PlatoShmHeader* ring, ReplayFrame* frame,
+			 long frameBytes) {
+  unsigned long published = ring->published;
+  int latest = published ? ring->latestSlot : -1;
+  unsigned long sequence;
+  PlatoShmSlot* slot;
+  int s;
+
+  // any slot but the newest and the one pvs is holding...
+  for(int i = 1; ; i++) {
+    s = (latest + i + ring->numSlots) % ring->numSlots;
+    if(s == latest ||
+       s == __atomic_load_n(&ring->heldSlot, __ATOMIC_SEQ_CST))
+      continue;
+
+    // claim it, then make sure pvs didn't take hold of it meanwhile...
+    slot = getSlot(ring, s);
+    sequence = slot->sequence;
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&ring->heldSlot, __ATOMIC_SEQ_CST) != s)
+      break;
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+  }
+
+  memcpy((char*) slot + ring->valuesOffset, frame->values, frameBytes);
+  slot->frame = frame->header.frame;
+  slot->publishTime = now() * 1000.0;
+  __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+
+  __atomic_store_n(&ring->latestSlot, s, __ATOMIC_RELEASE);
+  __atomic_store_n(&ring->published, published + 1, __ATOMIC_RELEASE);
+
+  // one wake up is enough however many frames it's behind...
+  int waiting;
+  sem_getvalue(&ring->wake, &waiting);
+  if(waiting <= 0)
+    sem_post(&ring->wake);
+}
+
+int main(int argc, char** argv) {
+  const char* host = "127.0.0.1";
+  const char* shmName = NULL;
+  int port = PVS_STREAM_PORT;
+  int slots = 4;
+  int synthetic = 0;
+  bool deltas = false;
+  ReplayDelta delta;
+  double rate = 10.0;
+  long maxFrames = 0;
+  std::vector<ReplayFrame> frames;
+
+  delta.threshold = 0.0f;
+  delta.quantum = 0.0f;
+  delta.keyframes = 0;
+  delta.sent = NULL;
+
+  // parse options...
+  int argNum;
+  for(argNum = 1; argNum < argc && argv[argNum][0] == '-'; argNum++) {
+    if(strcmp(argv[argNum], "-h") == 0) {
+      replayUsage();
+      exit(0);
+    }
+    if(argNum + 1 >= argc) {
+      replayUsage();
+      exit(1);
+    }
+    if(strcmp(argv[argNum], "-g") == 0)
+      synthetic = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-H") == 0)
+      host = argv[++argNum];
+    else if(strcmp(argv[argNum], "-p") == 0)
+      port = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-s") == 0)
+      shmName = argv[++argNum];
+    else if(strcmp(argv[argNum], "-S") == 0)
+      slots = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-r") == 0)
+      rate = atof(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-n") == 0)
+      maxFrames = atol(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-d") == 0) {
+      deltas = true;
+      delta.threshold = atof(argv[++argNum]);
+    }
+    else if(strcmp(argv[argNum], "-q") == 0)
+      delta.quantum = atof(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-k") == 0)
+      delta.keyframes = atoi(argv[++argNum]);
+    else {
+      std::cerr << "Unknown option " << argv[argNum] << "\n\n";
+      replayUsage();
+      exit(1);
+    }
+  }
+  if((argNum == argc) == (synthetic == 0)) {
+    replayUsage();
+    exit(1);
+  }
+  if(deltas && shmName) {
+    std::cerr << "Deltas can only be sent down a socket.\n";
+    exit(1);
+  }
+  if(slots < 3 || slots > PVS_SHM_MAX_SLOTS) {
+    std::cerr << "A ring needs 3 to " << PVS_SHM_MAX_SLOTS << " slots.\n";
+    exit(1);
+  }
+
+  // make or read everything up front so that doesn't slow the sending
+  // down...
+  if(synthetic) {
+    if(synthetic < 2) {
+      std::cerr << "Bad grid size: " << synthetic << std::endl;
+      exit(1);
+    }
+    for(int i = 0; i < REPLAY_SYNTHETIC_FRAMES; i++) {
+      ReplayFrame frame;
+      makeFrame(synthetic, i, &frame);
+      frames.push_back(frame);
+    }
+  }
+  for(; argNum < argc; argNum++) {
+    ReplayFrame frame;
+    readFrame(argv[argNum], &frame);
+    if(!frames.empty() &&
+       memcmp(frame.header.dims, frames[0].header.dims, sizeof(int) * 3)) {
+      std::cerr << argv[argNum] << " has a different grid size.\n";
+      exit(1);
+    }
+    frames.push_back(frame);
+  }
+
+  // connect to pvs...
+  int s = -1;
+  PlatoShmHeader* ring = NULL;
+  if(shmName)
+    ring = openRing(shmName, slots, &frames[0].header);
+  else
+    s = connectStream(host, port);
+
+  long frameBytes = sizeof(float) * frames[0].header.dims[0] *
+    frames[0].header.dims[1] * frames[0].header.dims[2];
+  double start = now();
+  double next = start;
+  double lastReport = start;
+  double writing = 0.0;
+  double t;
+  long lastSent = 0;
+  long sent;
+  long bytes = 0;
+  long lastBytes = 0;
+  long frameSent;
+
+  // send frames on a fixed schedule, if we fall behind don't try to catch
+  // up with a burst...
+  for(sent = 0; maxFrames == 0 || sent < maxFrames; sent++) {
+    ReplayFrame* frame = &frames[sent % frames.size()];
+    frame->header.frame = (int) sent;
+
+    t = now();
+    if(ring) {
+      publishFrame(ring, frame, frameBytes);
+      frameSent = frameBytes;
+    }
+    else if(deltas) {
+      frameSent = sendDelta(s, frame, &delta, sent);
+    }
+    else {
+      frameSent = sizeof(PlatoStreamHeader) + frameBytes;
+      if(!sendFully(s, &frame->header, sizeof(PlatoStreamHeader)) ||
+	 !sendFully(s, frame->values, frameBytes))
+	frameSent = -1;
+    }
+    if(frameSent < 0) {
+      std::cerr << "Connection closed by pvs.\n";
+      break;
+    }
+    writing += now() - t;
+    bytes += frameSent;
+
+    if(rate > 0.0) {
+      next += 1.0 / rate;
+      double wait = next - now();
+      if(wait > 0.0) {
+	struct timespec ts;
+	ts.tv_sec = (time_t) wait;
+	ts.tv_nsec = (long) ((wait - ts.tv_sec) * 1.0e9);
+	nanosleep(&ts, NULL);
+      }
+      else {
+	next = now();
+      }
+    }
+
+    t = now();
+    if(t - lastReport >= 1.0) {
+      double fps = (sent + 1 - lastSent) / (t - lastReport);
+      printf("%8ld frames  %8.1f frames/s  %8.1f MB/s\n", sent + 1, fps,
+	     (bytes - lastBytes) / (t - lastReport) / 1.0e6);
+      fflush(stdout);
+      lastReport = t;
+      lastSent = sent + 1;
+      lastBytes = bytes;
+    }
+  }
+
+  double elapsed = now() - start;
+  if(sent > 0 && elapsed > 0.0) {
+    printf("Sent %ld frames in %.2fs: %.1f frames/s, %.1f MB/s, %.3f ms to",
+	   sent, elapsed, sent / elapsed, bytes / elapsed / 1.0e6,
+	   1000.0 * writing / sent);
+    printf(" write each, %.1f%% of full frames\n",
+	   (100.0 * bytes) / (sent * (sizeof(PlatoStreamHeader) + frameBytes)));
+  }
+
+  if(s >= 0)
+    close(s);
+  for(unsigned int i = 0; i < frames.size(); i++)
+    delete[] frames[i].values;
+  delete[] delta.sent;
+
+  return 0;
+}
@@ -0,0 +1,281 @@
+/*----------------------------------------------------------------------------
+  This file is part of the Plato Visualization System.
+
+  (C) Copyright 2005, University of Manchester, United Kingdom,
+  all rights reserved.
+
+  This software was developed by the RealityGrid project
+  (http://www.realitygrid.org), funded by the EPSRC under grants
+  GR/R67699/01 and GR/R67699/02.
+
+  LICENCE TERMS
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS MATERIAL IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. THE ENTIRE RISK AS TO THE QUALITY
+  AND PERFORMANCE OF THE PROGRAM IS WITH YOU.  SHOULD THE PROGRAM PROVE
+  DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR
+  CORRECTION.
+
+  Author........: Robert Haines
+---------------------------------------------------------------------------*/
+
+// a reference thin client for pvs --publish: takes the compressed frames,
+// puts them back together and reports the bandwidth and the latency from
+// render to arrival (only meaningful on the same host). Frames can be
+// recorded as PPM files, or the latest kept in one file for an image
+// viewer to watch...
+
+// system includes...
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+// plato includes...
+#include "main.h"
+#include "PlatoFrameServer.h"
+
+static double nowMillis() {
+  struct timeval t;
+  gettimeofday(&t, NULL);
+
+  return (t.tv_sec * 1000.0) + (t.tv_usec / 1000.0);
+}
+
+static void viewUsage() {
+  using std::cout;
+
+  cout << "Usage: pvs-view [options]\nOptions:\n";
+  cout << "  -H HOST\t\tThe host pvs is running on (default 127.0.0.1).\n";
+  cout << "  -p PORT\t\tThe port pvs is publishing on (default ";
+  cout << PVS_FRAME_PORT << ").\n";
+  cout << "  -n N\t\t\tStop after N frames (default: never).\n";
+  cout << "  -o PATTERN\t\tRecord every frame, eg frame%04d.ppm.\n";
+  cout << "  -l FILE\t\tKeep the latest frame in FILE.\n";
+}
+
+static bool readFully(int s, void* buffer, long bytes) {
+  char* next = (char*) buffer;
+  long got;
+
+  while(bytes > 0) {
+    got = recv(s, next, bytes, 0);
+    if(got < 0 && errno == EINTR)
+      continue;
+    if(got <= 0)
+      return false;
+    next += got;
+    bytes -= got;
+  }
+
+  return true;
+}
+
+static void writePPM(const char* filename, unsigned char* pixels, int width,
+		     int height) {
+  FILE* out = fopen(filename, "wb");
+  if(!out) {
+    std::cerr << "Could not write " << filename << std::endl;
+    exit(1);
+  }
+
+  // the frames come bottom row first...
+  fprintf(out, "P6\n%d %d\n255\n", width, height);
+  for(int row = height - 1; row >= 0; row--)
+    fwrite(pixels + (row * width * 3), 1, width * 3, out);
+  fclose(out);
+}
+
+static int connectServer(const char* host, int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if(inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+    std::cerr << "Bad host address: " << host << std::endl;
+    exit(1);
+  }
+
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  if(s < 0 || connect(s, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    std::cerr << "Could not connect to " << host << ":" << port << ": ";
+    std::cerr << strerror(errno) << std::endl;
+    exit(1);
+  }
+
+  return s;
+}
+
+int main(int argc, char** argv) {
+  const char* host = "127.0.0.1";
+  const char* pattern = NULL;
+  const char* latest = NULL;
+  int port = PVS_FRAME_PORT;
+  long maxFrames = 0;
+
+  // parse options...
+  for(int argNum = 1; argNum < argc; argNum++) {
+    if(strcmp(argv[argNum], "-h") == 0) {
+      viewUsage();
+      exit(0);
+    }
+    if(argNum + 1 >= argc) {
+      viewUsage();
+      exit(1);
+    }
+    if(strcmp(argv[argNum], "-H") == 0)
+      host = argv[++argNum];
+    else if(strcmp(argv[argNum], "-p") == 0)
+      port = atoi(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-n") == 0)
+      maxFrames = atol(argv[++argNum]);
+    else if(strcmp(argv[argNum], "-o") == 0)
+      pattern = argv[++argNum];
+    else if(strcmp(argv[argNum], "-l") == 0)
+      latest = argv[++argNum];
+    else {
+      std::cerr << "Unknown option " << argv[argNum] << "\n\n";
+      viewUsage();
+      exit(1);
+    }
+  }
+
+  int s = connectServer(host, port);
+
+  PlatoFrameHeader header;
+  PlatoFrameTile tile;
+  std::vector<unsigned char> image;
+  std::vector<unsigned char> packed;
+  std::vector<unsigned char> pixels;
+  std::vector<double> latencies;
+  unsigned long unpacked;
+  int width = 0;
+  int height = 0;
+  int lastFrame = 0;
+  long numFrames = 0;
+  long numDropped = 0;
+  double bytes = 0.0;
+  double rawBytes = 0.0;
+  double start = 0.0;
+  double finish = 0.0;
+  double reportTime = 0.0;
+  long reportFrames = 0;
+  double reportBytes = 0.0;
+  char name[1024];
+
+  while(maxFrames == 0 || numFrames < maxFrames) {
+    if(!readFully(s, &header, sizeof(header)))
+      break;
+    if(memcmp(header.magic, "PVSF", 4) != 0 ||
+       header.version != PVS_FRAME_VERSION) {
+      std::cerr << "Not a pvs frame stream (version " << PVS_FRAME_VERSION;
+      std::cerr << ").\n";
+      exit(1);
+    }
+
+    // a new size always comes with every tile...
+    if(header.width != width || header.height != height) {
+      width = header.width;
+      height = header.height;
+      image.assign((size_t) width * height * 3, 0);
+    }
+
+    bytes += sizeof(header);
+    for(int t = 0; t < header.numTiles; t++) {
+      if(!readFully(s, &tile, sizeof(tile)))
+	exit(1);
+      packed.resize(tile.bytes);
+      pixels.resize(tile.width * tile.height * 3);
+      if(!readFully(s, &packed[0], tile.bytes))
+	exit(1);
+      unpacked = pixels.size();
+      if(uncompress(&pixels[0], &unpacked, &packed[0], tile.bytes) != Z_OK ||
+	 tile.x + tile.width > width || tile.y + tile.height > height) {
+	std::cerr << "Bad tile in frame " << header.frame << std::endl;
+	exit(1);
+      }
+      for(int row = 0; row < tile.height; row++) {
+	memcpy(&image[(((tile.y + row) * width) + tile.x) * 3],
+	       &pixels[row * tile.width * 3], tile.width * 3);
+      }
+      bytes += sizeof(tile) + tile.bytes;
+      reportBytes += sizeof(tile) + tile.bytes;
+    }
+    latencies.push_back(nowMillis() - header.publishTime);
+
+    // the rate is timed from the first frame to the last, pvs may not
+    // draw anything for a while either side of them...
+    finish = nowMillis();
+    if(numFrames == 0) {
+      start = finish;
+      reportTime = start;
+    }
+
+    if(numFrames > 0 && header.frame > lastFrame + 1)
+      numDropped += header.frame - lastFrame - 1;
+    lastFrame = header.frame;
+    rawBytes += (double) width * height * 3;
+    numFrames++;
+    reportFrames++;
+
+    if(pattern) {
+      snprintf(name, sizeof(name), pattern, header.frame);
+      writePPM(name, &image[0], width, height);
+    }
+    if(latest) {
+      // written to the side and moved so a viewer never sees half a frame...
+      snprintf(name, sizeof(name), "%s.tmp", latest);
+      writePPM(name, &image[0], width, height);
+      rename(name, latest);
+    }
+
+    if(nowMillis() - reportTime >= 1000.0) {
+      double elapsed = (nowMillis() - reportTime) / 1000.0;
+      std::cout << reportFrames / elapsed << " frames/s, ";
+      std::cout << reportBytes / (elapsed * 1024.0 * 1024.0) << " MB/s, ";
+      std::cout << "latency " << latencies.back() << " ms\n";
+      reportTime = nowMillis();
+      reportFrames = 0;
+      reportBytes = 0.0;
+    }
+  }
+  close(s);
+
+  if(numFrames == 0)
+    return 0;
+
+  double elapsed = (finish - start) / 1000.0;
+  if(elapsed <= 0.0)
+    elapsed = 0.001;
+  std::sort(latencies.begin(), latencies.end());
+  std::cout << "Got " << numFrames << " frames (" << numDropped;
+  std::cout << " dropped by pvs) in " << elapsed << " s: ";
+  std::cout << numFrames / elapsed << " frames/s, ";
+  std::cout << bytes / (elapsed * 1024.0 * 1024.0) << " MB/s, ";
+  std::cout << (100.0 * bytes) / rawBytes << "% of raw\n";
+  std::cout << "Render to arrival latency: median ";
+  std::cout << latencies[latencies.size() / 2] << " ms, p99 ";
+  std::cout << latencies[(latencies.size() * 99) / 100] << " ms\n";
+
+  return 0;
+}